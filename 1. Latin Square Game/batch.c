@@ -0,0 +1,689 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime, opendir, stat, access and pwrite
+
+#include "batch.h"
+#include "console.h"
+#include "corpus.h"
+#include "lanes.h"
+#include "solver.h"
+#include "threadpool.h"
+#include "timing.h"
+#include "verify.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILES_PER_THREAD 4 // Files in flight per worker, bounds the memory in use
+#define CHUNK_RECORDS 256  // Corpus records handed to the pool at once
+#define GROUP_FILES 32     // Files to validate or solve handed to the pool at once, so their squares share the lanes
+
+/**
+ * @brief Represents the state of a batch run shared by the workers.
+ */
+typedef struct batch
+{
+    POOL *pool;             /**< The pool processing the files */
+    BATCH_MODE mode;        /**< What is done with every square */
+    uint16_t *buffers;      /**< Per-worker values and scratch of the verification, NULL otherwise */
+    int window;             /**< Maximum number of files (or runs of records) in flight */
+    int inFlight;           /**< Files submitted but not finished */
+    int processed;          /**< Squares finished */
+    int failures;           /**< Squares rejected, unsolvable or not saved */
+    pthread_mutex_t lock;   /**< Protects the counters and the standard output */
+    pthread_cond_t slot;    /**< Signalled when a file is finished */
+    struct source *sources; /**< Corpus files opened, released at the end */
+    struct group *group;    /**< Files waiting to be handed to the pool together, NULL if none */
+} BATCH;
+
+/**
+ * @brief Represents a corpus file whose records are processed by the pool.
+ */
+typedef struct source
+{
+    CORPUS corpus;       /**< The mapped corpus */
+    int output;          /**< Descriptor of the out- corpus receiving the solutions, -1 if none */
+    struct source *next; /**< Next corpus opened */
+    char path[];         /**< The name of the corpus file */
+} SOURCE;
+
+/**
+ * @brief Represents a run of corpus records handed to the pool.
+ */
+typedef struct chunk
+{
+    BATCH *batch;   /**< The batch the records belong to */
+    SOURCE *source; /**< The corpus holding them */
+    uint64_t first; /**< Index of the first record */
+    int count;      /**< Number of records */
+} CHUNK;
+
+/**
+ * @brief Represents one file handed to the pool to be verified.
+ */
+typedef struct item
+{
+    BATCH *batch; /**< The batch the file belongs to */
+    char path[];  /**< The name of the file */
+} ITEM;
+
+/**
+ * @brief Represents files handed to the pool together to be validated or solved.
+ */
+typedef struct group
+{
+    BATCH *batch;             /**< The batch the files belong to */
+    int count;                /**< Number of files */
+    char *paths[GROUP_FILES]; /**< The names of the files */
+} GROUP;
+
+/**
+ * @brief Prints the result lines of a task and counts its squares, then frees its place in the window.
+ *
+ * @param batch The batch.
+ * @param lines The result lines.
+ * @param length The length of the lines.
+ * @param squares The number of squares processed by the task.
+ * @param failures The number of squares that failed.
+ */
+static void reportResults(BATCH *batch, const char *lines, size_t length, int squares, int failures)
+{
+    pthread_mutex_lock(&batch->lock);
+    fwrite(lines, 1, length, stdout);
+    batch->processed += squares;
+    batch->failures += failures;
+    batch->inFlight--;
+    pthread_cond_signal(&batch->slot);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+/**
+ * @brief Completes the games that were loaded, those of one order together.
+ *
+ * Every game solved together is charged the average time of its run of solveLanes().
+ *
+ * @param games The games.
+ * @param statuses The load status of each game; only the games loaded are solved.
+ * @param count The number of games.
+ * @param solved Receives whether each game was completed.
+ * @param times The time spent on each game so far, in seconds; the solving time is added.
+ */
+static void solveGames(GAME games[], const LOAD_STATUS statuses[], int count, bool solved[], double times[])
+{
+    GAME **run = (GAME **)allocOrExit(count * sizeof(GAME *));
+    int *index = (int *)allocOrExit(count * sizeof(int));
+    bool *results = (bool *)allocOrExit(count * sizeof(bool));
+    bool *taken = (bool *)allocOrExit(count * sizeof(bool));
+    for (int k = 0; k < count; k++)
+    {
+        solved[k] = false;
+        taken[k] = false;
+    }
+    for (int k = 0; k < count; k++)
+    {
+        if (statuses[k] != LOAD_OK || taken[k])
+        {
+            continue;
+        }
+
+        // The games of the order of game k that are left
+        int length = 0;
+        for (int m = k; m < count; m++)
+        {
+            if (statuses[m] == LOAD_OK && !taken[m] && games[m].size == games[k].size)
+            {
+                taken[m] = true;
+                index[length] = m;
+                run[length++] = &games[m];
+            }
+        }
+
+        double start = now();
+        solveLanes(run, length, results);
+        double each = (now() - start) / length;
+        for (int b = 0; b < length; b++)
+        {
+            solved[index[b]] = results[b];
+            times[index[b]] += each;
+        }
+    }
+    free(taken);
+    free(results);
+    free(index);
+    free(run);
+}
+
+/**
+ * @brief Task function of the pool: validates or solves a group of files and prints their result lines.
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task.
+ * @param arg The GROUP to process. It is released here.
+ */
+static void processFiles(POOL *pool, int worker, void *arg)
+{
+    GROUP *group = (GROUP *)arg;
+    BATCH *batch = group->batch;
+    GAME games[GROUP_FILES];
+    LOAD_STATUS statuses[GROUP_FILES];
+    bool solved[GROUP_FILES];
+    double times[GROUP_FILES];
+
+    for (int k = 0; k < group->count; k++)
+    {
+        double start = now();
+        statuses[k] = loadLatinSquare(&games[k], group->paths[k]);
+        times[k] = now() - start;
+    }
+    if (batch->mode == BATCH_SOLVE)
+    {
+        solveGames(games, statuses, group->count, solved, times);
+    }
+
+    size_t lineBytes = MAX_PATH + 64;
+    char *lines = (char *)allocOrExit(group->count * lineBytes);
+    size_t used = 0;
+    int failures = 0;
+    for (int k = 0; k < group->count; k++)
+    {
+        double start = now();
+        const char *result;
+        bool failed = false;
+        if (statuses[k] != LOAD_OK)
+        {
+            result = loadStatusName(statuses[k]);
+            failed = true;
+        }
+        else
+        {
+            if (batch->mode == BATCH_VALIDATE)
+            {
+                result = isComplete(&games[k]) ? "complete" : "partial";
+            }
+            else if (!solved[k])
+            {
+                result = "unsolvable";
+                failed = true;
+            }
+            else
+            {
+                char outputFile[MAX_PATH];
+                outputFileName(group->paths[k], outputFile, sizeof(outputFile));
+                failed = !saveLatinSquare(&games[k], outputFile);
+                result = failed ? "unwritable" : "solved";
+            }
+            freeGame(&games[k]);
+        }
+        failures += failed;
+        int length = snprintf(lines + used, lineBytes, "%s %.3f %s\n", result, (times[k] + now() - start) * 1000,
+                              group->paths[k]);
+        used += length < (int)lineBytes ? (size_t)length : lineBytes - 1;
+        free(group->paths[k]);
+    }
+
+    reportResults(batch, lines, used, group->count, failures);
+    free(lines);
+    free(group);
+}
+
+/**
+ * @brief Task function of the pool: validates or solves a run of corpus records.
+ *
+ * The result lines of the run are gathered in one buffer and printed together. Solutions are
+ * written in place into the out- corpus, at the offset of their record. The records of the run
+ * are solved together by solveLanes().
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task.
+ * @param arg The CHUNK to process. It is released here.
+ */
+static void processChunk(POOL *pool, int worker, void *arg)
+{
+    CHUNK *chunk = (CHUNK *)arg;
+    BATCH *batch = chunk->batch;
+    const CORPUS *corpus = &chunk->source->corpus;
+    size_t lineBytes = strlen(chunk->source->path) + 64;
+    char *lines = (char *)allocOrExit(chunk->count * lineBytes);
+    uint8_t *record = (uint8_t *)allocOrExit(corpus->recordBytes);
+    size_t used = 0;
+    int failures = 0;
+
+    GAME *games = (GAME *)allocOrExit(chunk->count * sizeof(GAME));
+    LOAD_STATUS *statuses = (LOAD_STATUS *)allocOrExit(chunk->count * sizeof(LOAD_STATUS));
+    bool *solved = (bool *)allocOrExit(chunk->count * sizeof(bool));
+    double *times = (double *)allocOrExit(chunk->count * sizeof(double));
+    for (int b = 0; b < chunk->count; b++)
+    {
+        double start = now();
+        initGameOrExit(&games[b], corpus->size);
+        statuses[b] = decodeRecord(&games[b], corpusRecord(corpus, chunk->first + b), corpus->valueBits);
+        times[b] = now() - start;
+    }
+    if (batch->mode == BATCH_SOLVE)
+    {
+        solveGames(games, statuses, chunk->count, solved, times);
+    }
+
+    for (int b = 0; b < chunk->count; b++)
+    {
+        uint64_t k = chunk->first + b;
+        double start = now();
+        const char *result;
+        bool failed = false;
+        if (statuses[b] != LOAD_OK)
+        {
+            result = loadStatusName(statuses[b]);
+            failed = true;
+        }
+        else if (batch->mode == BATCH_VALIDATE)
+        {
+            result = isComplete(&games[b]) ? "complete" : "partial";
+        }
+        else if (!solved[b])
+        {
+            result = "unsolvable";
+            failed = true;
+        }
+        else
+        {
+            encodeRecord(&games[b], record, corpus->valueBits);
+            off_t offset = CORPUS_HEADER_BYTES + (off_t)(k * corpus->recordBytes);
+            failed = pwrite(chunk->source->output, record, corpus->recordBytes, offset) != (ssize_t)corpus->recordBytes;
+            result = failed ? "unwritable" : "solved";
+        }
+        failures += failed;
+        used += snprintf(lines + used, lineBytes, "%s %.3f %s#%llu\n", result, (times[b] + now() - start) * 1000,
+                         chunk->source->path, (unsigned long long)k + 1);
+        freeGame(&games[b]);
+    }
+    free(times);
+    free(solved);
+    free(statuses);
+    free(games);
+
+    reportResults(batch, lines, used, chunk->count, failures);
+    free(record);
+    free(lines);
+    free(chunk);
+}
+
+/**
+ * @brief Task function of the pool: verifies one completed square file.
+ *
+ * Only a file that is not a completed Latin square gets a result line.
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task, whose buffers are used.
+ * @param arg The ITEM to process. It is released here.
+ */
+static void verifyFile(POOL *pool, int worker, void *arg)
+{
+    ITEM *item = (ITEM *)arg;
+    BATCH *batch = item->batch;
+    uint16_t *values = batch->buffers + (size_t)worker * 2 * VERIFY_CELLS;
+    char line[MAX_PATH + 64];
+    int length = 0;
+
+    int size;
+    int index = -1;
+    LOAD_STATUS status = readSquareValues(item->path, values, &size);
+    if (status != LOAD_OK)
+    {
+        length = snprintf(line, sizeof(line), "%s 0 %s\n", loadStatusName(status), item->path);
+    }
+    else
+    {
+        VERIFY_STATUS verdict = verifySquare(values, size, values + VERIFY_CELLS, &index);
+        if (verdict != VERIFY_OK)
+        {
+            length = snprintf(line, sizeof(line), "%s %d %s\n", verifyStatusName(verdict), index + 1, item->path);
+        }
+    }
+
+    reportResults(batch, line, length < (int)sizeof(line) ? (size_t)length : sizeof(line) - 1, 1, length > 0);
+    free(item);
+}
+
+/**
+ * @brief Task function of the pool: verifies a run of corpus records.
+ *
+ * Only the records that are not completed Latin squares get a result line.
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task, whose buffers are used.
+ * @param arg The CHUNK to process. It is released here.
+ */
+static void verifyChunk(POOL *pool, int worker, void *arg)
+{
+    CHUNK *chunk = (CHUNK *)arg;
+    BATCH *batch = chunk->batch;
+    const CORPUS *corpus = &chunk->source->corpus;
+    uint16_t *values = batch->buffers + (size_t)worker * 2 * VERIFY_CELLS;
+    size_t lineBytes = strlen(chunk->source->path) + 64;
+    char *lines = (char *)allocOrExit(chunk->count * lineBytes);
+    size_t used = 0;
+    int failures = 0;
+
+    for (uint64_t k = chunk->first; k < chunk->first + chunk->count; k++)
+    {
+        int index;
+        unpackValues(corpusRecord(corpus, k), corpus->size, corpus->valueBits, values);
+        VERIFY_STATUS verdict = verifySquare(values, corpus->size, values + VERIFY_CELLS, &index);
+        if (verdict != VERIFY_OK)
+        {
+            failures++;
+            used += snprintf(lines + used, lineBytes, "%s %d %s#%llu\n", verifyStatusName(verdict), index + 1,
+                             chunk->source->path, (unsigned long long)k + 1);
+        }
+    }
+
+    reportResults(batch, lines, used, chunk->count, failures);
+    free(lines);
+    free(chunk);
+}
+
+/**
+ * @brief Waits while the window of files in flight is full, then takes a place in it.
+ *
+ * @param batch The batch.
+ */
+static void reserveSlot(BATCH *batch)
+{
+    pthread_mutex_lock(&batch->lock);
+    while (batch->inFlight >= batch->window)
+    {
+        pthread_cond_wait(&batch->slot, &batch->lock);
+    }
+    batch->inFlight++;
+    pthread_mutex_unlock(&batch->lock);
+}
+
+/**
+ * @brief Maps a corpus file and hands its records to the pool in runs of CHUNK_RECORDS.
+ *
+ * When solving, the corpus is first copied to out-<corpus> (keeping its index) and the
+ * solutions overwrite their records in the copy.
+ *
+ * @param batch The batch.
+ * @param path The name of the corpus file.
+ */
+static void submitCorpus(BATCH *batch, const char *path)
+{
+    SOURCE *source = (SOURCE *)allocOrExit(sizeof(SOURCE) + strlen(path) + 1);
+    strcpy(source->path, path);
+    source->output = -1;
+    bool ok = openCorpus(&source->corpus, path);
+    if (!ok)
+    {
+        perror(path);
+        free(source);
+    }
+    else if (batch->mode == BATCH_SOLVE)
+    {
+        char outputFile[MAX_PATH];
+        outputFileName(path, outputFile, sizeof(outputFile));
+        source->output = open(outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        ok = source->output >= 0 &&
+             write(source->output, source->corpus.map, source->corpus.length) == (ssize_t)source->corpus.length;
+        if (!ok)
+        {
+            perror(outputFile);
+            if (source->output >= 0)
+            {
+                close(source->output);
+            }
+            closeCorpus(&source->corpus);
+            free(source);
+        }
+    }
+    if (!ok)
+    {
+        pthread_mutex_lock(&batch->lock);
+        batch->failures++;
+        pthread_mutex_unlock(&batch->lock);
+        return;
+    }
+
+    source->next = batch->sources;
+    batch->sources = source;
+    for (uint64_t first = 0; first < source->corpus.count; first += CHUNK_RECORDS)
+    {
+        reserveSlot(batch);
+        CHUNK *chunk = (CHUNK *)allocOrExit(sizeof(CHUNK));
+        chunk->batch = batch;
+        chunk->source = source;
+        chunk->first = first;
+        chunk->count = source->corpus.count - first < CHUNK_RECORDS ? (int)(source->corpus.count - first) : CHUNK_RECORDS;
+        submitTask(batch->pool, -1, batch->mode == BATCH_VERIFY ? verifyChunk : processChunk, chunk);
+    }
+}
+
+/**
+ * @brief Hands a file to the pool, waiting first while the window of files in flight is full.
+ *
+ * Files to validate or solve are gathered in groups of GROUP_FILES, handed to the pool when
+ * full or by flushGroup(); files to verify are handed one by one.
+ *
+ * @param batch The batch.
+ * @param path The name of the file.
+ */
+static void submitFile(BATCH *batch, const char *path)
+{
+    if (batch->mode == BATCH_VERIFY)
+    {
+        reserveSlot(batch);
+        ITEM *item = (ITEM *)allocOrExit(sizeof(ITEM) + strlen(path) + 1);
+        item->batch = batch;
+        strcpy(item->path, path);
+        submitTask(batch->pool, -1, verifyFile, item);
+        return;
+    }
+
+    if (batch->group == NULL)
+    {
+        reserveSlot(batch);
+        batch->group = (GROUP *)allocOrExit(sizeof(GROUP));
+        batch->group->batch = batch;
+        batch->group->count = 0;
+    }
+    GROUP *group = batch->group;
+    group->paths[group->count] = (char *)allocOrExit(strlen(path) + 1);
+    strcpy(group->paths[group->count++], path);
+    if (group->count == GROUP_FILES)
+    {
+        submitTask(batch->pool, -1, processFiles, group);
+        batch->group = NULL;
+    }
+}
+
+/**
+ * @brief Hands the files gathered so far to the pool, if any.
+ *
+ * @param batch The batch.
+ */
+static void flushGroup(BATCH *batch)
+{
+    if (batch->group != NULL)
+    {
+        submitTask(batch->pool, -1, processFiles, batch->group);
+        batch->group = NULL;
+    }
+}
+
+/**
+ * @brief Tells whether a file name ends with a suffix.
+ *
+ * @param name The file name.
+ * @param suffix The suffix.
+ * @return true if the name ends with the suffix.
+ */
+static bool hasSuffix(const char *name, const char *suffix)
+{
+    size_t length = strlen(name), suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(name + length - suffixLength, suffix) == 0;
+}
+
+/**
+ * @brief Visits every game file below a directory.
+ *
+ * Hidden entries are skipped. Files starting with "out-" (results of this program) are
+ * skipped too, unless results are wanted: then they are visited in place of the files
+ * they were written for, except the journals of unfinished games (see journal.h) and the
+ * temporary files they are rewritten through.
+ *
+ * @param directory The name of the directory.
+ * @param results true to visit the out- files instead of their inputs.
+ * @param visit The function called with every file name.
+ * @param context The argument of the visitor.
+ */
+static void walkDirectory(const char *directory, bool results, FILE_VISITOR visit, void *context)
+{
+    DIR *dir = opendir(directory);
+    if (dir == NULL)
+    {
+        perror(directory);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        bool result = strncmp(entry->d_name, "out-", 4) == 0;
+        if (entry->d_name[0] == '.' || (result && !results))
+        {
+            continue;
+        }
+        if (result && (hasSuffix(entry->d_name, ".journal") || hasSuffix(entry->d_name, ".tmp")))
+        {
+            continue; // Binary move journal, not a result
+        }
+
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        struct stat info;
+        if (stat(path, &info) != 0)
+        {
+            continue;
+        }
+        if (results && !result && S_ISREG(info.st_mode))
+        {
+            char output[MAX_PATH];
+            snprintf(output, sizeof(output), "%s/out-%s", directory, entry->d_name);
+            if (access(output, F_OK) == 0)
+            {
+                continue; // Its result is visited instead
+            }
+        }
+        if (S_ISDIR(info.st_mode))
+        {
+            walkDirectory(path, results, visit, context);
+        }
+        else if (S_ISREG(info.st_mode))
+        {
+            visit(path, context);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * @brief Visits the file names read from the standard input, one per line.
+ *
+ * @param visit The function called with every file name.
+ * @param context The argument of the visitor.
+ */
+static void walkList(FILE_VISITOR visit, void *context)
+{
+    char path[MAX_PATH];
+    while (fgets(path, sizeof(path), stdin) != NULL)
+    {
+        path[strcspn(path, "\r\n")] = '\0'; // Remove the line ending
+        if (path[0] != '\0')
+        {
+            visit(path, context);
+        }
+    }
+}
+
+/**
+ * @brief Visitor of the batch files: hands a game file, or the records of a corpus, to the pool.
+ *
+ * @param path The name of the file.
+ * @param context The BATCH.
+ */
+static void submitPath(const char *path, void *context)
+{
+    BATCH *batch = (BATCH *)context;
+    if (isCorpusFile(path))
+    {
+        submitCorpus(batch, path);
+    }
+    else
+    {
+        submitFile(batch, path);
+    }
+}
+
+void forEachGameFile(char *paths[], int count, bool results, FILE_VISITOR visit, void *context)
+{
+    for (int k = 0; k < count; k++)
+    {
+        struct stat info;
+        if (strcmp(paths[k], "-") == 0)
+        {
+            walkList(visit, context);
+        }
+        else if (stat(paths[k], &info) == 0 && S_ISDIR(info.st_mode))
+        {
+            walkDirectory(paths[k], results, visit, context);
+        }
+        else
+        {
+            visit(paths[k], context); // Missing files are reported as unreadable
+        }
+    }
+}
+
+int runBatch(char *paths[], int count, BATCH_MODE mode, int threads)
+{
+    BATCH batch;
+    batch.pool = createPool(threads);
+    batch.mode = mode;
+    batch.buffers = NULL;
+    if (mode == BATCH_VERIFY)
+    {
+        batch.buffers = (uint16_t *)allocOrExit((size_t)batch.pool->threads * 2 * VERIFY_CELLS * sizeof(uint16_t));
+    }
+    batch.window = batch.pool->threads * FILES_PER_THREAD;
+    batch.inFlight = 0;
+    batch.processed = 0;
+    batch.failures = 0;
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.slot, NULL);
+    batch.sources = NULL;
+    batch.group = NULL;
+
+    double start = now();
+    forEachGameFile(paths, count, mode == BATCH_VERIFY, submitPath, &batch);
+    flushGroup(&batch);
+    waitPool(batch.pool);
+    freePool(batch.pool);
+
+    while (batch.sources != NULL)
+    {
+        SOURCE *source = batch.sources;
+        batch.sources = source->next;
+        if (source->output >= 0 && close(source->output) != 0)
+        {
+            perror(source->path);
+            batch.failures++;
+        }
+        closeCorpus(&source->corpus);
+        free(source);
+    }
+
+    fprintf(stderr, "%d squares, %d failed, %.3f s\n", batch.processed, batch.failures, now() - start);
+    free(batch.buffers);
+    pthread_mutex_destroy(&batch.lock);
+    pthread_cond_destroy(&batch.slot);
+    return batch.failures;
+}
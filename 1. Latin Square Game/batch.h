@@ -0,0 +1,75 @@
+/**
+ * @file batch.h
+ * @brief Declarations of the batch mode that validates, solves or verifies many game files in parallel.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "latinsquare.h"
+
+/**
+ * @brief What the batch mode does with every square.
+ */
+typedef enum
+{
+    BATCH_VALIDATE, /**< Load the square and tell whether it is complete */
+    BATCH_SOLVE,    /**< Complete the square and save the completion */
+    BATCH_VERIFY    /**< Check that the square is a completed Latin square (see verify.h) */
+} BATCH_MODE;
+
+/**
+ * @brief Signature of the function called by forEachGameFile() for every file.
+ *
+ * @param path The name of the file.
+ * @param context The argument given to forEachGameFile().
+ */
+typedef void (*FILE_VISITOR)(const char *path, void *context);
+
+/**
+ * @brief Calls a function for every game file named by the arguments.
+ *
+ * An argument may be a game file, a directory (walked recursively, skipping hidden files and
+ * the "out-" files written by this program) or "-" to read one file name per line from the
+ * standard input. When results are wanted, the "out-" files of a directory are visited instead
+ * of the files they were written for, leaving out the ".journal" and ".tmp" files of unfinished games.
+ *
+ * @param paths The file, directory or "-" arguments.
+ * @param count The number of arguments.
+ * @param results true to visit the "out-" files of the directories instead of their inputs.
+ * @param visit The function called with every file name.
+ * @param context The argument of the visitor.
+ */
+void forEachGameFile(char *paths[], int count, bool results, FILE_VISITOR visit, void *context);
+
+/**
+ * @brief Validates, solves or verifies every game file named by the arguments.
+ *
+ * The arguments are walked with forEachGameFile(), with the "out-" results when verifying. The files are processed by a thread pool with
+ * a bounded number of files in flight, so memory use does not depend on the number of files.
+ * A corpus file (see corpus.h) is mapped and its records are processed in runs, as if each were
+ * a file named <corpus>#<k>; solutions are written to the records of an out- copy of the corpus.
+ * One line is printed per square:
+ *
+ *     <status> <milliseconds> <file>
+ *
+ * where the status is "complete" or "partial" when validating, "solved" or "unsolvable" when
+ * solving (the completion is saved like writeLatinSquare() does), or the loadStatusName() of a
+ * file that was rejected. When verifying, only the squares that are not completed Latin squares
+ * are printed, as
+ *
+ *     <status> <line> <file>
+ *
+ * where the status is the verifyStatusName() of the square and the line the first row (or
+ * column) breaking the rule, or the loadStatusName() of a file that cannot be read and 0. A
+ * summary is printed on the standard error.
+ *
+ * @param paths The file, directory or "-" arguments.
+ * @param count The number of arguments.
+ * @param mode What to do with the squares.
+ * @param threads The number of worker threads, below 1 for one per processor.
+ * @return The number of files that were rejected, could not be completed or could not be saved.
+ */
+int runBatch(char *paths[], int count, BATCH_MODE mode, int threads);
+
+#endif // BATCH_H
@@ -0,0 +1,537 @@
+/**
+ * @file bench.c
+ * @brief Benchmark of the checker, the validation and the solver on reproducible random squares.
+ *
+ * Every case is an order, a fill ratio and an operation. The workload of an order and a fill
+ * ratio is a set of random partial squares: a random isotope of the cyclic square (its rows,
+ * columns and symbols shuffled) of which every cell is kept as a protected given with the
+ * probability of the fill ratio, so the squares always have a completion. The squares only
+ * depend on the seed, the order, the fill ratio and their index. The operations are:
+ *
+ *     check   checkDuplicates() on random cells and values, as the game does for every move
+ *     verify  decodeRecord() of the packed square, the full validation of a corpus record
+ *     solve   searchCompletions() up to the first completion
+ *     count   searchCompletions() up to --count-limit completions
+ *     hint    findHint() and candidateCount() of random cells, with candidate sets attached
+ *
+ * A sample times a run of operations (a single search for solve and count). The samples are
+ * repeated over the squares until every square was used and the time of the case is spent.
+ * One JSON object is printed per case on its own line:
+ *
+ *     {"op":"check","order":9,"fill":0.50,"samples":..,"ops":..,"ns_per_op":..,"p50_ns":..,
+ *      "p90_ns":..,"p99_ns":..,"max_ns":..,"nodes":..,"nodes_per_sec":..,"unfinished":..}
+ *
+ * where the percentiles are over the samples (per operation), nodes counts the states opened
+ * by the searches and unfinished the searches that ran out of their node budget.
+ */
+
+#define _POSIX_C_SOURCE 200809L // For clock_gettime
+
+#include "latinsquare.h"
+#include "candidates.h"
+#include "console.h"
+#include "corpus.h"
+#include "random.h"
+#include "solver.h"
+#include <time.h>
+
+#define DEFAULT_ORDERS "4,5,6,8,9,16,32,64,128,256" // Orders benchmarked by default
+#define DEFAULT_FILLS "0.2,0.5,0.8"                  // Fill ratios benchmarked by default
+#define DEFAULT_OPS "check,verify,solve,count,hint"  // Operations benchmarked by default
+#define DEFAULT_INSTANCES 4                          // Squares per order and fill ratio
+#define DEFAULT_SECONDS 0.2                          // Time spent on a case at least
+#define DEFAULT_MAX_NODES 1000                       // Node budget of a search
+#define DEFAULT_COUNT_LIMIT 1000                     // Completions counted by the count operation
+#define MAX_SAMPLES 100000                           // Samples of a case at most
+#define CHECK_BATCH 1024                             // Checks or hints timed together in a sample
+#define VERIFY_CELLS 65536                           // Cells decoded together in a sample
+#define FILL_SCALE 1000000                           // Resolution of the fill ratio
+
+/**
+ * @brief The operations measured.
+ */
+typedef enum
+{
+    OP_CHECK,  /**< checkDuplicates() */
+    OP_VERIFY, /**< decodeRecord() */
+    OP_SOLVE,  /**< searchCompletions() to the first completion */
+    OP_COUNT,  /**< searchCompletions() to the count limit */
+    OP_HINT,   /**< findHint() and candidateCount() */
+    OP_COUNT_OF
+} OPERATION;
+
+static const char *const operationNames[OP_COUNT_OF] = {"check", "verify", "solve", "count", "hint"};
+
+/**
+ * @brief Represents the settings of a benchmark run.
+ */
+typedef struct settings
+{
+    uint64_t seed;                /**< The seed of the workloads */
+    int instances;                /**< Squares per order and fill ratio */
+    double seconds;               /**< Time spent on a case at least */
+    unsigned long long maxNodes;  /**< Node budget of a search */
+    long long countLimit;         /**< Completions counted by the count operation */
+    bool operations[OP_COUNT_OF]; /**< The operations measured */
+} SETTINGS;
+
+/**
+ * @brief Represents the measurements of one case.
+ */
+typedef struct measure
+{
+    double *samples;          /**< Nanoseconds per operation of each sample */
+    int count;                /**< Number of samples */
+    long long ops;            /**< Operations timed */
+    double totalNs;           /**< Time of all the samples */
+    unsigned long long nodes; /**< Nodes opened by the searches */
+    int unfinished;           /**< Searches that ran out of nodes */
+} MEASURE;
+
+/**
+ * @brief Represents one random cell and value given to checkDuplicates() or candidateCount().
+ */
+typedef struct query
+{
+    int i;   /**< The row index (0-based) */
+    int j;   /**< The column index (0-based) */
+    int val; /**< The value */
+} QUERY;
+
+/**
+ * @brief Returns a monotonic time stamp.
+ *
+ * @return The time in nanoseconds.
+ */
+static double nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Fills a game with a random partial Latin square.
+ *
+ * @param game A game of the requested order.
+ * @param fill The probability of a cell being a given.
+ * @param state The random stream of the square.
+ */
+static void randomPartialSquare(GAME *game, double fill, uint64_t *state)
+{
+    int size = game->size;
+    int *rows = (int *)allocOrExit(3 * size * sizeof(int));
+    int *cols = rows + size;
+    int *symbols = cols + size;
+    for (int k = 0; k < size; k++)
+    {
+        rows[k] = cols[k] = symbols[k] = k;
+    }
+    shuffleInts(rows, size, state);
+    shuffleInts(cols, size, state);
+    shuffleInts(symbols, size, state);
+
+    int threshold = (int)(fill * FILL_SCALE);
+    clearGame(game);
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            if (randomBelow(state, FILL_SCALE) < threshold)
+            {
+                placeValue(game, i, j, -(1 + symbols[(rows[i] + cols[j]) % size]));
+            }
+        }
+    }
+    free(rows);
+}
+
+/**
+ * @brief Compares two doubles for qsort().
+ *
+ * @param a The first double.
+ * @param b The second double.
+ * @return Negative, zero or positive as a is below, equal to or above b.
+ */
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns a percentile of sorted samples (nearest rank).
+ *
+ * @param sorted The samples in increasing order.
+ * @param count Their number, at least 1.
+ * @param percent The percentile, in 1..100.
+ * @return The sample of that rank.
+ */
+static double percentile(const double *sorted, int count, int percent)
+{
+    int rank = (int)(((long long)percent * count + 99) / 100); // Rounded up
+    return sorted[rank - 1];
+}
+
+/**
+ * @brief Adds a sample to the measurements of a case.
+ *
+ * @param measure The measurements.
+ * @param ns The time of the sample.
+ * @param ops The number of operations it timed.
+ */
+static void addSample(MEASURE *measure, double ns, int ops)
+{
+    measure->samples[measure->count++] = ns / ops;
+    measure->totalNs += ns;
+    measure->ops += ops;
+}
+
+/**
+ * @brief Prints the measurements of a case as one JSON line.
+ *
+ * @param op The operation.
+ * @param size The order of the squares.
+ * @param fill The fill ratio.
+ * @param measure The measurements, whose samples are sorted.
+ */
+static void printMeasure(OPERATION op, int size, double fill, MEASURE *measure)
+{
+    qsort(measure->samples, measure->count, sizeof(double), compareDoubles);
+    double seconds = measure->totalNs / 1e9;
+    printf("{\"op\":\"%s\",\"order\":%d,\"fill\":%.2f,\"samples\":%d,\"ops\":%lld,\"ns_per_op\":%.1f,"
+           "\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,\"nodes\":%llu,"
+           "\"nodes_per_sec\":%.0f,\"unfinished\":%d}\n",
+           operationNames[op], size, fill, measure->count, measure->ops, measure->totalNs / measure->ops,
+           percentile(measure->samples, measure->count, 50), percentile(measure->samples, measure->count, 90),
+           percentile(measure->samples, measure->count, 99), measure->samples[measure->count - 1],
+           measure->nodes, seconds > 0 ? measure->nodes / seconds : 0.0, measure->unfinished);
+    fflush(stdout);
+}
+
+/**
+ * @brief Measures one operation on the squares of an order and a fill ratio.
+ *
+ * @param settings The settings of the run.
+ * @param op The operation.
+ * @param games The squares.
+ * @param fill The fill ratio of the squares.
+ * @param state The random stream of the check and hint queries.
+ */
+static void runCase(const SETTINGS *settings, OPERATION op, GAME *games, double fill, uint64_t *state)
+{
+    int size = games[0].size;
+    int instances = settings->instances;
+    MEASURE measure = {NULL, 0, 0, 0.0, 0, 0};
+    measure.samples = (double *)allocOrExit(MAX_SAMPLES * sizeof(double));
+
+    // Inputs of the operations, prepared before the clock starts
+    QUERY *queries = NULL;
+    uint8_t *records = NULL;
+    int valueBits = corpusValueBits(size);
+    size_t recordBytes = corpusRecordBytes(size);
+    int verifyBatch = VERIFY_CELLS / (size * size) > 0 ? VERIFY_CELLS / (size * size) : 1;
+    GAME scratch;
+    initGameOrExit(&scratch, size);
+    CANDIDATES *candidates = NULL;
+    if (op == OP_CHECK || op == OP_HINT)
+    {
+        queries = (QUERY *)allocOrExit(CHECK_BATCH * sizeof(QUERY));
+        for (int q = 0; q < CHECK_BATCH; q++)
+        {
+            queries[q].i = randomBelow(state, size);
+            queries[q].j = randomBelow(state, size);
+            queries[q].val = 1 + randomBelow(state, size);
+        }
+    }
+    if (op == OP_HINT)
+    {
+        candidates = (CANDIDATES *)allocOrExit(instances * sizeof(CANDIDATES));
+        for (int k = 0; k < instances; k++)
+        {
+            if (!attachCandidates(&candidates[k], &games[k]))
+            {
+                perror("Memory allocation failed");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    else if (op == OP_VERIFY)
+    {
+        records = (uint8_t *)allocOrExit(instances * recordBytes);
+        for (int k = 0; k < instances; k++)
+        {
+            encodeRecord(&games[k], records + k * recordBytes, valueBits);
+        }
+    }
+
+    double spent = 0;
+    int failures = 0;
+    for (int k = 0; measure.count < MAX_SAMPLES && (k < instances || spent < settings->seconds * 1e9); k++)
+    {
+        GAME *game = &games[k % instances];
+        unsigned long long nodes = 0;
+        long long found = 0;
+        int ops = 1;
+        double start = nowNs();
+        switch (op)
+        {
+        case OP_CHECK:
+            for (int q = 0; q < CHECK_BATCH; q++)
+            {
+                found += checkDuplicates(game, queries[q].i, queries[q].j, queries[q].val);
+            }
+            ops = CHECK_BATCH;
+            break;
+        case OP_VERIFY:
+            for (int b = 0; b < verifyBatch; b++)
+            {
+                failures += decodeRecord(&scratch, records + (k % instances) * recordBytes, valueBits) != LOAD_OK;
+            }
+            ops = verifyBatch;
+            break;
+        case OP_SOLVE:
+            found = searchCompletions(game, 1, settings->maxNodes, &nodes);
+            break;
+        case OP_COUNT:
+            found = searchCompletions(game, settings->countLimit, settings->maxNodes, &nodes);
+            break;
+        case OP_HINT:
+            for (int q = 0; q < CHECK_BATCH; q++)
+            {
+                const CANDIDATES *cands = &candidates[k % instances];
+                found += findHint(cands).val + candidateCount(cands, queries[q].i, queries[q].j);
+            }
+            ops = CHECK_BATCH;
+            break;
+        case OP_COUNT_OF:
+            break;
+        }
+        double ns = nowNs() - start;
+        spent += ns;
+        addSample(&measure, ns, ops);
+        measure.nodes += nodes;
+        if ((op == OP_SOLVE || op == OP_COUNT) && found < 0)
+        {
+            measure.unfinished++;
+        }
+        else if (op == OP_SOLVE && found == 0)
+        {
+            failures++; // The squares always have a completion
+        }
+    }
+    if (failures > 0)
+    {
+        fprintf(stderr, "%s order %d fill %.2f: %d wrong results\n", operationNames[op], size, fill, failures);
+    }
+    printMeasure(op, size, fill, &measure);
+
+    for (int k = 0; candidates != NULL && k < instances; k++)
+    {
+        detachCandidates(&candidates[k], &games[k]);
+    }
+    free(candidates);
+    freeGame(&scratch);
+    free(records);
+    free(queries);
+    free(measure.samples);
+}
+
+/**
+ * @brief Parses a comma separated list of numbers.
+ *
+ * @param text The list.
+ * @param values Receives the numbers.
+ * @param capacity The room in values.
+ * @return The number of values, or -1 if the list is malformed or too long.
+ */
+static int parseList(const char *text, double *values, int capacity)
+{
+    int count = 0;
+    while (*text != '\0')
+    {
+        char *end;
+        double value = strtod(text, &end);
+        if (end == text || count == capacity || (*end != ',' && *end != '\0'))
+        {
+            return -1;
+        }
+        values[count++] = value;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+/**
+ * @brief Selects the operations named in a comma separated list.
+ *
+ * @param text The list.
+ * @param operations Receives whether each operation is selected.
+ * @return true on success, false for an unknown name.
+ */
+static bool parseOperations(const char *text, bool *operations)
+{
+    for (int op = 0; op < OP_COUNT_OF; op++)
+    {
+        operations[op] = false;
+    }
+    while (*text != '\0')
+    {
+        size_t length = strcspn(text, ",");
+        int op = 0;
+        while (op < OP_COUNT_OF && (strlen(operationNames[op]) != length || strncmp(operationNames[op], text, length) != 0))
+        {
+            op++;
+        }
+        if (op == OP_COUNT_OF)
+        {
+            return false;
+        }
+        operations[op] = true;
+        text += length + (text[length] == ',');
+    }
+    return true;
+}
+
+/**
+ * @brief Prints the command line usage of the benchmark.
+ *
+ * @param program The name of the program.
+ */
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [--orders LIST] [--fills LIST] [--ops LIST] [--seed S] [--instances K]\n", program);
+    printf("       [--seconds T] [--max-nodes N] [--count-limit C]\n");
+    printf("Defaults: --orders %s --fills %s --ops %s --seed 1 --instances %d\n", DEFAULT_ORDERS, DEFAULT_FILLS,
+           DEFAULT_OPS, DEFAULT_INSTANCES);
+    printf("          --seconds %.1f --max-nodes %d --count-limit %d\n", DEFAULT_SECONDS, DEFAULT_MAX_NODES,
+           DEFAULT_COUNT_LIMIT);
+}
+
+/**
+ * @brief Runs the benchmark.
+ *
+ * Every selected operation is measured on every order and fill ratio, and one JSON line is
+ * printed per case after a first line holding the settings.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 on success, 1 for invalid arguments.
+ */
+int main(int argc, char *argv[])
+{
+    const char *orderList = DEFAULT_ORDERS;
+    const char *fillList = DEFAULT_FILLS;
+    const char *opList = DEFAULT_OPS;
+    SETTINGS settings;
+    settings.seed = 1;
+    settings.instances = DEFAULT_INSTANCES;
+    settings.seconds = DEFAULT_SECONDS;
+    settings.maxNodes = DEFAULT_MAX_NODES;
+    settings.countLimit = DEFAULT_COUNT_LIMIT;
+
+    for (int k = 1; k < argc; k++)
+    {
+        if (k + 1 == argc)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[k], "--orders") == 0)
+        {
+            orderList = argv[++k];
+        }
+        else if (strcmp(argv[k], "--fills") == 0)
+        {
+            fillList = argv[++k];
+        }
+        else if (strcmp(argv[k], "--ops") == 0)
+        {
+            opList = argv[++k];
+        }
+        else if (strcmp(argv[k], "--seed") == 0)
+        {
+            settings.seed = strtoull(argv[++k], NULL, 10);
+        }
+        else if (strcmp(argv[k], "--instances") == 0)
+        {
+            settings.instances = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--seconds") == 0)
+        {
+            settings.seconds = atof(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--max-nodes") == 0)
+        {
+            settings.maxNodes = strtoull(argv[++k], NULL, 10);
+        }
+        else if (strcmp(argv[k], "--count-limit") == 0)
+        {
+            settings.countLimit = atoll(argv[++k]);
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    double orders[MAX_SIZE];
+    double fills[MAX_SIZE];
+    int orderCount = parseList(orderList, orders, MAX_SIZE);
+    int fillCount = parseList(fillList, fills, MAX_SIZE);
+    bool valid = orderCount > 0 && fillCount > 0 && parseOperations(opList, settings.operations) &&
+                 settings.instances > 0 && settings.countLimit > 0 && settings.maxNodes > 0;
+    for (int o = 0; valid && o < orderCount; o++)
+    {
+        valid = orders[o] >= 1 && orders[o] <= MAX_SIZE && orders[o] == (int)orders[o];
+    }
+    for (int f = 0; valid && f < fillCount; f++)
+    {
+        valid = fills[f] >= 0 && fills[f] <= 1;
+    }
+    if (!valid)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    printf("{\"bench\":\"latinsquare\",\"seed\":%llu,\"instances\":%d,\"seconds\":%.3f,\"max_nodes\":%llu,"
+           "\"count_limit\":%lld}\n",
+           (unsigned long long)settings.seed, settings.instances, settings.seconds, settings.maxNodes,
+           settings.countLimit);
+
+    GAME *games = (GAME *)allocOrExit(settings.instances * sizeof(GAME));
+    for (int o = 0; o < orderCount; o++)
+    {
+        int size = (int)orders[o];
+        for (int f = 0; f < fillCount; f++)
+        {
+            // The squares of a case only depend on the seed, the order, the fill ratio and their index
+            uint64_t caseStream = (uint64_t)size << 32 | (uint64_t)(fills[f] * FILL_SCALE);
+            for (int k = 0; k < settings.instances; k++)
+            {
+                uint64_t state = streamSeed(settings.seed, mixRandom(caseStream) + (uint64_t)k);
+                initGameOrExit(&games[k], size);
+                randomPartialSquare(&games[k], fills[f], &state);
+            }
+
+            uint64_t state = streamSeed(settings.seed, ~caseStream);
+            for (int op = 0; op < OP_COUNT_OF; op++)
+            {
+                if (settings.operations[op])
+                {
+                    runCase(&settings, (OPERATION)op, games, fills[f], &state);
+                }
+            }
+
+            for (int k = 0; k < settings.instances; k++)
+            {
+                freeGame(&games[k]);
+            }
+        }
+    }
+    free(games);
+    return 0;
+}
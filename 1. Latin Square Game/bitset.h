@@ -0,0 +1,105 @@
+/**
+ * @file bitset.h
+ * @brief Fixed-size bitsets of Latin square values, stored in 64-bit words.
+ *
+ * Value v in [1..size] is stored as bit (v - 1). A bitset of an order n square takes
+ * BITSET_WORDS(n) words, so one word covers every order up to 64.
+ */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WORD_BITS 64                                            // Bits per bitset word
+#define BITSET_WORDS(n) (((n) + WORD_BITS - 1) / WORD_BITS)     // Words of a bitset of n values
+#define WORD_OF(val) (((val) - 1) / WORD_BITS)                  // Word holding a value
+#define BIT_OF(val) ((uint64_t)1 << (((val) - 1) % WORD_BITS))  // Bit of a value inside its word
+
+/**
+ * @brief Tells whether a value is in a bitset.
+ *
+ * @param set The bitset.
+ * @param val The value, in [1..size].
+ * @return true if the value is in the bitset.
+ */
+static inline bool hasValue(const uint64_t *set, int val)
+{
+    return (set[WORD_OF(val)] & BIT_OF(val)) != 0;
+}
+
+/**
+ * @brief Adds a value to a bitset.
+ *
+ * @param set The bitset.
+ * @param val The value, in [1..size].
+ */
+static inline void addValue(uint64_t *set, int val)
+{
+    set[WORD_OF(val)] |= BIT_OF(val);
+}
+
+/**
+ * @brief Removes a value from a bitset.
+ *
+ * @param set The bitset.
+ * @param val The value, in [1..size].
+ */
+static inline void removeValue(uint64_t *set, int val)
+{
+    set[WORD_OF(val)] &= ~BIT_OF(val);
+}
+
+/**
+ * @brief Fills a bitset with every value in [1..size].
+ *
+ * @param set The bitset of BITSET_WORDS(size) words.
+ * @param size The order of the Latin square.
+ */
+static inline void fillValues(uint64_t *set, int size)
+{
+    for (int w = 0; w < BITSET_WORDS(size); w++)
+    {
+        int bits = size - w * WORD_BITS;
+        set[w] = bits >= WORD_BITS ? ~(uint64_t)0 : ((uint64_t)1 << bits) - 1;
+    }
+}
+
+/**
+ * @brief Counts the values of a bitset.
+ *
+ * @param set The bitset.
+ * @param words The number of words of the bitset.
+ * @return The number of values in the bitset.
+ */
+static inline int countValues(const uint64_t *set, int words)
+{
+    int count = 0;
+    for (int w = 0; w < words; w++)
+    {
+        count += __builtin_popcountll(set[w]);
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the smallest value of a bitset.
+ *
+ * @param set The bitset.
+ * @param words The number of words of the bitset.
+ * @return The smallest value, or 0 if the bitset is empty.
+ */
+static inline int firstValue(const uint64_t *set, int words)
+{
+    for (int w = 0; w < words; w++)
+    {
+        if (set[w] != 0)
+        {
+            return w * WORD_BITS + __builtin_ctzll(set[w]) + 1;
+        }
+    }
+    return 0;
+}
+
+#endif // BITSET_H
@@ -0,0 +1,556 @@
+#include "candidates.h"
+
+/**
+ * @brief Allocates an empty index set.
+ *
+ * @param set The set to initialize.
+ * @param capacity The number of possible indices.
+ * @return false, with no members allocated, if the memory cannot be allocated.
+ */
+static bool initIndexSet(INDEXSET *set, int capacity)
+{
+    set->members = (int *)malloc(2 * (size_t)capacity * sizeof(int));
+    if (set->members == NULL)
+    {
+        return false;
+    }
+    set->position = set->members + capacity;
+    memset(set->position, -1, (size_t)capacity * sizeof(int));
+    set->count = 0;
+    return true;
+}
+
+/**
+ * @brief Releases an index set.
+ *
+ * @param set The set.
+ */
+static void freeIndexSet(INDEXSET *set)
+{
+    free(set->members);
+    set->members = NULL;
+    set->position = NULL;
+}
+
+/**
+ * @brief Adds an index to a set or removes it, whether or not it is already there.
+ *
+ * @param set The set.
+ * @param index The index.
+ * @param member true to add the index, false to remove it.
+ */
+static inline void setMember(INDEXSET *set, int index, bool member)
+{
+    int position = set->position[index];
+    if (member && position < 0)
+    {
+        set->position[index] = set->count;
+        set->members[set->count++] = index;
+    }
+    else if (!member && position >= 0)
+    {
+        // The last member takes the place of the removed one
+        int last = set->members[--set->count];
+        set->members[position] = last;
+        set->position[last] = position;
+        set->position[index] = -1;
+    }
+}
+
+/**
+ * @brief Tells whether an edge of a line of the matchings exists, i.e. whether its cell accepts its value.
+ *
+ * @param candidates The candidate sets.
+ * @param line The line (see MATCHINGS).
+ * @param left The left vertex.
+ * @param right The right vertex.
+ * @return true if the edge exists.
+ */
+static inline bool hasEdge(const CANDIDATES *candidates, int line, int left, int right)
+{
+    int size = candidates->size;
+    int index = line % size;
+    switch (line / size)
+    {
+    case 0:
+        return hasValue(cellCandidates(candidates, index, left), right + 1);
+    case 1:
+        return hasValue(cellCandidates(candidates, left, index), right + 1);
+    default:
+        return hasValue(cellCandidates(candidates, left, right), index + 1);
+    }
+}
+
+/**
+ * @brief Tells whether a left vertex of a line must be matched: an empty cell, or a row missing the value.
+ *
+ * @param game The game.
+ * @param line The line (see MATCHINGS).
+ * @param left The left vertex.
+ * @return true if the vertex must be matched.
+ */
+static inline bool isOpen(const GAME *game, int line, int left)
+{
+    int size = game->size;
+    int index = line % size;
+    switch (line / size)
+    {
+    case 0:
+        return getCell(game, index, left) == 0;
+    case 1:
+        return getCell(game, left, index) == 0;
+    default:
+        return !hasValue(rowSet(game, left), index + 1);
+    }
+}
+
+/**
+ * @brief Records that an edge of a line appeared or disappeared.
+ *
+ * @param candidates The candidate sets, with matchings attached.
+ * @param line The line (see MATCHINGS).
+ * @param left The left vertex.
+ * @param right The right vertex.
+ * @param add true if the edge appeared, false if it disappeared.
+ */
+static void changeEdge(CANDIDATES *candidates, int line, int left, int right, bool add)
+{
+    MATCHINGS *matchings = candidates->matchings;
+    size_t base = (size_t)line * candidates->size;
+    if (!add && matchings->mate[base + left] == right + 1)
+    {
+        // The matching loses an edge and the line has to look for another one
+        matchings->mate[base + left] = 0;
+        matchings->owner[base + right] = 0;
+        setMember(&matchings->dirty, line, true);
+    }
+    else if (add && matchings->deficient.position[line] >= 0)
+    {
+        setMember(&matchings->dirty, line, true); // The new edge may complete the matching
+    }
+}
+
+/**
+ * @brief Adds a candidate to a cell or removes it, updating the counters and the sets.
+ *
+ * @param candidates The candidate sets.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param val The value.
+ * @param add true to add the candidate, false to remove it; the caller knows it changes.
+ */
+static void changeCandidate(CANDIDATES *candidates, int i, int j, int val, bool add)
+{
+    int size = candidates->size;
+    int cell = i * size + j;
+    int row = i * size + val - 1;
+    int col = j * size + val - 1;
+    int delta = add ? 1 : -1;
+    uint64_t *mask = candidates->cellMask + (size_t)cell * candidates->words;
+    mask[WORD_OF(val)] ^= BIT_OF(val);
+    candidates->cellCount[cell] += delta;
+    candidates->rowCount[row] += delta;
+    candidates->colCount[col] += delta;
+    candidates->rowXor[row] ^= (uint16_t)j;
+    candidates->colXor[col] ^= (uint16_t)i;
+
+    setMember(&candidates->singles, cell, candidates->cellCount[cell] == 1);
+    setMember(&candidates->dead, cell, candidates->cellCount[cell] == 0);
+    setMember(&candidates->rowSingles, row, candidates->rowCount[row] == 1);
+    setMember(&candidates->colSingles, col, candidates->colCount[col] == 1);
+
+    if (candidates->matchings != NULL)
+    {
+        // The candidate is an edge of its row, of its column and of its value
+        changeEdge(candidates, i, j, val - 1, add);
+        changeEdge(candidates, size + j, i, val - 1, add);
+        changeEdge(candidates, 2 * size + val - 1, i, j, add);
+    }
+}
+
+/**
+ * @brief Looks for an augmenting path of a line from an unmatched left vertex, and applies it.
+ *
+ * Free right vertices are tried before the paths through the matched ones, which finds most
+ * augmenting paths at depth one.
+ *
+ * @param candidates The candidate sets, with matchings attached.
+ * @param line The line (see MATCHINGS).
+ * @param left The left vertex.
+ * @return true if the vertex was matched.
+ */
+static bool augment(CANDIDATES *candidates, int line, int left)
+{
+    MATCHINGS *matchings = candidates->matchings;
+    int size = candidates->size;
+    size_t base = (size_t)line * size;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int right = 0; right < size; right++)
+        {
+            int owner = matchings->owner[base + right];
+            if ((pass == 0) != (owner == 0) || matchings->seen[right] == matchings->search ||
+                !hasEdge(candidates, line, left, right))
+            {
+                continue;
+            }
+            matchings->seen[right] = matchings->search;
+            if (owner == 0 || augment(candidates, line, owner - 1))
+            {
+                matchings->mate[base + left] = (uint16_t)(right + 1);
+                matchings->owner[base + right] = (uint16_t)(left + 1);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Matches the unmatched vertices of the lines marked dirty, and updates the deficient lines.
+ *
+ * @param candidates The candidate sets, with matchings attached.
+ * @param game The game.
+ */
+static void repairMatchings(CANDIDATES *candidates, const GAME *game)
+{
+    MATCHINGS *matchings = candidates->matchings;
+    int size = candidates->size;
+    while (matchings->dirty.count > 0)
+    {
+        int line = matchings->dirty.members[matchings->dirty.count - 1];
+        setMember(&matchings->dirty, line, false);
+        size_t base = (size_t)line * size;
+        bool perfect = true;
+        for (int left = 0; left < size; left++)
+        {
+            if (matchings->mate[base + left] != 0 || !isOpen(game, line, left))
+            {
+                continue;
+            }
+            if (++matchings->search == 0)
+            {
+                // The search counter wrapped: forget every search
+                memset(matchings->seen, 0, (size_t)size * sizeof(uint32_t));
+                matchings->search = 1;
+            }
+            perfect &= augment(candidates, line, left);
+        }
+        setMember(&matchings->deficient, line, !perfect);
+    }
+}
+
+/**
+ * @brief Marks dirty the lines where a cell filled or emptied opens or closes a vertex.
+ *
+ * @param candidates The candidate sets.
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param val The value of the cell, in [1..size].
+ */
+static void updateMatchings(CANDIDATES *candidates, const GAME *game, int i, int j, int val)
+{
+    MATCHINGS *matchings = candidates->matchings;
+    if (matchings != NULL)
+    {
+        setMember(&matchings->dirty, i, true);
+        setMember(&matchings->dirty, candidates->size + j, true);
+        setMember(&matchings->dirty, 2 * candidates->size + val - 1, true);
+        repairMatchings(candidates, game);
+    }
+}
+
+/**
+ * @brief Gives an empty cell every value missing from its row and column.
+ *
+ * @param candidates The candidate sets, holding no candidate for the cell.
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ */
+static void fillCell(CANDIDATES *candidates, const GAME *game, int i, int j)
+{
+    const uint64_t *row = rowSet(game, i);
+    const uint64_t *col = colSet(game, j);
+    uint64_t all[BITSET_WORDS(MAX_SIZE)];
+    fillValues(all, game->size);
+    for (int w = 0; w < game->words; w++)
+    {
+        uint64_t bits = all[w] & ~row[w] & ~col[w];
+        while (bits != 0)
+        {
+            changeCandidate(candidates, i, j, w * WORD_BITS + __builtin_ctzll(bits) + 1, true);
+            bits &= bits - 1;
+        }
+    }
+    setMember(&candidates->dead, i * game->size + j, candidates->cellCount[i * game->size + j] == 0);
+}
+
+/**
+ * @brief Releases the Hall matchings of candidate sets, if any.
+ *
+ * @param candidates The candidate sets.
+ */
+static void freeMatchings(CANDIDATES *candidates)
+{
+    MATCHINGS *matchings = candidates->matchings;
+    if (matchings != NULL)
+    {
+        free(matchings->mate);
+        free(matchings->seen);
+        freeIndexSet(&matchings->dirty);
+        freeIndexSet(&matchings->deficient);
+        free(matchings);
+        candidates->matchings = NULL;
+    }
+}
+
+/**
+ * @brief Releases the arrays of candidate sets and their matchings, any of them possibly NULL.
+ *
+ * @param candidates The candidate sets.
+ */
+static void freeCandidates(CANDIDATES *candidates)
+{
+    free(candidates->cellMask);
+    free(candidates->cellCount);
+    candidates->cellMask = NULL;
+    candidates->cellCount = NULL;
+    freeIndexSet(&candidates->singles);
+    freeIndexSet(&candidates->dead);
+    freeIndexSet(&candidates->rowSingles);
+    freeIndexSet(&candidates->colSingles);
+
+    freeMatchings(candidates);
+}
+
+bool attachCandidates(CANDIDATES *candidates, GAME *game)
+{
+    int size = game->size;
+    size_t cells = (size_t)size * size;
+    candidates->size = size;
+    candidates->words = game->words;
+    candidates->matchings = NULL;
+    candidates->singles.members = NULL;
+    candidates->dead.members = NULL;
+    candidates->rowSingles.members = NULL;
+    candidates->colSingles.members = NULL;
+    candidates->cellMask = (uint64_t *)malloc(cells * game->words * sizeof(uint64_t));
+    candidates->cellCount = (uint16_t *)malloc(5 * cells * sizeof(uint16_t));
+    if (candidates->cellMask == NULL || candidates->cellCount == NULL ||
+        !initIndexSet(&candidates->singles, (int)cells) || !initIndexSet(&candidates->dead, (int)cells) ||
+        !initIndexSet(&candidates->rowSingles, (int)cells) || !initIndexSet(&candidates->colSingles, (int)cells))
+    {
+        freeCandidates(candidates);
+        return false;
+    }
+    memset(candidates->cellMask, 0, cells * game->words * sizeof(uint64_t));
+    memset(candidates->cellCount, 0, 5 * cells * sizeof(uint16_t));
+    candidates->rowCount = candidates->cellCount + cells;
+    candidates->colCount = candidates->rowCount + cells;
+    candidates->rowXor = candidates->colCount + cells;
+    candidates->colXor = candidates->rowXor + cells;
+
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            if (getCell(game, i, j) == 0)
+            {
+                fillCell(candidates, game, i, j);
+            }
+        }
+    }
+    game->candidates = candidates;
+    return true;
+}
+
+void detachCandidates(CANDIDATES *candidates, GAME *game)
+{
+    game->candidates = NULL;
+    freeCandidates(candidates);
+}
+
+bool attachMatchings(CANDIDATES *candidates, const GAME *game, bool strict)
+{
+    int size = candidates->size;
+    size_t vertices = 3 * (size_t)size * size;
+    MATCHINGS *matchings = (MATCHINGS *)calloc(1, sizeof(MATCHINGS));
+    if (matchings == NULL)
+    {
+        return false;
+    }
+    candidates->matchings = matchings;
+    matchings->strict = strict;
+    matchings->mate = (uint16_t *)calloc(2 * vertices, sizeof(uint16_t));
+    matchings->seen = (uint32_t *)calloc(size, sizeof(uint32_t));
+    if (matchings->mate == NULL || matchings->seen == NULL || !initIndexSet(&matchings->dirty, 3 * size) ||
+        !initIndexSet(&matchings->deficient, 3 * size))
+    {
+        freeMatchings(candidates);
+        return false;
+    }
+    matchings->owner = matchings->mate + vertices;
+    matchings->search = 0;
+
+    for (int line = 0; line < 3 * size; line++)
+    {
+        setMember(&matchings->dirty, line, true);
+    }
+    repairMatchings(candidates, game);
+    return true;
+}
+
+bool describeHallFailure(const CANDIDATES *candidates, char *buffer)
+{
+    const INDEXSET *deficient = &candidates->matchings->deficient;
+    if (deficient->count == 0)
+    {
+        buffer[0] = '\0';
+        return false;
+    }
+    int size = candidates->size;
+    int line = deficient->members[0];
+    int index = line % size + 1;
+    if (line < 2 * size)
+    {
+        sprintf(buffer, "the empty cells of %s %d cannot take its missing values", line < size ? "row" : "column",
+                index);
+    }
+    else
+    {
+        sprintf(buffer, "value %d cannot be placed in every row missing it", index);
+    }
+    return true;
+}
+
+void removeCandidates(CANDIDATES *candidates, const GAME *game, int i, int j, int val)
+{
+    int size = candidates->size;
+
+    // The filled cell loses all its candidates
+    const uint64_t *mask = cellCandidates(candidates, i, j);
+    for (int w = 0; w < candidates->words; w++)
+    {
+        uint64_t bits = mask[w];
+        while (bits != 0)
+        {
+            changeCandidate(candidates, i, j, w * WORD_BITS + __builtin_ctzll(bits) + 1, false);
+            bits &= bits - 1;
+        }
+    }
+    setMember(&candidates->dead, i * size + j, false);
+
+    // The other cells of the row and the column lose the value
+    for (int k = 0; k < size; k++)
+    {
+        if (k != j && hasValue(cellCandidates(candidates, i, k), val))
+        {
+            changeCandidate(candidates, i, k, val, false);
+        }
+        if (k != i && hasValue(cellCandidates(candidates, k, j), val))
+        {
+            changeCandidate(candidates, k, j, val, false);
+        }
+    }
+    updateMatchings(candidates, game, i, j, val);
+}
+
+void restoreCandidates(CANDIDATES *candidates, const GAME *game, int i, int j, int val)
+{
+    int size = candidates->size;
+
+    // The emptied cell gets the values missing from its row and column, val among them
+    fillCell(candidates, game, i, j);
+
+    // The other empty cells of the row and the column get the value back unless their other
+    // line still holds it
+    for (int k = 0; k < size; k++)
+    {
+        if (k != j && getCell(game, i, k) == 0 && !hasValue(colSet(game, k), val))
+        {
+            changeCandidate(candidates, i, k, val, true);
+        }
+        if (k != i && getCell(game, k, j) == 0 && !hasValue(rowSet(game, k), val))
+        {
+            changeCandidate(candidates, k, j, val, true);
+        }
+    }
+    updateMatchings(candidates, game, i, j, val);
+}
+
+size_t formatCandidates(const CANDIDATES *candidates, int i, int j, char *buffer)
+{
+    const uint64_t *mask = cellCandidates(candidates, i, j);
+    char *out = buffer;
+    for (int w = 0; w < candidates->words; w++)
+    {
+        uint64_t bits = mask[w];
+        while (bits != 0)
+        {
+            int val = w * WORD_BITS + __builtin_ctzll(bits) + 1;
+            out += sprintf(out, out == buffer ? "%d" : " %d", val);
+            bits &= bits - 1;
+        }
+    }
+    *out = '\0';
+    return (size_t)(out - buffer);
+}
+
+HINT findHint(const CANDIDATES *candidates)
+{
+    int size = candidates->size;
+    HINT hint = {HINT_NONE, -1, -1, 0};
+    if (candidates->singles.count > 0)
+    {
+        int cell = candidates->singles.members[0];
+        hint.kind = HINT_SINGLE;
+        hint.i = cell / size;
+        hint.j = cell % size;
+        hint.val = firstValue(cellCandidates(candidates, hint.i, hint.j), candidates->words);
+    }
+    else if (candidates->rowSingles.count > 0)
+    {
+        int pair = candidates->rowSingles.members[0];
+        hint.kind = HINT_ROW;
+        hint.i = pair / size;
+        hint.j = candidates->rowXor[pair]; // The only column left
+        hint.val = pair % size + 1;
+    }
+    else if (candidates->colSingles.count > 0)
+    {
+        int pair = candidates->colSingles.members[0];
+        hint.kind = HINT_COLUMN;
+        hint.i = candidates->colXor[pair]; // The only row left
+        hint.j = pair / size;
+        hint.val = pair % size + 1;
+    }
+    return hint;
+}
+
+const char *hintKindName(HINT_KIND kind)
+{
+    switch (kind)
+    {
+    case HINT_NONE:
+        return "none";
+    case HINT_SINGLE:
+        return "single";
+    case HINT_ROW:
+        return "row";
+    case HINT_COLUMN:
+        return "column";
+    }
+    return "unknown";
+}
+
+int listDeadCells(const CANDIDATES *candidates, int *cells, int max)
+{
+    int count = candidates->dead.count;
+    for (int k = 0; k < count && k < max; k++)
+    {
+        cells[k] = candidates->dead.members[k];
+    }
+    return count;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file candidates.h
+ * @brief Declarations of the live candidate sets of a game and of the hints built on them.
+ *
+ * The candidates of an empty cell are the values missing from both its row and its column. They
+ * are kept as one bitset per cell, together with the number of candidates of every cell and,
+ * for every row (column) and value, the number of cells of the line that accept the value and
+ * the XOR of their indices. Once attached to a game the sets follow every placeValue() and
+ * clearValue(): a move only touches the cell, its row and its column, so it costs O(size)
+ * instead of a rescan of the board.
+ *
+ * The cells with one candidate, the cells without any and the lines where a value fits a single
+ * cell are kept in sets with constant time insertion and removal, so a hint or a dead end is
+ * found without looking at the board, and the cell of a hidden single is the XOR of its line.
+ *
+ * Optional matchings check Hall's condition on the candidates. A completion fills the empty
+ * cells of every row with the values missing from the row, one each, so the empty cells of the
+ * row and its missing values must have a perfect matching through the candidates; the same holds
+ * for every column, and for every value between the rows and the columns missing it. One maximum
+ * matching is kept per row, column and value. A candidate removed only breaks the matchings
+ * using it, and a candidate added only helps the lines not perfectly matched, so a move repairs
+ * the few lines it touched with augmenting paths instead of matching everything again. A line
+ * without a perfect matching proves the board cannot be completed; the converse does not hold.
+ */
+
+#ifndef CANDIDATES_H
+#define CANDIDATES_H
+
+#include "latinsquare.h"
+
+#define CANDIDATE_TEXT_BYTES (4 * MAX_SIZE + 1) // Room for the candidates of a cell as text
+#define HALL_TEXT_BYTES 64                      // Room for the description of a line failing Hall's condition
+
+/**
+ * @brief Represents a set of indices in [0..capacity) with constant time updates.
+ */
+typedef struct indexset
+{
+    int *members;  /**< The indices of the set, in no particular order */
+    int *position; /**< Position of each index in members, -1 when absent */
+    int count;     /**< Number of indices in the set */
+} INDEXSET;
+
+/**
+ * @brief Represents the Hall matchings of the candidate sets of a game.
+ *
+ * Line L is row L for L < size, column L - size, then value L - 2 * size + 1. Its left vertices
+ * are the columns of the empty cells of the row, the rows of the empty cells of the column, or
+ * the rows missing the value; its right vertices are the missing values, or the columns missing
+ * the value. Vertex k of line L is indexed L * size + k.
+ */
+typedef struct matchings
+{
+    bool strict;        /**< Whether validateMove() rejects the moves breaking Hall's condition */
+    uint16_t *mate;     /**< Right vertex + 1 matched to each left vertex, 0 when unmatched */
+    uint16_t *owner;    /**< Left vertex + 1 matched to each right vertex, 0 when unmatched */
+    uint32_t *seen;     /**< Per right vertex: the search that last reached it */
+    uint32_t search;    /**< The current augmenting path search */
+    INDEXSET dirty;     /**< Lines whose matching may grow */
+    INDEXSET deficient; /**< Lines without a perfect matching */
+} MATCHINGS;
+
+/**
+ * @brief Represents the candidate sets of a game.
+ *
+ * Cell (i, j) is indexed i * size + j. The pair (line, value) is indexed line * size + val - 1.
+ */
+typedef struct candidates
+{
+    int size;             /**< The order of the square */
+    int words;            /**< Words per bitset */
+    uint64_t *cellMask;   /**< size * size bitsets: candidates of each cell, empty when filled */
+    uint16_t *cellCount;  /**< Candidates of each cell */
+    uint16_t *rowCount;   /**< Cells of a row that accept a value */
+    uint16_t *colCount;   /**< Cells of a column that accept a value */
+    uint16_t *rowXor;     /**< XOR of the columns of those cells of a row */
+    uint16_t *colXor;     /**< XOR of the rows of those cells of a column */
+    INDEXSET singles;     /**< Empty cells with a single candidate */
+    INDEXSET dead;        /**< Empty cells without candidates */
+    INDEXSET rowSingles;  /**< (row, value) pairs accepted by a single cell */
+    INDEXSET colSingles;  /**< (column, value) pairs accepted by a single cell */
+    MATCHINGS *matchings; /**< Hall matchings, NULL unless attachMatchings() was called */
+} CANDIDATES;
+
+/**
+ * @brief Kinds of forced moves.
+ */
+typedef enum
+{
+    HINT_NONE,   /**< No move is forced */
+    HINT_SINGLE, /**< The cell has a single candidate */
+    HINT_ROW,    /**< The value fits a single cell of the row */
+    HINT_COLUMN  /**< The value fits a single cell of the column */
+} HINT_KIND;
+
+/**
+ * @brief Represents a forced move.
+ */
+typedef struct hint
+{
+    HINT_KIND kind; /**< Why the move is forced */
+    int i;          /**< The row index (0-based) */
+    int j;          /**< The column index (0-based) */
+    int val;        /**< The value */
+} HINT;
+
+/**
+ * @brief Builds the candidate sets of a game and attaches them to it.
+ *
+ * From then on placeValue() and clearValue() keep the sets up to date, until detachCandidates().
+ *
+ * @param candidates The candidate sets to build.
+ * @param game The game, whose candidates member is set.
+ * @return false, with nothing allocated or attached, if the memory cannot be allocated.
+ */
+bool attachCandidates(CANDIDATES *candidates, GAME *game);
+
+/**
+ * @brief Detaches the candidate sets from their game and releases them.
+ *
+ * @param candidates The candidate sets.
+ * @param game The game they are attached to.
+ */
+void detachCandidates(CANDIDATES *candidates, GAME *game);
+
+/**
+ * @brief Returns the candidates of a cell.
+ *
+ * @param candidates The candidate sets.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @return The bitset of the values allowed in the cell, empty for a filled cell.
+ */
+static inline const uint64_t *cellCandidates(const CANDIDATES *candidates, int i, int j)
+{
+    return candidates->cellMask + ((size_t)i * candidates->size + j) * candidates->words;
+}
+
+/**
+ * @brief Returns the number of candidates of a cell.
+ *
+ * @param candidates The candidate sets.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @return The number of values allowed in the cell, 0 for a filled cell.
+ */
+static inline int candidateCount(const CANDIDATES *candidates, int i, int j)
+{
+    return candidates->cellCount[i * candidates->size + j];
+}
+
+/**
+ * @brief Writes the candidates of a cell as text, e.g. "1 4 7".
+ *
+ * @param candidates The candidate sets.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param buffer Receives the text, at least CANDIDATE_TEXT_BYTES bytes.
+ * @return The length of the text.
+ */
+size_t formatCandidates(const CANDIDATES *candidates, int i, int j, char *buffer);
+
+/**
+ * @brief Finds a forced move: a cell with a single candidate first, then a value that fits a
+ * single cell of a row, then of a column.
+ *
+ * @param candidates The candidate sets.
+ * @return The move, of kind HINT_NONE when no move is forced.
+ */
+HINT findHint(const CANDIDATES *candidates);
+
+/**
+ * @brief Returns a short name for the kind of a forced move.
+ *
+ * @param kind The kind returned by findHint().
+ * @return A lowercase name without spaces, e.g. "single".
+ */
+const char *hintKindName(HINT_KIND kind);
+
+/**
+ * @brief Lists the empty cells left without candidates, which make the board impossible to complete.
+ *
+ * @param candidates The candidate sets.
+ * @param cells Receives the first cells found, as i * size + j; may be NULL when max is 0.
+ * @param max The room in cells.
+ * @return The number of such cells, which may exceed max.
+ */
+int listDeadCells(const CANDIDATES *candidates, int *cells, int max);
+
+/**
+ * @brief Builds the Hall matchings of candidate sets, kept up to date from then on by every move.
+ *
+ * The matchings are released by detachCandidates().
+ *
+ * @param candidates The candidate sets, attached to the game.
+ * @param game The game.
+ * @param strict true to make validateMove() reject the moves after which the board fails Hall's
+ *        condition while it held before, as MOVE_DEAD_END.
+ * @return false, with no matchings attached, if the memory cannot be allocated.
+ */
+bool attachMatchings(CANDIDATES *candidates, const GAME *game, bool strict);
+
+/**
+ * @brief Tells whether the board passes Hall's condition, a necessary condition for a completion.
+ *
+ * @param candidates The candidate sets, with matchings attached.
+ * @return false if the board provably cannot be completed.
+ */
+static inline bool passesHall(const CANDIDATES *candidates)
+{
+    return candidates->matchings->deficient.count == 0;
+}
+
+/**
+ * @brief Describes a line that fails Hall's condition.
+ *
+ * @param candidates The candidate sets, with matchings attached.
+ * @param buffer Receives the description, e.g. "value 7 cannot be placed in every row missing it",
+ *        at least HALL_TEXT_BYTES bytes.
+ * @return false, with an empty description, if every line passes.
+ */
+bool describeHallFailure(const CANDIDATES *candidates, char *buffer);
+
+#endif // CANDIDATES_H
@@ -0,0 +1,823 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime
+
+#include "canonical.h"
+#include "batch.h"
+#include "console.h"
+#include "corpus.h"
+#include "random.h"
+#include "timing.h"
+
+#define MAX_GENERATORS 64 // Automorphisms kept to prune the search
+
+/**
+ * @brief Represents a vertex with its signature, to sort a class.
+ */
+typedef struct keyed
+{
+    uint64_t key; /**< The signature */
+    int vertex;   /**< The vertex */
+} KEYED;
+
+/**
+ * @brief Represents the set of fingerprints of the squares already copied by the dedup mode.
+ */
+typedef struct fingerprints
+{
+    uint64_t *slots; /**< Open addressing table, 0 for a free slot */
+    size_t capacity; /**< Slots, a power of 2 */
+    size_t count;    /**< Fingerprints stored */
+    size_t maxCount; /**< Fingerprints stored at most */
+} FINGERPRINTS;
+
+/**
+ * @brief Represents the state of the dedup mode.
+ */
+typedef struct dedup
+{
+    const char *filename;          /**< The corpus file created */
+    CORPUS_WRITER writer;          /**< The corpus receiving the unique squares */
+    bool open;                     /**< Whether the corpus was created */
+    bool failed;                   /**< Whether writing the corpus failed */
+    bool full;                     /**< Whether the fingerprint set reached its limit */
+    CANON canon;                   /**< Workspace of the canonical forms */
+    FINGERPRINTS seen;             /**< Fingerprints of the squares copied */
+    unsigned long long squares;    /**< Squares read */
+    unsigned long long duplicates; /**< Squares dropped */
+    unsigned long long nodes;      /**< Nodes of the canonical form searches */
+    int skipped;                   /**< Files skipped */
+} DEDUP;
+
+/**
+ * @brief Allocates the arrays of a labelling.
+ *
+ * @param leaf The labelling.
+ * @param vertices The number of vertices.
+ * @param cells The number of cells of the square.
+ */
+static void initLeaf(CANON_LEAF *leaf, int vertices, int cells)
+{
+    leaf->depth = -1;
+    leaf->path = (int *)allocOrExit(vertices * sizeof(int));
+    leaf->trace = (uint64_t *)allocOrExit((vertices + 1) * sizeof(uint64_t));
+    leaf->order = (int *)allocOrExit(vertices * sizeof(int));
+    leaf->grid = (short *)allocOrExit(cells * sizeof(short));
+}
+
+/**
+ * @brief Releases the arrays of a labelling.
+ *
+ * @param leaf The labelling.
+ */
+static void freeLeaf(CANON_LEAF *leaf)
+{
+    free(leaf->path);
+    free(leaf->trace);
+    free(leaf->order);
+    free(leaf->grid);
+}
+
+void initCanon(CANON *canon, int size)
+{
+    int vertices = 3 * size;
+    size_t levels = (size_t)vertices + 1;
+    canon->size = size;
+    canon->vertices = vertices;
+    canon->triples = 0;
+    canon->triple = (int *)allocOrExit(3 * (size_t)size * size * sizeof(int));
+    canon->protectedCell = (bool *)allocOrExit((size_t)size * size * sizeof(bool));
+    canon->degree = (int *)allocOrExit(vertices * sizeof(int));
+    canon->order = (int *)allocOrExit(levels * vertices * sizeof(int));
+    canon->cls = (int *)allocOrExit(levels * vertices * sizeof(int));
+    canon->end = (int *)allocOrExit(levels * vertices * sizeof(int));
+    canon->trace = (uint64_t *)allocOrExit(levels * sizeof(uint64_t));
+    canon->path = (int *)allocOrExit(vertices * sizeof(int));
+    canon->signature = (uint64_t *)allocOrExit(vertices * sizeof(uint64_t));
+    canon->keyed = (KEYED *)allocOrExit(vertices * sizeof(KEYED));
+    canon->parent = (int *)allocOrExit(vertices * sizeof(int));
+    canon->grid = (short *)allocOrExit((size_t)size * size * sizeof(short));
+    initLeaf(&canon->first, vertices, size * size);
+    initLeaf(&canon->best, vertices, size * size);
+    canon->bestVersion = 0;
+    canon->generators = (int *)allocOrExit((size_t)MAX_GENERATORS * vertices * sizeof(int));
+    canon->generatorCount = 0;
+    canon->nodes = 0;
+}
+
+void freeCanon(CANON *canon)
+{
+    free(canon->triple);
+    free(canon->protectedCell);
+    free(canon->degree);
+    free(canon->order);
+    free(canon->cls);
+    free(canon->end);
+    free(canon->trace);
+    free(canon->path);
+    free(canon->signature);
+    free(canon->keyed);
+    free(canon->parent);
+    free(canon->grid);
+    freeLeaf(&canon->first);
+    freeLeaf(&canon->best);
+    free(canon->generators);
+}
+
+/**
+ * @brief Orders vertices by signature, for qsort().
+ *
+ * @param a The first KEYED.
+ * @param b The second KEYED.
+ * @return A negative, zero or positive value.
+ */
+static int compareKeys(const void *a, const void *b)
+{
+    uint64_t x = ((const KEYED *)a)->key;
+    uint64_t y = ((const KEYED *)b)->key;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Refines the partition of a level until the vertices of every class see the same thing.
+ *
+ * The signature of a vertex sums a hash of the classes of the two other vertices of each of its
+ * triples, with the protection of the cell, so it only depends on the classes and not on the
+ * labels. Each class is sorted by signature and split into runs; a run keeps its first position
+ * as the name of its class, so the result is the same for isotopic squares.
+ *
+ * @param canon The workspace.
+ * @param level The level whose partition is refined in place.
+ * @param trace The invariant of the partition before the refinement.
+ * @return The invariant after the refinement, which records every split.
+ */
+static uint64_t refine(CANON *canon, int level, uint64_t trace)
+{
+    int vertices = canon->vertices;
+    int *order = canon->order + (size_t)level * vertices;
+    int *cls = canon->cls + (size_t)level * vertices;
+    int *end = canon->end + (size_t)level * vertices;
+    uint64_t *signature = canon->signature;
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        memset(signature, 0, vertices * sizeof(uint64_t));
+        for (int t = 0; t < canon->triples; t++)
+        {
+            int r = canon->triple[3 * t], c = canon->triple[3 * t + 1], s = canon->triple[3 * t + 2];
+            uint64_t flag = canon->protectedCell[t];
+            signature[r] += mixRandom(((uint64_t)cls[c] << 32 | (uint64_t)cls[s] << 1) | flag);
+            signature[c] += mixRandom(((uint64_t)cls[r] << 32 | (uint64_t)cls[s] << 1) | flag);
+            signature[s] += mixRandom(((uint64_t)cls[r] << 32 | (uint64_t)cls[c] << 1) | flag);
+        }
+
+        for (int start = 0; start < vertices; start = end[start])
+        {
+            int stop = end[start];
+            if (stop - start == 1)
+            {
+                continue;
+            }
+            KEYED *keyed = canon->keyed;
+            bool same = true;
+            for (int p = start; p < stop; p++)
+            {
+                int v = order[p];
+                keyed[p - start].key = mixRandom(signature[v] + (uint64_t)canon->degree[v]);
+                keyed[p - start].vertex = v;
+                same = same && keyed[p - start].key == keyed[0].key;
+            }
+            if (same)
+            {
+                continue;
+            }
+            qsort(keyed, stop - start, sizeof(KEYED), compareKeys);
+            changed = true;
+            int run = start;
+            for (int p = start; p < stop; p++)
+            {
+                if (keyed[p - start].key != keyed[run - start].key)
+                {
+                    end[run] = p;
+                    trace = mixRandom(trace + ((uint64_t)run << 32 | (uint64_t)p) + keyed[run - start].key);
+                    run = p;
+                }
+                order[p] = keyed[p - start].vertex;
+                cls[order[p]] = run;
+            }
+            end[run] = stop;
+            trace = mixRandom(trace + ((uint64_t)run << 32 | (uint64_t)stop) + keyed[run - start].key);
+        }
+    }
+    return trace;
+}
+
+/**
+ * @brief Copies the partition of a level to the next one, with a vertex split from its class.
+ *
+ * @param canon The workspace.
+ * @param level The level of the partition.
+ * @param v The vertex, placed first in its class as a singleton.
+ */
+static void individualize(CANON *canon, int level, int v)
+{
+    int vertices = canon->vertices;
+    size_t from = (size_t)level * vertices, to = from + vertices;
+    memcpy(canon->order + to, canon->order + from, vertices * sizeof(int));
+    memcpy(canon->cls + to, canon->cls + from, vertices * sizeof(int));
+    memcpy(canon->end + to, canon->end + from, vertices * sizeof(int));
+
+    int *order = canon->order + to;
+    int *cls = canon->cls + to;
+    int *end = canon->end + to;
+    int start = cls[v];
+    int stop = end[start];
+    int p = start;
+    while (order[p] != v)
+    {
+        p++;
+    }
+    order[p] = order[start];
+    order[start] = v;
+    end[start] = start + 1;
+    end[start + 1] = stop;
+    for (p = start + 1; p < stop; p++)
+    {
+        cls[order[p]] = start + 1;
+    }
+}
+
+/**
+ * @brief Chooses the class whose vertices are individualized next.
+ *
+ * The first class with several vertices that have triples is taken, preferring a class of
+ * another kind (rows, columns, symbols) than the vertex individualized last: alternating rows
+ * and columns fixes the symbols much sooner than individualizing every row first.
+ *
+ * @param canon The workspace.
+ * @param level The level of the partition.
+ * @return The first position of the class, or -1 when the partition gives a labelling.
+ */
+static int chooseTarget(const CANON *canon, int level)
+{
+    int vertices = canon->vertices;
+    const int *order = canon->order + (size_t)level * vertices;
+    const int *end = canon->end + (size_t)level * vertices;
+    int lastKind = level > 0 ? canon->path[level - 1] / canon->size : -1;
+    int target = -1;
+    for (int start = 0; start < vertices; start = end[start])
+    {
+        if (end[start] - start == 1)
+        {
+            continue;
+        }
+        bool isolated = true;
+        for (int p = start; p < end[start] && isolated; p++)
+        {
+            isolated = canon->degree[order[p]] == 0;
+        }
+        if (isolated)
+        {
+            continue; // Vertices without triples can take any label of their class
+        }
+        if (start / canon->size != lastKind)
+        {
+            return start;
+        }
+        if (target < 0)
+        {
+            target = start;
+        }
+    }
+    return target;
+}
+
+/**
+ * @brief Relabels the square with the positions of the vertices in a partition.
+ *
+ * @param canon The workspace.
+ * @param level The level of the partition.
+ * @param grid Receives the relabelled cells.
+ */
+static void buildGrid(CANON *canon, int level, short *grid)
+{
+    int size = canon->size;
+    const int *order = canon->order + (size_t)level * canon->vertices;
+    int *label = canon->parent; // Free while a labelling is read
+    for (int p = 0; p < canon->vertices; p++)
+    {
+        label[order[p]] = p % size;
+    }
+    memset(grid, 0, (size_t)size * size * sizeof(short));
+    for (int t = 0; t < canon->triples; t++)
+    {
+        int val = label[canon->triple[3 * t + 2]] + 1;
+        grid[label[canon->triple[3 * t]] * size + label[canon->triple[3 * t + 1]]] =
+            (short)(canon->protectedCell[t] ? -val : val);
+    }
+}
+
+/**
+ * @brief Compares two relabelled squares, cell by cell.
+ *
+ * @param a The first square.
+ * @param b The second square.
+ * @param cells The number of cells.
+ * @return A negative, zero or positive value.
+ */
+static int compareGrids(const short *a, const short *b, int cells)
+{
+    for (int k = 0; k < cells; k++)
+    {
+        if (a[k] != b[k])
+        {
+            return a[k] < b[k] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Keeps the current labelling.
+ *
+ * @param canon The workspace.
+ * @param leaf Receives the labelling.
+ * @param level The level of the labelling.
+ */
+static void saveLeaf(CANON *canon, CANON_LEAF *leaf, int level)
+{
+    int vertices = canon->vertices;
+    leaf->depth = level;
+    memcpy(leaf->path, canon->path, level * sizeof(int));
+    memcpy(leaf->trace, canon->trace, (level + 1) * sizeof(uint64_t));
+    memcpy(leaf->order, canon->order + (size_t)level * vertices, vertices * sizeof(int));
+    memcpy(leaf->grid, canon->grid, (size_t)canon->size * canon->size * sizeof(short));
+}
+
+/**
+ * @brief Records the automorphism mapping a labelling to the current one, which gives the same square.
+ *
+ * @param canon The workspace.
+ * @param leaf The labelling giving the same square.
+ * @param level The level of the current labelling.
+ * @return The level where the path of the current labelling left the path of the other one.
+ */
+static int recordAutomorphism(CANON *canon, const CANON_LEAF *leaf, int level)
+{
+    int vertices = canon->vertices;
+    if (canon->generatorCount < MAX_GENERATORS)
+    {
+        int *map = canon->generators + (size_t)canon->generatorCount++ * vertices;
+        const int *order = canon->order + (size_t)level * vertices;
+        for (int p = 0; p < vertices; p++)
+        {
+            map[leaf->order[p]] = order[p];
+        }
+    }
+    int split = 0;
+    while (split < level && split < leaf->depth && canon->path[split] == leaf->path[split])
+    {
+        split++;
+    }
+    return split;
+}
+
+/**
+ * @brief Finds the representative of a vertex in the orbits.
+ *
+ * @param parent The union-find forest.
+ * @param v The vertex.
+ * @return The representative of its orbit.
+ */
+static int findOrbit(int *parent, int v)
+{
+    while (parent[v] != v)
+    {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+/**
+ * @brief Tells whether a vertex of the target class is in the orbit of a vertex tried before it.
+ *
+ * Only the automorphisms fixing every vertex individualized on the way to the node are used:
+ * they map the branch of the earlier vertex onto the branch of this one.
+ *
+ * @param canon The workspace.
+ * @param level The level of the node.
+ * @param start The first position of the target class.
+ * @param p The position of the vertex.
+ * @return true if the branch of the vertex can be skipped.
+ */
+static bool seenOrbit(CANON *canon, int level, int start, int p)
+{
+    int vertices = canon->vertices;
+    int *parent = canon->parent;
+    for (int v = 0; v < vertices; v++)
+    {
+        parent[v] = v;
+    }
+    bool any = false;
+    for (int g = 0; g < canon->generatorCount; g++)
+    {
+        const int *map = canon->generators + (size_t)g * vertices;
+        bool fixes = true;
+        for (int k = 0; k < level && fixes; k++)
+        {
+            fixes = map[canon->path[k]] == canon->path[k];
+        }
+        if (!fixes)
+        {
+            continue;
+        }
+        any = true;
+        for (int v = 0; v < vertices; v++)
+        {
+            int a = findOrbit(parent, v), b = findOrbit(parent, map[v]);
+            parent[a < b ? b : a] = a < b ? a : b;
+        }
+    }
+    if (!any)
+    {
+        return false;
+    }
+    const int *order = canon->order + (size_t)level * vertices;
+    int orbit = findOrbit(parent, order[p]);
+    for (int q = start; q < p; q++)
+    {
+        if (findOrbit(parent, order[q]) == orbit)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Compares the labelling of a leaf with the best and the first ones.
+ *
+ * @param canon The workspace.
+ * @param level The level of the leaf.
+ * @param better Whether the invariants on the way are smaller than those of the best labelling.
+ * @return The level the search resumes at: the level of the leaf, or a smaller one after an automorphism.
+ */
+static int reachLeaf(CANON *canon, int level, bool better)
+{
+    int cells = canon->size * canon->size;
+    buildGrid(canon, level, canon->grid);
+    if (canon->first.depth < 0)
+    {
+        saveLeaf(canon, &canon->first, level);
+        saveLeaf(canon, &canon->best, level);
+        canon->bestVersion++;
+        return level;
+    }
+
+    int cmp = better || level < canon->best.depth ? -1 : compareGrids(canon->grid, canon->best.grid, cells);
+    if (cmp < 0)
+    {
+        saveLeaf(canon, &canon->best, level);
+        canon->bestVersion++;
+    }
+    if (compareGrids(canon->grid, canon->first.grid, cells) == 0)
+    {
+        return recordAutomorphism(canon, &canon->first, level);
+    }
+    if (cmp == 0)
+    {
+        return recordAutomorphism(canon, &canon->best, level);
+    }
+    return level;
+}
+
+/**
+ * @brief Searches the labellings below a node of the search tree.
+ *
+ * @param canon The workspace.
+ * @param level The level of the node, whose partition is refined and whose trace is set.
+ * @param better Whether the invariants on the way are smaller than those of the best labelling.
+ * @return The level the search resumes at: the level of the node, or a smaller one after an automorphism.
+ */
+static int searchNode(CANON *canon, int level, bool better)
+{
+    canon->nodes++;
+    if (!better && canon->best.depth >= 0)
+    {
+        if (level > canon->best.depth || canon->trace[level] > canon->best.trace[level])
+        {
+            return level; // Every labelling below gives a larger square
+        }
+        better = canon->trace[level] < canon->best.trace[level];
+    }
+
+    int start = chooseTarget(canon, level);
+    if (start < 0)
+    {
+        return reachLeaf(canon, level, better);
+    }
+
+    const int *order = canon->order + (size_t)level * canon->vertices;
+    int stop = canon->end[(size_t)level * canon->vertices + start];
+    unsigned version = canon->bestVersion;
+    for (int p = start; p < stop; p++)
+    {
+        if (p > start && seenOrbit(canon, level, start, p))
+        {
+            continue;
+        }
+        canon->path[level] = order[p];
+        individualize(canon, level, order[p]);
+        canon->trace[level + 1] = refine(canon, level + 1, mixRandom(canon->trace[level] + (uint64_t)start));
+        int resume = searchNode(canon, level + 1, better);
+        if (resume < level)
+        {
+            return resume;
+        }
+        if (canon->bestVersion != version)
+        {
+            better = false; // The best labelling now goes through this node
+            version = canon->bestVersion;
+        }
+    }
+    return level;
+}
+
+unsigned long long canonicalForm(CANON *canon, const GAME *game, short *canonical)
+{
+    int size = canon->size;
+    int vertices = canon->vertices;
+    canon->triples = 0;
+    memset(canon->degree, 0, vertices * sizeof(int));
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int val = getCell(game, i, j);
+            if (val != 0)
+            {
+                int *triple = canon->triple + 3 * canon->triples;
+                triple[0] = i;
+                triple[1] = size + j;
+                triple[2] = 2 * size + abs(val) - 1;
+                canon->protectedCell[canon->triples++] = val < 0;
+                canon->degree[triple[0]]++;
+                canon->degree[triple[1]]++;
+                canon->degree[triple[2]]++;
+            }
+        }
+    }
+
+    // Rows, columns and symbols are never mixed: they start as three classes
+    for (int v = 0; v < vertices; v++)
+    {
+        canon->order[v] = v;
+        canon->cls[v] = v / size * size;
+    }
+    canon->end[0] = size;
+    canon->end[size] = 2 * size;
+    canon->end[2 * size] = 3 * size;
+
+    canon->first.depth = -1;
+    canon->best.depth = -1;
+    canon->generatorCount = 0;
+    canon->nodes = 0;
+    canon->trace[0] = refine(canon, 0, (uint64_t)size);
+    searchNode(canon, 0, false);
+    memcpy(canonical, canon->best.grid, (size_t)size * size * sizeof(short));
+    return canon->nodes;
+}
+
+uint64_t canonicalHash(CANON *canon, const GAME *game)
+{
+    int cells = canon->size * canon->size;
+    canonicalForm(canon, game, canon->grid);
+    uint64_t hash = (uint64_t)canon->size;
+    for (int k = 0; k < cells; k++)
+    {
+        hash = mixRandom(hash + GOLDEN_GAMMA + (uint16_t)canon->grid[k]);
+    }
+    return hash;
+}
+
+/**
+ * @brief Adds a fingerprint to the set, doubling the table while it stays under its limit.
+ *
+ * @param set The set.
+ * @param fingerprint The fingerprint.
+ * @param full Set when the fingerprint is not stored because the set is full.
+ * @return false if the fingerprint was already in the set.
+ */
+static bool addFingerprint(FINGERPRINTS *set, uint64_t fingerprint, bool *full)
+{
+    fingerprint = fingerprint == 0 ? 1 : fingerprint; // 0 marks a free slot
+    size_t mask = set->capacity - 1;
+    size_t k = (size_t)fingerprint & mask;
+    while (set->slots[k] != 0)
+    {
+        if (set->slots[k] == fingerprint)
+        {
+            return false;
+        }
+        k = (k + 1) & mask;
+    }
+    if (set->count >= set->maxCount)
+    {
+        *full = true;
+        return true;
+    }
+    set->slots[k] = fingerprint;
+    set->count++;
+
+    if (2 * set->count > set->capacity && set->capacity < 2 * set->maxCount)
+    {
+        size_t capacity = set->capacity * 2;
+        uint64_t *slots = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+        if (slots == NULL)
+        {
+            perror("Error allocating memory");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t s = 0; s < set->capacity; s++)
+        {
+            if (set->slots[s] != 0)
+            {
+                size_t t = (size_t)set->slots[s] & (capacity - 1);
+                while (slots[t] != 0)
+                {
+                    t = (t + 1) & (capacity - 1);
+                }
+                slots[t] = set->slots[s];
+            }
+        }
+        free(set->slots);
+        set->slots = slots;
+        set->capacity = capacity;
+    }
+    return true;
+}
+
+/**
+ * @brief Copies a square to the corpus unless a square of its isotopy class was copied before.
+ *
+ * @param dedup The dedup state.
+ * @param game The square.
+ * @param name Its name in the corpus.
+ */
+static void dedupSquare(DEDUP *dedup, const GAME *game, const char *name)
+{
+    if (!dedup->open)
+    {
+        // The first square gives the order of the corpus
+        if (!createCorpus(&dedup->writer, dedup->filename, game->size, true))
+        {
+            perror(dedup->filename);
+            dedup->failed = true;
+        }
+        initCanon(&dedup->canon, game->size);
+        dedup->open = true;
+    }
+    if (dedup->failed)
+    {
+        return;
+    }
+    if (game->size != dedup->writer.size)
+    {
+        printf("wrong-size %s\n", name);
+        dedup->skipped++;
+        return;
+    }
+
+    dedup->squares++;
+    bool full = false;
+    bool unique = addFingerprint(&dedup->seen, canonicalHash(&dedup->canon, game), &full);
+    dedup->nodes += dedup->canon.nodes;
+    if (full && !dedup->full)
+    {
+        fprintf(stderr, "%s: %zu canonical forms remembered, later squares may be duplicates\n", dedup->filename,
+                dedup->seen.count);
+        dedup->full = true;
+    }
+    if (!unique)
+    {
+        dedup->duplicates++;
+    }
+    else if (!dedup->failed && !appendCorpus(&dedup->writer, game, name))
+    {
+        perror(dedup->filename);
+        dedup->failed = true;
+    }
+}
+
+/**
+ * @brief Visitor of the dedup files: loads a game file, or every record of a corpus, and deduplicates it.
+ *
+ * @param path The name of the file.
+ * @param context The DEDUP.
+ */
+static void dedupFile(const char *path, void *context)
+{
+    DEDUP *dedup = (DEDUP *)context;
+    if (dedup->failed)
+    {
+        return;
+    }
+    if (strcmp(path, dedup->filename) == 0)
+    {
+        printf("output-file %s\n", path); // Being rewritten, it cannot be read
+        dedup->skipped++;
+        return;
+    }
+
+    GAME game;
+    if (!isCorpusFile(path))
+    {
+        LOAD_STATUS status = loadLatinSquare(&game, path);
+        if (status != LOAD_OK)
+        {
+            printf("%s %s\n", loadStatusName(status), path);
+            dedup->skipped++;
+            return;
+        }
+        dedupSquare(dedup, &game, path);
+        freeGame(&game);
+        return;
+    }
+
+    CORPUS corpus;
+    if (!openCorpus(&corpus, path))
+    {
+        perror(path);
+        dedup->skipped++;
+        return;
+    }
+    initGameOrExit(&game, corpus.size);
+    for (uint64_t k = 0; k < corpus.count && !dedup->failed; k++)
+    {
+        char name[MAX_PATH];
+        const char *stored = corpusName(&corpus, k);
+        if (stored == NULL)
+        {
+            snprintf(name, sizeof(name), "%s#%llu", path, (unsigned long long)k);
+            stored = name;
+        }
+        LOAD_STATUS status = decodeRecord(&game, corpusRecord(&corpus, k), corpus.valueBits);
+        if (status != LOAD_OK)
+        {
+            printf("%s %s\n", loadStatusName(status), stored);
+            dedup->skipped++;
+        }
+        else
+        {
+            dedupSquare(dedup, &game, stored);
+        }
+    }
+    freeGame(&game);
+    closeCorpus(&corpus);
+}
+
+int runDedup(const char *corpusFile, char *paths[], int count, long maxUnique)
+{
+    DEDUP dedup;
+    dedup.filename = corpusFile;
+    dedup.open = false;
+    dedup.failed = false;
+    dedup.full = false;
+    dedup.seen.maxCount = maxUnique < 1 ? DEFAULT_MAX_UNIQUE : (size_t)maxUnique;
+    dedup.seen.capacity = 1024;
+    dedup.seen.slots = (uint64_t *)calloc(dedup.seen.capacity, sizeof(uint64_t));
+    dedup.seen.count = 0;
+    if (dedup.seen.slots == NULL)
+    {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+    dedup.squares = 0;
+    dedup.duplicates = 0;
+    dedup.nodes = 0;
+    dedup.skipped = 0;
+
+    double start = now();
+    forEachGameFile(paths, count, false, dedupFile, &dedup);
+    free(dedup.seen.slots);
+
+    if (!dedup.open)
+    {
+        printf("No game file to deduplicate\n");
+        return -1;
+    }
+    freeCanon(&dedup.canon);
+    if (dedup.writer.file != NULL && !finishCorpus(&dedup.writer) && !dedup.failed)
+    {
+        perror(corpusFile);
+        dedup.failed = true;
+    }
+    if (!dedup.failed)
+    {
+        fprintf(stderr, "%llu squares of order %d, %llu unique, %llu duplicates, %d skipped, %llu nodes, %.3f s\n",
+                dedup.squares, dedup.writer.size, dedup.squares - dedup.duplicates, dedup.duplicates, dedup.skipped,
+                dedup.nodes, now() - start);
+    }
+    return dedup.failed ? -1 : dedup.skipped;
+}
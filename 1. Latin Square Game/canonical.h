@@ -0,0 +1,124 @@
+/**
+ * @file canonical.h
+ * @brief Declarations of the canonical form of partial Latin squares up to isotopy, and of the dedup mode.
+ *
+ * Two squares are isotopic when one is obtained from the other by permuting its rows, its
+ * columns and its symbols. A square is seen as a set of (row, column, symbol) triples over three
+ * disjoint sets of vertices, and the canonical form is the smallest relabelled square over the
+ * labellings produced by an individualization-refinement search, as in graph canonization:
+ *
+ * - the vertices are split into classes that no isotopy can mix, refined until every vertex of a
+ *   class sees the same multiset of (class, class, protection) pairs through its triples;
+ * - a vertex of a class that is not a singleton is individualized and the classes refined again,
+ *   until every class is a singleton (or holds vertices without any triple, which can take any
+ *   label), which gives a labelling;
+ * - every refinement leaves an invariant, and a branch whose invariants are larger than those of
+ *   the best labelling found so far is cut, since it cannot lead to a smaller square;
+ * - two labellings giving the same square reveal an automorphism; the search then jumps back to
+ *   where the two branches split, and skips the branches in the same orbit as one already searched.
+ *
+ * Protected cells stay protected, so a puzzle and the same puzzle with moves made are different.
+ */
+
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include "latinsquare.h"
+
+#define DEFAULT_MAX_UNIQUE (1 << 22) // Canonical forms remembered by the dedup mode when no limit is given
+
+/**
+ * @brief Represents a labelling reached by the search, kept to compare the next ones with.
+ */
+typedef struct canonleaf
+{
+    int depth;       /**< Vertices individualized to reach it, -1 when there is none yet */
+    int *path;       /**< The vertices individualized, in order */
+    uint64_t *trace; /**< The invariant of each level on the way */
+    int *order;      /**< The vertex at each position of the final partition */
+    short *grid;     /**< The square relabelled by it */
+} CANON_LEAF;
+
+/**
+ * @brief Represents the workspace of the canonical form of the squares of one order.
+ */
+typedef struct canon
+{
+    int size;                 /**< The order of the squares */
+    int vertices;             /**< 3 * size: rows, then columns, then symbols */
+    int triples;              /**< Filled cells of the square */
+    int *triple;              /**< Row, column and symbol vertex of each filled cell */
+    bool *protectedCell;      /**< Whether each filled cell is protected */
+    int *degree;              /**< Filled cells through each vertex */
+    int *order;               /**< Per level: the vertices, class by class */
+    int *cls;                 /**< Per level: the first position of the class of each vertex */
+    int *end;                 /**< Per level: the end of each class, at its first position */
+    uint64_t *trace;          /**< Per level: the invariant of the refinement that produced it */
+    int *path;                /**< The vertex individualized at each level */
+    uint64_t *signature;      /**< What each vertex sees through its triples, during a refinement */
+    struct keyed *keyed;      /**< Scratch of the sort of a class by signature */
+    int *parent;              /**< Scratch of the orbits (union-find) */
+    short *grid;              /**< The square relabelled by the current labelling */
+    CANON_LEAF first;         /**< The first labelling reached */
+    CANON_LEAF best;          /**< The labelling giving the smallest square so far */
+    unsigned bestVersion;     /**< Incremented when the best labelling changes */
+    int *generators;          /**< Automorphisms found, as vertex maps */
+    int generatorCount;       /**< Automorphisms kept */
+    unsigned long long nodes; /**< Nodes of the last search */
+} CANON;
+
+/**
+ * @brief Allocates the workspace of the canonical form for squares of one order.
+ *
+ * @param canon The workspace.
+ * @param size The order of the squares.
+ */
+void initCanon(CANON *canon, int size);
+
+/**
+ * @brief Releases the workspace of the canonical form.
+ *
+ * @param canon The workspace.
+ */
+void freeCanon(CANON *canon);
+
+/**
+ * @brief Computes the canonical form of a square: the same for every square of its isotopy class.
+ *
+ * @param canon A workspace of the order of the game.
+ * @param game The game holding the square; empty cells are 0 and protected values negative.
+ * @param canonical Receives the size * size cells of the canonical form, with the same conventions.
+ * @return The number of nodes searched.
+ */
+unsigned long long canonicalForm(CANON *canon, const GAME *game, short *canonical);
+
+/**
+ * @brief Returns a 64-bit fingerprint of the canonical form of a square.
+ *
+ * @param canon A workspace of the order of the game.
+ * @param game The game holding the square.
+ * @return The same value for every square of the isotopy class (different classes collide with
+ *         probability about 2^-64).
+ */
+uint64_t canonicalHash(CANON *canon, const GAME *game);
+
+/**
+ * @brief Copies the squares of game files into a new corpus, dropping the ones isotopic to a square already copied.
+ *
+ * The arguments are walked like the ones of runBatch(), corpus files included (their records are
+ * named <corpus>#<k> when the corpus has no index), in one pass. Only the fingerprints of the
+ * canonical forms are remembered, in a hash set that grows up to maxUnique entries. Once it is
+ * full the squares not seen are still copied but no longer remembered, so some later duplicates
+ * may be copied too. Files that cannot be loaded, or whose order differs from the order of the
+ * first one, are reported and skipped like in packCorpus(). A summary is printed on the standard
+ * error.
+ *
+ * @param corpusFile The name of the corpus file to create.
+ * @param paths The file, directory or "-" arguments.
+ * @param count The number of arguments.
+ * @param maxUnique The number of fingerprints remembered at most, below 1 for DEFAULT_MAX_UNIQUE.
+ * @return The number of files skipped, or -1 if the corpus could not be written.
+ */
+int runDedup(const char *corpusFile, char *paths[], int count, long maxUnique);
+
+#endif // CANONICAL_H
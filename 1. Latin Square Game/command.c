@@ -0,0 +1,174 @@
+#include "command.h"
+#include <ctype.h>
+
+/**
+ * @brief Reads one number of a command, skipping the blanks before it.
+ *
+ * @param text Where to read, moved past the number.
+ * @param number Receives the number, clamped to [-MAX_SIZE - 1..MAX_SIZE + 1].
+ * @return true if a number was read.
+ */
+static bool parseNumber(const char **text, int *number)
+{
+    char *end;
+    long value = strtol(*text, &end, 10);
+    if (end == *text)
+    {
+        return false;
+    }
+    *text = end;
+    *number = value > MAX_SIZE + 1 ? MAX_SIZE + 1 : value < -MAX_SIZE - 1 ? -MAX_SIZE - 1 : (int)value;
+    return true;
+}
+
+/**
+ * @brief Tells whether only blanks are left in a line.
+ *
+ * @param text The rest of the line.
+ * @return true if the line ends there.
+ */
+static bool atLineEnd(const char *text)
+{
+    while (isspace((unsigned char)*text))
+    {
+        text++;
+    }
+    return *text == '\0';
+}
+
+COMMAND parseCommand(const char *line)
+{
+    COMMAND command = {COMMAND_INVALID, 0, 0, 0, line};
+    const char *text = line;
+    while (isspace((unsigned char)*text))
+    {
+        text++;
+    }
+    command.text = text;
+
+    switch (*text)
+    {
+    case '\0':
+    case '#':
+        command.kind = COMMAND_NONE; // Blank line or comment
+        return command;
+    case 'u':
+    case 'r':
+    case 's':
+    case 'h':
+    case 'd':
+        if (atLineEnd(text + 1))
+        {
+            command.kind = *text == 'u'   ? COMMAND_UNDO
+                           : *text == 'r' ? COMMAND_REDO
+                           : *text == 's' ? COMMAND_SAVE
+                           : *text == 'h' ? COMMAND_HINT
+                                          : COMMAND_DEAD;
+        }
+        return command;
+    case 'c':
+        text++;
+        if (parseNumber(&text, &command.i) && *text++ == ',' && parseNumber(&text, &command.j) && atLineEnd(text))
+        {
+            command.kind = COMMAND_CANDIDATES;
+        }
+        return command;
+    }
+
+    if (parseNumber(&text, &command.i) && *text++ == ',' && parseNumber(&text, &command.j) && *text++ == '=' &&
+        parseNumber(&text, &command.val) && atLineEnd(text))
+    {
+        command.kind = COMMAND_MOVE;
+    }
+    return command;
+}
+
+MOVE_STATUS applyMove(GAME *game, JOURNAL *journal, const COMMAND *command)
+{
+    int before;
+    MOVE_STATUS status = playMove(game, command->i - 1, command->j - 1, command->val, &before);
+    if (status == MOVE_OK && before != command->val)
+    {
+        recordMove(journal, command->i - 1, command->j - 1, before, command->val);
+    }
+    return status;
+}
+
+MOVE_STATUS evaluateQuery(const GAME *game, const CANDIDATES *candidates, const COMMAND *command, QUERY *query)
+{
+    int size = game->size;
+    if (command->kind == COMMAND_CANDIDATES)
+    {
+        int i = command->i, j = command->j;
+        if (i < 1 || i > size || j < 1 || j > size)
+        {
+            return MOVE_OUT_OF_RANGE;
+        }
+        return getCell(game, i - 1, j - 1) != 0 ? MOVE_OCCUPIED : MOVE_OK;
+    }
+
+    query->deadCount = listDeadCells(candidates, query->dead, MAX_DEAD_LISTED);
+    query->hint.kind = HINT_NONE;
+    if (command->kind == COMMAND_HINT && query->deadCount == 0)
+    {
+        query->hint = findHint(candidates);
+    }
+    return MOVE_OK;
+}
+
+MOVE_STATUS answerQuery(const GAME *game, const CANDIDATES *candidates, const COMMAND *command, char *buffer,
+                        size_t *length)
+{
+    int size = game->size;
+    char *out = buffer;
+    *length = 0;
+    QUERY query;
+    MOVE_STATUS status = evaluateQuery(game, candidates, command, &query);
+    if (status != MOVE_OK)
+    {
+        return status;
+    }
+    if (command->kind == COMMAND_CANDIDATES)
+    {
+        int i = command->i, j = command->j;
+        out += sprintf(out, "candidates %d,%d:", i, j);
+        if (candidateCount(candidates, i - 1, j - 1) > 0)
+        {
+            *out++ = ' ';
+            out += formatCandidates(candidates, i - 1, j - 1, out);
+        }
+        *out++ = '\n';
+        *length = (size_t)(out - buffer);
+        return MOVE_OK;
+    }
+
+    const int *dead = query.dead;
+    int deadCount = query.deadCount;
+    if (command->kind == COMMAND_HINT)
+    {
+        HINT hint = query.hint;
+        if (deadCount > 0)
+        {
+            out += sprintf(out, "hint dead %d,%d\n", dead[0] / size + 1, dead[0] % size + 1);
+        }
+        else if (hint.kind != HINT_NONE)
+        {
+            out += sprintf(out, "hint %d,%d=%d %s\n", hint.i + 1, hint.j + 1, hint.val, hintKindName(hint.kind));
+        }
+        else
+        {
+            out += sprintf(out, "hint none\n");
+        }
+    }
+    else
+    {
+        out += sprintf(out, "dead %d", deadCount);
+        for (int k = 0; k < deadCount && k < MAX_DEAD_LISTED; k++)
+        {
+            out += sprintf(out, " %d,%d", dead[k] / size + 1, dead[k] % size + 1);
+        }
+        out += sprintf(out, deadCount > MAX_DEAD_LISTED ? " ...\n" : "\n");
+    }
+    *length = (size_t)(out - buffer);
+    return MOVE_OK;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file command.h
+ * @brief Declarations of the parser of the game commands shared by the scripted mode and the server.
+ *
+ * The commands are the ones of play(), one per line: "i,j=val" fills or clears a cell ("0,0=0"
+ * saves and ends the game), "u" and "r" undo and redo a move, "s" saves the journal, "c i,j"
+ * lists the candidates of a cell, "h" gives a hint and "d" lists the cells without candidates.
+ * Blank lines and lines starting with '#' hold no command.
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "latinsquare.h"
+#include "candidates.h"
+#include "journal.h"
+
+#define QUERY_ANSWER_BYTES (CANDIDATE_TEXT_BYTES + 128) // Room for the answer to a c, h or d command
+#define MAX_DEAD_LISTED 8                                // Cells without candidates listed by the d command
+
+/**
+ * @brief Kinds of command lines.
+ */
+typedef enum
+{
+    COMMAND_NONE,       /**< A blank line or a comment */
+    COMMAND_MOVE,       /**< i,j=val */
+    COMMAND_UNDO,       /**< u */
+    COMMAND_REDO,       /**< r */
+    COMMAND_SAVE,       /**< s */
+    COMMAND_CANDIDATES, /**< c i,j */
+    COMMAND_HINT,       /**< h */
+    COMMAND_DEAD,       /**< d */
+    COMMAND_INVALID     /**< Anything else */
+} COMMAND_KIND;
+
+/**
+ * @brief Represents a parsed command line.
+ */
+typedef struct command
+{
+    COMMAND_KIND kind; /**< The kind of command */
+    int i;             /**< The row (1-based) of a move or of a c command */
+    int j;             /**< The column (1-based) of a move or of a c command */
+    int val;           /**< The value of a move */
+    const char *text;  /**< The command, after the blanks that start the line */
+} COMMAND;
+
+/**
+ * @brief Represents what a c, h or d command asks about the candidates of a game.
+ */
+typedef struct query
+{
+    HINT hint;                 /**< h: the forced move, HINT_NONE if none */
+    int deadCount;             /**< h and d: the number of empty cells accepting no value */
+    int dead[MAX_DEAD_LISTED]; /**< h and d: the first of them, as flat indices */
+} QUERY;
+
+/**
+ * @brief Parses a command line, with the rules of the scanf() of play().
+ *
+ * Numbers too large for the board are clamped to a value that is still out of range, so they
+ * are rejected like the other out of range moves.
+ *
+ * @param line The line, with or without its end of line.
+ * @return The command; only the fields its kind uses are set.
+ */
+COMMAND parseCommand(const char *line);
+
+/**
+ * @brief Validates a move and applies it, recording it in a journal.
+ *
+ * Clearing an empty cell is accepted and changes nothing.
+ *
+ * @param game The game.
+ * @param journal The journal of the game.
+ * @param command A COMMAND_MOVE other than 0,0=0.
+ * @return MOVE_OK if the move was applied, otherwise the reason it was rejected.
+ */
+MOVE_STATUS applyMove(GAME *game, JOURNAL *journal, const COMMAND *command);
+
+/**
+ * @brief Looks up what a c, h or d command asks, for the frontends to word the answer.
+ *
+ * A c command only checks its cell, whose values are then read with formatCandidates().
+ *
+ * @param game The game.
+ * @param candidates The candidate sets of the game.
+ * @param command A COMMAND_CANDIDATES, COMMAND_HINT or COMMAND_DEAD.
+ * @param query Receives the hint and the cells accepting no value of an h or d command.
+ * @return MOVE_OK, or MOVE_OUT_OF_RANGE or MOVE_OCCUPIED for the cell of a c command.
+ */
+MOVE_STATUS evaluateQuery(const GAME *game, const CANDIDATES *candidates, const COMMAND *command, QUERY *query);
+
+/**
+ * @brief Answers a question about the candidates of a game: the c, h and d commands.
+ *
+ * The answers, worded from evaluateQuery(), are
+ *
+ *     candidates <i>,<j>: <values accepted by the cell>
+ *     hint <i>,<j>=<val> single|row|column, hint dead <i>,<j> or hint none
+ *     dead <count> <i>,<j> ... (the first empty cells accepting no value)
+ *
+ * each followed by an end of line.
+ *
+ * @param game The game.
+ * @param candidates The candidate sets of the game.
+ * @param command A COMMAND_CANDIDATES, COMMAND_HINT or COMMAND_DEAD.
+ * @param buffer Receives the answer, at least QUERY_ANSWER_BYTES bytes.
+ * @param length Receives the length of the answer, 0 when the command is rejected.
+ * @return MOVE_OK if the command was answered, otherwise why the cell of a c command was rejected.
+ */
+MOVE_STATUS answerQuery(const GAME *game, const CANDIDATES *candidates, const COMMAND *command, char *buffer,
+                        size_t *length);
+
+#endif // COMMAND_H
@@ -0,0 +1,485 @@
+/**
+ * @file console.c
+ * @brief The console frontend of the game, built on the board model of latinsquare.c.
+ *
+ * @author Spyros Gavriil
+ * @since 26/09/2024
+ * @bug No known bugs.
+ */
+
+#include "console.h"
+#include "candidates.h"
+#include "command.h"
+#include "journal.h"
+#include "screen.h"
+
+#define QUERY_LINE_BYTES 64 // Longest c, h or d command line read by the console
+
+/**
+ * @brief Prints the message of a rejected move.
+ *
+ * @param game The game holding the Latin square.
+ * @param status The outcome of checking the move; nothing is printed for MOVE_OK.
+ */
+static void printMoveError(const GAME *game, MOVE_STATUS status)
+{
+    switch (status)
+    {
+    case MOVE_OK:
+        break;
+    case MOVE_OUT_OF_RANGE:
+        printf("Error: i,j or val are outside the allowed range [1..%d]!\n", game->size);
+        break;
+    case MOVE_PROTECTED:
+        printf("Error: illegal to clear cell!\n");
+        break;
+    case MOVE_OCCUPIED:
+        printf("Error: cell is already occupied!\n");
+        break;
+    case MOVE_DUPLICATE:
+        printf("Error: Illegal value insertion!\n");
+        break;
+    case MOVE_DEAD_END:
+        printf("Error: the square could no longer be completed!\n");
+        break;
+    }
+}
+
+/**
+ * @brief Reads a Latin square from the specified file.
+ *
+ * This function opens the file, reads the size of the Latin square, and fills the array
+ * with the values from the file. The row and column occupancy bitsets are built in the
+ * same pass, so duplicate givens are rejected as soon as they are read. If the file
+ * contains invalid data or cannot be opened, the function prints an error and exits the program.
+ *
+ * @param game The game where the Latin square will be stored.
+ * @param filename The name of the file containing the Latin square.
+ */
+void readLatinSquare(GAME *game, const char *filename)
+{
+    switch (loadLatinSquare(game, filename))
+    {
+    case LOAD_OK:
+        return;
+    case LOAD_OPEN_FAILED:
+        perror("Error opening file");
+        exit(1); // Exit the program if file can't be opened
+    case LOAD_INVALID_SIZE:
+        printf("Invalid size in file. Max allowed size is %d\n", MAX_SIZE);
+        break;
+    case LOAD_INVALID_VALUE:
+        printf("File contains invalid values!\n");
+        break;
+    case LOAD_OUT_OF_RANGE:
+        printf("File contains invalid values\n");
+        break;
+    case LOAD_DUPLICATE:
+        printf("File contains duplicate values!\n");
+        break;
+    case LOAD_EXTRA_DATA:
+        printf("File contains more data than expected!\n");
+        break;
+    case LOAD_NO_SPACE: // Only for the blocks of parseLatinSquare(), files are loaded on the heap
+        break;
+    case LOAD_NO_MEMORY:
+        printf("Not enough memory to load the file!\n");
+        break;
+    }
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Displays a Latin square in a formatted grid with boundaries.
+ *
+ * This function prints a Latin square of given size in a well-formatted table.
+ * Each element in the square is surrounded by boundaries (| and +) and negative
+ * numbers are displayed in parentheses.
+ *
+ * @param game The game holding the Latin square.
+ *
+ */
+void displayLatinSquare(const GAME *game)
+{
+    // The board is drawn in memory and printed with one call instead of one per cell
+    char *buffer = (char *)allocOrExit(boardTextSize(game->size));
+    size_t length = renderLatinSquare(game, buffer);
+    fwrite(buffer, 1, length, stdout);
+    free(buffer);
+}
+
+/**
+ * @brief Answers a question about the candidates of the game: the c, h and d commands.
+ *
+ * The rest of the command line is read from the standard input and the whole line is parsed
+ * with parseCommand(), then evaluateQuery() finds the answer, worded here for the player.
+ *
+ * @param game The game holding the Latin square.
+ * @param candidates The candidate sets of the game.
+ * @param letter The command letter, already read.
+ */
+static void printQuery(const GAME *game, const CANDIDATES *candidates, int letter)
+{
+    char line[QUERY_LINE_BYTES];
+    size_t length = 0;
+    line[length++] = (char)letter;
+    bool whole = true;
+    int rest;
+    while ((rest = getchar()) != '\n' && rest != EOF)
+    {
+        if (length + 1 < sizeof(line))
+        {
+            line[length++] = (char)rest;
+        }
+        else
+        {
+            whole = false; // Too long for any valid command
+        }
+    }
+    line[length] = '\0';
+    printf("\n");
+
+    COMMAND command = parseCommand(line);
+    if (!whole || command.kind == COMMAND_INVALID)
+    {
+        printf("Error: wrong format of command!\n");
+        return;
+    }
+    int size = candidates->size;
+    int i = command.i, j = command.j;
+    QUERY query;
+    MOVE_STATUS status = evaluateQuery(game, candidates, &command, &query);
+    if (command.kind == COMMAND_CANDIDATES)
+    {
+        if (status == MOVE_OUT_OF_RANGE)
+        {
+            printf("Error: i,j are outside the allowed range [1..%d]!\n", size);
+        }
+        else if (status == MOVE_OCCUPIED)
+        {
+            printf("Cell (%d,%d) is already occupied\n", i, j);
+        }
+        else if (candidateCount(candidates, i - 1, j - 1) > 0)
+        {
+            char text[CANDIDATE_TEXT_BYTES];
+            formatCandidates(candidates, i - 1, j - 1, text);
+            printf("Cell (%d,%d) accepts: %s\n", i, j, text);
+        }
+        else
+        {
+            printf("Cell (%d,%d) accepts no value, undo some moves!\n", i, j);
+        }
+        return;
+    }
+
+    const int *dead = query.dead;
+    int deadCount = query.deadCount;
+    if (command.kind == COMMAND_HINT)
+    {
+        HINT hint = query.hint;
+        if (deadCount > 0)
+        {
+            printf("No hint: cell (%d,%d) accepts no value, undo some moves!\n", dead[0] / size + 1,
+                   dead[0] % size + 1);
+        }
+        else if (hint.kind == HINT_SINGLE)
+        {
+            printf("Hint: %d,%d=%d is the only value the cell accepts\n", hint.i + 1, hint.j + 1, hint.val);
+        }
+        else if (hint.kind == HINT_ROW)
+        {
+            printf("Hint: %d,%d=%d is the only cell of row %d accepting %d\n", hint.i + 1, hint.j + 1, hint.val,
+                   hint.i + 1, hint.val);
+        }
+        else if (hint.kind == HINT_COLUMN)
+        {
+            printf("Hint: %d,%d=%d is the only cell of column %d accepting %d\n", hint.i + 1, hint.j + 1,
+                   hint.val, hint.j + 1, hint.val);
+        }
+        else
+        {
+            printf("No move is forced\n");
+        }
+        return;
+    }
+
+    if (deadCount == 0)
+    {
+        printf("Every empty cell accepts a value\n");
+        return;
+    }
+    printf("%d empty cell%s accept%s no value:", deadCount, deadCount == 1 ? "" : "s", deadCount == 1 ? "s" : "");
+    for (int k = 0; k < deadCount && k < MAX_DEAD_LISTED; k++)
+    {
+        printf(" (%d,%d)", dead[k] / size + 1, dead[k] % size + 1);
+    }
+    printf(deadCount > MAX_DEAD_LISTED ? " ...\n" : "\n");
+}
+
+/**
+ * @brief Warns once the board fails Hall's condition, i.e. provably cannot be completed any more.
+ *
+ * @param candidates The candidate sets of the game, with matchings attached.
+ * @param passing Whether the board passed the condition at the last call; updated.
+ */
+static void warnDeadEnd(const CANDIDATES *candidates, bool *passing)
+{
+    char reason[HALL_TEXT_BYTES];
+    bool failing = describeHallFailure(candidates, reason);
+    if (*passing && failing)
+    {
+        printf("Warning: the square can no longer be completed, %s!\n", reason);
+    }
+    *passing = !failing;
+}
+
+/**
+ * @brief Plays a Latin square game where the user can input values into the square.
+ *
+ * The function repeatedly displays the current state of the Latin square and prompts
+ * the user for input to modify the square. The input can either set a value, clear a
+ * cell, undo or redo a move, save the moves, ask for the values a cell accepts, a hint or the
+ * cells left without any value, or end the game. The game ends when the user
+ * inputs the command to save and exit or when the Latin square is completely filled with
+ * non-zero values. Every move is appended to the journal of the game, so a session that ends
+ * without saving is resumed the next time the same game file is played. On a terminal the
+ * board stays at the top of the screen and only its changed cells are drawn again (see screen.h).
+ * A warning is printed when the board stops passing Hall's condition (see candidates.h) and can
+ * no longer be completed.
+ *
+ * @param game The game holding the Latin square.
+ * @param filename The name of the file where the Latin square will be saved when the game ends.
+ * @param strict true to refuse the moves after which the board can no longer be completed.
+ *
+ */
+void play(GAME *game, const char *filename, bool strict)
+{
+    int i, j, val;
+    int size = game->size;
+    bool solved = false;
+
+    JOURNAL journal;
+    long replayed = openJournal(&journal, game, filename);
+    SCREEN screen; // On a terminal the board is drawn at the top and only changed cells are redrawn
+    openScreen(&screen, game);
+    if (replayed < 0)
+    {
+        perror(journal.path);
+        printf("The moves will not be journaled!\n");
+    }
+    else if (replayed > 0)
+    {
+        printf("Game resumed from %s\n", journal.path);
+    }
+    CANDIDATES candidates; // Built once, then kept up to date by every move
+    if (!attachCandidates(&candidates, game) || !attachMatchings(&candidates, game, strict))
+    {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    bool passing = true; // Whether the board passed Hall's condition after the last command
+    warnDeadEnd(&candidates, &passing);
+
+    while (!solved)
+    {
+        drawScreen(&screen, game);
+
+        printf("Enter your command in the following format:\n");
+        printf("+ i,j=val: for entering val at position (i,j)\n");
+        printf("+ i,j=0 : for clearing cell (i,j)\n");
+        printf("+ u : for undoing the last move\n");
+        printf("+ r : for redoing the last undone move\n");
+        printf("+ s : for saving the moves without ending the game\n");
+        printf("+ c i,j : for listing the values cell (i,j) accepts\n");
+        printf("+ h : for a hint\n");
+        printf("+ d : for listing the empty cells that accept no value\n");
+        printf("+ 0,0=0 : for saving and ending the game\n");
+        printf("Notice: i, j, val numbering is from [1..%d]\n", size);
+        printf(">");
+
+        // Letter commands are recognised before the numbers are read
+        int command;
+        if (scanf(" ") != EOF && (command = getchar()) != EOF)
+        {
+            if (command == 'u' || command == 'r' || command == 's')
+            {
+                int rest;
+                while ((rest = getchar()) != '\n' && rest != EOF)
+                {
+                }; // Clear the input buffer
+                printf("\n");
+                if (command == 's')
+                {
+                    if (syncJournal(&journal) && journal.fd >= 0)
+                    {
+                        printf("Moves saved to %s\n", journal.path);
+                    }
+                    else
+                    {
+                        printf("Error: the moves cannot be saved!\n");
+                    }
+                }
+                else if (command == 'u' ? undoMove(&journal, game) : redoMove(&journal, game))
+                {
+                    printf(command == 'u' ? "Move undone!\n" : "Move redone!\n");
+                }
+                else
+                {
+                    printf(command == 'u' ? "Error: no move to undo!\n" : "Error: no move to redo!\n");
+                }
+                warnDeadEnd(&candidates, &passing);
+                solved = isComplete(game);
+                continue;
+            }
+            if (command == 'c' || command == 'h' || command == 'd')
+            {
+                printQuery(game, &candidates, command);
+                continue;
+            }
+            ungetc(command, stdin);
+        }
+
+        int read = scanf("%d,%d=%d", &i, &j, &val);
+        if (read == EOF)
+        {
+            if (journal.fd >= 0)
+            {
+                printf("\nEnd of input, the game can be resumed from %s\n", journal.path);
+            }
+            else
+            {
+                printf("\nEnd of input, the game is not saved!\n");
+            }
+            closeScreen(&screen);
+            detachCandidates(&candidates, game);
+            closeJournal(&journal, false);
+            return;
+        }
+        if (read != 3)
+        {
+            int c;
+            while ((c = getchar()) != '\n' && c != EOF)
+            {
+            }; // Clear the input buffer
+            printf("Error: wrong format of command!\n");
+        }
+        else
+        {
+            printf("\n");
+            if (handleInput(game, &journal, i - 1, j - 1, val, filename))
+            {
+                // Saved on 0,0=0, the journal is closed already
+                closeScreen(&screen);
+                detachCandidates(&candidates, game);
+                return;
+            }
+            warnDeadEnd(&candidates, &passing);
+        }
+
+        solved = isComplete(game); // Kept up to date by handleInput()
+    }
+
+    closeScreen(&screen);
+    printf("\nGame completed!!!\n");
+    displayLatinSquare(game);
+    writeLatinSquare(game, filename);
+    detachCandidates(&candidates, game);
+    closeJournal(&journal, true);
+}
+
+/**
+ * @brief Validates the user's input for modifying the Latin square.
+ *
+ * This function checks if the indices (i, j) and the value `val` are within the allowed
+ * range for the Latin square. It also ensures that clearing a protected cell or inserting
+ * a duplicate value in the same row or column is not allowed, nor in strict mode a value
+ * after which the square can no longer be completed.
+ *
+ * @param game The game holding the Latin square.
+ * @param i The row index (0-based) for the cell to modify.
+ * @param j The column index (0-based) for the cell to modify.
+ * @param val The value to insert into the cell, or 0 to clear the cell.
+ *
+ * @return true if the input is valid and can be applied, false otherwise.
+ *
+ */
+bool checkInput(GAME *game, int i, int j, int val)
+{
+    MOVE_STATUS status = validateMove(game, i, j, val);
+    printMoveError(game, status);
+    return status == MOVE_OK;
+}
+
+/**
+ * @brief Handles the user's input to modify the Latin square or save and end the game.
+ *
+ * This function processes the user's command by either modifying the Latin square or
+ * saving the current game state if the user inputs the save command, after which the caller
+ * ends the game. The occupancy bitsets are updated together with the cell, and the move is
+ * recorded in the journal so it can be undone.
+ *
+ * @param game The game holding the Latin square.
+ * @param journal The move history of the game (see journal.h), NULL to keep none.
+ * @param i The row index (0-based) for the cell to modify.
+ * @param j The column index (0-based) for the cell to modify.
+ * @param val The value to insert into the cell, or 0 to clear the cell.
+ * @param filename The name of the file where the Latin square will be saved.
+ * @return true if the game was saved and ends, false otherwise.
+ *
+ */
+bool handleInput(GAME *game, JOURNAL *journal, int i, int j, int val, const char *filename)
+{
+    if (i == -1 && j == -1 && val == 0)
+    {
+        writeLatinSquare(game, filename);
+        if (journal != NULL)
+        {
+            closeJournal(journal, true); // The saved file holds every move
+        }
+        return true;
+    }
+
+    int before;
+    MOVE_STATUS status = playMove(game, i, j, val, &before);
+    if (status != MOVE_OK)
+    {
+        printMoveError(game, status);
+        return false;
+    }
+    if (journal != NULL && before != val)
+    {
+        recordMove(journal, i, j, before, val);
+    }
+    printf(val == 0 ? "Value cleared!\n" : "Value inserted!\n");
+    return false;
+}
+
+/**
+ * @brief Saves the current Latin square to a file.
+ *
+ * This function writes the current state of the Latin square to a file. The output filename is
+ * prefixed with "out-" and the contents are written in a plain text format with each row of
+ * the Latin square on a new line.
+ *
+ * @param game The game holding the Latin square.
+ * @param filename The original filename used as a base to generate the output file name.
+ *
+ */
+void writeLatinSquare(GAME *game, const char *filename)
+{
+    // Create a buffer for the output filename
+    char outputFile[MAX_PATH];
+    outputFileName(filename, outputFile, sizeof(outputFile));
+
+    printf("Saving to %s...\n", outputFile);
+
+    // Open the output file and write the square
+    if (!saveLatinSquare(game, outputFile))
+    {
+        perror("Error opening output file");
+        exit(EXIT_FAILURE); // Exit if file opening fails
+    }
+
+    printf("Done\n");
+}
+
@@ -0,0 +1,152 @@
+/**
+ * @file console.h
+ * @brief Declarations of the console frontend of the game: the interactive play and its messages.
+ *
+ * The functions here read the standard input, print to the standard output and, on the errors
+ * the game cannot recover from, print a message and exit the program. The board model they
+ * drive, in latinsquare.h, does none of this.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "latinsquare.h"
+
+struct journal;
+
+/**
+ * @brief Allocates memory, printing an error and exiting the program on failure.
+ *
+ * @param bytes The number of bytes to allocate.
+ * @return void* The allocated memory.
+ */
+static inline void *allocOrExit(size_t bytes)
+{
+    void *memory = malloc(bytes);
+    if (memory == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+/**
+ * @brief Allocates an empty game like initGame(), printing an error and exiting the program on failure.
+ *
+ * @param game The game to initialize.
+ * @param size The order of the Latin square, in [1..MAX_SIZE].
+ */
+static inline void initGameOrExit(GAME *game, int size)
+{
+    if (!initGame(game, size))
+    {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+}
+/**
+ * @brief Allocates a copy of a game like copyGame(), printing an error and exiting the program on failure.
+ *
+ * @param copy The game to initialize.
+ * @param game The game to copy.
+ */
+static inline void copyGameOrExit(GAME *copy, const GAME *game)
+{
+    if (!copyGame(copy, game))
+    {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Displays a Latin square in a formatted grid with boundaries.
+ *
+ * This function prints a Latin square of given size in a well-formatted table.
+ * Each element in the square is surrounded by boundaries (| and +) and negative
+ * numbers are displayed in parentheses.
+ *
+ * @param game The game holding the Latin square.
+ *
+ */
+void displayLatinSquare(const GAME *game);
+/**
+ * @brief Reads a Latin square from the specified file.
+ *
+ * This function opens the file, reads the size of the Latin square, and fills the array
+ * with the values from the file. The row and column occupancy bitsets are built in the
+ * same pass, so duplicate givens are rejected as soon as they are read. If the file
+ * contains invalid data or cannot be opened, the function prints an error and exits the program.
+ *
+ * @param game The game where the Latin square will be stored.
+ * @param filename The name of the file containing the Latin square.
+ */
+void readLatinSquare(GAME *game, const char *filename);
+/**
+ * @brief Plays a Latin square game where the user can input values into the square.
+ *
+ * The function repeatedly displays the current state of the Latin square and prompts
+ * the user for input to modify the square. The input can either set a value, clear a
+ * cell, undo or redo a move, save the moves, ask for the values a cell accepts, a hint or the
+ * cells left without any value, or end the game. The game ends when the user
+ * inputs the command to save and exit or when the Latin square is completely filled with
+ * non-zero values. Every move is appended to the journal of the game, so a session that ends
+ * without saving is resumed the next time the same game file is played. A warning is printed
+ * when the board stops passing Hall's condition (see candidates.h) and can no longer be completed.
+ *
+ * @param game The game holding the Latin square.
+ * @param filename The name of the file where the Latin square will be saved when the game ends.
+ * @param strict true to refuse the moves after which the board can no longer be completed.
+ *
+ */
+void play(GAME *game, const char *filename, bool strict);
+/**
+ * @brief Validates the user's input for modifying the Latin square.
+ *
+ * This function checks if the indices (i, j) and the value `val` are within the allowed
+ * range for the Latin square. It also ensures that clearing a protected cell or inserting
+ * a duplicate value in the same row or column is not allowed, nor in strict mode a value
+ * after which the square can no longer be completed.
+ *
+ * @param game The game holding the Latin square.
+ * @param i The row index (0-based) for the cell to modify.
+ * @param j The column index (0-based) for the cell to modify.
+ * @param val The value to insert into the cell, or 0 to clear the cell.
+ *
+ * @return true if the input is valid and can be applied, false otherwise.
+ *
+ */
+bool checkInput(GAME *game, int i, int j, int val);
+/**
+ * @brief Handles the user's input to modify the Latin square or save and end the game.
+ *
+ * This function processes the user's command by either modifying the Latin square or
+ * saving the current game state if the user inputs the save command, after which the caller
+ * ends the game. The occupancy bitsets are updated together with the cell, and the move is
+ * recorded in the journal so it can be undone.
+ *
+ * @param game The game holding the Latin square.
+ * @param journal The move history of the game (see journal.h), NULL to keep none.
+ * @param i The row index (0-based) for the cell to modify.
+ * @param j The column index (0-based) for the cell to modify.
+ * @param val The value to insert into the cell, or 0 to clear the cell.
+ * @param filename The name of the file where the Latin square will be saved.
+ * @return true if the game was saved and ends, false otherwise.
+ *
+ */
+bool handleInput(GAME *game, struct journal *journal, int i, int j, int val, const char *filename);
+/**
+ * @brief Saves the current Latin square to a file.
+ *
+ * This function writes the current state of the Latin square to a file. The output filename is
+ * prefixed with "out-" and the contents are written in a plain text format with each row of
+ * the Latin square on a new line.
+ *
+ * @param game The game holding the Latin square.
+ * @param filename The original filename used as a base to generate the output file name.
+ *
+ */
+void writeLatinSquare(GAME *game, const char *filename);
+
+#endif // CONSOLE_H
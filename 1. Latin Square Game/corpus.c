@@ -0,0 +1,652 @@
+#define _POSIX_C_SOURCE 200809L // For mmap, fstat and mkdir
+
+#include "corpus.h"
+#include "batch.h"
+#include "littleendian.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CORPUS_MAGIC "LSQC" // First bytes of a corpus file
+#define CORPUS_VERSION 1    // Version of the layout written
+
+/**
+ * @brief Represents the walk of the files packed into a corpus.
+ */
+typedef struct pack
+{
+    CORPUS_WRITER writer; /**< The corpus written, open once the first file is loaded */
+    const char *filename; /**< The name of the corpus file */
+    bool open;            /**< Whether the writer is open */
+    bool failed;          /**< Set on a write error */
+    int skipped;          /**< Files not packed */
+} PACK;
+
+/**
+ * @brief Represents the file name a record of a corpus is unpacked to.
+ */
+typedef struct unpacked
+{
+    const char *base; /**< The stored name without its directories */
+    uint64_t k;       /**< The index of the record */
+} UNPACKED;
+
+/**
+ * @brief Builds the header of a corpus file.
+ *
+ * @param header Receives CORPUS_HEADER_BYTES bytes.
+ * @param size The order of the squares.
+ * @param flags The header flags.
+ * @param count The number of records.
+ * @param indexOffset The offset of the index, 0 without index.
+ */
+static void buildHeader(uint8_t *header, int size, uint32_t flags, uint64_t count, uint64_t indexOffset)
+{
+    memcpy(header, CORPUS_MAGIC, 4);
+    put16(header + 4, CORPUS_VERSION);
+    put16(header + 6, (uint16_t)size);
+    put32(header + 8, (uint32_t)corpusRecordBytes(size));
+    put32(header + 12, flags);
+    put64(header + 16, count);
+    put64(header + 24, indexOffset);
+}
+
+int corpusValueBits(int size)
+{
+    int bits = 1;
+    while ((1 << bits) <= size)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+size_t corpusRecordBytes(int size)
+{
+    size_t cells = (size_t)size * size;
+    return (cells * corpusValueBits(size) + 7) / 8 + (cells + 7) / 8;
+}
+
+bool isCorpusFile(const char *filename)
+{
+    char magic[4];
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool corpus = fread(magic, 1, 4, file) == 4 && memcmp(magic, CORPUS_MAGIC, 4) == 0;
+    fclose(file);
+    return corpus;
+}
+
+bool openCorpus(CORPUS *corpus, const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    if (info.st_size < CORPUS_HEADER_BYTES)
+    {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    corpus->length = (size_t)info.st_size;
+    void *map = mmap(NULL, corpus->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+    corpus->map = (const uint8_t *)map;
+
+    // Check that the header describes the file
+    const uint8_t *header = corpus->map;
+    corpus->size = get16(header + 6);
+    corpus->count = get64(header + 16);
+    uint64_t indexOffset = get64(header + 24);
+    bool valid = memcmp(header, CORPUS_MAGIC, 4) == 0 && get16(header + 4) == CORPUS_VERSION &&
+                 corpus->size >= 1 && corpus->size <= MAX_SIZE;
+    if (valid)
+    {
+        corpus->valueBits = corpusValueBits(corpus->size);
+        corpus->recordBytes = corpusRecordBytes(corpus->size);
+        uint64_t end = CORPUS_HEADER_BYTES + corpus->count * corpus->recordBytes;
+        valid = get32(header + 8) == corpus->recordBytes &&
+                corpus->count <= (corpus->length - CORPUS_HEADER_BYTES) / corpus->recordBytes && end <= corpus->length;
+        if (valid && (get32(header + 12) & CORPUS_INDEXED))
+        {
+            // The offset is checked against the length first, so the subtraction cannot wrap
+            valid = indexOffset >= end && indexOffset <= corpus->length &&
+                    corpus->count <= (corpus->length - indexOffset) / 8;
+        }
+    }
+    if (!valid)
+    {
+        munmap(map, corpus->length);
+        errno = EINVAL;
+        return false;
+    }
+
+    corpus->records = corpus->map + CORPUS_HEADER_BYTES;
+    corpus->index = NULL;
+    corpus->names = NULL;
+    corpus->namesLength = 0;
+    if (get32(header + 12) & CORPUS_INDEXED)
+    {
+        corpus->index = corpus->map + indexOffset;
+        corpus->names = (const char *)corpus->index + corpus->count * 8;
+        corpus->namesLength = corpus->length - (indexOffset + corpus->count * 8);
+    }
+    posix_madvise(map, corpus->length, POSIX_MADV_SEQUENTIAL);
+    return true;
+}
+
+void closeCorpus(CORPUS *corpus)
+{
+    munmap((void *)corpus->map, corpus->length);
+    corpus->map = NULL;
+}
+
+const char *corpusName(const CORPUS *corpus, uint64_t k)
+{
+    if (corpus->index == NULL)
+    {
+        return NULL;
+    }
+    uint64_t offset = get64(corpus->index + k * 8);
+    if (offset >= corpus->namesLength || memchr(corpus->names + offset, '\0', corpus->namesLength - offset) == NULL)
+    {
+        return NULL; // Damaged index
+    }
+    return corpus->names + offset;
+}
+
+/**
+ * @brief Unpacks a record of an order up to 64 without branching on the values.
+ *
+ * Empty cells, protected cells and values are in random order in a record, so a branch per
+ * cell mispredicts about half of the time. Here every cell goes through the same operations
+ * and the checks are accumulated in flags, tested once at the end.
+ *
+ * @param game A game of order up to 64 (one-word bitsets), emptied by the caller.
+ * @param record The record.
+ * @param valueBits Bits per packed value.
+ * @return true if the record is valid, false if decodeRecord() must find the error.
+ */
+static bool decodeSmallRecord(GAME *game, const uint8_t *record, int valueBits)
+{
+    int size = game->size;
+    int cells = size * size;
+    const uint8_t *protect = record + ((size_t)cells * valueBits + 7) / 8;
+    unsigned mask = (1u << valueBits) - 1;
+
+    // Work on local pointers: the 8-bit cell stores may alias anything, which would otherwise
+    // make the compiler reload every field of the game after each cell
+    int8_t *cellsOut = (int8_t *)game->cells; // Orders up to 64 use 8-bit cells
+    uint64_t *rowMask = game->rowMask;
+    uint64_t *colMask = game->colMask;
+    int *rowFill = game->rowFill;
+    int *colFill = game->colFill;
+    uint64_t duplicate = 0;
+    unsigned invalid = 0;
+    int filled = 0;
+
+    for (int i = 0, cell = 0, bit = 0; i < size; i++)
+    {
+        uint64_t row = 0;
+        for (int j = 0; j < size; j++, cell++, bit += valueBits)
+        {
+            // A value spans at most two bytes, and the bitmap follows the values
+            unsigned window = record[bit >> 3] | (unsigned)record[(bit >> 3) + 1] << 8;
+            int value = (int)((window >> (bit & 7)) & mask);
+            int protectedCell = (protect[cell >> 3] >> (cell & 7)) & 1;
+            int present = value != 0;
+            uint64_t valueBit = (uint64_t)present << ((value - 1) & (WORD_BITS - 1));
+
+            invalid |= (value > size) | (protectedCell & !present);
+            duplicate |= (row & valueBit) | (colMask[j] & valueBit);
+            row |= valueBit;
+            colMask[j] |= valueBit;
+            colFill[j] += present;
+            filled += present;
+            cellsOut[cell] = (int8_t)(protectedCell ? -value : value);
+        }
+        rowMask[i] = row;
+        rowFill[i] = __builtin_popcountll(row);
+    }
+    game->empty -= filled;
+    return invalid == 0 && duplicate == 0;
+}
+
+LOAD_STATUS decodeRecord(GAME *game, const uint8_t *record, int valueBits)
+{
+    int size = game->size;
+    int words = game->words;
+    int cells = size * size;
+    const uint8_t *protect = record + ((size_t)cells * valueBits + 7) / 8;
+    unsigned mask = (1u << valueBits) - 1;
+
+    // Work on local pointers: the 8-bit cell stores may alias anything, which would otherwise
+    // make the compiler reload every field of the game after each cell
+    int8_t *small = game->cellBytes == 1 ? (int8_t *)game->cells : NULL;
+    int16_t *wide = (int16_t *)game->cells;
+    int *rowFill = game->rowFill;
+    int *colFill = game->colFill;
+    int filled = 0;
+
+    clearGame(game);
+    if (words == 1 && decodeSmallRecord(game, record, valueBits))
+    {
+        return LOAD_OK;
+    }
+
+    // Checked decoding, which also tells which check failed
+    clearGame(game);
+    LOAD_STATUS status = LOAD_OK;
+    for (int i = 0, cell = 0, bit = 0; i < size && status == LOAD_OK; i++)
+    {
+        uint64_t *row = game->rowMask + (size_t)i * words;
+        for (int j = 0; j < size; j++, cell++, bit += valueBits)
+        {
+            // A value spans at most two bytes, and the bitmap follows the values
+            unsigned window = record[bit >> 3] | (unsigned)record[(bit >> 3) + 1] << 8;
+            int value = (int)((window >> (bit & 7)) & mask);
+            bool protectedCell = (protect[cell >> 3] >> (cell & 7)) & 1;
+            uint64_t *col = game->colMask + (size_t)j * words;
+            if (value == 0)
+            {
+                if (protectedCell)
+                {
+                    status = LOAD_INVALID_VALUE;
+                    break;
+                }
+                continue;
+            }
+            if (value > size)
+            {
+                status = LOAD_OUT_OF_RANGE;
+                break;
+            }
+            if (hasValue(row, value) || hasValue(col, value))
+            {
+                status = LOAD_DUPLICATE;
+                break;
+            }
+
+            // Same as placeValue()
+            addValue(row, value);
+            addValue(col, value);
+            rowFill[i]++;
+            colFill[j]++;
+            filled++;
+            if (small != NULL)
+            {
+                small[cell] = (int8_t)(protectedCell ? -value : value);
+            }
+            else
+            {
+                wide[cell] = (int16_t)(protectedCell ? -value : value);
+            }
+        }
+    }
+    game->empty -= filled;
+    return status;
+}
+
+void unpackValues(const uint8_t *record, int size, int valueBits, uint16_t *values)
+{
+    size_t cells = (size_t)size * size;
+    if (valueBits == 8)
+    {
+        for (size_t cell = 0; cell < cells; cell++)
+        {
+            values[cell] = record[cell]; // Orders 128 to 255 take whole bytes
+        }
+        return;
+    }
+    unsigned mask = (1u << valueBits) - 1;
+    for (size_t cell = 0, bit = 0; cell < cells; cell++, bit += valueBits)
+    {
+        // A value spans at most two bytes, and the bitmap follows the values
+        unsigned window = record[bit >> 3] | (unsigned)record[(bit >> 3) + 1] << 8;
+        values[cell] = (uint16_t)((window >> (bit & 7)) & mask);
+    }
+}
+
+void encodeRecord(const GAME *game, uint8_t *record, int valueBits)
+{
+    int size = game->size;
+    int cells = size * size;
+    uint8_t *protect = record + ((size_t)cells * valueBits + 7) / 8;
+    memset(record, 0, corpusRecordBytes(size));
+
+    for (int cell = 0, bit = 0; cell < cells; cell++, bit += valueBits)
+    {
+        int value = getCell(game, cell / size, cell % size);
+        unsigned window = (unsigned)abs(value) << (bit & 7);
+        record[bit >> 3] |= (uint8_t)window;
+        record[(bit >> 3) + 1] |= (uint8_t)(window >> 8);
+        if (value < 0)
+        {
+            protect[cell >> 3] |= (uint8_t)(1 << (cell & 7));
+        }
+    }
+}
+
+bool createCorpus(CORPUS_WRITER *writer, const char *filename, int size, bool indexed)
+{
+    writer->file = fopen(filename, "wb");
+    if (writer->file == NULL)
+    {
+        return false;
+    }
+    writer->size = size;
+    writer->valueBits = corpusValueBits(size);
+    writer->recordBytes = corpusRecordBytes(size);
+    writer->count = 0;
+    writer->record = (uint8_t *)malloc(writer->recordBytes);
+    if (writer->record == NULL)
+    {
+        fclose(writer->file);
+        errno = ENOMEM;
+        return false;
+    }
+    writer->indexed = indexed;
+    writer->offsets = NULL;
+    writer->capacity = 0;
+    writer->names = NULL;
+    writer->namesLength = 0;
+    writer->namesSize = 0;
+
+    // The header is written again with the final count by finishCorpus()
+    uint8_t header[CORPUS_HEADER_BYTES];
+    buildHeader(header, size, 0, 0, 0);
+    return fwrite(header, 1, sizeof(header), writer->file) == sizeof(header);
+}
+
+bool appendCorpus(CORPUS_WRITER *writer, const GAME *game, const char *name)
+{
+    if (writer->indexed)
+    {
+        size_t length = strlen(name) + 1;
+        if (writer->count == writer->capacity)
+        {
+            size_t capacity = writer->capacity == 0 ? 1024 : 2 * writer->capacity;
+            uint64_t *offsets = (uint64_t *)realloc(writer->offsets, capacity * sizeof(uint64_t));
+            if (offsets == NULL)
+            {
+                errno = ENOMEM;
+                return false;
+            }
+            writer->offsets = offsets;
+            writer->capacity = capacity;
+        }
+        while (writer->namesLength + length > writer->namesSize)
+        {
+            size_t namesSize = writer->namesSize == 0 ? 65536 : 2 * writer->namesSize;
+            char *names = (char *)realloc(writer->names, namesSize);
+            if (names == NULL)
+            {
+                errno = ENOMEM;
+                return false;
+            }
+            writer->names = names;
+            writer->namesSize = namesSize;
+        }
+        writer->offsets[writer->count] = writer->namesLength;
+        memcpy(writer->names + writer->namesLength, name, length);
+        writer->namesLength += length;
+    }
+
+    encodeRecord(game, writer->record, writer->valueBits);
+    writer->count++;
+    return fwrite(writer->record, 1, writer->recordBytes, writer->file) == writer->recordBytes;
+}
+
+bool finishCorpus(CORPUS_WRITER *writer)
+{
+    bool ok = true;
+    uint64_t indexOffset = 0;
+    if (writer->indexed)
+    {
+        indexOffset = CORPUS_HEADER_BYTES + writer->count * writer->recordBytes;
+        uint8_t entry[8];
+        for (uint64_t k = 0; k < writer->count && ok; k++)
+        {
+            put64(entry, writer->offsets[k]);
+            ok = fwrite(entry, 1, sizeof(entry), writer->file) == sizeof(entry);
+        }
+        ok = ok && fwrite(writer->names, 1, writer->namesLength, writer->file) == writer->namesLength;
+    }
+
+    uint8_t header[CORPUS_HEADER_BYTES];
+    buildHeader(header, writer->size, writer->indexed ? CORPUS_INDEXED : 0, writer->count, indexOffset);
+    ok = ok && fseek(writer->file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), writer->file) == sizeof(header);
+    ok = fclose(writer->file) == 0 && ok;
+
+    free(writer->record);
+    free(writer->offsets);
+    free(writer->names);
+    return ok;
+}
+
+/**
+ * @brief Visitor of the packed files: loads a game file and appends it to the corpus.
+ *
+ * @param path The name of the game file.
+ * @param context The PACK.
+ */
+static void packFile(const char *path, void *context)
+{
+    PACK *pack = (PACK *)context;
+    if (pack->failed)
+    {
+        return;
+    }
+
+    GAME game;
+    LOAD_STATUS status = loadLatinSquare(&game, path);
+    if (status != LOAD_OK)
+    {
+        printf("%s %s\n", loadStatusName(status), path);
+        pack->skipped++;
+        return;
+    }
+
+    if (!pack->open)
+    {
+        // The first file gives the order of the corpus
+        if (!createCorpus(&pack->writer, pack->filename, game.size, true))
+        {
+            perror(pack->filename);
+            pack->failed = true; // The writer was not created, so it is never finished
+            freeGame(&game);
+            return;
+        }
+        pack->open = true;
+    }
+    if (game.size != pack->writer.size)
+    {
+        printf("wrong-size %s\n", path);
+        pack->skipped++;
+    }
+    else if (!pack->failed && !appendCorpus(&pack->writer, &game, path))
+    {
+        perror(pack->filename);
+        pack->failed = true;
+    }
+    freeGame(&game);
+}
+
+int packCorpus(const char *corpusFile, char *paths[], int count)
+{
+    PACK pack;
+    pack.filename = corpusFile;
+    pack.open = false;
+    pack.failed = false;
+    pack.skipped = 0;
+    forEachGameFile(paths, count, false, packFile, &pack);
+
+    if (!pack.open)
+    {
+        if (!pack.failed)
+        {
+            printf("No game file to pack\n");
+        }
+        return -1;
+    }
+    if (!finishCorpus(&pack.writer) && !pack.failed)
+    {
+        perror(corpusFile);
+        pack.failed = true;
+    }
+    if (!pack.failed)
+    {
+        fprintf(stderr, "%llu squares of order %d packed, %d skipped\n", (unsigned long long)pack.writer.count,
+                pack.writer.size, pack.skipped);
+    }
+    return pack.failed ? -1 : pack.skipped;
+}
+
+/**
+ * @brief Orders unpacked names by name then by record, for qsort().
+ */
+static int compareUnpacked(const void *a, const void *b)
+{
+    const UNPACKED *x = (const UNPACKED *)a;
+    const UNPACKED *y = (const UNPACKED *)b;
+    int order = strcmp(x->base, y->base);
+    if (order != 0)
+    {
+        return order;
+    }
+    return (x->k > y->k) - (x->k < y->k);
+}
+
+/**
+ * @brief Finds the records whose stored name repeats the name of an earlier record.
+ *
+ * Names are unpacked without their directories, so p.txt packed from two directories
+ * would otherwise overwrite each other.
+ *
+ * @param corpus The corpus.
+ * @return An array of corpus->count flags, set on every record but the first of each name,
+ *         or NULL if the memory is exhausted.
+ */
+static bool *findDuplicateNames(const CORPUS *corpus)
+{
+    bool *duplicate = (bool *)calloc(corpus->count == 0 ? 1 : corpus->count, sizeof(bool));
+    UNPACKED *names = (UNPACKED *)malloc((corpus->count == 0 ? 1 : corpus->count) * sizeof(UNPACKED));
+    if (duplicate == NULL || names == NULL)
+    {
+        free(duplicate);
+        free(names);
+        return NULL;
+    }
+    size_t named = 0;
+    for (uint64_t k = 0; k < corpus->count; k++)
+    {
+        const char *name = corpusName(corpus, k);
+        if (name != NULL)
+        {
+            const char *base = strrchr(name, '/');
+            names[named].base = base == NULL ? name : base + 1;
+            names[named].k = k;
+            named++;
+        }
+    }
+    qsort(names, named, sizeof(UNPACKED), compareUnpacked);
+    for (size_t i = 1; i < named; i++)
+    {
+        if (strcmp(names[i].base, names[i - 1].base) == 0)
+        {
+            duplicate[names[i].k] = true;
+        }
+    }
+    free(names);
+    return duplicate;
+}
+
+int unpackCorpus(const char *corpusFile, const char *directory)
+{
+    CORPUS corpus;
+    if (!openCorpus(&corpus, corpusFile))
+    {
+        perror(corpusFile);
+        return -1;
+    }
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST)
+    {
+        perror(directory);
+        closeCorpus(&corpus);
+        return -1;
+    }
+
+    bool *duplicate = findDuplicateNames(&corpus);
+    if (duplicate == NULL)
+    {
+        perror(corpusFile);
+        closeCorpus(&corpus);
+        return -1;
+    }
+
+    int failures = 0;
+    int digits = snprintf(NULL, 0, "%llu", (unsigned long long)corpus.count);
+    GAME game;
+    if (!initGame(&game, corpus.size))
+    {
+        perror(corpusFile);
+        free(duplicate);
+        closeCorpus(&corpus);
+        return -1;
+    }
+    for (uint64_t k = 0; k < corpus.count; k++)
+    {
+        char outputFile[MAX_PATH];
+        const char *name = corpusName(&corpus, k);
+        if (duplicate[k])
+        {
+            // Written under the name of an earlier record, it would replace that file
+            printf("duplicate-name %s record %llu\n", name, (unsigned long long)k + 1);
+            failures++;
+            continue;
+        }
+        if (name != NULL)
+        {
+            const char *base = strrchr(name, '/');
+            snprintf(outputFile, sizeof(outputFile), "%s/%s", directory, base == NULL ? name : base + 1);
+        }
+        else
+        {
+            snprintf(outputFile, sizeof(outputFile), "%s/puzzle-%0*llu.txt", directory, digits, (unsigned long long)k + 1);
+        }
+
+        LOAD_STATUS status = decodeRecord(&game, corpusRecord(&corpus, k), corpus.valueBits);
+        if (status != LOAD_OK)
+        {
+            printf("%s record %llu\n", loadStatusName(status), (unsigned long long)k + 1);
+            failures++;
+        }
+        else if (!saveLatinSquare(&game, outputFile))
+        {
+            perror(outputFile);
+            failures++;
+        }
+    }
+    freeGame(&game);
+    free(duplicate);
+    closeCorpus(&corpus);
+    return failures;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file corpus.h
+ * @brief Declarations of the binary puzzle corpus: many squares of one order in a single file.
+ *
+ * A corpus file is made of a 32-byte header, the records and an optional name index:
+ *
+ *     header  "LSQC", version, order, record size, flags, count, index offset (little-endian)
+ *     records count fixed-size records, one per square
+ *     index   count 64-bit offsets into the names that follow, then the NUL-terminated names
+ *
+ * A record holds the size * size values row by row, packed on valueBits bits each (enough
+ * for [0..size]), followed by a bitmap with one bit per cell set for protected values.
+ * An order 9 square takes 52 bytes. Since records have a fixed size, the file is mapped in
+ * memory and record k is read in place, without parsing or copying the file.
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "latinsquare.h"
+
+#define CORPUS_HEADER_BYTES 32 // Size of the header of a corpus file
+#define CORPUS_INDEXED 1       // Header flag: the file ends with a name index
+
+/**
+ * @brief Represents a corpus file mapped in memory for reading.
+ */
+typedef struct corpus
+{
+    const uint8_t *map;     /**< The mapped file */
+    size_t length;          /**< Length of the mapping */
+    int size;               /**< The order of the squares */
+    int valueBits;          /**< Bits per packed value */
+    size_t recordBytes;     /**< Bytes per record */
+    uint64_t count;         /**< Number of records */
+    const uint8_t *records; /**< First record */
+    const uint8_t *index;   /**< Offsets of the names, NULL without index */
+    const char *names;      /**< The names, NULL without index */
+    size_t namesLength;     /**< Bytes of the names */
+} CORPUS;
+
+/**
+ * @brief Represents a corpus file being written sequentially.
+ */
+typedef struct corpusWriter
+{
+    FILE *file;          /**< The file written */
+    int size;            /**< The order of the squares */
+    int valueBits;       /**< Bits per packed value */
+    size_t recordBytes;  /**< Bytes per record */
+    uint64_t count;      /**< Records written so far */
+    uint8_t *record;     /**< Buffer of one record */
+    bool indexed;        /**< Whether names are kept */
+    uint64_t *offsets;   /**< Offset of the name of each record */
+    uint64_t capacity;   /**< Entries allocated in offsets */
+    char *names;         /**< The names, NUL-terminated */
+    size_t namesLength;  /**< Bytes used in names */
+    size_t namesSize;    /**< Bytes allocated in names */
+} CORPUS_WRITER;
+
+/**
+ * @brief Returns the number of bits a value of a square of the given order is packed on.
+ *
+ * @param size The order of the square.
+ * @return The number of bits needed to store [0..size].
+ */
+int corpusValueBits(int size);
+
+/**
+ * @brief Returns the number of bytes of a record of a square of the given order.
+ *
+ * @param size The order of the square.
+ * @return The record size.
+ */
+size_t corpusRecordBytes(int size);
+
+/**
+ * @brief Tells whether a file starts with the corpus magic number.
+ *
+ * @param filename The name of the file.
+ * @return true if the file looks like a corpus file.
+ */
+bool isCorpusFile(const char *filename);
+
+/**
+ * @brief Maps a corpus file in memory and checks its header.
+ *
+ * @param corpus The corpus to fill.
+ * @param filename The name of the file.
+ * @return true on success, false with errno set otherwise (EINVAL for a malformed file).
+ */
+bool openCorpus(CORPUS *corpus, const char *filename);
+
+/**
+ * @brief Unmaps a corpus file.
+ *
+ * @param corpus The corpus.
+ */
+void closeCorpus(CORPUS *corpus);
+
+/**
+ * @brief Returns a record of a corpus, in place in the mapped file.
+ *
+ * @param corpus The corpus.
+ * @param k The index of the record, below corpus->count.
+ * @return The record.
+ */
+static inline const uint8_t *corpusRecord(const CORPUS *corpus, uint64_t k)
+{
+    return corpus->records + k * corpus->recordBytes;
+}
+
+/**
+ * @brief Returns the name stored in the index for a record.
+ *
+ * @param corpus The corpus.
+ * @param k The index of the record.
+ * @return The name, or NULL if the corpus has no index.
+ */
+const char *corpusName(const CORPUS *corpus, uint64_t k);
+
+/**
+ * @brief Unpacks a record into a game, with the checks of loadLatinSquare().
+ *
+ * @param game A game of the order of the records. Its previous contents are replaced.
+ * @param record The record.
+ * @param valueBits Bits per packed value.
+ * @return LOAD_OK, or LOAD_OUT_OF_RANGE, LOAD_INVALID_VALUE (an empty protected cell) or
+ *         LOAD_DUPLICATE for a damaged record.
+ */
+LOAD_STATUS decodeRecord(GAME *game, const uint8_t *record, int valueBits);
+
+/**
+ * @brief Unpacks the values of a record without any check and without their protection.
+ *
+ * @param record The record.
+ * @param size The order of the records.
+ * @param valueBits Bits per packed value.
+ * @param values Receives the size * size values, row by row.
+ */
+void unpackValues(const uint8_t *record, int size, int valueBits, uint16_t *values);
+
+/**
+ * @brief Packs a game into a record.
+ *
+ * @param game The game.
+ * @param record Receives corpusRecordBytes(game->size) bytes.
+ * @param valueBits Bits per packed value.
+ */
+void encodeRecord(const GAME *game, uint8_t *record, int valueBits);
+
+/**
+ * @brief Creates a corpus file and writes its header.
+ *
+ * @param writer The writer to initialize.
+ * @param filename The name of the file.
+ * @param size The order of the squares.
+ * @param indexed true to store a name with every record.
+ * @return true on success, false with errno set otherwise.
+ */
+bool createCorpus(CORPUS_WRITER *writer, const char *filename, int size, bool indexed);
+
+/**
+ * @brief Appends a square to a corpus file.
+ *
+ * @param writer The writer.
+ * @param game The square, of the order of the corpus.
+ * @param name Its name for the index, ignored without index.
+ * @return true on success, false with errno set on a write error or when the memory is exhausted.
+ */
+bool appendCorpus(CORPUS_WRITER *writer, const GAME *game, const char *name);
+
+/**
+ * @brief Writes the index, completes the header and closes a corpus file.
+ *
+ * @param writer The writer, released.
+ * @return true on success, false on a write error.
+ */
+bool finishCorpus(CORPUS_WRITER *writer);
+
+/**
+ * @brief Packs game files into a new corpus file, keeping their names in the index.
+ *
+ * The arguments are walked like the ones of runBatch(). Files that cannot be loaded, or whose
+ * order differs from the order of the first file, are reported and skipped.
+ *
+ * @param corpusFile The name of the corpus file to create.
+ * @param paths The file, directory or "-" arguments.
+ * @param count The number of arguments.
+ * @return The number of files skipped, or -1 if the corpus could not be written.
+ */
+int packCorpus(const char *corpusFile, char *paths[], int count);
+
+/**
+ * @brief Writes every record of a corpus as a game file.
+ *
+ * The files take the names stored in the index (without their directories), or
+ * puzzle-<k>.txt without index. The directory is created if needed. A record whose name
+ * repeats the name of an earlier record (the same file name packed from two directories)
+ * is reported as duplicate-name and not written.
+ *
+ * @param corpusFile The name of the corpus file.
+ * @param directory The directory receiving the game files.
+ * @return The number of records that could not be written, or -1 if the corpus cannot be read.
+ */
+int unpackCorpus(const char *corpusFile, const char *directory);
+
+#endif // CORPUS_H
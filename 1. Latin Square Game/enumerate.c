@@ -0,0 +1,534 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime, fileno and fsync
+
+#include "enumerate.h"
+#include "console.h"
+#include "corpus.h"
+#include "stats.h"
+#include "threadpool.h"
+#include "timing.h"
+#include <errno.h>
+#include <unistd.h>
+
+#define CHECKPOINT_MAGIC "LSQE" // First word of a checkpoint file
+#define MEMO_BITS 18             // Log2 of the entries of the cache of row counts of a worker
+
+/**
+ * @brief Represents a cached count of the completions of the last rows of a square.
+ *
+ * The count only depends on the values each column misses, not on the order of the columns, so
+ * the key is the sorted bitsets of the missing values of the columns but the first.
+ */
+typedef struct memoentry
+{
+    uint16_t missing[ENUM_MAX_ORDER - 1]; /**< The sorted key; missing[0] is 0 for an empty entry */
+    unsigned long long count;             /**< The number of completions */
+} MEMO_ENTRY;
+
+/**
+ * @brief Represents the state of an enumeration run shared by the workers.
+ */
+typedef struct enumeration
+{
+    int size;                   /**< The order of the squares */
+    int part;                   /**< The part of the jobs run */
+    int parts;                  /**< The number of parts */
+    int jobs;                   /**< Jobs of every part together */
+    short *rows;                /**< The second row of every job, size values each */
+    bool *done;                 /**< Whether each job is finished, here or in the checkpoint */
+    unsigned long long *counts; /**< The squares of each finished job */
+    unsigned long long total;   /**< Squares of the finished jobs of the part */
+    int run;                    /**< Jobs of the part run by this call */
+    int finished;               /**< Of those, the ones finished */
+    int resumed;                /**< Jobs of the part found finished in the checkpoint */
+    FILE *checkpoint;           /**< The checkpoint file, NULL for none */
+    double lastSync;            /**< When the checkpoint was last synced to the disk */
+    CORPUS_WRITER writer;       /**< The corpus receiving the squares */
+    bool streaming;             /**< Whether the squares are written to the corpus */
+    bool failed;                /**< Whether writing the checkpoint or the corpus failed */
+    bool progress;              /**< Whether progress lines are printed */
+    double start;               /**< When the jobs started */
+    double lastReport;          /**< When the last progress line was printed */
+    MEMO_ENTRY **memos;         /**< A direct-mapped cache of row counts per worker, allocated on use */
+    pthread_mutex_t lock;       /**< Protects the counters, the checkpoint and the corpus */
+} ENUMERATION;
+
+/**
+ * @brief Represents one job handed to the pool: the reduced squares with a given second row.
+ */
+typedef struct enumjob
+{
+    ENUMERATION *enumeration; /**< The enumeration run */
+    int index;                /**< The index of the job */
+} ENUM_JOB;
+
+/**
+ * @brief Lists the second rows of the reduced squares, in lexicographic order.
+ *
+ * A second row starts with 2, and its column j cannot hold j + 1, the value of the first row.
+ *
+ * @param enumeration The run; its rows and jobs are set.
+ * @param row The row being built, from column 1.
+ * @param col The next column to fill.
+ * @param used The values already in the row, as bits.
+ * @param capacity The rows allocated.
+ */
+static void listSecondRows(ENUMERATION *enumeration, short *row, int col, unsigned used, int *capacity)
+{
+    int size = enumeration->size;
+    if (col == size)
+    {
+        if (enumeration->jobs == *capacity)
+        {
+            *capacity = *capacity == 0 ? 256 : 2 * *capacity;
+            enumeration->rows = (short *)realloc(enumeration->rows, (size_t)*capacity * size * sizeof(short));
+            if (enumeration->rows == NULL)
+            {
+                perror("Memory allocation failed");
+                exit(EXIT_FAILURE);
+            }
+        }
+        memcpy(enumeration->rows + (size_t)enumeration->jobs * size, row, size * sizeof(short));
+        enumeration->jobs++;
+        return;
+    }
+    for (int val = 1; val <= size; val++)
+    {
+        if (val != col + 1 && (used & (1u << val)) == 0)
+        {
+            row[col] = (short)val;
+            listSecondRows(enumeration, row, col + 1, used | (1u << val), capacity);
+        }
+    }
+}
+
+/**
+ * @brief Counts the ways to complete the last two rows of a reduced square.
+ *
+ * Each column but the first misses two values; seen as edges between values, the columns form
+ * cycles and a single path from size - 1 to size, whose values are fixed in the first column.
+ * The path can be completed in one way and each cycle in two.
+ *
+ * @param game The square, filled but for the last two rows after their first cell.
+ * @return The number of completions.
+ */
+static unsigned long long completeLastRows(const GAME *game)
+{
+    int size = game->size;
+    int parent[ENUM_MAX_ORDER + 1];
+    for (int val = 1; val <= size; val++)
+    {
+        parent[val] = val;
+    }
+    uint64_t all = ((uint64_t)1 << size) - 1;
+    int components = size;
+    for (int j = 1; j < size; j++)
+    {
+        uint64_t missing = all & ~colSet(game, j)[0];
+        int a = __builtin_ctzll(missing) + 1;
+        int b = __builtin_ctzll(missing & (missing - 1)) + 1;
+        while (parent[a] != a)
+        {
+            a = parent[a];
+        }
+        while (parent[b] != b)
+        {
+            b = parent[b];
+        }
+        if (a != b)
+        {
+            parent[a] = b;
+            components--;
+        }
+    }
+    return 1ULL << (components - 1);
+}
+
+/**
+ * @brief Writes a complete square to the corpus of the run.
+ *
+ * @param enumeration The run.
+ * @param game The square.
+ */
+static void streamSquare(ENUMERATION *enumeration, const GAME *game)
+{
+    pthread_mutex_lock(&enumeration->lock);
+    if (!enumeration->failed && !appendCorpus(&enumeration->writer, game, NULL))
+    {
+        perror("Error writing the squares");
+        enumeration->failed = true;
+    }
+    pthread_mutex_unlock(&enumeration->lock);
+}
+
+static unsigned long long countSquares(ENUMERATION *enumeration, MEMO_ENTRY *memo, GAME *game, int row, int col);
+
+/**
+ * @brief Counts the completions of a reduced square filled up to a row, through the cache of the worker.
+ *
+ * @param enumeration The run.
+ * @param memo The cache of the worker, or NULL when the squares are streamed.
+ * @param game The square, filled before the given row.
+ * @param row The first row to fill.
+ * @return The number of completions.
+ */
+static unsigned long long countRows(ENUMERATION *enumeration, MEMO_ENTRY *memo, GAME *game, int row)
+{
+    int size = game->size;
+    if (memo == NULL || row < 3 || row > size - 3)
+    {
+        // Rows 1 and 2 come from the job, the last two are counted by their cycles
+        return countSquares(enumeration, memo, game, row, 1);
+    }
+
+    // Sort the missing values of the columns with an insertion sort, then hash them
+    MEMO_ENTRY key;
+    memset(&key, 0, sizeof(key));
+    uint16_t all = (uint16_t)((1u << size) - 1);
+    uint64_t hash = 0;
+    for (int j = 1; j < size; j++)
+    {
+        uint16_t missing = (uint16_t)(all & ~colSet(game, j)[0]);
+        int k = j - 1;
+        for (; k > 0 && key.missing[k - 1] > missing; k--)
+        {
+            key.missing[k] = key.missing[k - 1];
+        }
+        key.missing[k] = missing;
+    }
+    for (int j = 0; j < size - 1; j++)
+    {
+        hash = (hash ^ key.missing[j]) * 0x100000001b3ULL;
+    }
+    MEMO_ENTRY *entry = &memo[(hash ^ (hash >> 29)) & ((1u << MEMO_BITS) - 1)];
+    if (memcmp(entry->missing, key.missing, sizeof(key.missing)) == 0)
+    {
+        return entry->count;
+    }
+    key.count = countSquares(enumeration, memo, game, row, 1);
+    *entry = key;
+    return key.count;
+}
+
+/**
+ * @brief Counts the completions of a reduced square filled up to a cell, in row-major order.
+ *
+ * @param enumeration The run.
+ * @param memo The cache of the worker, or NULL when the squares are streamed.
+ * @param game The square, filled before cell (row, col); the first column is always filled.
+ * @param row The row of the next cell.
+ * @param col The column of the next cell, at least 1.
+ * @return The number of completions.
+ */
+static unsigned long long countSquares(ENUMERATION *enumeration, MEMO_ENTRY *memo, GAME *game, int row, int col)
+{
+    int size = game->size;
+    if (row >= size - 2 && !enumeration->streaming)
+    {
+        // The last row is forced by the others, and the last two rows are counted by their cycles
+        return row == size - 2 ? completeLastRows(game) : 1;
+    }
+    if (row == size)
+    {
+        streamSquare(enumeration, game);
+        return 1;
+    }
+    if (col == size)
+    {
+        return countRows(enumeration, memo, game, row + 1);
+    }
+
+    unsigned long long count = 0;
+    uint64_t bits = (((uint64_t)1 << size) - 1) & ~rowSet(game, row)[0] & ~colSet(game, col)[0];
+    while (bits != 0)
+    {
+        int val = __builtin_ctzll(bits) + 1;
+        bits &= bits - 1;
+        placeValue(game, row, col, val);
+        count += countSquares(enumeration, memo, game, row, col + 1);
+        clearValue(game, row, col);
+    }
+    return count;
+}
+
+/**
+ * @brief Records a finished job in the checkpoint file, syncing it to the disk now and then.
+ *
+ * Called with the lock of the run held.
+ *
+ * @param enumeration The run, with a checkpoint file.
+ * @param index The index of the job.
+ * @param count Its number of squares.
+ */
+static void recordJob(ENUMERATION *enumeration, int index, unsigned long long count)
+{
+    FILE *checkpoint = enumeration->checkpoint;
+    bool written = fprintf(checkpoint, "%d %llu\n", index, count) > 0 && fflush(checkpoint) == 0;
+    double time = now();
+    if (written && time - enumeration->lastSync >= CHECKPOINT_SYNC_SECONDS)
+    {
+        written = fsync(fileno(checkpoint)) == 0;
+        enumeration->lastSync = time;
+    }
+    if (!written && !enumeration->failed)
+    {
+        perror("Error writing the checkpoint");
+        enumeration->failed = true;
+    }
+}
+
+/**
+ * @brief Task function of the pool: counts the reduced squares of one job.
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task.
+ * @param arg The ENUM_JOB to run. It is released here.
+ */
+static void runEnumJob(POOL *pool, int worker, void *arg)
+{
+    ENUM_JOB *job = (ENUM_JOB *)arg;
+    ENUMERATION *enumeration = job->enumeration;
+    int size = enumeration->size;
+    (void)pool;
+
+    MEMO_ENTRY *memo = NULL;
+    if (!enumeration->streaming)
+    {
+        if (enumeration->memos[worker] == NULL)
+        {
+            enumeration->memos[worker] = (MEMO_ENTRY *)calloc((size_t)1 << MEMO_BITS, sizeof(MEMO_ENTRY));
+        }
+        memo = enumeration->memos[worker]; // Without memory, the rows are counted one by one
+    }
+
+    // The first row and column are 1..size, the second row is the one of the job
+    GAME game;
+    initGameOrExit(&game, size);
+    for (int k = 0; k < size; k++)
+    {
+        placeValue(&game, 0, k, k + 1);
+        if (k > 0)
+        {
+            placeValue(&game, k, 0, k + 1);
+        }
+    }
+    const short *second = enumeration->rows + (size_t)job->index * size;
+    for (int j = 1; j < size && size > 1; j++)
+    {
+        placeValue(&game, 1, j, second[j]);
+    }
+    unsigned long long count = countSquares(enumeration, memo, &game, size > 1 ? 2 : 1, 1);
+    freeGame(&game);
+    STATS_ADD(STAT_SOLUTIONS, count);
+
+    pthread_mutex_lock(&enumeration->lock);
+    enumeration->total += count;
+    enumeration->finished++;
+    enumeration->done[job->index] = true;
+    enumeration->counts[job->index] = count;
+    if (enumeration->checkpoint != NULL)
+    {
+        recordJob(enumeration, job->index, count);
+    }
+    double time = now();
+    if (enumeration->progress && time - enumeration->lastReport >= 1.0)
+    {
+        fprintf(stderr, "%d/%d jobs, %llu squares so far, %.1f s\n", enumeration->finished, enumeration->run,
+                enumeration->total, time - enumeration->start);
+        enumeration->lastReport = time;
+    }
+    pthread_mutex_unlock(&enumeration->lock);
+
+    free(job);
+}
+
+/**
+ * @brief Reads the jobs finished by an earlier run from a checkpoint file, then rewrites it for appending.
+ *
+ * The file is rewritten through a temporary file renamed over it, without a line cut short by
+ * an interruption, so the lines appended next start on a line of their own.
+ *
+ * @param enumeration The run; its done flags, total and resumed count are set.
+ * @param checkpointFile The name of the checkpoint file, which may not exist yet.
+ * @return true on success, false if the file belongs to another run or cannot be read or written.
+ */
+static bool openCheckpoint(ENUMERATION *enumeration, const char *checkpointFile)
+{
+    FILE *old = fopen(checkpointFile, "r");
+    if (old == NULL && errno != ENOENT)
+    {
+        perror(checkpointFile);
+        return false;
+    }
+    if (old != NULL)
+    {
+        int size, part, parts, jobs;
+        if (fscanf(old, CHECKPOINT_MAGIC " order %d part %d/%d jobs %d", &size, &part, &parts, &jobs) != 4 ||
+            size != enumeration->size || part != enumeration->part || parts != enumeration->parts ||
+            jobs != enumeration->jobs)
+        {
+            fprintf(stderr, "%s: not a checkpoint of this enumeration\n", checkpointFile);
+            fclose(old);
+            return false;
+        }
+        int index;
+        unsigned long long count;
+        char end;
+        while (fscanf(old, "%d %llu%c", &index, &count, &end) == 3 && end == '\n')
+        {
+            if (index >= 0 && index < jobs && index % parts == part && !enumeration->done[index])
+            {
+                enumeration->done[index] = true;
+                enumeration->counts[index] = count;
+                enumeration->total += count;
+                enumeration->resumed++;
+            }
+        }
+        fclose(old);
+    }
+
+    char temporary[MAX_PATH];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", checkpointFile);
+    FILE *file = fopen(temporary, "w");
+    if (file == NULL)
+    {
+        perror(temporary);
+        return false;
+    }
+    fprintf(file, CHECKPOINT_MAGIC " order %d part %d/%d jobs %d\n", enumeration->size, enumeration->part,
+            enumeration->parts, enumeration->jobs);
+    for (int k = enumeration->part; k < enumeration->jobs; k += enumeration->parts)
+    {
+        if (enumeration->done[k])
+        {
+            fprintf(file, "%d %llu\n", k, enumeration->counts[k]);
+        }
+    }
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0 || fclose(file) != 0 || rename(temporary, checkpointFile) != 0)
+    {
+        perror(checkpointFile);
+        return false;
+    }
+
+    enumeration->checkpoint = fopen(checkpointFile, "a");
+    if (enumeration->checkpoint == NULL)
+    {
+        perror(checkpointFile);
+        return false;
+    }
+    enumeration->lastSync = now();
+    return true;
+}
+
+int runEnumeration(int size, int part, int parts, int threads, const char *checkpointFile, const char *streamFile,
+                   bool progress)
+{
+    ENUMERATION enumeration;
+    enumeration.size = size;
+    enumeration.part = part;
+    enumeration.parts = parts;
+    enumeration.jobs = 0;
+    enumeration.rows = NULL;
+    if (size > 1)
+    {
+        short row[ENUM_MAX_ORDER];
+        int capacity = 0;
+        row[0] = 2;
+        listSecondRows(&enumeration, row, 1, 1u << 2, &capacity);
+    }
+    else
+    {
+        enumeration.rows = (short *)allocOrExit(sizeof(short));
+        enumeration.jobs = 1; // The square of order 1 has no second row
+    }
+    enumeration.done = (bool *)allocOrExit(enumeration.jobs * sizeof(bool));
+    memset(enumeration.done, 0, enumeration.jobs * sizeof(bool));
+    enumeration.counts = (unsigned long long *)allocOrExit(enumeration.jobs * sizeof(unsigned long long));
+    enumeration.total = 0;
+    enumeration.run = 0;
+    enumeration.finished = 0;
+    enumeration.resumed = 0;
+    enumeration.checkpoint = NULL;
+    enumeration.streaming = streamFile != NULL;
+    enumeration.failed = false;
+    enumeration.progress = progress;
+    pthread_mutex_init(&enumeration.lock, NULL);
+
+    bool opened = checkpointFile == NULL || openCheckpoint(&enumeration, checkpointFile);
+    if (opened && streamFile != NULL && !createCorpus(&enumeration.writer, streamFile, size, false))
+    {
+        perror(streamFile);
+        opened = false;
+    }
+    if (!opened)
+    {
+        if (enumeration.checkpoint != NULL)
+        {
+            fclose(enumeration.checkpoint);
+        }
+        pthread_mutex_destroy(&enumeration.lock);
+        free(enumeration.done);
+        free(enumeration.counts);
+        free(enumeration.rows);
+        return -1;
+    }
+
+    unsigned long long resumedTotal = enumeration.total;
+    POOL *pool = createPool(threads);
+    enumeration.memos = (MEMO_ENTRY **)allocOrExit(pool->threads * sizeof(MEMO_ENTRY *));
+    memset(enumeration.memos, 0, pool->threads * sizeof(MEMO_ENTRY *));
+    enumeration.start = now();
+    enumeration.lastReport = enumeration.start;
+    for (int k = part; k < enumeration.jobs; k += parts)
+    {
+        if (!enumeration.done[k])
+        {
+            ENUM_JOB *job = (ENUM_JOB *)allocOrExit(sizeof(ENUM_JOB));
+            job->enumeration = &enumeration;
+            job->index = k;
+            enumeration.run++;
+            submitTask(pool, -1, runEnumJob, job);
+        }
+    }
+    waitPool(pool);
+    for (int k = 0; k < pool->threads; k++)
+    {
+        free(enumeration.memos[k]);
+    }
+    free(enumeration.memos);
+    freePool(pool);
+    double elapsed = now() - enumeration.start;
+    unsigned long long found = enumeration.total - resumedTotal;
+
+    if (enumeration.checkpoint != NULL &&
+        (fflush(enumeration.checkpoint) != 0 || fsync(fileno(enumeration.checkpoint)) != 0 ||
+         fclose(enumeration.checkpoint) != 0) &&
+        !enumeration.failed)
+    {
+        perror(checkpointFile);
+        enumeration.failed = true;
+    }
+    if (streamFile != NULL && !finishCorpus(&enumeration.writer) && !enumeration.failed)
+    {
+        perror(streamFile);
+        enumeration.failed = true;
+    }
+
+    int partJobs = (enumeration.jobs - part + parts - 1) / parts;
+    if (parts == 1)
+    {
+        printf("order %d: %llu reduced Latin squares\n", size, enumeration.total);
+    }
+    else
+    {
+        printf("order %d, part %d/%d: %llu reduced Latin squares in %d of %d jobs\n", size, part, parts,
+               enumeration.total, partJobs, enumeration.jobs);
+    }
+    fprintf(stderr, "%d jobs run, %d resumed, %.3f s, %.0f squares/s\n", enumeration.run, enumeration.resumed, elapsed,
+            elapsed > 0 ? found / elapsed : 0.0);
+
+    pthread_mutex_destroy(&enumeration.lock);
+    free(enumeration.done);
+    free(enumeration.counts);
+    free(enumeration.rows);
+    return enumeration.failed ? -1 : 0;
+}
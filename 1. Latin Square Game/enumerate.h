@@ -0,0 +1,56 @@
+/**
+ * @file enumerate.h
+ * @brief Declarations of the exhaustive enumeration of reduced Latin squares.
+ *
+ * A Latin square is reduced when its first row and its first column are 1, 2, ..., size. Every
+ * square is obtained from exactly one reduced square by permuting its columns and then its last
+ * size - 1 rows, so there are size! (size - 1)! times more squares than reduced ones.
+ *
+ * The reduced squares are split into jobs by their second row, in lexicographic order, and the
+ * rows below are filled cell by cell on a GAME with its occupancy bitsets. When only counting,
+ * the last two rows are not enumerated: each column misses two values, and the columns link
+ * those values into cycles and one path from size - 1 to size (the values of the first column
+ * there), so the two rows can be completed in 2^cycles ways. The completions of the rows below
+ * row 2 only depend on the values each column misses, so every worker caches them by those sets.
+ *
+ * A checkpoint file keeps the count of every job finished:
+ *
+ *     LSQE order <size> part <part>/<parts> jobs <jobs>
+ *     <job> <count>
+ *     ...
+ *
+ * A line is appended and flushed as soon as a job ends, and the file is synced to the disk every
+ * CHECKPOINT_SYNC_SECONDS, so an interrupted run given the same checkpoint file resumes with the
+ * jobs that were not finished.
+ */
+
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+
+#include "latinsquare.h"
+
+#define ENUM_MAX_ORDER 9          // Largest order enumerated: the count of order 10 exceeds 64 bits
+#define CHECKPOINT_SYNC_SECONDS 10 // Seconds between two syncs of the checkpoint file to the disk
+
+/**
+ * @brief Counts, and optionally writes, the reduced Latin squares of an order.
+ *
+ * The jobs of the run are the ones whose index is part modulo parts, so several processes can
+ * share an enumeration, each with its own part and checkpoint file, and add their counts. They
+ * run on a work-stealing pool. The count is printed on the standard output, the number of jobs,
+ * the time and the rate on the standard error.
+ *
+ * @param size The order, in [1..ENUM_MAX_ORDER].
+ * @param part The part of the jobs to run, in [0..parts).
+ * @param parts The number of parts the jobs are split into, at least 1.
+ * @param threads The number of worker threads, below 1 for one per processor.
+ * @param checkpointFile The checkpoint file to resume from and to update, or NULL for none.
+ * @param streamFile The corpus file receiving every square enumerated, or NULL for none; the
+ *        squares come in no particular order, and only those of the jobs run by this call.
+ * @param progress true to print a progress line on the standard error every second.
+ * @return 0 on success, -1 if the checkpoint or the corpus could not be read or written.
+ */
+int runEnumeration(int size, int part, int parts, int threads, const char *checkpointFile, const char *streamFile,
+                   bool progress);
+
+#endif // ENUMERATE_H
@@ -0,0 +1,295 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime and mkdir
+
+#include "generator.h"
+#include "console.h"
+#include "random.h"
+#include "solver.h"
+#include "threadpool.h"
+#include "timing.h"
+#include <errno.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Represents the state of a generator run shared by the workers.
+ */
+typedef struct generator
+{
+    POOL *pool;            /**< The pool generating the puzzles */
+    int size;              /**< The order of the puzzles */
+    int count;             /**< The number of puzzles */
+    uint64_t seed;         /**< The seed of the random choices */
+    int width;             /**< Removals of one puzzle tried concurrently */
+    const char *directory; /**< The directory receiving the puzzles */
+    long long givens;      /**< Givens left in the puzzles written */
+    int written;           /**< Puzzles written */
+    int failures;          /**< Puzzles that could not be written */
+    pthread_mutex_t lock;  /**< Protects the counters */
+} GENERATOR;
+
+/**
+ * @brief Represents one puzzle handed to the pool.
+ */
+typedef struct puzzle
+{
+    GENERATOR *generator; /**< The generator run */
+    int index;            /**< The index of the puzzle, which selects its random stream */
+} PUZZLE;
+
+/**
+ * @brief Represents the trial removal of one given, run as a sub-task of a puzzle.
+ */
+typedef struct check
+{
+    const GAME *puzzle; /**< The puzzle, not modified while its checks run */
+    int cell;           /**< The cell to empty, as row * size + column */
+    bool unique;        /**< Receives whether the completion stays unique without it */
+    int *pending;       /**< Checks of the batch still running */
+} CHECK;
+
+/**
+ * @brief Fills a game with a random complete Latin square.
+ *
+ * A few random values are placed and the solver completes them, then the rows, columns and
+ * symbols of the completion are shuffled so the squares are not biased towards the first
+ * completion of the solver.
+ *
+ * @param game The game, of the requested order.
+ * @param state The random stream.
+ */
+static void randomSquare(GAME *game, uint64_t *state)
+{
+    int size = game->size;
+    do
+    {
+        clearGame(game);
+        for (int k = 0; k < size; k++)
+        {
+            int i = randomBelow(state, size);
+            int j = randomBelow(state, size);
+            int val = 1 + randomBelow(state, size);
+            if (getCell(game, i, j) == 0 && !checkDuplicates(game, i, j, val))
+            {
+                placeValue(game, i, j, val);
+            }
+        }
+    } while (!solveLatinSquare(game, 1)); // A few random seeds rarely block the square
+
+    int *rows = (int *)allocOrExit(3 * size * sizeof(int));
+    int *cols = rows + size;
+    int *symbols = cols + size;
+    short *square = (short *)allocOrExit((size_t)size * size * sizeof(short));
+    for (int k = 0; k < size; k++)
+    {
+        rows[k] = cols[k] = symbols[k] = k;
+    }
+    shuffleInts(rows, size, state);
+    shuffleInts(cols, size, state);
+    shuffleInts(symbols, size, state);
+
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            square[i * size + j] = getCell(game, i, j);
+        }
+    }
+    clearGame(game);
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            placeValue(game, i, j, 1 + symbols[square[rows[i] * size + cols[j]] - 1]);
+        }
+    }
+
+    free(square);
+    free(rows);
+}
+
+/**
+ * @brief Tells whether a puzzle keeps a unique completion when one of its givens is removed.
+ *
+ * @param puzzle The puzzle, left unchanged.
+ * @param cell The cell to empty, as row * size + column.
+ * @return true if the completion is still unique.
+ */
+static bool uniqueWithout(const GAME *puzzle, int cell)
+{
+    GAME trial;
+    copyGameOrExit(&trial, puzzle);
+    clearValue(&trial, cell / puzzle->size, cell % puzzle->size);
+
+    bool unique = countCompletions(&trial, 2, 1) == 1;
+    freeGame(&trial);
+    return unique;
+}
+
+/**
+ * @brief Task function of the pool: tries the removal of one given.
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task.
+ * @param arg The CHECK to run. It belongs to the puzzle task waiting for it.
+ */
+static void checkRemoval(POOL *pool, int worker, void *arg)
+{
+    CHECK *check = (CHECK *)arg;
+    (void)pool;
+    (void)worker;
+
+    check->unique = uniqueWithout(check->puzzle, check->cell);
+    __atomic_sub_fetch(check->pending, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Removes the givens of a complete square while its completion stays unique.
+ *
+ * The cells are tried in a random order, in batches of generator->width concurrent checks.
+ * In a batch the first successful removal is applied and every failed one is final, since
+ * emptying more cells can only add completions. The successful checks after the applied one
+ * ran on a puzzle with one more given, so they are tried again in the next batch.
+ *
+ * @param generator The generator run.
+ * @param worker The worker running the puzzle.
+ * @param puzzle The complete square, reduced in place.
+ * @param state The random stream of the puzzle.
+ * @return The number of givens left.
+ */
+static int minimiseGivens(GENERATOR *generator, int worker, GAME *puzzle, uint64_t *state)
+{
+    int cells = puzzle->size * puzzle->size;
+    int *order = (int *)allocOrExit(cells * sizeof(int));
+    CHECK *checks = (CHECK *)allocOrExit(generator->width * sizeof(CHECK));
+    for (int k = 0; k < cells; k++)
+    {
+        order[k] = k;
+    }
+    shuffleInts(order, cells, state);
+
+    int head = 0;
+    while (head < cells)
+    {
+        int batch = cells - head < generator->width ? cells - head : generator->width;
+        int pending = batch;
+        for (int b = 0; b < batch; b++)
+        {
+            checks[b].puzzle = puzzle;
+            checks[b].cell = order[head + b];
+            checks[b].unique = false;
+            checks[b].pending = &pending;
+            submitTask(generator->pool, worker, checkRemoval, &checks[b]);
+        }
+        helpUntilDone(generator->pool, worker, &pending);
+
+        int first = 0;
+        while (first < batch && !checks[first].unique)
+        {
+            first++;
+        }
+        int next = head + batch;
+        if (first < batch)
+        {
+            clearValue(puzzle, checks[first].cell / puzzle->size, checks[first].cell % puzzle->size);
+            for (int b = batch - 1; b > first; b--)
+            {
+                if (checks[b].unique)
+                {
+                    order[--next] = checks[b].cell; // Try it again on the reduced puzzle
+                }
+            }
+        }
+        head = next;
+    }
+
+    free(checks);
+    free(order);
+    return cells - puzzle->empty;
+}
+
+/**
+ * @brief Task function of the pool: generates, minimises and writes one puzzle.
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task.
+ * @param arg The PUZZLE to generate. It is released here.
+ */
+static void generatePuzzle(POOL *pool, int worker, void *arg)
+{
+    PUZZLE *job = (PUZZLE *)arg;
+    GENERATOR *generator = job->generator;
+    uint64_t state = streamSeed(generator->seed, (uint64_t)job->index);
+    (void)pool;
+
+    GAME puzzle;
+    initGameOrExit(&puzzle, generator->size);
+    randomSquare(&puzzle, &state);
+    int givens = minimiseGivens(generator, worker, &puzzle, &state);
+
+    // The remaining givens are protected
+    for (int i = 0; i < puzzle.size; i++)
+    {
+        for (int j = 0; j < puzzle.size; j++)
+        {
+            setCell(&puzzle, i, j, -getCell(&puzzle, i, j));
+        }
+    }
+
+    int digits = snprintf(NULL, 0, "%d", generator->count);
+    char outputFile[MAX_PATH];
+    snprintf(outputFile, sizeof(outputFile), "%s/puzzle-%0*d.txt", generator->directory, digits, job->index + 1);
+    bool saved = saveLatinSquare(&puzzle, outputFile);
+    freeGame(&puzzle);
+
+    pthread_mutex_lock(&generator->lock);
+    if (saved)
+    {
+        generator->written++;
+        generator->givens += givens;
+    }
+    else
+    {
+        perror(outputFile);
+        generator->failures++;
+    }
+    pthread_mutex_unlock(&generator->lock);
+
+    free(job);
+}
+
+int runGenerator(int size, int count, uint64_t seed, int threads, const char *directory)
+{
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST)
+    {
+        perror(directory);
+        return count;
+    }
+
+    GENERATOR generator;
+    generator.pool = createPool(threads);
+    generator.size = size;
+    generator.count = count;
+    generator.seed = seed;
+    generator.width = count < generator.pool->threads ? generator.pool->threads / count : 1;
+    generator.directory = directory;
+    generator.givens = 0;
+    generator.written = 0;
+    generator.failures = 0;
+    pthread_mutex_init(&generator.lock, NULL);
+
+    double start = now();
+    for (int k = 0; k < count; k++)
+    {
+        PUZZLE *job = (PUZZLE *)allocOrExit(sizeof(PUZZLE));
+        job->generator = &generator;
+        job->index = k;
+        submitTask(generator.pool, -1, generatePuzzle, job);
+    }
+    waitPool(generator.pool);
+    freePool(generator.pool);
+
+    fprintf(stderr, "%d puzzles of order %d, %.1f givens on average, %d failed, seed %llu, %.3f s\n",
+            generator.written, size, generator.written > 0 ? (double)generator.givens / generator.written : 0.0,
+            generator.failures, (unsigned long long)seed, now() - start);
+    pthread_mutex_destroy(&generator.lock);
+    return generator.failures;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file generator.h
+ * @brief Declarations of the generator of puzzles with a unique completion.
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "latinsquare.h"
+
+/**
+ * @brief Generates puzzles with a unique completion and writes them as game files.
+ *
+ * Each puzzle starts as a random complete square of the requested order. Its cells are then
+ * visited in a random order and emptied whenever the solver, stopping at the second completion,
+ * still finds a single one. The remaining givens are written as protected (negative) values,
+ * so no given can be removed without losing uniqueness.
+ *
+ * Puzzles are generated concurrently on a work-stealing pool, and when there are fewer puzzles
+ * than workers the removals of one puzzle are tried concurrently as well. Since emptying more
+ * cells never makes a completion unique again, a failed removal stays failed and the result is
+ * the same as trying the removals one by one: a seed always gives the same puzzles, whatever
+ * the number of threads.
+ *
+ * The puzzles are written to directory/puzzle-<k>.txt, the directory is created if needed.
+ *
+ * @param size The order of the puzzles.
+ * @param count The number of puzzles.
+ * @param seed The seed of the random choices.
+ * @param threads The number of worker threads, below 1 for one per processor.
+ * @param directory The directory receiving the puzzles.
+ * @return The number of puzzles that could not be written.
+ */
+int runGenerator(int size, int count, uint64_t seed, int threads, const char *directory);
+
+#endif // GENERATOR_H
@@ -0,0 +1,501 @@
+#define _POSIX_C_SOURCE 200809L // For fdatasync, ftruncate and fstat
+
+#include "journal.h"
+#include "console.h"
+#include "littleendian.h"
+#include "random.h"
+#include "stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JOURNAL_MAGIC "LSQJ"     // First bytes of a journal file
+#define JOURNAL_VERSION 1        // Version of the layout written
+#define JOURNAL_HEADER_BYTES 16  // Size of the header of a journal file
+#define JOURNAL_RECORD_BYTES 8   // Size of a record
+#define JOURNAL_COMPACT_MIN 1024 // Records a journal may waste before it is compacted
+#define INITIAL_HISTORY 64       // Moves the history holds before growing
+
+/**
+ * @brief Kinds of journal records.
+ */
+typedef enum
+{
+    RECORD_MOVE = 1, /**< A move was applied */
+    RECORD_UNDO,     /**< The last move in effect was undone */
+    RECORD_REDO,     /**< The last move undone was applied again */
+    RECORD_SAVE      /**< The player saved the game */
+} RECORD_TYPE;
+
+/**
+ * @brief Returns a hash of the cells of a board, telling which board a journal belongs to.
+ *
+ * @param game The game.
+ * @return The hash.
+ */
+static uint64_t boardHash(const GAME *game)
+{
+    uint64_t hash = (uint64_t)game->size;
+    for (int i = 0; i < game->size; i++)
+    {
+        for (int j = 0; j < game->size; j++)
+        {
+            hash = mixRandom(hash + GOLDEN_GAMMA + (uint16_t)getCell(game, i, j));
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief Changes the value of a non-protected cell, keeping the bitsets and counters up to date.
+ *
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param val The new value, 0 to empty the cell.
+ */
+static void changeCell(GAME *game, int i, int j, int val)
+{
+    if (getCell(game, i, j) != 0)
+    {
+        clearValue(game, i, j);
+    }
+    if (val != 0)
+    {
+        placeValue(game, i, j, val);
+    }
+}
+
+/**
+ * @brief Adds a move after the ones in effect, forgetting the moves that could be redone.
+ *
+ * @param journal The journal.
+ * @param move The move.
+ */
+static void pushMove(JOURNAL *journal, MOVE move)
+{
+    journal->count = journal->cursor;
+    if (journal->count == journal->capacity)
+    {
+        journal->capacity = journal->capacity == 0 ? INITIAL_HISTORY : 2 * journal->capacity;
+        MOVE *moves = (MOVE *)realloc(journal->moves, journal->capacity * sizeof(MOVE));
+        if (moves == NULL)
+        {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        journal->moves = moves;
+    }
+    journal->moves[journal->count++] = move;
+    journal->cursor = journal->count;
+}
+
+/**
+ * @brief Writes a whole buffer to a file, resuming after interrupted or partial writes.
+ *
+ * @param fd The file.
+ * @param bytes The buffer.
+ * @param length Its length.
+ * @return true on success, false with errno set otherwise.
+ */
+static bool writeAll(int fd, const uint8_t *bytes, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0 && errno != EINTR)
+        {
+            return false;
+        }
+        if (written > 0)
+        {
+            bytes += written;
+            length -= (size_t)written;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Builds a journal record.
+ *
+ * @param record Receives JOURNAL_RECORD_BYTES bytes.
+ * @param type The kind of record.
+ * @param move The move of a RECORD_MOVE, NULL otherwise.
+ */
+static void buildRecord(uint8_t *record, RECORD_TYPE type, const MOVE *move)
+{
+    memset(record, 0, JOURNAL_RECORD_BYTES);
+    record[0] = (uint8_t)type;
+    if (move != NULL)
+    {
+        record[1] = move->i;
+        record[2] = move->j;
+        put16(record + 4, (uint16_t)move->before);
+        put16(record + 6, (uint16_t)move->after);
+    }
+}
+
+/**
+ * @brief Builds the header of a journal file.
+ *
+ * @param header Receives JOURNAL_HEADER_BYTES bytes.
+ * @param size The order of the square.
+ * @param hash The hash of the starting board.
+ */
+static void buildHeader(uint8_t *header, int size, uint64_t hash)
+{
+    memcpy(header, JOURNAL_MAGIC, 4);
+    put16(header + 4, JOURNAL_VERSION);
+    put16(header + 6, (uint16_t)size);
+    put64(header + 8, hash);
+}
+
+/**
+ * @brief Stops writing the journal file after an error. The history stays in memory.
+ *
+ * @param journal The journal.
+ */
+static void dropJournalFile(JOURNAL *journal)
+{
+    perror(journal->path);
+    close(journal->fd);
+    journal->fd = -1;
+}
+
+/**
+ * @brief Rewrites the journal file with only the records needed to rebuild the history.
+ *
+ * Undo and redo records accumulate when the player goes back and forth, so once the file is
+ * twice as long as needed it is replaced by the moves of the history followed by one undo
+ * record per move that can be redone. The new file is written aside and renamed over the old
+ * one, so a crash leaves one of the two complete journals.
+ *
+ * @param journal The journal.
+ */
+static void compactJournal(JOURNAL *journal)
+{
+    char temporary[MAX_PATH + 4];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", journal->path);
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        return; // Keep the long journal
+    }
+
+    uint64_t records = journal->count + (journal->count - journal->cursor);
+    size_t length = JOURNAL_HEADER_BYTES + records * JOURNAL_RECORD_BYTES;
+    uint8_t *bytes = (uint8_t *)allocOrExit(length);
+    uint8_t *record = bytes + JOURNAL_HEADER_BYTES;
+    buildHeader(bytes, journal->size, journal->hash);
+    for (size_t k = 0; k < journal->count; k++, record += JOURNAL_RECORD_BYTES)
+    {
+        buildRecord(record, RECORD_MOVE, &journal->moves[k]);
+    }
+    for (size_t k = journal->cursor; k < journal->count; k++, record += JOURNAL_RECORD_BYTES)
+    {
+        buildRecord(record, RECORD_UNDO, NULL);
+    }
+
+    bool done = writeAll(fd, bytes, length) && fdatasync(fd) == 0 && rename(temporary, journal->path) == 0;
+    free(bytes);
+    if (!done)
+    {
+        close(fd);
+        unlink(temporary);
+        return;
+    }
+    close(journal->fd);
+    journal->fd = fd;
+    journal->records = records;
+    journal->unsynced = 0;
+}
+
+/**
+ * @brief Appends a record to the journal file, flushing it every JOURNAL_SYNC_RECORDS records.
+ *
+ * @param journal The journal.
+ * @param type The kind of record.
+ * @param move The move of a RECORD_MOVE, NULL otherwise.
+ */
+static void appendRecord(JOURNAL *journal, RECORD_TYPE type, const MOVE *move)
+{
+    if (journal->fd < 0)
+    {
+        return;
+    }
+
+    uint8_t record[JOURNAL_RECORD_BYTES];
+    buildRecord(record, type, move);
+    if (!writeAll(journal->fd, record, sizeof(record)))
+    {
+        dropJournalFile(journal);
+        return;
+    }
+    journal->records++;
+    if (++journal->unsynced >= JOURNAL_SYNC_RECORDS)
+    {
+        if (fdatasync(journal->fd) != 0)
+        {
+            dropJournalFile(journal);
+            return;
+        }
+        journal->unsynced = 0;
+    }
+
+    uint64_t needed = journal->count + (journal->count - journal->cursor);
+    if (journal->records > 2 * needed + JOURNAL_COMPACT_MIN)
+    {
+        compactJournal(journal);
+    }
+}
+
+/**
+ * @brief Takes back the last move in effect without writing the journal file.
+ *
+ * @param journal The journal.
+ * @param game The game.
+ * @return true if a move was undone.
+ */
+static bool applyUndo(JOURNAL *journal, GAME *game)
+{
+    if (journal->cursor == 0)
+    {
+        return false;
+    }
+    const MOVE *move = &journal->moves[--journal->cursor];
+    changeCell(game, move->i, move->j, move->before);
+    return true;
+}
+
+/**
+ * @brief Applies again the last move undone without writing the journal file.
+ *
+ * @param journal The journal.
+ * @param game The game.
+ * @return true if a move was redone.
+ */
+static bool applyRedo(JOURNAL *journal, GAME *game)
+{
+    if (journal->cursor == journal->count)
+    {
+        return false;
+    }
+    const MOVE *move = &journal->moves[journal->cursor++];
+    changeCell(game, move->i, move->j, move->after);
+    return true;
+}
+
+/**
+ * @brief Replays one record of a journal file onto the game.
+ *
+ * @param journal The journal.
+ * @param game The game.
+ * @param record The record.
+ * @return true if the record was replayed, false if it does not apply to the game.
+ */
+static bool replayRecord(JOURNAL *journal, GAME *game, const uint8_t *record)
+{
+    switch (record[0])
+    {
+    case RECORD_MOVE:
+    {
+        MOVE move = {record[1], record[2], (int16_t)get16(record + 4), (int16_t)get16(record + 6)};
+        if (move.i >= game->size || move.j >= game->size || getCell(game, move.i, move.j) != move.before ||
+            (move.before == 0) == (move.after == 0) || validateMove(game, move.i, move.j, move.after) != MOVE_OK)
+        {
+            return false;
+        }
+        changeCell(game, move.i, move.j, move.after);
+        pushMove(journal, move);
+        return true;
+    }
+    case RECORD_UNDO:
+        return applyUndo(journal, game);
+    case RECORD_REDO:
+        return applyRedo(journal, game);
+    case RECORD_SAVE:
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Reads a whole journal file.
+ *
+ * @param fd The file.
+ * @param length Receives its length.
+ * @return The contents, NULL with errno set on a read error.
+ */
+static uint8_t *readJournalFile(int fd, size_t *length)
+{
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        return NULL;
+    }
+    *length = (size_t)info.st_size;
+    uint8_t *bytes = (uint8_t *)allocOrExit(*length + 1);
+    size_t done = 0;
+    while (done < *length)
+    {
+        ssize_t got = pread(fd, bytes + done, *length - done, (off_t)done);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got < 0)
+        {
+            free(bytes);
+            return NULL;
+        }
+        if (got == 0)
+        {
+            *length = done; // Shorter than announced: the rest is ignored like a torn record
+            break;
+        }
+        done += (size_t)got;
+    }
+    return bytes;
+}
+
+void initJournal(JOURNAL *journal)
+{
+    journal->moves = NULL;
+    journal->count = 0;
+    journal->cursor = 0;
+    journal->capacity = 0;
+    journal->fd = -1;
+    journal->size = 0;
+    journal->hash = 0;
+    journal->records = 0;
+    journal->unsynced = 0;
+    journal->path[0] = '\0';
+}
+
+long openJournal(JOURNAL *journal, GAME *game, const char *filename)
+{
+    initJournal(journal);
+    outputFileName(filename, journal->path, sizeof(journal->path) - strlen(".journal"));
+    strcat(journal->path, ".journal");
+    journal->size = game->size;
+    journal->hash = boardHash(game);
+
+    journal->fd = open(journal->path, O_RDWR | O_CREAT, 0666);
+    if (journal->fd < 0)
+    {
+        return -1;
+    }
+    size_t length;
+    uint8_t *bytes = readJournalFile(journal->fd, &length);
+    if (bytes == NULL)
+    {
+        int error = errno;
+        close(journal->fd);
+        journal->fd = -1;
+        errno = error;
+        return -1;
+    }
+
+    // Replay the journal if it was started from this board
+    long replayed = 0;
+    size_t kept = 0;
+    if (length >= JOURNAL_HEADER_BYTES && memcmp(bytes, JOURNAL_MAGIC, 4) == 0 &&
+        get16(bytes + 4) == JOURNAL_VERSION && get16(bytes + 6) == game->size && get64(bytes + 8) == journal->hash)
+    {
+        kept = JOURNAL_HEADER_BYTES;
+        while (kept + JOURNAL_RECORD_BYTES <= length && replayRecord(journal, game, bytes + kept))
+        {
+            kept += JOURNAL_RECORD_BYTES;
+            replayed++;
+        }
+    }
+    free(bytes);
+
+    // Cut what was not replayed, or start a new journal
+    bool done = true;
+    if (kept == 0)
+    {
+        uint8_t header[JOURNAL_HEADER_BYTES];
+        buildHeader(header, game->size, journal->hash);
+        done = ftruncate(journal->fd, 0) == 0 && writeAll(journal->fd, header, sizeof(header)) &&
+               fdatasync(journal->fd) == 0;
+    }
+    else if (kept < length)
+    {
+        done = ftruncate(journal->fd, (off_t)kept) == 0;
+    }
+    if (!done || lseek(journal->fd, 0, SEEK_END) < 0)
+    {
+        int error = errno;
+        close(journal->fd);
+        journal->fd = -1;
+        errno = error;
+        return -1;
+    }
+    journal->records = (uint64_t)replayed;
+    return replayed;
+}
+
+void recordMove(JOURNAL *journal, int i, int j, int before, int after)
+{
+    MOVE move = {(uint8_t)i, (uint8_t)j, (int16_t)before, (int16_t)after};
+    pushMove(journal, move);
+    appendRecord(journal, RECORD_MOVE, &move);
+}
+
+bool undoMove(JOURNAL *journal, GAME *game)
+{
+    if (!applyUndo(journal, game))
+    {
+        return false;
+    }
+    appendRecord(journal, RECORD_UNDO, NULL);
+    STATS_COUNT(STAT_UNDOS);
+    return true;
+}
+
+bool redoMove(JOURNAL *journal, GAME *game)
+{
+    if (!applyRedo(journal, game))
+    {
+        return false;
+    }
+    appendRecord(journal, RECORD_REDO, NULL);
+    STATS_COUNT(STAT_REDOS);
+    return true;
+}
+
+bool syncJournal(JOURNAL *journal)
+{
+    if (journal->fd < 0)
+    {
+        return true;
+    }
+    appendRecord(journal, RECORD_SAVE, NULL);
+    if (journal->fd < 0 || fdatasync(journal->fd) != 0)
+    {
+        return false;
+    }
+    journal->unsynced = 0;
+    return true;
+}
+
+void closeJournal(JOURNAL *journal, bool discard)
+{
+    if (journal->fd >= 0)
+    {
+        if (!discard && journal->unsynced > 0)
+        {
+            fdatasync(journal->fd);
+        }
+        close(journal->fd);
+        if (discard)
+        {
+            unlink(journal->path);
+        }
+    }
+    free(journal->moves);
+    initJournal(journal);
+}
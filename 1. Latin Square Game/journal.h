@@ -0,0 +1,120 @@
+/**
+ * @file journal.h
+ * @brief Declarations of the move history of a game and of its append-only journal file.
+ *
+ * Every move applied to a game is kept in a history array, with a cursor separating the moves
+ * in effect from the undone ones, so an undo or a redo is a single cell change. The history can
+ * be backed by a journal file, out-<game-file>.journal, made of a 16-byte header followed by one
+ * 8-byte record per event:
+ *
+ *     header  "LSQJ", version, order, hash of the starting board (little-endian)
+ *     records type (move, undo, redo or save), row, column, 0, value before, value after
+ *
+ * A record is appended with one write() as soon as the event happens, and the file is only
+ * flushed to the disk every JOURNAL_SYNC_RECORDS records or on an explicit save. Replaying
+ * the records onto the starting board rebuilds the board and the history after a crash.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "latinsquare.h"
+
+#define JOURNAL_SYNC_RECORDS 32 // Records appended between two flushes to the disk
+
+/**
+ * @brief Represents one move of the history: a cell going from one value to another.
+ */
+typedef struct move
+{
+    uint8_t i;      /**< The row index (0-based) */
+    uint8_t j;      /**< The column index (0-based) */
+    int16_t before; /**< The value of the cell before the move, 0 for empty */
+    int16_t after;  /**< The value of the cell after the move, 0 for empty */
+} MOVE;
+
+/**
+ * @brief Represents the move history of a game and its journal file.
+ */
+typedef struct journal
+{
+    MOVE *moves;            /**< The moves, oldest first */
+    size_t count;           /**< Moves in the history */
+    size_t cursor;          /**< Moves in effect; the ones after it can be redone */
+    size_t capacity;        /**< Moves allocated */
+    int fd;                 /**< The journal file, -1 for a history kept in memory only */
+    int size;               /**< The order of the square */
+    uint64_t hash;          /**< Hash of the starting board */
+    uint64_t records;       /**< Records in the journal file */
+    unsigned unsynced;      /**< Records not flushed to the disk yet */
+    char path[MAX_PATH];    /**< The name of the journal file */
+} JOURNAL;
+
+/**
+ * @brief Initializes an empty history kept in memory only.
+ *
+ * @param journal The journal to initialize.
+ */
+void initJournal(JOURNAL *journal);
+
+/**
+ * @brief Opens the journal file of a game, replaying it if a previous session left one.
+ *
+ * A journal is only replayed onto the board it was started from. Its records are replayed until
+ * the end of the file or the first record that is incomplete or does not apply to the board, and
+ * the file is cut after the last record replayed. Without a usable journal a new one is created.
+ *
+ * @param journal The journal to initialize.
+ * @param game The game as loaded from its file, brought to the state recorded in the journal.
+ * @param filename The name of the game file.
+ * @return The number of records replayed, or -1 with errno set if the journal cannot be
+ *         written; the history is then kept in memory only.
+ */
+long openJournal(JOURNAL *journal, GAME *game, const char *filename);
+
+/**
+ * @brief Records a move that was just applied. The moves that could be redone are forgotten.
+ *
+ * @param journal The journal.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param before The value of the cell before the move.
+ * @param after The value of the cell after the move.
+ */
+void recordMove(JOURNAL *journal, int i, int j, int before, int after);
+
+/**
+ * @brief Takes back the last move in effect.
+ *
+ * @param journal The journal.
+ * @param game The game.
+ * @return true if a move was undone, false if there is none.
+ */
+bool undoMove(JOURNAL *journal, GAME *game);
+
+/**
+ * @brief Applies again the last move undone.
+ *
+ * @param journal The journal.
+ * @param game The game.
+ * @return true if a move was redone, false if there is none.
+ */
+bool redoMove(JOURNAL *journal, GAME *game);
+
+/**
+ * @brief Saves the session: appends a save record and flushes the journal file to the disk.
+ *
+ * @param journal The journal.
+ * @return true on success or for a history kept in memory, false with errno set otherwise.
+ */
+bool syncJournal(JOURNAL *journal);
+
+/**
+ * @brief Flushes and closes the journal file and releases the history.
+ *
+ * @param journal The journal.
+ * @param discard true to delete the journal file, when the game was saved as a whole.
+ */
+void closeJournal(JOURNAL *journal, bool discard);
+
+#endif // JOURNAL_H
@@ -0,0 +1,64 @@
+#include "kernels.h"
+#include "stats.h"
+
+#define KERNEL_PASTE(name, order) name##order
+#define KERNEL_EXPAND(name, order) KERNEL_PASTE(name, order)
+#define KERNEL_NAME(name) KERNEL_EXPAND(name, KERNEL_ORDER) // Name of a function for the current order
+
+#define KERNEL_ORDER 4
+#include "kerneltemplate.h"
+#undef KERNEL_ORDER
+
+#define KERNEL_ORDER 5
+#include "kerneltemplate.h"
+#undef KERNEL_ORDER
+
+#define KERNEL_ORDER 6
+#include "kerneltemplate.h"
+#undef KERNEL_ORDER
+
+#define KERNEL_ORDER 7
+#include "kerneltemplate.h"
+#undef KERNEL_ORDER
+
+#define KERNEL_ORDER 8
+#include "kerneltemplate.h"
+#undef KERNEL_ORDER
+
+#define KERNEL_ORDER 9
+#include "kerneltemplate.h"
+#undef KERNEL_ORDER
+
+#define KERNEL_ORDER 16
+#include "kerneltemplate.h"
+#undef KERNEL_ORDER
+
+/**
+ * @brief The kernels of every order that has them.
+ */
+static const KERNEL kernels[] = {
+    {4, search4, verify4},
+    {5, search5, verify5},
+    {6, search6, verify6},
+    {7, search7, verify7},
+    {8, search8, verify8},
+    {9, search9, verify9},
+    {16, search16, verify16},
+};
+
+const KERNEL *findKernel(int size)
+{
+#ifndef NO_KERNELS
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        if (kernels[k].size == size)
+        {
+            return &kernels[k];
+        }
+    }
+#else
+    (void)size;
+    (void)kernels;
+#endif
+    return NULL;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file kernels.h
+ * @brief Declarations of the solver and checker kernels compiled for fixed orders.
+ *
+ * The generic solver and checker loop to a runtime order over bitsets of runtime length. For the
+ * orders used most (4 to 9 and 16) kernels.c instantiates kerneltemplate.h with the order as a
+ * compile-time constant: the board, the bitsets and the search stack are fixed-size arrays on the
+ * stack, every bitset is a single word and every loop over a row, a column or the board has a
+ * constant trip count the compiler can unroll. findKernel() picks the kernel of an order at run
+ * time and the callers fall back to the generic code for the other orders. The kernels follow
+ * the generic algorithms step by step, so they return the same completions and verdicts.
+ *
+ * Building with -DNO_KERNELS disables every kernel, to compare them with the generic code.
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "verify.h"
+
+/**
+ * @brief Signature of a kernel search, the sequential search of the solver for one order.
+ *
+ * @param cells The size * size cells, row by row, 0 for an empty cell. The sign of the values is ignored.
+ * @param limit Stop after this many completions.
+ * @param maxNodes Give up after this many nodes.
+ * @param nodes Receives the number of nodes searched.
+ * @param solution Receives the first completion, if any (size * size cells).
+ * @return The number of completions found, at most limit.
+ */
+typedef long long (*KERNEL_SEARCH)(const short *cells, long long limit, unsigned long long maxNodes,
+                                   unsigned long long *nodes, short *solution);
+
+/**
+ * @brief Signature of a kernel verification, verifySquare() for one order.
+ *
+ * @param values The size * size values, row by row.
+ * @param line Receives the first row (column for VERIFY_COLUMN) breaking the rule, 0-based.
+ * @return VERIFY_OK for a Latin square, otherwise the first rule broken.
+ */
+typedef VERIFY_STATUS (*KERNEL_VERIFY)(const uint16_t *values, int *line);
+
+/**
+ * @brief Represents the kernels compiled for one order.
+ */
+typedef struct kernel
+{
+    int size;             /**< The order the kernels are compiled for */
+    KERNEL_SEARCH search; /**< Searches completions */
+    KERNEL_VERIFY verify; /**< Verifies a completed square */
+} KERNEL;
+
+/**
+ * @brief Returns the kernels compiled for an order.
+ *
+ * @param size The order of the square.
+ * @return The kernels, or NULL when the order has none and the generic code must be used.
+ */
+const KERNEL *findKernel(int size);
+
+#endif // KERNELS_H
@@ -0,0 +1,360 @@
+/**
+ * @file kerneltemplate.h
+ * @brief The solver and checker of one order, instantiated by kernels.c.
+ *
+ * This file has no include guard: kernels.c includes it once per order, with KERNEL_ORDER set
+ * to the order and KERNEL_NAME() appending it to the names defined here. Every function is the
+ * generic one of solver.c or verify.c with the order replaced by the constant, the bitsets by a
+ * single word and the heap buffers by arrays of the state, which lives on the stack.
+ */
+
+#define ORDER KERNEL_ORDER                             // The order of the square
+#define CELLS (ORDER * ORDER)                          // The number of cells
+#define FULL ((((uint64_t)1 << (ORDER - 1)) << 1) - 1) // Bitset of all values [1..ORDER]
+#define KSTATE KERNEL_NAME(KSTATE)                     // The search state of the order
+
+/**
+ * @brief Represents the search state of the solver, as SOLVER does in solver.c.
+ */
+typedef struct KERNEL_NAME(kstate)
+{
+    uint8_t cells[CELLS];             /**< Current values, 0 for an empty cell */
+    uint64_t rowMask[ORDER];          /**< Values present in each row */
+    uint64_t colMask[ORDER];          /**< Values present in each column */
+    int empty;                        /**< Number of empty cells */
+    int trail[CELLS];                 /**< Cells assigned so far, in order */
+    int trailTop;                     /**< Number of entries in the trail */
+    int mark[CELLS + 1];              /**< Trail position before the propagation of each node */
+    int branch[CELLS + 1];            /**< Trail position before the value tried at each node */
+    int branchCell[CELLS + 1];        /**< The cell branched on at each node */
+    uint64_t branchCand[CELLS + 1];   /**< The candidates of that cell not tried yet */
+    long long found;                  /**< Number of completions found */
+    long long limit;                  /**< Stop searching after this many completions */
+    unsigned long long nodes;         /**< Nodes opened by the search */
+    unsigned long long maxNodes;      /**< Give up after this many nodes */
+    short *solution;                  /**< The first completion found */
+} KSTATE;
+
+/**
+ * @brief Computes the candidate values of an empty cell.
+ *
+ * @param s The search state.
+ * @param cell The flat index of the cell.
+ * @return The values that appear neither in the row nor in the column of the cell.
+ */
+static inline uint64_t KERNEL_NAME(candidates)(const KSTATE *s, int cell)
+{
+    return FULL & ~(s->rowMask[cell / ORDER] | s->colMask[cell % ORDER]);
+}
+
+/**
+ * @brief Places a value in an empty cell and records it on the trail.
+ *
+ * @param s The search state.
+ * @param cell The flat index of the cell.
+ * @param val The value to place.
+ */
+static inline void KERNEL_NAME(assign)(KSTATE *s, int cell, int val)
+{
+    s->cells[cell] = (uint8_t)val;
+    s->rowMask[cell / ORDER] |= BIT_OF(val);
+    s->colMask[cell % ORDER] |= BIT_OF(val);
+    s->trail[s->trailTop++] = cell;
+    s->empty--;
+}
+
+/**
+ * @brief Clears every cell assigned after the given trail position.
+ *
+ * @param s The search state.
+ * @param mark The trail position to return to.
+ */
+static inline void KERNEL_NAME(undo)(KSTATE *s, int mark)
+{
+    while (s->trailTop > mark)
+    {
+        int cell = s->trail[--s->trailTop];
+        s->rowMask[cell / ORDER] &= ~BIT_OF(s->cells[cell]);
+        s->colMask[cell % ORDER] &= ~BIT_OF(s->cells[cell]);
+        s->cells[cell] = 0;
+        s->empty++;
+    }
+}
+
+/**
+ * @brief Finds the hidden singles of a row or column and places them.
+ *
+ * @param s The search state.
+ * @param first The flat index of the first cell of the line.
+ * @param step The distance between two consecutive cells of the line.
+ * @param used The values present in the line.
+ * @param changed Set to true if a value was placed.
+ * @return false if some missing value cannot be placed in the line, true otherwise.
+ */
+static inline bool KERNEL_NAME(hiddenSingles)(KSTATE *s, int first, int step, uint64_t used, bool *changed)
+{
+    uint64_t once = 0, twice = 0;
+    for (int k = 0, cell = first; k < ORDER; k++, cell += step)
+    {
+        if (s->cells[cell] == 0)
+        {
+            uint64_t cand = KERNEL_NAME(candidates)(s, cell);
+            twice |= once & cand;
+            once |= cand;
+        }
+    }
+
+    uint64_t missing = FULL & ~used;
+    if (missing & ~once)
+    {
+        return false; // A missing value has nowhere to go
+    }
+    uint64_t singles = missing & once & ~twice;
+    while (singles != 0)
+    {
+        int val = __builtin_ctzll(singles) + 1;
+        singles &= singles - 1;
+        int k = 0, cell = first;
+        while (k < ORDER && (s->cells[cell] != 0 || !(KERNEL_NAME(candidates)(s, cell) & BIT_OF(val))))
+        {
+            k++;
+            cell += step;
+        }
+        if (k == ORDER)
+        {
+            return false; // Another single took the only cell of this value
+        }
+        KERNEL_NAME(assign)(s, cell, val);
+        STATS_COUNT(STAT_PROPAGATIONS);
+        *changed = true;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies naked and hidden singles until nothing more can be deduced.
+ *
+ * @param s The search state.
+ * @return false if a contradiction was found, true otherwise.
+ */
+static bool KERNEL_NAME(propagate)(KSTATE *s)
+{
+    bool changed = true;
+    while (changed && s->empty > 0)
+    {
+        changed = false;
+        for (int cell = 0; cell < CELLS; cell++)
+        {
+            if (s->cells[cell] != 0)
+            {
+                continue;
+            }
+            uint64_t cand = KERNEL_NAME(candidates)(s, cell);
+            if (cand == 0)
+            {
+                return false;
+            }
+            if ((cand & (cand - 1)) == 0)
+            {
+                KERNEL_NAME(assign)(s, cell, __builtin_ctzll(cand) + 1);
+                STATS_COUNT(STAT_PROPAGATIONS);
+                changed = true;
+            }
+        }
+        for (int k = 0; k < ORDER; k++)
+        {
+            if (!KERNEL_NAME(hiddenSingles)(s, k * ORDER, 1, s->rowMask[k], &changed) ||
+                !KERNEL_NAME(hiddenSingles)(s, k, ORDER, s->colMask[k], &changed))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Chooses the first empty cell with the fewest candidates.
+ *
+ * @param s The search state, after a successful propagation.
+ * @return The flat index of the cell to branch on.
+ */
+static inline int KERNEL_NAME(chooseBranchCell)(const KSTATE *s)
+{
+    int best = -1;
+    int bestCount = ORDER + 1;
+    for (int cell = 0; cell < CELLS && bestCount > 2; cell++)
+    {
+        if (s->cells[cell] == 0)
+        {
+            int count = __builtin_popcountll(KERNEL_NAME(candidates)(s, cell));
+            if (count < bestCount)
+            {
+                best = cell;
+                bestCount = count;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Propagates the current state and prepares a branching point for it.
+ *
+ * @param s The search state.
+ * @param depth The branching point to fill.
+ * @return true if the node has to be branched on, false if it failed or was a completion.
+ */
+static bool KERNEL_NAME(openFrame)(KSTATE *s, int depth)
+{
+    s->nodes++;
+    STATS_COUNT(STAT_NODES);
+    s->mark[depth] = s->trailTop;
+    STATS_START(TIMER_PROPAGATE);
+    bool consistent = KERNEL_NAME(propagate)(s);
+    STATS_STOP(TIMER_PROPAGATE);
+    if (!consistent)
+    {
+        STATS_COUNT(STAT_BACKTRACKS);
+        KERNEL_NAME(undo)(s, s->mark[depth]);
+        return false;
+    }
+    if (s->empty == 0)
+    {
+        STATS_COUNT(STAT_SOLUTIONS);
+        if (s->found++ == 0)
+        {
+            for (int cell = 0; cell < CELLS; cell++)
+            {
+                s->solution[cell] = s->cells[cell];
+            }
+        }
+        KERNEL_NAME(undo)(s, s->mark[depth]);
+        return false;
+    }
+    s->branchCell[depth] = KERNEL_NAME(chooseBranchCell)(s);
+    s->branchCand[depth] = KERNEL_NAME(candidates)(s, s->branchCell[depth]);
+    s->branch[depth] = s->trailTop;
+    return true;
+}
+
+/**
+ * @brief Searches for completions of a board, as the sequential search of solver.c does.
+ *
+ * @param cells The cells, row by row, 0 for an empty cell. The sign of the values is ignored.
+ * @param limit Stop after this many completions.
+ * @param maxNodes Give up after this many nodes.
+ * @param nodes Receives the number of nodes searched.
+ * @param solution Receives the first completion, if any.
+ * @return The number of completions found, at most limit.
+ */
+static long long KERNEL_NAME(search)(const short *cells, long long limit, unsigned long long maxNodes,
+                                     unsigned long long *nodes, short *solution)
+{
+    KSTATE s;
+    s.empty = 0;
+    s.trailTop = 0;
+    s.found = 0;
+    s.limit = limit;
+    s.nodes = 0;
+    s.maxNodes = maxNodes;
+    s.solution = solution;
+    memset(s.rowMask, 0, sizeof(s.rowMask));
+    memset(s.colMask, 0, sizeof(s.colMask));
+    for (int cell = 0; cell < CELLS; cell++)
+    {
+        int val = abs(cells[cell]);
+        s.cells[cell] = (uint8_t)val;
+        if (val == 0)
+        {
+            s.empty++;
+        }
+        else
+        {
+            s.rowMask[cell / ORDER] |= BIT_OF(val);
+            s.colMask[cell % ORDER] |= BIT_OF(val);
+        }
+    }
+
+    int depth = KERNEL_NAME(openFrame)(&s, 0) ? 1 : 0;
+    while (depth > 0)
+    {
+        int f = depth - 1;
+        KERNEL_NAME(undo)(&s, s.branch[f]); // Take back the value tried last at this node
+        if (s.branchCand[f] == 0 || s.found >= s.limit || s.nodes >= s.maxNodes)
+        {
+            KERNEL_NAME(undo)(&s, s.mark[f]);
+            depth--;
+            continue;
+        }
+        int val = __builtin_ctzll(s.branchCand[f]) + 1;
+        s.branchCand[f] &= s.branchCand[f] - 1;
+        KERNEL_NAME(assign)(&s, s.branchCell[f], val);
+        if (KERNEL_NAME(openFrame)(&s, depth))
+        {
+            depth++;
+        }
+    }
+    *nodes = s.nodes;
+    return s.found;
+}
+
+/**
+ * @brief Verifies a square, as verifySquare() does.
+ *
+ * The rows and the columns are folded into bitmaps in the same pass, with one bitmap per column.
+ *
+ * @param values The values, row by row.
+ * @param line Receives the first row (column for VERIFY_COLUMN) breaking the rule, 0-based.
+ * @return VERIFY_OK for a Latin square, otherwise the first rule broken.
+ */
+static VERIFY_STATUS KERNEL_NAME(verify)(const uint16_t *values, int *line)
+{
+    bool bad = false;
+    for (int k = 0; k < CELLS; k++)
+    {
+        bad |= (uint16_t)(values[k] - 1) >= ORDER;
+    }
+    if (bad)
+    {
+        int k = 0;
+        while ((uint16_t)(values[k] - 1) < ORDER)
+        {
+            k++;
+        }
+        *line = k / ORDER;
+        return values[k] == 0 ? VERIFY_INCOMPLETE : VERIFY_OUT_OF_RANGE;
+    }
+
+    uint64_t cols[ORDER] = {0};
+    for (int i = 0; i < ORDER; i++)
+    {
+        uint64_t row = 0;
+        for (int j = 0; j < ORDER; j++)
+        {
+            uint64_t bit = BIT_OF(values[i * ORDER + j]);
+            row |= bit;
+            cols[j] |= bit;
+        }
+        if (row != FULL)
+        {
+            *line = i;
+            return VERIFY_ROW;
+        }
+    }
+    for (int j = 0; j < ORDER; j++)
+    {
+        if (cols[j] != FULL)
+        {
+            *line = j;
+            return VERIFY_COLUMN;
+        }
+    }
+    *line = -1;
+    return VERIFY_OK;
+}
+
+#undef ORDER
+#undef CELLS
+#undef FULL
+#undef KSTATE
@@ -0,0 +1,479 @@
+#include "lanes.h"
+#include "console.h"
+#include "solver.h"
+#include "stats.h"
+
+/**
+ * @brief A vector of LANE_PUZZLES value sets, compiled to SIMD registers where the target has them.
+ */
+typedef uint16_t LANES __attribute__((vector_size(2 * LANE_PUZZLES)));
+
+/**
+ * @brief Represents LANE_PUZZLES boards of one order, side by side.
+ */
+typedef struct lanestate
+{
+    int size;                                     /**< The order of the squares */
+    LANES full;                                   /**< The set of all values in every lane */
+    LANES cells[LANE_MAX_ORDER * LANE_MAX_ORDER]; /**< The value of each cell as a single bit, 0 when empty */
+    LANES rows[LANE_MAX_ORDER];                   /**< The values present in each row */
+    LANES cols[LANE_MAX_ORDER];                   /**< The values present in each column */
+    LANES dead;                                   /**< All bits set in the lanes found to have no completion */
+} LANE_STATE;
+
+/**
+ * @brief Tells whether any lane of a vector is not zero.
+ *
+ * @param lanes The vector.
+ * @return true if a lane is not zero.
+ */
+static inline bool anyLane(LANES lanes)
+{
+    uint64_t words[sizeof(LANES) / sizeof(uint64_t)];
+    memcpy(words, &lanes, sizeof(words));
+    uint64_t any = 0;
+    for (size_t k = 0; k < sizeof(words) / sizeof(words[0]); k++)
+    {
+        any |= words[k];
+    }
+    return any != 0;
+}
+
+/**
+ * @brief Counts the lanes of a vector that are not zero.
+ *
+ * @param lanes The vector.
+ * @return The number of lanes not zero.
+ */
+static inline int countLanes(LANES lanes)
+{
+    int count = 0;
+    for (int k = 0; k < LANE_PUZZLES; k++)
+    {
+        count += lanes[k] != 0;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns all bits set in the lanes that are zero.
+ *
+ * @param lanes The vector.
+ * @return The mask of the zero lanes.
+ */
+static inline LANES zeroLanes(LANES lanes)
+{
+    return (LANES)(lanes == 0);
+}
+
+/**
+ * @brief Returns the candidates of a cell in every lane: the values missing from its row and column.
+ *
+ * @param state The boards.
+ * @param i The row of the cell.
+ * @param j The column of the cell.
+ * @return The candidates, empty in the lanes where the cell is filled.
+ */
+static inline LANES laneCandidates(const LANE_STATE *state, int i, int j)
+{
+    return state->full & ~(state->rows[i] | state->cols[j]) & zeroLanes(state->cells[i * state->size + j]);
+}
+
+/**
+ * @brief Places a value bit in a cell in the lanes where it is not zero.
+ *
+ * @param state The boards.
+ * @param i The row of the cell.
+ * @param j The column of the cell.
+ * @param place The value in each lane, a single bit or 0.
+ */
+static inline void placeLanes(LANE_STATE *state, int i, int j, LANES place)
+{
+    state->cells[i * state->size + j] |= place;
+    state->rows[i] |= place;
+    state->cols[j] |= place;
+}
+
+/**
+ * @brief Fills the cells with a single candidate, in every lane.
+ *
+ * A filled cell updates its row and column at once, so the cells after it see the new value.
+ *
+ * @param state The boards.
+ * @return Whether a cell was filled in a lane still alive.
+ */
+static bool fillNakedSingles(LANE_STATE *state)
+{
+    int size = state->size;
+    LANES changed = {0};
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            LANES empty = zeroLanes(state->cells[i * size + j]);
+            LANES cand = laneCandidates(state, i, j);
+            state->dead |= empty & zeroLanes(cand);
+            LANES place = cand & zeroLanes(cand & (cand - 1));
+            placeLanes(state, i, j, place);
+            STATS_ADD(STAT_PROPAGATIONS, countLanes(place & ~state->dead));
+            changed |= place;
+        }
+    }
+    return anyLane(changed & ~state->dead);
+}
+
+/**
+ * @brief Fills the only cell of each row, or of each column, accepting a value it misses, in every lane.
+ *
+ * @param state The boards.
+ * @param columns false for the rows, true for the columns.
+ * @return Whether a cell was filled in a lane still alive.
+ */
+static bool fillHiddenSingles(LANE_STATE *state, bool columns)
+{
+    int size = state->size;
+    LANES changed = {0};
+    for (int line = 0; line < size; line++)
+    {
+        // The values seen in the candidates of one cell of the line, and of two or more
+        LANES once = {0};
+        LANES twice = {0};
+        for (int k = 0; k < size; k++)
+        {
+            LANES cand = columns ? laneCandidates(state, k, line) : laneCandidates(state, line, k);
+            twice |= once & cand;
+            once |= cand;
+        }
+        LANES missing = state->full & ~(columns ? state->cols[line] : state->rows[line]);
+        state->dead |= ~zeroLanes(missing & ~once); // A missing value no cell accepts
+        LANES hidden = missing & once & ~twice;
+        if (!anyLane(hidden))
+        {
+            continue;
+        }
+        for (int k = 0; k < size; k++)
+        {
+            int i = columns ? k : line;
+            int j = columns ? line : k;
+            LANES place = laneCandidates(state, i, j) & hidden;
+            LANES single = zeroLanes(place & (place - 1));
+            state->dead |= ~single; // Two values only this cell accepts
+            placeLanes(state, i, j, place & single);
+            STATS_ADD(STAT_PROPAGATIONS, countLanes(place & single & ~state->dead));
+            changed |= place & single;
+        }
+    }
+    return anyLane(changed & ~state->dead);
+}
+
+/**
+ * @brief Represents a branch of the search of one lane: a cell and the values not tried in it yet.
+ */
+typedef struct lanebranch
+{
+    int cell;         /**< The cell branched on */
+    uint16_t untried; /**< Its candidates not tried yet */
+} LANE_BRANCH;
+
+/**
+ * @brief Represents the search of the square held by one lane.
+ */
+typedef struct lanesearch
+{
+    int game;              /**< The index of the game in the lane, -1 when the lane is idle */
+    int depth;             /**< Number of open branches */
+    LANE_BRANCH *branches; /**< The open branches */
+    uint16_t *saved;       /**< The cells of the lane before each open branch, size * size each */
+} LANE_SEARCH;
+
+/**
+ * @brief Loads a board into a lane, or makes the lane idle.
+ *
+ * @param state The boards.
+ * @param lane The lane.
+ * @param cells The size * size cells as value bits, or NULL to make the lane idle.
+ */
+static void loadLane(LANE_STATE *state, int lane, const uint16_t *cells)
+{
+    int size = state->size;
+    for (int i = 0; i < size; i++)
+    {
+        state->rows[i][lane] = 0;
+        state->cols[i][lane] = 0;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            uint16_t bit = cells != NULL ? cells[i * size + j] : 0;
+            state->cells[i * size + j][lane] = bit;
+            state->rows[i][lane] |= bit;
+            state->cols[j][lane] |= bit;
+        }
+    }
+    state->dead[lane] = cells != NULL ? 0 : 0xFFFF; // An idle lane is dead, so it never branches
+}
+
+/**
+ * @brief Loads a game into a lane.
+ *
+ * @param state The boards.
+ * @param lane The lane.
+ * @param game The game.
+ */
+static void loadGame(LANE_STATE *state, int lane, const GAME *game)
+{
+    uint16_t cells[LANE_MAX_ORDER * LANE_MAX_ORDER];
+    int size = state->size;
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int val = abs(getCell(game, i, j));
+            cells[i * size + j] = val != 0 ? (uint16_t)BIT_OF(val) : 0;
+        }
+    }
+    loadLane(state, lane, cells);
+}
+
+/**
+ * @brief Places a value in a cell of one lane.
+ *
+ * @param state The boards.
+ * @param lane The lane.
+ * @param cell The flat index of the cell.
+ * @param bit The value, as a single bit.
+ */
+static void placeInLane(LANE_STATE *state, int lane, int cell, uint16_t bit)
+{
+    state->cells[cell][lane] = bit;
+    state->rows[cell / state->size][lane] |= bit;
+    state->cols[cell % state->size][lane] |= bit;
+}
+
+/**
+ * @brief Finds the empty cell of a lane with the fewest candidates, as the scalar solver branches.
+ *
+ * @param state The boards.
+ * @param lane The lane.
+ * @param candidates Receives the candidates of the cell.
+ * @return The flat index of the cell, or -1 when the board of the lane is complete.
+ */
+static int branchCell(const LANE_STATE *state, int lane, uint16_t *candidates)
+{
+    int size = state->size;
+    int best = -1;
+    int fewest = size + 1;
+    for (int k = 0; k < size * size && fewest > 2; k++)
+    {
+        if (state->cells[k][lane] == 0)
+        {
+            uint16_t cand = state->full[lane] & ~(state->rows[k / size][lane] | state->cols[k % size][lane]);
+            int count = __builtin_popcount(cand);
+            if (count < fewest)
+            {
+                best = k;
+                fewest = count;
+                *candidates = cand;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Takes the next value of the innermost open branch of a lane after a contradiction.
+ *
+ * @param state The boards.
+ * @param lane The lane.
+ * @param search The search of the lane.
+ * @return false if every branch is exhausted: the game has no completion.
+ */
+static bool backtrackLane(LANE_STATE *state, int lane, LANE_SEARCH *search)
+{
+    if (search->depth == 0)
+    {
+        return false;
+    }
+    STATS_COUNT(STAT_BACKTRACKS);
+    int cells = state->size * state->size;
+    LANE_BRANCH *branch = &search->branches[search->depth - 1];
+    loadLane(state, lane, search->saved + (size_t)(search->depth - 1) * cells);
+    uint16_t bit = branch->untried & -branch->untried;
+    branch->untried &= ~bit;
+    int cell = branch->cell;
+    if (branch->untried == 0)
+    {
+        search->depth--; // The last value of the branch: its failure goes to the branch above
+    }
+    placeInLane(state, lane, cell, bit);
+    return true;
+}
+
+/**
+ * @brief Opens a branch on the empty cell of a lane with the fewest candidates and tries its first value.
+ *
+ * @param state The boards.
+ * @param lane The lane, alive and not complete.
+ * @param search The search of the lane.
+ * @param cell The cell to branch on.
+ * @param candidates Its candidates, at least two.
+ */
+static void branchLane(LANE_STATE *state, int lane, LANE_SEARCH *search, int cell, uint16_t candidates)
+{
+    STATS_COUNT(STAT_NODES);
+    int cells = state->size * state->size;
+    uint16_t *saved = search->saved + (size_t)search->depth * cells;
+    for (int k = 0; k < cells; k++)
+    {
+        saved[k] = state->cells[k][lane];
+    }
+    uint16_t bit = candidates & -candidates;
+    search->branches[search->depth].cell = cell;
+    search->branches[search->depth].untried = candidates & ~bit;
+    search->depth++;
+    placeInLane(state, lane, cell, bit);
+}
+
+/**
+ * @brief Completes a game with the values of a lane.
+ *
+ * @param state The boards.
+ * @param lane The lane, holding a complete board.
+ * @param game The game.
+ */
+static void storeLane(const LANE_STATE *state, int lane, GAME *game)
+{
+    int size = state->size;
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            if (getCell(game, i, j) == 0)
+            {
+                placeValue(game, i, j, __builtin_ctz(state->cells[i * size + j][lane]) + 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Completes games of an order up to LANE_MAX_ORDER, LANE_PUZZLES at a time.
+ *
+ * Every lane runs its own depth-first search: the propagation of all the lanes runs together,
+ * then each lane that reached a contradiction backtracks, each lane that stalled branches, and
+ * each lane that finished its game takes the next one.
+ *
+ * @param games The games.
+ * @param count The number of games.
+ * @param solved Receives whether each game was completed.
+ * @return The number of games that needed a branch.
+ */
+static int searchLanes(GAME *games[], int count, bool solved[])
+{
+    int size = games[0]->size;
+    int cells = size * size;
+    LANE_STATE state;
+    memset(&state, 0, sizeof(state));
+    state.size = size;
+    state.full += (uint16_t)((1u << size) - 1);
+
+    // Every lane branches at most once per cell
+    LANE_SEARCH searches[LANE_PUZZLES];
+    LANE_BRANCH *branches = (LANE_BRANCH *)allocOrExit((size_t)LANE_PUZZLES * cells * sizeof(LANE_BRANCH));
+    uint16_t *saved = (uint16_t *)allocOrExit((size_t)LANE_PUZZLES * cells * cells * sizeof(uint16_t));
+    int next = 0;
+    int active = 0;
+    for (int lane = 0; lane < LANE_PUZZLES; lane++)
+    {
+        searches[lane].branches = branches + (size_t)lane * cells;
+        searches[lane].saved = saved + (size_t)lane * cells * cells;
+        searches[lane].depth = 0;
+        searches[lane].game = next < count ? next++ : -1;
+        if (searches[lane].game >= 0)
+        {
+            loadGame(&state, lane, games[searches[lane].game]);
+            active++;
+        }
+        else
+        {
+            loadLane(&state, lane, NULL);
+        }
+    }
+
+    int searched = 0;
+    while (active > 0)
+    {
+        // Propagate until no lane still alive changes
+        bool changed = true;
+        while (changed)
+        {
+            changed = fillNakedSingles(&state);
+            changed = fillHiddenSingles(&state, false) || changed;
+            changed = fillHiddenSingles(&state, true) || changed;
+        }
+
+        for (int lane = 0; lane < LANE_PUZZLES; lane++)
+        {
+            LANE_SEARCH *search = &searches[lane];
+            if (search->game < 0)
+            {
+                continue;
+            }
+            uint16_t candidates = 0;
+            int cell = state.dead[lane] != 0 ? -1 : branchCell(&state, lane, &candidates);
+            if (state.dead[lane] != 0 && backtrackLane(&state, lane, search))
+            {
+                continue;
+            }
+            if (state.dead[lane] == 0 && cell >= 0)
+            {
+                searched += search->depth == 0;
+                branchLane(&state, lane, search, cell, candidates);
+                continue;
+            }
+
+            // The game is complete, or has no completion: the lane takes the next game
+            solved[search->game] = state.dead[lane] == 0;
+            if (solved[search->game])
+            {
+                STATS_COUNT(STAT_SOLUTIONS);
+                storeLane(&state, lane, games[search->game]);
+            }
+            search->depth = 0;
+            search->game = next < count ? next++ : -1;
+            if (search->game >= 0)
+            {
+                loadGame(&state, lane, games[search->game]);
+            }
+            else
+            {
+                loadLane(&state, lane, NULL);
+                active--;
+            }
+        }
+    }
+
+    free(saved);
+    free(branches);
+    return searched;
+}
+
+int solveLanes(GAME *games[], int count, bool solved[])
+{
+#ifndef NO_LANES
+    if (count > 0 && games[0]->size <= LANE_MAX_ORDER)
+    {
+        return searchLanes(games, count, solved);
+    }
+#else
+    (void)searchLanes;
+#endif
+    int searched = 0;
+    for (int k = 0; k < count; k++)
+    {
+        solved[k] = solveLatinSquare(games[k], 1);
+        searched++;
+    }
+    return searched;
+}
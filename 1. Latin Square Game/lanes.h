@@ -0,0 +1,46 @@
+/**
+ * @file lanes.h
+ * @brief Declarations of the lane-parallel solver of many small squares at once.
+ *
+ * Up to LANE_PUZZLES squares of one order, at most LANE_MAX_ORDER, are held side by side, one
+ * per 16-bit lane of a vector: every cell, row and column of the board is a vector whose lane
+ * k is the bitset of values of square k. The constraints of every square are then propagated
+ * by the same vector operations, compiled to SIMD instructions: a cell with a single candidate
+ * is filled (naked single), and so is the only cell of a row or a column accepting a value it
+ * misses (hidden single), found with the "seen once" and "seen twice" accumulators of the line.
+ * A lane without a candidate for a cell or a value is a contradiction and the square has no
+ * completion. Many puzzles with a unique completion are solved by propagation alone.
+ *
+ * A lane where nothing more can be deduced branches on its empty cell with the fewest candidates,
+ * saving its cells first, and a lane that reaches a contradiction goes back to the cells saved by
+ * its last branch and tries the next value: every lane runs its own depth-first search, while the
+ * propagation keeps running on all the lanes at once. A lane that completes its square, or proves
+ * it has no completion, takes the next square of the run, so the lanes stay busy until the end.
+ *
+ * Building with -DNO_LANES solves every square with the scalar solver, to compare the two.
+ */
+
+#ifndef LANES_H
+#define LANES_H
+
+#include "latinsquare.h"
+
+#define LANE_PUZZLES 8    // Squares solved together, one per 16-bit lane of a 128-bit vector
+#define LANE_MAX_ORDER 16 // Largest order held by a lane: a value set fits in 16 bits
+
+/**
+ * @brief Completes games of one order, LANE_PUZZLES of them at a time.
+ *
+ * The games are valid partial squares, as loaded by loadLatinSquare(). The values found are
+ * placed as positive (unprotected) values. Orders above LANE_MAX_ORDER are solved one by one.
+ * A completion is found whenever the game has one; the completions of a game with several may
+ * differ from the one solveLatinSquare() returns, since the lanes try the values in another order.
+ *
+ * @param games The games, all of the same order.
+ * @param count The number of games.
+ * @param solved Receives whether each game was completed.
+ * @return The number of games that needed a branch.
+ */
+int solveLanes(GAME *games[], int count, bool solved[]);
+
+#endif // LANES_H
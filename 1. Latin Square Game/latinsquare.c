@@ -1,403 +1,496 @@
 /**
  * @file latinsquare.c
- * @brief Function prototypes for the console driver.
+ * @brief The Latin square board model: games, their files and the rules of a move.
  *
+ * Nothing here prints or exits on an error, and no state is shared between games, so several
+ * threads can each work on their own games. The console game is built on it in console.c.
  *
  * @author Spyros Gavriil
  * @since 26/09/2024
  * @bug No known bugs.
  */
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdbool.h>
-#include <string.h>
+#include "latinsquare.h"
+#include "candidates.h"
+#include "stats.h"
+#include <ctype.h>
+#include <errno.h>
 
-#define N 9 // Maximum size of the array
+#define FILE_READ_BYTES 4096 // First size of the buffer a game file is read into
 
-/**
- * @brief Displays a Latin square in a formatted grid with boundaries.
- *
- * This function prints a Latin square of given size in a well-formatted table.
- * Each element in the square is surrounded by boundaries (| and +) and negative
- * numbers are displayed in parentheses.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square.
- *
- */
-void displayLatinSquare(short square[N][N], int size);
-/**
- * @brief Reads a Latin square from the specified file.
- *
- * This function opens the file, reads the size of the Latin square, and fills the array
- * with the values from the file. If the file contains invalid data or cannot be opened,
- * the function prints an error and exits the program.
- *
- * @param square The 2D array where the Latin square will be stored.
- * @param filename The name of the file containing the Latin square.
- * @param size Pointer to an integer that will store the size of the Latin square.
- */
-void readLatinSquare(short square[N][N], const char *filename, int *size);
-/**
- * @brief Plays a Latin square game where the user can input values into the square.
- *
- * The function repeatedly displays the current state of the Latin square and prompts
- * the user for input to modify the square. The input can either set a value, clear a
- * cell, or end the game. The game ends when the user inputs the command to save and exit
- * or when the Latin square is completely filled with non-zero values.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
- * @param filename The name of the file where the Latin square will be saved when the game ends.
- *
- */
-void play(short square[N][N], int size, const char *filename);
-/**
- * @brief Validates the user's input for modifying the Latin square.
- *
- * This function checks if the indices (i, j) and the value `val` are within the allowed
- * range for the Latin square. It also ensures that clearing a protected cell or inserting
- * a duplicate value in the same row or column is not allowed.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
- * @param i The row index (0-based) for the cell to modify.
- * @param j The column index (0-based) for the cell to modify.
- * @param val The value to insert into the cell, or 0 to clear the cell.
- *
- * @return true if the input is valid and can be applied, false otherwise.
- *
- */
-bool checkInput(short square[N][N], int size, int i, int j, int val);
-/**
- * @brief Checks for duplicates of a given value in the row and column of the Latin square.
- *
- * This function checks whether the given value `val` already exists in the same row or column
- * as the cell (i, j) in the Latin square. Duplicate values are not allowed in any row or column.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
- * @param i The row index (0-based) where the value is to be inserted.
- * @param j The column index (0-based) where the value is to be inserted.
- * @param val The value to check for duplicates in the row and column.
- *
- * @return true if a duplicate value is found in the row or column, false otherwise.
- *
- */
-void handleInput(short square[N][N], int size, int i, int j, int val, const char *filename);
-/**
- * @brief Checks for duplicates of a given value in the row and column of the Latin square.
- *
- * This function checks whether the given value `val` already exists in the same row or column
- * as the cell (i, j) in the Latin square. Duplicate values are not allowed in any row or column.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
- * @param i The row index (0-based) where the value is to be inserted.
- * @param j The column index (0-based) where the value is to be inserted.
- * @param val The value to check for duplicates in the row and column.
- *
- * @return true if a duplicate value is found in the row or column, false otherwise.
- *
- */
-bool checkDuplicates(short square[N][N], int size, int i, int j, int val);
-/**
- * @brief Saves the current Latin square to a file.
- *
- * This function writes the current state of the Latin square to a file. The output filename is
- * prefixed with "out-" and the contents are written in a plain text format with each row of
- * the Latin square on a new line.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square.
- * @param filename The original filename used as a base to generate the output file name.
- *
- */
-void writeLatinSquare(short square[N][N], int size, const char *filename);
-
-/**
- * @brief Main function to execute the Latin square game.
- *
- * This function checks if the correct number of arguments is provided, reads the Latin square from a file,
- * and starts the gameplay. It uses the file specified by the user to initialize the game.
- *
- * @param argc The number of command-line arguments.
- * @param argv An array of command-line arguments. argv[1] should be the filename of the game file.
- * @return 0 on successful execution.
- */
-int main(int argc, char *argv[])
+bool initGame(GAME *game, int size)
 {
-    // Check if the correct number of arguments is provided
-    if (argc != 2)
+    void *block = malloc(gameBlockBytes(size));
+    if (block == NULL)
     {
-        printf("Missing arguments\nUsage: %s <game-file>\n", argv[0]);
-        return 1;
+        return false;
     }
+    initGameInto(game, size, block);
+    return true;
+}
 
-    short square[N][N]; // Define the array with the maximum size
-    int size;           // Size will be dynamically set based on the file
+void initGameInto(GAME *game, int size, void *block)
+{
+    size_t words = (size_t)size * BITSET_WORDS(size);
+    game->size = size;
+    game->cellBytes = size <= SMALL_CELL_LIMIT ? 1 : 2;
+    game->words = BITSET_WORDS(size);
+    game->rowMask = (uint64_t *)block;
+    game->colMask = game->rowMask + words;
+    game->rowFill = (int *)(game->colMask + words);
+    game->colFill = game->rowFill + size;
+    game->cells = game->colFill + size;
+    game->candidates = NULL;
+    clearGame(game);
+}
 
-    // Read the Latin square from the file
-    readLatinSquare(square, argv[1], &size);
+void clearGame(GAME *game)
+{
+    size_t cells = (size_t)game->size * game->size;
+    memset(game->cells, 0, cells * game->cellBytes);
+    memset(game->rowMask, 0, (size_t)game->size * game->words * sizeof(uint64_t));
+    memset(game->colMask, 0, (size_t)game->size * game->words * sizeof(uint64_t));
+    memset(game->rowFill, 0, 2 * (size_t)game->size * sizeof(int));
+    game->empty = (int)cells;
+}
 
-    // Start the game
-    play(square, size, argv[1]);
+bool copyGame(GAME *copy, const GAME *game)
+{
+    void *block = malloc(gameBlockBytes(game->size));
+    if (block == NULL)
+    {
+        return false;
+    }
+    copyGameInto(copy, game, block);
+    return true;
+}
 
-    return 0;
+size_t gameBlockBytes(int size)
+{
+    size_t words = (size_t)size * BITSET_WORDS(size);
+    size_t bytes = 2 * words * sizeof(uint64_t) + 2 * (size_t)size * sizeof(int);
+    bytes += (size_t)size * size * (size <= SMALL_CELL_LIMIT ? 1 : 2);
+    return (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
 }
 
-/**
- * @brief Reads a Latin square from the specified file.
- *
- * This function opens the file, reads the size of the Latin square, and fills the array
- * with the values from the file. If the file contains invalid data or cannot be opened,
- * the function prints an error and exits the program.
- *
- * @param square The 2D array where the Latin square will be stored.
- * @param filename The name of the file containing the Latin square.
- * @param size Pointer to an integer that will store the size of the Latin square.
- */
-void readLatinSquare(short square[N][N], const char *filename, int *size)
+void copyGameInto(GAME *copy, const GAME *game, void *block)
 {
-    FILE *file = fopen(filename, "r");
+    int size = game->size;
+    initGameInto(copy, size, block);
+    memcpy(copy->cells, game->cells, (size_t)size * size * game->cellBytes);
+    memcpy(copy->rowMask, game->rowMask, (size_t)size * game->words * sizeof(uint64_t));
+    memcpy(copy->colMask, game->colMask, (size_t)size * game->words * sizeof(uint64_t));
+    memcpy(copy->rowFill, game->rowFill, 2 * (size_t)size * sizeof(int));
+    copy->empty = game->empty;
+}
 
-    // Check if the file was opened successfully
-    if (file == NULL)
+void freeGame(GAME *game)
+{
+    free(game->rowMask); // The cells, bitsets and counters share one block
+    game->cells = NULL;
+    game->rowMask = NULL;
+    game->colMask = NULL;
+    game->rowFill = NULL;
+    game->colFill = NULL;
+}
+
+bool scanGameNumber(const char **text, const char *end, int *number)
+{
+    const char *p = *text;
+    while (p < end && isspace((unsigned char)*p))
+    {
+        p++;
+    }
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
     {
-        perror("Error opening file");
-        exit(1); // Exit the program if file can't be opened
+        p++;
     }
+    if (p == end || !isdigit((unsigned char)*p))
+    {
+        return false;
+    }
+    int value = 0;
+    for (; p < end && isdigit((unsigned char)*p); p++)
+    {
+        // Larger numbers are out of range anyway
+        value = value > MAX_SIZE ? MAX_SIZE + 1 : value * 10 + (*p - '0');
+    }
+    *text = p;
+    *number = negative ? -value : value;
+    return true;
+}
+
+LOAD_STATUS parseLatinSquare(GAME *game, const char *text, size_t length, void *block, size_t blockBytes)
+{
+    const char *end = text + length;
 
-    // Read the size from the first line
-    if (fscanf(file, "%d", size) != 1 || *size > N || *size <= 0)
+    // Read the size first
+    int size;
+    if (!scanGameNumber(&text, end, &size) || size > MAX_SIZE || size <= 0)
     {
-        printf("Invalid size in file. Max allowed size is %d\n", N);
-        fclose(file);
-        exit(EXIT_FAILURE);
+        return LOAD_INVALID_SIZE;
+    }
+    if (block == NULL)
+    {
+        if (!initGame(game, size))
+        {
+            return LOAD_NO_MEMORY;
+        }
+    }
+    else if (blockBytes < gameBlockBytes(size))
+    {
+        game->size = size; // So the caller can provide a block large enough
+        return LOAD_NO_SPACE;
+    }
+    else
+    {
+        initGameInto(game, size, block);
     }
 
-    // Read the numbers from the file and fill the square
-    for (int i = 0; i < *size; i++)
+    // Read the values and fill the square
+    LOAD_STATUS status = LOAD_OK;
+    for (int i = 0; i < size && status == LOAD_OK; i++)
     {
-        for (int j = 0; j < *size; j++)
+        for (int j = 0; j < size && status == LOAD_OK; j++)
         {
-            if (fscanf(file, "%hd", &square[i][j]) != 1)
+            int value;
+            if (!scanGameNumber(&text, end, &value))
             {
-                printf("File contains invalid values!\n");
-                fclose(file);
-                exit(EXIT_FAILURE); // Exit if reading fails
+                status = LOAD_INVALID_VALUE;
             }
-
-            // Check for valid range of values
-            if (square[i][j] < -*size || square[i][j] > *size)
+            else if (value < -size || value > size) // Check for valid range of values
             {
-                printf("File contains invalid values\n");
-                fclose(file);
-                exit(EXIT_FAILURE);
+                status = LOAD_OUT_OF_RANGE;
+            }
+            else if (value != 0)
+            {
+                // Check that the value is not already in its row or column
+                if (hasValue(rowSet(game, i), abs(value)) || hasValue(colSet(game, j), abs(value)))
+                {
+                    status = LOAD_DUPLICATE;
+                }
+                placeValue(game, i, j, value);
             }
         }
     }
 
-    // Check for extra values in the file
-    short temp;
-    if (fscanf(file, "%hd", &temp) == 1)
+    // Check for extra values in the text
+    int temp;
+    if (status == LOAD_OK && scanGameNumber(&text, end, &temp))
     {
-        printf("File contains more data than expected!\n");
-        fclose(file);
-        exit(EXIT_FAILURE);
+        status = LOAD_EXTRA_DATA;
     }
 
-    // Close the file
+    if (status != LOAD_OK && block == NULL)
+    {
+        freeGame(game);
+    }
+    return status;
+}
+
+LOAD_STATUS readGameFile(const char *filename, char **text, size_t *length)
+{
+    FILE *file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        return LOAD_OPEN_FAILED;
+    }
+
+    size_t capacity = FILE_READ_BYTES;
+    size_t used = 0;
+    char *data = (char *)malloc(capacity);
+    size_t read;
+    while (data != NULL && (read = fread(data + used, 1, capacity - used, file)) > 0)
+    {
+        used += read;
+        if (used == capacity)
+        {
+            capacity *= 2;
+            char *larger = (char *)realloc(data, capacity);
+            if (larger == NULL)
+            {
+                free(data);
+            }
+            data = larger;
+        }
+    }
+    bool failed = ferror(file) != 0;
     fclose(file);
+
+    if (data == NULL)
+    {
+        return LOAD_NO_MEMORY;
+    }
+    if (failed)
+    {
+        free(data);
+        return LOAD_OPEN_FAILED;
+    }
+    *text = data;
+    *length = used;
+    return LOAD_OK;
 }
 
 /**
- * @brief Displays a Latin square in a formatted grid with boundaries.
+ * @brief Loads a Latin square from the specified file without exiting on errors.
  *
- * This function prints a Latin square of given size in a well-formatted table.
- * Each element in the square is surrounded by boundaries (| and +) and negative
- * numbers are displayed in parentheses.
+ * The file is read whole into memory by readGameFile() and parsed by parseLatinSquare().
  *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square.
+ * @param game The game where the Latin square will be stored. It is only allocated on success.
+ * @param filename The name of the file containing the Latin square.
+ * @return LOAD_OK on success, otherwise the reason the file was rejected.
+ */
+LOAD_STATUS loadLatinSquare(GAME *game, const char *filename)
+{
+    STATS_START(TIMER_LOAD);
+    char *text;
+    size_t length;
+    LOAD_STATUS status = readGameFile(filename, &text, &length);
+    if (status == LOAD_OK)
+    {
+        status = parseLatinSquare(game, text, length, NULL, 0);
+        free(text);
+    }
+    STATS_STOP(TIMER_LOAD);
+    return status;
+}
+
+/**
+ * @brief Returns a short name for the outcome of loading a game file.
  *
+ * @param status The outcome returned by loadLatinSquare().
+ * @return A lowercase name without spaces, e.g. "duplicate".
  */
-void displayLatinSquare(short square[N][N], int size)
+const char *loadStatusName(LOAD_STATUS status)
 {
-    for (int i = 0; i < size; i++)
+    switch (status)
     {
-        printf("+");
-        for (int j = 0; j < size; j++)
-        {
-            printf("-----+");
-        }
-        printf("\n");
-        for (int j = 0; j < size; j++)
-        {
-            int number = square[i][j];
+    case LOAD_OK:
+        return "ok";
+    case LOAD_OPEN_FAILED:
+        return "unreadable";
+    case LOAD_INVALID_SIZE:
+        return "invalid-size";
+    case LOAD_INVALID_VALUE:
+        return "invalid-value";
+    case LOAD_OUT_OF_RANGE:
+        return "out-of-range";
+    case LOAD_DUPLICATE:
+        return "duplicate";
+    case LOAD_EXTRA_DATA:
+        return "extra-data";
+    case LOAD_NO_SPACE:
+        return "no-space";
+    case LOAD_NO_MEMORY:
+        return "no-memory";
+    }
+    return "unknown";
+}
 
-            // If the number is negative, print with parentheses
-            if (number < 0)
-            {
-                printf("| (%d) ", -number);
-            }
-            else
-            {
-                // Print positive number normally
-                printf("|  %d  ", number);
-            }
-        }
-        printf("|\n");
+int valueDigits(int size)
+{
+    int digits = 1;
+    for (int limit = 10; limit <= size; limit *= 10)
+    {
+        digits++;
     }
-    printf("+");
+    return digits;
+}
+
+/**
+ * @brief Draws a border line of the board, e.g. "+-----+-----+" for orders below 10.
+ *
+ * @param out Where the line is written.
+ * @param size The order of the square.
+ * @param digits The width of a value.
+ * @return The position after the line.
+ */
+static char *renderBorder(char *out, int size, int digits)
+{
+    *out++ = '+';
     for (int j = 0; j < size; j++)
     {
-        printf("-----+");
+        memset(out, '-', digits + 4);
+        out += digits + 4;
+        *out++ = '+';
     }
-    printf("\n");
+    *out++ = '\n';
+    return out;
 }
 
 /**
- * @brief Plays a Latin square game where the user can input values into the square.
- *
- * The function repeatedly displays the current state of the Latin square and prompts
- * the user for input to modify the square. The input can either set a value, clear a
- * cell, or end the game. The game ends when the user inputs the command to save and exit
- * or when the Latin square is completely filled with non-zero values.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
- * @param filename The name of the file where the Latin square will be saved when the game ends.
+ * @brief Returns the number of characters of a square drawn by renderLatinSquare().
  *
+ * @param size The order of the square.
+ * @return The length of the drawing, newlines included.
  */
-void play(short square[N][N], int size, const char *filename)
+size_t boardTextSize(int size)
 {
-    int i, j, val;
-    bool solved = false;
-    while (!solved)
-    {
-        displayLatinSquare(square, size);
+    // size + 1 border lines and size rows, each with size cells of digits + 5 characters
+    size_t line = (size_t)size * (valueDigits(size) + 5) + 2;
+    return (2 * (size_t)size + 1) * line;
+}
 
-        printf("Enter your command in the following format:\n");
-        printf("+ i,j=val: for entering val at position (i,j)\n");
-        printf("+ i,j=0 : for clearing cell (i,j)\n");
-        printf("+ 0,0=0 : for saving and ending the game\n");
-        printf("Notice: i, j, val numbering is from [1..%d]\n", size);
-        printf(">");
+/**
+ * @brief Draws a Latin square into a buffer, as displayLatinSquare() prints it.
+ *
+ * @param game The game holding the Latin square.
+ * @param buffer Receives boardTextSize(game->size) characters, without a terminating NUL.
+ * @return The number of characters written.
+ */
+size_t renderLatinSquare(const GAME *game, char *buffer)
+{
+    STATS_START(TIMER_RENDER);
+    int size = game->size;
 
-        if (scanf("%d,%d=%d", &i, &j, &val) != 3)
-        {
-            while (getchar() != '\n')
-            {
-            }; // Clear the input buffer
-            printf("Error: wrong format of command!\n");
-        }
-        else
-        {
-            printf("\n");
-            handleInput(square, size, i - 1, j - 1, val, filename);
-        }
+    // Cells are as wide as the largest value, e.g. "| (9) " and "|  9  " for orders below 10
+    int digits = valueDigits(size);
 
-        solved = true;
-        for (int row = 0; row < size && solved; row++)
+    char *out = buffer;
+    for (int i = 0; i < size; i++)
+    {
+        out = renderBorder(out, size, digits);
+        for (int j = 0; j < size; j++)
         {
-            for (int col = 0; col < size && solved; col++)
+            int number = getCell(game, i, j);
+            int value = abs(number);
+
+            // Negative numbers are printed with parentheses
+            memcpy(out, number < 0 ? "| (" : "|  ", 3);
+            char *digit = out + 3 + digits;
+            memset(out + 3, ' ', digits);
+            do
             {
-                if (square[row][col] == 0)
-                {
-                    solved = false;
-                }
-            }
+                *--digit = (char)('0' + value % 10);
+                value /= 10;
+            } while (value > 0);
+            memcpy(out + 3 + digits, number < 0 ? ") " : "  ", 2);
+            out += digits + 5;
         }
+        *out++ = '|';
+        *out++ = '\n';
     }
+    out = renderBorder(out, size, digits);
+    STATS_STOP(TIMER_RENDER);
+    return (size_t)(out - buffer);
+}
 
-    printf("\nGame completed!!!\n");
-    displayLatinSquare(square, size);
-    writeLatinSquare(square, size, filename);
+/**
+ * @brief Tells whether a value would leave the board failing Hall's condition, in strict mode.
+ *
+ * @param game The game holding the Latin square.
+ * @param i The row index (0-based) of an empty cell.
+ * @param j The column index (0-based) of the cell.
+ * @param val A value missing from the row and the column of the cell.
+ * @return true if strict matchings are attached and the board passes the condition without the
+ *         value and fails it with the value.
+ */
+static bool leadsToDeadEnd(GAME *game, int i, int j, int val)
+{
+    const CANDIDATES *candidates = game->candidates;
+    if (candidates == NULL || candidates->matchings == NULL || !candidates->matchings->strict ||
+        !passesHall(candidates))
+    {
+        return false;
+    }
+    // The matchings follow the value in and out, repairing only the lines it touches
+    placeValue(game, i, j, val);
+    bool deadEnd = !passesHall(candidates);
+    clearValue(game, i, j);
+    return deadEnd;
 }
 
 /**
- * @brief Validates the user's input for modifying the Latin square.
+ * @brief Checks a move like checkInput() does, without printing anything.
  *
- * This function checks if the indices (i, j) and the value `val` are within the allowed
- * range for the Latin square. It also ensures that clearing a protected cell or inserting
- * a duplicate value in the same row or column is not allowed.
+ * When strict matchings are attached to the candidate sets of the game (see attachMatchings()),
+ * a value is tried on the board and removed again, and it is rejected if the board passed Hall's
+ * condition before it and no longer does with it.
  *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
+ * @param game The game holding the Latin square.
  * @param i The row index (0-based) for the cell to modify.
  * @param j The column index (0-based) for the cell to modify.
  * @param val The value to insert into the cell, or 0 to clear the cell.
- *
- * @return true if the input is valid and can be applied, false otherwise.
- *
+ * @return MOVE_OK if the move can be applied, otherwise the rule it breaks.
  */
-bool checkInput(short square[N][N], int size, int i, int j, int val)
+MOVE_STATUS validateMove(GAME *game, int i, int j, int val)
 {
+    STATS_START(TIMER_VALIDATE);
+    int size = game->size;
+    MOVE_STATUS status;
     if (i < 0 || i >= size || j < 0 || j >= size || val < 0 || val > size)
     {
-        printf("Error: i,j or val are outside the allowed range [1..%d]!\n", size);
-        return false;
+        status = MOVE_OUT_OF_RANGE;
     }
-    if (val == 0)
+    else if (val == 0)
     {
-        if (square[i][j] < 0)
-        {
-            printf("Error: illegal to clear cell!\n");
-            return false;
-        }
+        status = getCell(game, i, j) < 0 ? MOVE_PROTECTED : MOVE_OK;
+    }
+    else if (getCell(game, i, j) != 0)
+    {
+        status = MOVE_OCCUPIED;
     }
     else
     {
-        if (square[i][j] != 0)
-        {
-            printf("Error: cell is already occupied!\n");
-            return false;
-        }
-        if (checkDuplicates(square, size, i, j, val))
-        {
-            printf("Error: Illegal value insertion!\n");
-            return false;
-        }
+        status = checkDuplicates(game, i, j, val) ? MOVE_DUPLICATE
+                 : leadsToDeadEnd(game, i, j, val) ? MOVE_DEAD_END
+                                                   : MOVE_OK;
     }
-    return true;
+    STATS_STOP(TIMER_VALIDATE);
+    STATS_COUNT(STAT_ACCEPTED + status); // The rejection counters follow the order of MOVE_STATUS
+    return status;
 }
 
-/**
- * @brief Handles the user's input to modify the Latin square or save and exit the game.
- *
- * This function processes the user's command by either modifying the Latin square or
- * saving the current game state and exiting if the user inputs the save command.
- *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
- * @param i The row index (0-based) for the cell to modify.
- * @param j The column index (0-based) for the cell to modify.
- * @param val The value to insert into the cell, or 0 to clear the cell.
- * @param filename The name of the file where the Latin square will be saved.
- *
- */
-void handleInput(short square[N][N], int size, int i, int j, int val, const char *filename)
+MOVE_STATUS playMove(GAME *game, int i, int j, int val, int *before)
 {
-    if (i == -1 && j == -1 && val == 0)
+    MOVE_STATUS status = validateMove(game, i, j, val);
+    if (status != MOVE_OK)
     {
-        writeLatinSquare(square, size, filename);
-        exit(EXIT_SUCCESS); // Save the game logic if required and then exit
+        return status;
     }
 
-    if (checkInput(square, size, i, j, val))
+    STATS_COUNT(STAT_MOVES);
+    int previous = getCell(game, i, j);
+    if (before != NULL)
     {
-        square[i][j] = val;
-        if (val == 0)
-        {
-            printf("Value cleared!\n");
-        }
-        else
-        {
-            printf("Value inserted!\n");
-        }
+        *before = previous;
+    }
+    if (val != 0)
+    {
+        placeValue(game, i, j, val);
+    }
+    else if (previous != 0)
+    {
+        clearValue(game, i, j); // Only non-protected cells get here, clearing an empty cell changes nothing
+    }
+    return MOVE_OK;
+}
+
+/**
+ * @brief Returns a short name for the outcome of checking a move.
+ *
+ * @param status The outcome returned by validateMove().
+ * @return A lowercase name without spaces, e.g. "duplicate".
+ */
+const char *moveStatusName(MOVE_STATUS status)
+{
+    switch (status)
+    {
+    case MOVE_OK:
+        return "ok";
+    case MOVE_OUT_OF_RANGE:
+        return "out-of-range";
+    case MOVE_PROTECTED:
+        return "protected";
+    case MOVE_OCCUPIED:
+        return "occupied";
+    case MOVE_DUPLICATE:
+        return "duplicate";
+    case MOVE_DEAD_END:
+        return "dead-end";
     }
+    return "unknown";
 }
 
 /**
@@ -406,8 +499,7 @@ void handleInput(short square[N][N], int size, int i, int j, int val, const char
  * This function checks whether the given value `val` already exists in the same row or column
  * as the cell (i, j) in the Latin square. Duplicate values are not allowed in any row or column.
  *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square (number of rows and columns).
+ * @param game The game holding the Latin square.
  * @param i The row index (0-based) where the value is to be inserted.
  * @param j The column index (0-based) where the value is to be inserted.
  * @param val The value to check for duplicates in the row and column.
@@ -415,68 +507,98 @@ void handleInput(short square[N][N], int size, int i, int j, int val, const char
  * @return true if a duplicate value is found in the row or column, false otherwise.
  *
  */
-bool checkDuplicates(short square[N][N], int size, int i, int j, int val)
+bool checkDuplicates(GAME *game, int i, int j, int val)
+{
+    // The bitsets already hold every value of the row and column
+    return hasValue(rowSet(game, i), val) || hasValue(colSet(game, j), val);
+}
+
+/**
+ * @brief Builds the name of the file a game is saved to.
+ *
+ * The name of the game file is prefixed with "out-", in the same directory as the game file.
+ *
+ * @param filename The name of the game file.
+ * @param outputFile Receives the name of the output file.
+ * @param size The size of the outputFile buffer.
+ */
+void outputFileName(const char *filename, char *outputFile, size_t size)
+{
+    const char *base = strrchr(filename, '/');
+    base = (base == NULL) ? filename : base + 1;
+    snprintf(outputFile, size, "%.*sout-%s", (int)(base - filename), filename, base);
+}
+
+size_t squareTextSize(int size)
 {
-    for (int k = 0; k < size; k++)
+    // The size and its end of line, then size rows of size signed values each followed by a blank
+    return (size_t)valueDigits(size) + 1 + (size_t)size * ((size_t)size * (valueDigits(size) + 2) + 1);
+}
+
+size_t formatLatinSquare(const GAME *game, char *buffer)
+{
+    char digits[8];
+    char *out = buffer;
+    int size = game->size;
+    for (int k = -1; k < size * size; k++)
     {
-        if (abs(square[i][k]) == val) // Check for duplicates in the row
+        // The size first, then the cells row by row
+        int number = k < 0 ? size : getCell(game, k / size, k % size);
+        int value = abs(number);
+        int count = 0;
+        do
+        {
+            digits[count++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        if (number < 0)
         {
-            return true;
+            *out++ = '-';
         }
-    }
-    for (int k = 0; k < size; k++)
-    {
-        if (abs(square[k][j]) == val) // Check for duplicates in the column
+        while (count > 0)
+        {
+            *out++ = digits[--count];
+        }
+        *out++ = k < 0 ? '\n' : ' ';
+        if (k >= 0 && k % size == size - 1)
         {
-            return true;
+            *out++ = '\n'; // New line after each row
         }
     }
-    return false;
+    return (size_t)(out - buffer);
 }
 
 /**
- * @brief Saves the current Latin square to a file.
+ * @brief Writes a Latin square to a file without exiting on errors.
  *
- * This function writes the current state of the Latin square to a file. The output filename is
- * prefixed with "out-" and the contents are written in a plain text format with each row of
+ * The contents are written in the game file format: the size first, then each row of
  * the Latin square on a new line.
  *
- * @param square A 2D array representing the Latin square.
- * @param size The size of the Latin square.
- * @param filename The original filename used as a base to generate the output file name.
- *
+ * @param game The game holding the Latin square.
+ * @param outputFile The name of the file to write.
+ * @return true on success, false if the file cannot be written.
  */
-void writeLatinSquare(short square[N][N], int size, const char *filename)
+bool saveLatinSquare(GAME *game, const char *outputFile)
 {
-    // Create a buffer for the output filename
-    char outputFile[256]; // Ensure this is large enough for the output file name
-    strcpy(outputFile, "out-");
-    strcat(outputFile, filename); // Concatenate "out-" with the original filename
-
     // Open the output file for writing
     FILE *file = fopen(outputFile, "w");
     if (file == NULL)
     {
-        perror("Error opening output file");
-        exit(EXIT_FAILURE); // Exit if file opening fails
+        return false;
     }
 
-    printf("Saving to %s...\n", outputFile);
-
-    // Write the size first
-    fprintf(file, "%d\n", size);
-
-    // Write the square's content row by row
-    for (int i = 0; i < size; i++)
+    // The square is formatted in memory and written with one call
+    char *text = (char *)malloc(squareTextSize(game->size));
+    if (text == NULL)
     {
-        for (int j = 0; j < size; j++)
-        {
-            fprintf(file, "%d ", square[i][j]); // Write each value with a space separator
-        }
-        fprintf(file, "\n"); // New line after each row
+        fclose(file);
+        errno = ENOMEM;
+        return false;
     }
+    size_t length = formatLatinSquare(game, text);
+    bool written = fwrite(text, 1, length, file) == length;
+    free(text);
 
-    printf("Done\n");
     // Close the file
-    fclose(file);
+    return fclose(file) == 0 && written;
 }
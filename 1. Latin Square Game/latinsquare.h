@@ -0,0 +1,448 @@
+/**
+ * @file latinsquare.h
+ * @brief Declarations of the Latin square board model shared by the game and its solver.
+ *
+ * The model is a library: its functions report errors by their return values, running out of
+ * memory included, and never print or exit (the allocOrExit() helpers of the frontends are in
+ * console.h). A game holds all its state and the functions share none, so any number of threads
+ * can use the model at once as long as each game is used by one thread at a time. A caller that manages its own memory builds
+ * games in blocks it provides (initGameInto(), parseLatinSquare()) and reads and writes them as
+ * text in buffers (parseLatinSquare(), formatLatinSquare()), without any allocation or file.
+ * The console game is built on it (see console.h).
+ */
+
+#ifndef LATINSQUARE_H
+#define LATINSQUARE_H
+
+#include "bitset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_SIZE 256         // Largest order of a Latin square
+#define SMALL_CELL_LIMIT 127 // Largest order stored with 8-bit cells
+#define MAX_PATH 1024        // Longest file name handled
+
+struct candidates;
+
+/**
+ * @brief Represents the state of a Latin square game.
+ *
+ * The cells are stored row by row in one heap block sized at load time, using 8-bit cells
+ * up to order SMALL_CELL_LIMIT and 16-bit cells beyond, so a row is a short contiguous run
+ * of memory. Besides the cells the game carries one occupancy bitset per row and per column:
+ * value v (protected or not) is in the bitset of row i when it appears in row i, so a
+ * legality check is a couple of AND operations instead of a scan of the whole row and column.
+ * The number of empty cells and the number of filled cells of every row and column are kept
+ * up to date by placeValue() and clearValue(), so completion is known without a scan and the
+ * counters can be read directly for progress reports. When candidate sets are attached (see
+ * candidates.h) the two functions keep them up to date as well.
+ */
+typedef struct game
+{
+    int size;          /**< The order of the Latin square */
+    int cellBytes;     /**< Bytes per cell: 1 or 2 */
+    void *cells;       /**< size * size cells, row-major; negative values are protected */
+    int words;         /**< Words per occupancy bitset */
+    uint64_t *rowMask; /**< size bitsets: values present in each row */
+    uint64_t *colMask; /**< size bitsets: values present in each column */
+    int empty;         /**< Number of empty cells */
+    int *rowFill;      /**< Number of filled cells of each row */
+    int *colFill;      /**< Number of filled cells of each column */
+    struct candidates *candidates; /**< Live candidate sets, NULL when none are attached */
+} GAME;
+
+/**
+ * @brief Outcome of loading a game file.
+ */
+typedef enum
+{
+    LOAD_OK,            /**< The file holds a valid partial Latin square */
+    LOAD_OPEN_FAILED,   /**< The file cannot be opened */
+    LOAD_INVALID_SIZE,  /**< The size is missing or outside [1..MAX_SIZE] */
+    LOAD_INVALID_VALUE, /**< A value is missing or is not a number */
+    LOAD_OUT_OF_RANGE,  /**< A value is outside [-size..size] */
+    LOAD_DUPLICATE,     /**< A value repeats in a row or column */
+    LOAD_EXTRA_DATA,    /**< The file holds more values than the square */
+    LOAD_NO_SPACE,      /**< The square does not fit in the block provided by the caller */
+    LOAD_NO_MEMORY      /**< The memory of the game or of the text of the file cannot be allocated */
+} LOAD_STATUS;
+
+/**
+ * @brief Outcome of checking a move against the rules of the game.
+ */
+typedef enum
+{
+    MOVE_OK,           /**< The move can be applied */
+    MOVE_OUT_OF_RANGE, /**< i, j or val is outside [1..size] (val may be 0) */
+    MOVE_PROTECTED,    /**< The move clears a protected cell */
+    MOVE_OCCUPIED,     /**< The move fills a cell that is not empty */
+    MOVE_DUPLICATE,    /**< The value is already in the row or column */
+    MOVE_DEAD_END      /**< In strict mode, the move leaves a board that provably cannot be completed */
+} MOVE_STATUS;
+
+/**
+ * @brief Returns the value of a cell.
+ *
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @return The value, negative for a protected cell and 0 for an empty one.
+ */
+static inline int getCell(const GAME *game, int i, int j)
+{
+    int k = i * game->size + j;
+    return game->cellBytes == 1 ? ((const int8_t *)game->cells)[k] : ((const int16_t *)game->cells)[k];
+}
+
+/**
+ * @brief Stores the value of a cell. The occupancy bitsets are not touched.
+ *
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param val The value, negative for a protected cell and 0 for an empty one.
+ */
+static inline void setCell(GAME *game, int i, int j, int val)
+{
+    int k = i * game->size + j;
+    if (game->cellBytes == 1)
+    {
+        ((int8_t *)game->cells)[k] = (int8_t)val;
+    }
+    else
+    {
+        ((int16_t *)game->cells)[k] = (int16_t)val;
+    }
+}
+
+/**
+ * @brief Returns the occupancy bitset of a row.
+ *
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @return uint64_t* The bitset of the values present in row i.
+ */
+static inline uint64_t *rowSet(const GAME *game, int i)
+{
+    return game->rowMask + (size_t)i * game->words;
+}
+
+/**
+ * @brief Returns the occupancy bitset of a column.
+ *
+ * @param game The game.
+ * @param j The column index (0-based).
+ * @return uint64_t* The bitset of the values present in column j.
+ */
+static inline uint64_t *colSet(const GAME *game, int j)
+{
+    return game->colMask + (size_t)j * game->words;
+}
+
+/**
+ * @brief Updates the candidate sets after a value was placed (see candidates.c).
+ *
+ * @param candidates The candidate sets of the game.
+ * @param game The game, already holding the value.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param val The value placed, in [1..size].
+ */
+void removeCandidates(struct candidates *candidates, const GAME *game, int i, int j, int val);
+
+/**
+ * @brief Updates the candidate sets after a value was cleared (see candidates.c).
+ *
+ * @param candidates The candidate sets of the game.
+ * @param game The game, no longer holding the value.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param val The value cleared, in [1..size].
+ */
+void restoreCandidates(struct candidates *candidates, const GAME *game, int i, int j, int val);
+
+/**
+ * @brief Fills an empty cell, updating the bitsets and the fill counters.
+ *
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ * @param val The value, negative for a protected cell.
+ */
+static inline void placeValue(GAME *game, int i, int j, int val)
+{
+    setCell(game, i, j, val);
+    addValue(rowSet(game, i), abs(val));
+    addValue(colSet(game, j), abs(val));
+    game->rowFill[i]++;
+    game->colFill[j]++;
+    game->empty--;
+    if (game->candidates != NULL)
+    {
+        removeCandidates(game->candidates, game, i, j, abs(val));
+    }
+}
+
+/**
+ * @brief Empties a filled cell, updating the bitsets and the fill counters.
+ *
+ * @param game The game.
+ * @param i The row index (0-based).
+ * @param j The column index (0-based).
+ */
+static inline void clearValue(GAME *game, int i, int j)
+{
+    int val = abs(getCell(game, i, j));
+    setCell(game, i, j, 0);
+    removeValue(rowSet(game, i), val);
+    removeValue(colSet(game, j), val);
+    game->rowFill[i]--;
+    game->colFill[j]--;
+    game->empty++;
+    if (game->candidates != NULL)
+    {
+        restoreCandidates(game->candidates, game, i, j, val);
+    }
+}
+
+/**
+ * @brief Tells whether every cell of a game is filled.
+ *
+ * @param game The game.
+ * @return true if the game has no empty cell.
+ */
+static inline bool isComplete(const GAME *game)
+{
+    return game->empty == 0;
+}
+
+/**
+ * @brief Allocates an empty game of the given order.
+ *
+ * @param game The game to initialize.
+ * @param size The order of the Latin square, in [1..MAX_SIZE].
+ * @return false, with the game left uninitialized, if the memory cannot be allocated.
+ */
+bool initGame(GAME *game, int size);
+/**
+ * @brief Makes an empty game of the given order in a block provided by the caller instead of the heap.
+ *
+ * The game must not be released with freeGame(): the block belongs to the caller.
+ *
+ * @param game The game to initialize.
+ * @param size The order of the Latin square, in [1..MAX_SIZE].
+ * @param block At least gameBlockBytes(size) bytes, aligned for 64-bit words.
+ */
+void initGameInto(GAME *game, int size, void *block);
+/**
+ * @brief Empties every cell of a game.
+ *
+ * @param game The game.
+ */
+void clearGame(GAME *game);
+/**
+ * @brief Allocates a copy of a game, with its bitsets and counters.
+ *
+ * @param copy The game to initialize.
+ * @param game The game to copy.
+ * @return false, with the copy left uninitialized, if the memory cannot be allocated.
+ */
+bool copyGame(GAME *copy, const GAME *game);
+/**
+ * @brief Returns the bytes of the block holding the cells, bitsets and counters of a game.
+ *
+ * @param size The order of the Latin square.
+ * @return The size of the block, a multiple of 8.
+ */
+size_t gameBlockBytes(int size);
+/**
+ * @brief Makes a copy of a game in a block provided by the caller instead of the heap.
+ *
+ * The copy has no candidate sets and must not be released with freeGame(): the block belongs
+ * to the caller, who can keep many games of one order in a single allocation.
+ *
+ * @param copy The game to initialize.
+ * @param game The game to copy.
+ * @param block At least gameBlockBytes(game->size) bytes, aligned for 64-bit words.
+ */
+void copyGameInto(GAME *copy, const GAME *game, void *block);
+/**
+ * @brief Releases the memory of a game allocated by initGame(), copyGame() or a load.
+ *
+ * @param game The game.
+ */
+void freeGame(GAME *game);
+/**
+ * @brief Returns the number of digits of the largest value of a square.
+ *
+ * @param size The order of the square.
+ * @return The width of a value in the drawing of the square, as renderLatinSquare() draws it.
+ */
+int valueDigits(int size);
+/**
+ * @brief Returns the number of characters of a square drawn by renderLatinSquare().
+ *
+ * @param size The order of the square.
+ * @return The length of the drawing, newlines included.
+ */
+size_t boardTextSize(int size);
+/**
+ * @brief Draws a Latin square into a buffer, as displayLatinSquare() prints it.
+ *
+ * The drawing is built without any formatted output call, so a board can be written with a
+ * single system call.
+ *
+ * @param game The game holding the Latin square.
+ * @param buffer Receives boardTextSize(game->size) characters, without a terminating NUL.
+ * @return The number of characters written.
+ */
+size_t renderLatinSquare(const GAME *game, char *buffer);
+/**
+ * @brief Reads one number of the text of a game file, skipping the blanks before it, as
+ *        fscanf("%d") does.
+ *
+ * @param text Where to read, moved past the number.
+ * @param end The end of the text.
+ * @param number Receives the number, clamped to [-MAX_SIZE - 1..MAX_SIZE + 1].
+ * @return true if a number was read.
+ */
+bool scanGameNumber(const char **text, const char *end, int *number);
+/**
+ * @brief Reads a whole game file into memory without exiting on errors.
+ *
+ * @param filename The name of the game file.
+ * @param text Receives the text, not terminated by a NUL, only on success. It must be freed.
+ * @param length Receives the number of characters of the text.
+ * @return LOAD_OK on success, otherwise LOAD_OPEN_FAILED or LOAD_NO_MEMORY.
+ */
+LOAD_STATUS readGameFile(const char *filename, char **text, size_t *length);
+/**
+ * @brief Reads a Latin square from the text of a game file held in memory.
+ *
+ * The text holds the order of the square followed by its size * size values, negative for
+ * protected cells and 0 for empty ones, separated by blanks. The row and column occupancy
+ * bitsets are built while reading, so duplicate givens are detected in the same pass.
+ *
+ * @param game The game where the Latin square will be stored. On LOAD_NO_SPACE its size holds the
+ *             order read, so a large enough block can be provided.
+ * @param text The text, not necessarily terminated by a NUL.
+ * @param length The number of characters of the text.
+ * @param block The block receiving the game (see initGameInto()), or NULL to allocate the game on
+ *              the heap, only on success; LOAD_NO_MEMORY is returned if it cannot be allocated.
+ * @param blockBytes The size of the block; gameBlockBytes(MAX_SIZE) is enough for any square.
+ * @return LOAD_OK on success, otherwise the reason the text was rejected.
+ */
+LOAD_STATUS parseLatinSquare(GAME *game, const char *text, size_t length, void *block, size_t blockBytes);
+/**
+ * @brief Loads a Latin square from the specified file without exiting on errors.
+ *
+ * The file holds the order of the square followed by its size * size values, negative for
+ * protected cells and 0 for empty ones. The row and column occupancy bitsets are built while
+ * reading, so duplicate givens are detected in the same pass.
+ *
+ * @param game The game where the Latin square will be stored. It is only allocated on success.
+ * @param filename The name of the file containing the Latin square.
+ * @return LOAD_OK on success, otherwise the reason the file was rejected.
+ */
+LOAD_STATUS loadLatinSquare(GAME *game, const char *filename);
+/**
+ * @brief Returns a short name for the outcome of loading a game file.
+ *
+ * @param status The outcome returned by loadLatinSquare() or parseLatinSquare().
+ * @return A lowercase name without spaces, e.g. "duplicate".
+ */
+const char *loadStatusName(LOAD_STATUS status);
+/**
+ * @brief Checks a move like checkInput() does, without printing anything.
+ *
+ * When strict matchings are attached to the candidate sets of the game (see attachMatchings()),
+ * a value is tried on the board and removed again, and it is rejected if the board passed Hall's
+ * condition before it and no longer does with it.
+ *
+ * @param game The game holding the Latin square.
+ * @param i The row index (0-based) for the cell to modify.
+ * @param j The column index (0-based) for the cell to modify.
+ * @param val The value to insert into the cell, or 0 to clear the cell.
+ * @return MOVE_OK if the move can be applied, otherwise the rule it breaks.
+ */
+MOVE_STATUS validateMove(GAME *game, int i, int j, int val);
+/**
+ * @brief Validates a move like validateMove() and applies it when it is legal.
+ *
+ * Clearing an empty cell is accepted and changes nothing.
+ *
+ * @param game The game holding the Latin square.
+ * @param i The row index (0-based) for the cell to modify.
+ * @param j The column index (0-based) for the cell to modify.
+ * @param val The value to insert into the cell, or 0 to clear the cell.
+ * @param before Receives the value of the cell before an applied move, e.g. to record it; may be NULL.
+ * @return MOVE_OK if the move was applied, otherwise the rule it breaks.
+ */
+MOVE_STATUS playMove(GAME *game, int i, int j, int val, int *before);
+/**
+ * @brief Returns a short name for the outcome of checking a move.
+ *
+ * @param status The outcome returned by validateMove() or playMove().
+ * @return A lowercase name without spaces, e.g. "duplicate".
+ */
+const char *moveStatusName(MOVE_STATUS status);
+/**
+ * @brief Checks for duplicates of a given value in the row and column of the Latin square.
+ *
+ * This function checks whether the given value `val` already exists in the same row or column
+ * as the cell (i, j) in the Latin square. Duplicate values are not allowed in any row or column.
+ *
+ * @param game The game holding the Latin square.
+ * @param i The row index (0-based) where the value is to be inserted.
+ * @param j The column index (0-based) where the value is to be inserted.
+ * @param val The value to check for duplicates in the row and column.
+ *
+ * @return true if a duplicate value is found in the row or column, false otherwise.
+ *
+ */
+bool checkDuplicates(GAME *game, int i, int j, int val);
+/**
+ * @brief Builds the name of the file a game is saved to.
+ *
+ * The name of the game file is prefixed with "out-", in the same directory as the game file.
+ *
+ * @param filename The name of the game file.
+ * @param outputFile Receives the name of the output file.
+ * @param size The size of the outputFile buffer.
+ */
+void outputFileName(const char *filename, char *outputFile, size_t size);
+/**
+ * @brief Returns the largest number of characters of a square written by formatLatinSquare().
+ *
+ * @param size The order of the square.
+ * @return The bound on the length of the text.
+ */
+size_t squareTextSize(int size);
+/**
+ * @brief Writes a Latin square into a buffer in the game file format.
+ *
+ * The size comes first, then each row of the Latin square on a new line, as saveLatinSquare()
+ * writes it and parseLatinSquare() reads it.
+ *
+ * @param game The game holding the Latin square.
+ * @param buffer Receives at most squareTextSize(game->size) characters, without a terminating NUL.
+ * @return The number of characters written.
+ */
+size_t formatLatinSquare(const GAME *game, char *buffer);
+/**
+ * @brief Writes a Latin square to a file without exiting on errors.
+ *
+ * The contents are written in the game file format: the size first, then each row of
+ * the Latin square on a new line.
+ *
+ * @param game The game holding the Latin square.
+ * @param outputFile The name of the file to write.
+ * @return true on success, false (with errno set) if the file cannot be written or the memory
+ *         of its text cannot be allocated.
+ */
+bool saveLatinSquare(GAME *game, const char *outputFile);
+
+#endif // LATINSQUARE_H
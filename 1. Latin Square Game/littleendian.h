@@ -0,0 +1,80 @@
+/**
+ * @file littleendian.h
+ * @brief Helpers storing and loading the little-endian numbers of the binary file formats.
+ */
+
+#ifndef LITTLEENDIAN_H
+#define LITTLEENDIAN_H
+
+#include <stdint.h>
+
+/**
+ * @brief Stores a 16-bit little-endian number.
+ *
+ * @param bytes The destination.
+ * @param value The number.
+ */
+static inline void put16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief Stores a 32-bit little-endian number.
+ *
+ * @param bytes The destination.
+ * @param value The number.
+ */
+static inline void put32(uint8_t *bytes, uint32_t value)
+{
+    put16(bytes, (uint16_t)value);
+    put16(bytes + 2, (uint16_t)(value >> 16));
+}
+
+/**
+ * @brief Stores a 64-bit little-endian number.
+ *
+ * @param bytes The destination.
+ * @param value The number.
+ */
+static inline void put64(uint8_t *bytes, uint64_t value)
+{
+    put32(bytes, (uint32_t)value);
+    put32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+/**
+ * @brief Loads a 16-bit little-endian number.
+ *
+ * @param bytes The source.
+ * @return The number.
+ */
+static inline uint16_t get16(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] | bytes[1] << 8);
+}
+
+/**
+ * @brief Loads a 32-bit little-endian number.
+ *
+ * @param bytes The source.
+ * @return The number.
+ */
+static inline uint32_t get32(const uint8_t *bytes)
+{
+    return get16(bytes) | (uint32_t)get16(bytes + 2) << 16;
+}
+
+/**
+ * @brief Loads a 64-bit little-endian number.
+ *
+ * @param bytes The source.
+ * @return The number.
+ */
+static inline uint64_t get64(const uint8_t *bytes)
+{
+    return get32(bytes) | (uint64_t)get32(bytes + 4) << 32;
+}
+
+#endif // LITTLEENDIAN_H
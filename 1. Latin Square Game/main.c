@@ -0,0 +1,429 @@
+/**
+ * @file main.c
+ * @brief Command line entry point of the Latin square game and of its non-interactive modes.
+ */
+
+#include "console.h"
+#include "solver.h"
+#include "batch.h"
+#include "canonical.h"
+#include "corpus.h"
+#include "enumerate.h"
+#include "generator.h"
+#include "mols.h"
+#include "sampler.h"
+#include "script.h"
+#include "server.h"
+#include <time.h>
+
+/**
+ * @brief Solves a game file without user interaction.
+ *
+ * The file is read with the same rules as for the interactive game, completed by the
+ * solver and saved with writeLatinSquare().
+ *
+ * @param filename The name of the game file.
+ * @param threads Number of solver threads.
+ * @return true if the square was completed and saved, false if it has no completion.
+ */
+static bool solveGameFile(const char *filename, int threads)
+{
+    GAME game;
+    readLatinSquare(&game, filename);
+
+    bool solved = solveLatinSquare(&game, threads);
+    if (solved)
+    {
+        writeLatinSquare(&game, filename);
+    }
+    else
+    {
+        printf("%s: the Latin square cannot be completed!\n", filename);
+    }
+
+    freeGame(&game);
+    return solved;
+}
+
+/**
+ * @brief Counts the completions of a game file without user interaction.
+ *
+ * @param filename The name of the game file.
+ * @param threads Number of counting threads.
+ * @param progress true to report the progress of long counts.
+ */
+static void countGameFile(const char *filename, int threads, bool progress)
+{
+    GAME game;
+    readLatinSquare(&game, filename);
+
+    unsigned long long count;
+    if (countLatinSquare(&game, threads, progress, &count))
+    {
+        printf("%s: %llu completions\n", filename, count);
+    }
+    else
+    {
+        printf("%s: more than %llu completions\n", filename, count);
+    }
+
+    freeGame(&game);
+}
+
+/**
+ * @brief Prints the command line usage of the program.
+ *
+ * @param program The name of the program.
+ */
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [--strict] <game-file>\n", program);
+    printf("       %s --script <command-file|-> [--render] [--strict] <game-file>\n", program);
+    printf("       %s --solve [--threads N] <game-file>...\n", program);
+    printf("       %s --batch [--solve] [--threads N] <game-file|directory|->...\n", program);
+    printf("       %s --verify [--threads N] <game-file|directory|->...\n", program);
+    printf("       %s --pack <corpus-file> <game-file|directory|->...\n", program);
+    printf("       %s --unpack <corpus-file> <directory>\n", program);
+    printf("       %s --dedup <corpus-file> [--max-unique N] <game-file|directory|->...\n", program);
+    printf("       %s --count [--progress] [--threads N] <game-file>...\n", program);
+    printf("       %s --generate ORDER [--puzzles K] [--seed S] [--threads N] <directory>\n", program);
+    printf("       %s --mols K [--threads N] <game-file|ORDER>\n", program);
+    printf("       %s --sample ORDER [--squares K] [--steps S] [--seed S] [--threads N] [--corpus] <directory|corpus-file>\n",
+           program);
+    printf("           (S is ORDER^2 by default; every step takes about ORDER moves of the chain)\n");
+    printf("       %s --enumerate ORDER [--part P/Q] [--checkpoint FILE] [--stream CORPUS] [--progress] [--threads N]\n",
+           program);
+    printf("       %s --serve <socket> [--max-sessions N] <game-file>\n", program);
+}
+
+/**
+ * @brief Main function to execute the Latin square game.
+ *
+ * This function checks if the correct number of arguments is provided, reads the Latin square from a file,
+ * and starts the gameplay. It uses the file specified by the user to initialize the game.
+ * With the --solve option every given game file is completed by the solver instead, using
+ * the number of threads given with --threads (0 for one per processor). With the --batch
+ * option the files, directories or file lists given are validated (or solved) in parallel.
+ * With the --verify option they are checked to be completed Latin squares in parallel.
+ * With the --pack and --unpack options game files are converted to and from a binary corpus.
+ * With the --dedup option they are packed without the squares isotopic to one packed before.
+ * With the --count option the number of completions of every given game file is printed.
+ * With the --generate option new puzzles with a unique completion are written to a directory.
+ * With the --mols option a set of mutually orthogonal Latin squares containing a square is searched.
+ * With the --sample option uniformly distributed random Latin squares are written to a directory or a corpus.
+ * With the --enumerate option the reduced Latin squares of an order are counted, or written to a corpus.
+ * With the --script option the game is played with the commands of a file instead of the keyboard.
+ * With the --strict option the moves after which the square can no longer be completed are refused.
+ * With the --serve option the game is played by the clients of a Unix domain socket, one game each.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments. argv[1] should be the filename of the game file,
+ *             or a mode option followed by the options and one or more game files. An option
+ *             after the first file is rejected.
+ * @return 0 on successful execution.
+ */
+int main(int argc, char *argv[])
+{
+    bool solve = false;
+    bool batch = false;
+    bool verify = false;
+    bool count = false;
+    bool progress = false;
+    const char *pack = NULL; // Corpus file to create from game files
+    const char *unpack = NULL; // Corpus file to convert to game files
+    const char *dedup = NULL; // Corpus file receiving the squares not isotopic to an earlier one
+    long maxUnique = 0; // Canonical forms remembered when deduplicating, 0 for the default
+    const char *script = NULL; // Command file to play, "-" for the standard input
+    bool render = false;
+    bool strict = false; // Refuse the moves breaking Hall's condition
+    const char *serve = NULL; // Socket to serve games on
+    int maxSessions = 0; // Sessions served at the same time, 0 for the default
+    int threads = -1; // Not given: one thread to solve, one per processor in batch mode
+    int generate = -1; // Order of the puzzles to generate, -1 when not generating
+    int puzzles = 1; // Number of puzzles to generate
+    int mols = 0; // Number of mutually orthogonal squares to search, 0 when not searching
+    int sample = 0; // Order of the random squares to draw, 0 when not sampling
+    long long squares = 1; // Number of random squares to draw
+    long long steps = 0; // Proper states between two random squares, 0 for ORDER^2
+    bool corpus = false; // Write the random squares to a corpus file instead of a directory
+    int enumerate = 0; // Order of the reduced squares to enumerate, 0 when not enumerating
+    int part = 0, parts = 1; // Part of the enumeration jobs run by this process
+    const char *checkpoint = NULL; // Checkpoint file of the enumeration
+    const char *stream = NULL; // Corpus receiving the enumerated squares
+    uint64_t seed = (uint64_t)time(NULL);
+    int first = argc; // Index of the first file argument
+
+    for (int k = 1; k < argc && first == argc; k++)
+    {
+        if (strcmp(argv[k], "--solve") == 0)
+        {
+            solve = true;
+        }
+        else if (strcmp(argv[k], "--batch") == 0)
+        {
+            batch = true;
+        }
+        else if (strcmp(argv[k], "--verify") == 0)
+        {
+            verify = true;
+        }
+        else if (strcmp(argv[k], "--threads") == 0 && k + 1 < argc)
+        {
+            threads = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--generate") == 0 && k + 1 < argc)
+        {
+            generate = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--puzzles") == 0 && k + 1 < argc)
+        {
+            puzzles = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--mols") == 0 && k + 1 < argc)
+        {
+            mols = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--sample") == 0 && k + 1 < argc)
+        {
+            sample = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--squares") == 0 && k + 1 < argc)
+        {
+            squares = atoll(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--steps") == 0 && k + 1 < argc)
+        {
+            steps = atoll(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--corpus") == 0)
+        {
+            corpus = true;
+        }
+        else if (strcmp(argv[k], "--enumerate") == 0 && k + 1 < argc)
+        {
+            enumerate = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--part") == 0 && k + 1 < argc)
+        {
+            if (sscanf(argv[++k], "%d/%d", &part, &parts) != 2)
+            {
+                parts = 0; // Rejected below
+            }
+        }
+        else if (strcmp(argv[k], "--checkpoint") == 0 && k + 1 < argc)
+        {
+            checkpoint = argv[++k];
+        }
+        else if (strcmp(argv[k], "--stream") == 0 && k + 1 < argc)
+        {
+            stream = argv[++k];
+        }
+        else if (strcmp(argv[k], "--count") == 0)
+        {
+            count = true;
+        }
+        else if (strcmp(argv[k], "--pack") == 0 && k + 1 < argc)
+        {
+            pack = argv[++k];
+        }
+        else if (strcmp(argv[k], "--unpack") == 0 && k + 1 < argc)
+        {
+            unpack = argv[++k];
+        }
+        else if (strcmp(argv[k], "--dedup") == 0 && k + 1 < argc)
+        {
+            dedup = argv[++k];
+        }
+        else if (strcmp(argv[k], "--max-unique") == 0 && k + 1 < argc)
+        {
+            maxUnique = atol(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--script") == 0 && k + 1 < argc)
+        {
+            script = argv[++k];
+        }
+        else if (strcmp(argv[k], "--serve") == 0 && k + 1 < argc)
+        {
+            serve = argv[++k];
+        }
+        else if (strcmp(argv[k], "--max-sessions") == 0 && k + 1 < argc)
+        {
+            maxSessions = atoi(argv[++k]);
+        }
+        else if (strcmp(argv[k], "--render") == 0)
+        {
+            render = true;
+        }
+        else if (strcmp(argv[k], "--strict") == 0)
+        {
+            strict = true;
+        }
+        else if (strcmp(argv[k], "--progress") == 0)
+        {
+            progress = true;
+        }
+        else if (strcmp(argv[k], "--seed") == 0 && k + 1 < argc)
+        {
+            seed = strtoull(argv[++k], NULL, 10);
+        }
+        else if (strncmp(argv[k], "--", 2) == 0)
+        {
+            printf("Unknown option %s\n", argv[k]);
+            printUsage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            first = k;
+        }
+    }
+
+    // Options are only read before the files: one after them would otherwise be taken as a file
+    for (int k = first + 1; k < argc; k++)
+    {
+        if (strncmp(argv[k], "--", 2) == 0)
+        {
+            printf("Option %s after the files\n", argv[k]);
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Corpus conversions
+    if (pack != NULL && first < argc)
+    {
+        return packCorpus(pack, argv + first, argc - first) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (unpack != NULL && first == argc - 1)
+    {
+        return unpackCorpus(unpack, argv[first]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (dedup != NULL && first < argc)
+    {
+        return runDedup(dedup, argv + first, argc - first, maxUnique) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Scripted mode: play the commands of a file without interaction
+    if (script != NULL && first == argc - 1)
+    {
+        GAME game;
+        readLatinSquare(&game, argv[first]);
+        int rejected = runScript(&game, argv[first], script, render, strict);
+        freeGame(&game);
+        return rejected == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Server mode: play games with the clients of a socket until interrupted
+    if (serve != NULL && first == argc - 1)
+    {
+        return runServer(serve, argv[first], maxSessions) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Generator mode: write new puzzles to a directory
+    if (generate >= 0 && first == argc - 1)
+    {
+        if (generate < 1 || generate > MAX_SIZE || puzzles < 1)
+        {
+            printf("Invalid order or count\n");
+            return 1;
+        }
+        int failures = runGenerator(generate, puzzles, seed, threads < 0 ? 0 : threads, argv[first]);
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // MOLS mode: search for squares orthogonal to a square and to each other
+    if (mols != 0 && first == argc - 1)
+    {
+        if (mols < 2)
+        {
+            printf("Invalid number of squares\n");
+            return 1;
+        }
+        return runMols(argv[first], mols, threads < 0 ? 0 : threads) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Sampler mode: write uniformly distributed random squares
+    if (sample != 0 && first == argc - 1)
+    {
+        if (sample < 1 || sample > MAX_SIZE || squares < 1 || steps < 0)
+        {
+            printf("Invalid order or count\n");
+            return 1;
+        }
+        long long failures = runSampler(sample, squares, steps, seed, threads < 0 ? 0 : threads, argv[first], corpus);
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Enumeration mode: count the reduced squares of an order, or a part of them
+    if (enumerate != 0 && first == argc)
+    {
+        if (enumerate < 1 || enumerate > ENUM_MAX_ORDER || parts < 1 || part < 0 || part >= parts)
+        {
+            printf("Invalid order or part\n");
+            return 1;
+        }
+        int status = runEnumeration(enumerate, part, parts, threads < 0 ? 0 : threads, checkpoint, stream, progress);
+        return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Verification mode: check many completed squares in parallel
+    if (verify && first < argc)
+    {
+        int failures = runBatch(argv + first, argc - first, BATCH_VERIFY, threads < 0 ? 0 : threads);
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Batch mode: validate or solve many files in parallel
+    if (batch && first < argc)
+    {
+        BATCH_MODE mode = solve ? BATCH_SOLVE : BATCH_VALIDATE;
+        int failures = runBatch(argv + first, argc - first, mode, threads < 0 ? 0 : threads);
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Counting mode: print the number of completions of every game file given
+    if (count && first < argc)
+    {
+        for (int k = first; k < argc; k++)
+        {
+            countGameFile(argv[k], threads < 0 ? 0 : threads, progress);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Solver mode: complete every game file given
+    if (solve && first < argc)
+    {
+        threads = threads < 0 ? 1 : threads;
+        int failures = 0;
+        for (int k = first; k < argc; k++)
+        {
+            if (!solveGameFile(argv[k], threads))
+            {
+                failures++;
+            }
+        }
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Check if the correct number of arguments is provided
+    if (solve || batch || verify || count || generate >= 0 || mols != 0 || sample != 0 || enumerate != 0 ||
+        pack != NULL || unpack != NULL || dedup != NULL || script != NULL || render || serve != NULL ||
+        first != argc - 1)
+    {
+        printf("Missing arguments\n");
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    GAME game; // The square, its size and its occupancy bitsets
+
+    // Read the Latin square from the file
+    readLatinSquare(&game, argv[first]);
+
+    // Start the game
+    play(&game, argv[first], strict);
+
+    freeGame(&game);
+    return 0;
+}
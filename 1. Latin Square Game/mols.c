@@ -0,0 +1,768 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime
+
+#include "mols.h"
+#include "console.h"
+#include "threadpool.h"
+#include "timing.h"
+#include <ctype.h>
+#include <limits.h>
+
+#define MAX_WORDS BITSET_WORDS(MAX_SIZE) // Words of the largest bitset of columns or values
+#define INITIAL_TRANSVERSALS 1024        // Room for transversals before the first growth
+#define NO_KEY INT_MAX                   // Key of the best set before any is found
+
+/**
+ * @brief Represents the transversals common to a set of squares.
+ */
+typedef struct transversals
+{
+    int size;          /**< The order of the squares */
+    int count;         /**< Number of transversals */
+    int capacity;      /**< Room in columns, in transversals */
+    uint8_t *columns;  /**< count * size: the column of the cell of each row, per transversal */
+    int words;         /**< Words of a bitset of transversals */
+    uint64_t *through; /**< size * size bitsets: the transversals through each cell */
+} TRANSVERSALS;
+
+/**
+ * @brief Represents the state of the enumeration of transversals.
+ */
+typedef struct walk
+{
+    const uint16_t *square;          /**< The square */
+    int size;                        /**< The order of the square */
+    int words;                       /**< Words per bitset of columns or values */
+    uint64_t freeColumns[MAX_WORDS]; /**< Columns without a cell yet, column j stored as value j + 1 */
+    uint64_t used[MAX_WORDS];        /**< Values taken by the cells chosen so far */
+    uint8_t path[MAX_SIZE];          /**< The column chosen in each row so far */
+    TRANSVERSALS *result;            /**< Receives the transversals */
+} WALK;
+
+/**
+ * @brief Represents the state shared by the branches of a parallel search.
+ *
+ * Every branch has a key that orders it like the sequential search would visit it. The set
+ * found by the branch with the smallest key wins, and branches with larger keys are cancelled.
+ */
+typedef struct search
+{
+    int size;                  /**< The order of the squares */
+    int count;                 /**< Number of squares of the set */
+    const uint16_t *square;    /**< The given square */
+    const TRANSVERSALS *first; /**< The transversals of the given square */
+    int bestKey;               /**< Key of the branch of the best set, NO_KEY before (atomic) */
+    uint16_t *mates;           /**< The mates of the best set, protected by lock */
+    unsigned long long nodes;  /**< Nodes of the finished branches (atomic) */
+    pthread_mutex_t lock;      /**< Protects mates and bestKey updates */
+} SEARCH;
+
+/**
+ * @brief Represents the exact cover of the cells by the transversals of a set of squares.
+ */
+typedef struct cover
+{
+    SEARCH *search;            /**< The search it belongs to */
+    int key;                   /**< The key of its branch */
+    uint16_t *squares;         /**< The set so far, with room for every square of the set */
+    int filled;                /**< Squares of the set so far; the mate goes after them */
+    const TRANSVERSALS *t;     /**< The transversals common to the set */
+    uint64_t *live;            /**< size + 1 bitsets: the transversals still usable at each depth */
+    bool *covered;             /**< Tells whether each cell lies in a chosen transversal */
+    int *chosen;               /**< The transversal chosen at each depth */
+    unsigned long long nodes;  /**< Nodes searched */
+} COVER;
+
+/**
+ * @brief Represents a branch of the first cell handed to the thread pool.
+ */
+typedef struct job
+{
+    SEARCH *search; /**< The search */
+    int key;        /**< Position of the branch in the sequential order */
+    int first;      /**< The transversal chosen for the first cell */
+} JOB;
+
+static bool searchMates(SEARCH *search, int key, uint16_t *squares, int filled, const TRANSVERSALS *parent);
+
+/**
+ * @brief Appends the transversal held by a walk to its result.
+ *
+ * @param walk The walk, with a column chosen in every row.
+ * @return false if the result already holds MAX_TRANSVERSALS transversals, true otherwise.
+ */
+static bool addTransversal(WALK *walk)
+{
+    TRANSVERSALS *t = walk->result;
+    if (t->count == MAX_TRANSVERSALS)
+    {
+        return false;
+    }
+    if (t->count == t->capacity)
+    {
+        t->capacity = t->capacity == 0 ? INITIAL_TRANSVERSALS : 2 * t->capacity;
+        uint8_t *columns = (uint8_t *)realloc(t->columns, (size_t)t->capacity * t->size);
+        if (columns == NULL)
+        {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        t->columns = columns;
+    }
+    memcpy(t->columns + (size_t)t->count * t->size, walk->path, t->size);
+    t->count++;
+    return true;
+}
+
+/**
+ * @brief Extends the partial transversal of a walk with every fitting cell of a row.
+ *
+ * @param walk The walk, with a column chosen in the rows above.
+ * @param row The row to choose a cell in.
+ * @return false if the enumeration gave up on too many transversals, true otherwise.
+ */
+static bool walkRow(WALK *walk, int row)
+{
+    if (row == walk->size)
+    {
+        return addTransversal(walk);
+    }
+    const uint16_t *values = walk->square + (size_t)row * walk->size;
+    for (int w = 0; w < walk->words; w++)
+    {
+        uint64_t bits = walk->freeColumns[w];
+        while (bits != 0)
+        {
+            int column = w * WORD_BITS + __builtin_ctzll(bits) + 1;
+            bits &= bits - 1;
+            int val = values[column - 1];
+            if (hasValue(walk->used, val))
+            {
+                continue;
+            }
+
+            addValue(walk->used, val);
+            removeValue(walk->freeColumns, column);
+            walk->path[row] = (uint8_t)(column - 1);
+            bool complete = walkRow(walk, row + 1);
+            addValue(walk->freeColumns, column);
+            removeValue(walk->used, val);
+            if (!complete)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Builds the bitsets of the transversals through every cell.
+ *
+ * @param t The transversals, without their bitsets yet.
+ */
+static void indexTransversals(TRANSVERSALS *t)
+{
+    int size = t->size;
+    size_t cells = (size_t)size * size;
+    t->words = BITSET_WORDS(t->count > 0 ? t->count : 1);
+    t->through = (uint64_t *)allocOrExit(cells * t->words * sizeof(uint64_t));
+    memset(t->through, 0, cells * t->words * sizeof(uint64_t));
+    for (int k = 0; k < t->count; k++)
+    {
+        const uint8_t *columns = t->columns + (size_t)k * size;
+        for (int i = 0; i < size; i++)
+        {
+            addValue(t->through + ((size_t)i * size + columns[i]) * t->words, k + 1);
+        }
+    }
+}
+
+/**
+ * @brief Enumerates the transversals of a square and indexes them by cell.
+ *
+ * @param square The square.
+ * @param size The order of the square.
+ * @param t Receives the transversals; release them with freeTransversals().
+ * @return false if there are more than MAX_TRANSVERSALS of them, true otherwise.
+ */
+static bool findTransversals(const uint16_t *square, int size, TRANSVERSALS *t)
+{
+    WALK walk;
+    walk.square = square;
+    walk.size = size;
+    walk.words = BITSET_WORDS(size);
+    fillValues(walk.freeColumns, size);
+    memset(walk.used, 0, sizeof(walk.used));
+    walk.result = t;
+
+    t->size = size;
+    t->count = 0;
+    t->capacity = 0;
+    t->columns = NULL;
+    t->through = NULL;
+    if (!walkRow(&walk, 0))
+    {
+        return false;
+    }
+    indexTransversals(t);
+    return true;
+}
+
+/**
+ * @brief Keeps the transversals of a set of squares that are also transversals of a new square.
+ *
+ * Every transversal common to the set is one of the transversals of its first square, so a
+ * mate is only enumerated once and each further square filters the list.
+ *
+ * @param parent The transversals common to the set.
+ * @param square The new square.
+ * @param t Receives the transversals common to the set and the square; release them with
+ *          freeTransversals().
+ */
+static void filterTransversals(const TRANSVERSALS *parent, const uint16_t *square, TRANSVERSALS *t)
+{
+    int size = parent->size;
+    t->size = size;
+    t->count = 0;
+    t->capacity = parent->count;
+    t->columns = (uint8_t *)allocOrExit(((size_t)parent->count + 1) * size);
+    for (int k = 0; k < parent->count; k++)
+    {
+        const uint8_t *columns = parent->columns + (size_t)k * size;
+        uint64_t seen[MAX_WORDS] = {0};
+        int i = 0;
+        while (i < size && !hasValue(seen, square[i * size + columns[i]]))
+        {
+            addValue(seen, square[i * size + columns[i]]);
+            i++;
+        }
+        if (i == size)
+        {
+            memcpy(t->columns + (size_t)t->count++ * size, columns, size);
+        }
+    }
+    indexTransversals(t);
+}
+
+/**
+ * @brief Releases the transversals of a set of squares.
+ *
+ * @param t The transversals.
+ */
+static void freeTransversals(TRANSVERSALS *t)
+{
+    free(t->columns);
+    free(t->through);
+    t->columns = NULL;
+    t->through = NULL;
+}
+
+/**
+ * @brief Allocates an exact cover whose live transversals at depth 0 are all of them.
+ *
+ * @param cover The cover to initialize.
+ * @param search The search it belongs to.
+ * @param key The key of its branch.
+ * @param squares The set so far.
+ * @param filled Squares of the set so far.
+ * @param t The transversals common to the set.
+ */
+static void initCover(COVER *cover, SEARCH *search, int key, uint16_t *squares, int filled, const TRANSVERSALS *t)
+{
+    int size = t->size;
+    size_t cells = (size_t)size * size;
+    cover->search = search;
+    cover->key = key;
+    cover->squares = squares;
+    cover->filled = filled;
+    cover->t = t;
+    cover->live = (uint64_t *)allocOrExit((size_t)(size + 1) * t->words * sizeof(uint64_t));
+    cover->covered = (bool *)allocOrExit(cells * sizeof(bool));
+    cover->chosen = (int *)allocOrExit((size_t)size * sizeof(int));
+    cover->nodes = 0;
+    memset(cover->live, 0, (size_t)t->words * sizeof(uint64_t));
+    fillValues(cover->live, t->count);
+    memset(cover->covered, 0, cells * sizeof(bool));
+}
+
+/**
+ * @brief Releases an exact cover.
+ *
+ * @param cover The cover.
+ */
+static void freeCover(COVER *cover)
+{
+    free(cover->live);
+    free(cover->covered);
+    free(cover->chosen);
+}
+
+/**
+ * @brief Chooses the uncovered cell with the fewest live transversals through it.
+ *
+ * @param cover The cover.
+ * @param depth The number of transversals chosen.
+ * @param count Receives the number of live transversals through the cell.
+ * @return The cell, as i * size + j.
+ */
+static int chooseCell(const COVER *cover, int depth, int *count)
+{
+    const TRANSVERSALS *t = cover->t;
+    const uint64_t *live = cover->live + (size_t)depth * t->words;
+    int cells = t->size * t->size;
+    int best = -1;
+    *count = INT_MAX;
+    for (int cell = 0; cell < cells && *count > 0; cell++)
+    {
+        if (cover->covered[cell])
+        {
+            continue;
+        }
+        const uint64_t *through = t->through + (size_t)cell * t->words;
+        int found = 0;
+        for (int w = 0; w < t->words; w++)
+        {
+            found += __builtin_popcountll(live[w] & through[w]);
+        }
+        if (found < *count)
+        {
+            best = cell;
+            *count = found;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Chooses a transversal: its cells are covered and the transversals meeting it die.
+ *
+ * @param cover The cover.
+ * @param depth The number of transversals chosen before it.
+ * @param k The transversal.
+ */
+static void chooseTransversal(COVER *cover, int depth, int k)
+{
+    const TRANSVERSALS *t = cover->t;
+    int size = t->size;
+    const uint64_t *live = cover->live + (size_t)depth * t->words;
+    uint64_t *next = cover->live + (size_t)(depth + 1) * t->words;
+    memcpy(next, live, t->words * sizeof(uint64_t));
+    const uint8_t *columns = t->columns + (size_t)k * size;
+    for (int i = 0; i < size; i++)
+    {
+        int cell = i * size + columns[i];
+        const uint64_t *through = t->through + (size_t)cell * t->words;
+        for (int w = 0; w < t->words; w++)
+        {
+            next[w] &= ~through[w];
+        }
+        cover->covered[cell] = true;
+    }
+    cover->chosen[depth] = k;
+}
+
+/**
+ * @brief Takes back a transversal chosen by chooseTransversal().
+ *
+ * @param cover The cover.
+ * @param k The transversal.
+ */
+static void dropTransversal(COVER *cover, int k)
+{
+    int size = cover->t->size;
+    const uint8_t *columns = cover->t->columns + (size_t)k * size;
+    for (int i = 0; i < size; i++)
+    {
+        cover->covered[i * size + columns[i]] = false;
+    }
+}
+
+/**
+ * @brief Tells whether a branch can stop because a branch before it completed the set.
+ *
+ * @param search The search.
+ * @param key The key of the branch.
+ * @return true if the branch should stop.
+ */
+static bool stopBranch(SEARCH *search, int key)
+{
+    return __atomic_load_n(&search->bestKey, __ATOMIC_RELAXED) < key;
+}
+
+/**
+ * @brief Records the set held by a branch if it is the best so far.
+ *
+ * @param search The search.
+ * @param key The key of the branch.
+ * @param squares The set, the given square first.
+ */
+static void recordSet(SEARCH *search, int key, const uint16_t *squares)
+{
+    size_t cells = (size_t)search->size * search->size;
+    pthread_mutex_lock(&search->lock);
+    if (key < search->bestKey)
+    {
+        memcpy(search->mates, squares + cells, (search->count - 1) * cells * sizeof(uint16_t));
+        __atomic_store_n(&search->bestKey, key, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&search->lock);
+}
+
+/**
+ * @brief Builds the mate of a complete cover and grows the set with it.
+ *
+ * @param cover The cover, with size transversals chosen.
+ * @return true if the set was completed, false otherwise.
+ */
+static bool acceptMate(COVER *cover)
+{
+    const TRANSVERSALS *t = cover->t;
+    int size = t->size;
+    uint16_t *mate = cover->squares + (size_t)cover->filled * size * size;
+    for (int depth = 0; depth < size; depth++)
+    {
+        const uint8_t *columns = t->columns + (size_t)cover->chosen[depth] * size;
+        for (int i = 0; i < size; i++)
+        {
+            mate[i * size + columns[i]] = (uint16_t)(columns[0] + 1);
+        }
+    }
+    if (cover->filled + 1 == cover->search->count)
+    {
+        recordSet(cover->search, cover->key, cover->squares);
+        return true;
+    }
+    return searchMates(cover->search, cover->key, cover->squares, cover->filled + 1, t);
+}
+
+/**
+ * @brief Covers the remaining cells, branching on the cell with the fewest live transversals.
+ *
+ * @param cover The cover.
+ * @param depth The number of transversals chosen.
+ * @return true if the set was completed, false otherwise.
+ */
+static bool coverCells(COVER *cover, int depth)
+{
+    const TRANSVERSALS *t = cover->t;
+    if (depth == t->size)
+    {
+        return acceptMate(cover);
+    }
+    cover->nodes++;
+    if (stopBranch(cover->search, cover->key))
+    {
+        return false;
+    }
+
+    int count;
+    int cell = chooseCell(cover, depth, &count);
+    const uint64_t *live = cover->live + (size_t)depth * t->words;
+    const uint64_t *through = t->through + (size_t)cell * t->words;
+    for (int w = 0; w < t->words && count > 0; w++)
+    {
+        uint64_t bits = live[w] & through[w];
+        while (bits != 0)
+        {
+            int k = w * WORD_BITS + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            chooseTransversal(cover, depth, k);
+            bool found = coverCells(cover, depth + 1);
+            dropTransversal(cover, k);
+            if (found)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Searches for the next mate of a set, and for the rest of the set after it.
+ *
+ * @param search The search.
+ * @param key The key of the branch.
+ * @param squares The set so far, with room for every square of the set.
+ * @param filled Squares of the set so far.
+ * @param parent The transversals common to the squares before the last one.
+ * @return true if the set was completed, false otherwise.
+ */
+static bool searchMates(SEARCH *search, int key, uint16_t *squares, int filled, const TRANSVERSALS *parent)
+{
+    TRANSVERSALS t;
+    filterTransversals(parent, squares + (size_t)(filled - 1) * search->size * search->size, &t);
+    COVER cover;
+    initCover(&cover, search, key, squares, filled, &t);
+    bool found = coverCells(&cover, 0);
+    __atomic_add_fetch(&search->nodes, cover.nodes, __ATOMIC_RELAXED);
+    freeCover(&cover);
+    freeTransversals(&t);
+    return found;
+}
+
+/**
+ * @brief Searches the branch of one transversal through the first cell of the given square.
+ *
+ * @param search The search.
+ * @param key The key of the branch.
+ * @param first The transversal.
+ */
+static void searchBranch(SEARCH *search, int key, int first)
+{
+    if (stopBranch(search, key))
+    {
+        return;
+    }
+    size_t cells = (size_t)search->size * search->size;
+    uint16_t *squares = (uint16_t *)allocOrExit(search->count * cells * sizeof(uint16_t));
+    memcpy(squares, search->square, cells * sizeof(uint16_t));
+
+    COVER cover;
+    initCover(&cover, search, key, squares, 1, search->first);
+    cover.nodes++;
+    chooseTransversal(&cover, 0, first);
+    coverCells(&cover, 1);
+    __atomic_add_fetch(&search->nodes, cover.nodes, __ATOMIC_RELAXED);
+    freeCover(&cover);
+    free(squares);
+}
+
+/**
+ * @brief Task function of the thread pool: searches one branch of the first cell.
+ *
+ * @param pool The pool running the job.
+ * @param worker The worker running the job.
+ * @param arg The JOB to run. It is released here.
+ */
+static void runJob(POOL *pool, int worker, void *arg)
+{
+    (void)pool;
+    (void)worker;
+    JOB *job = (JOB *)arg;
+    searchBranch(job->search, job->key, job->first);
+    free(job);
+}
+
+MOLS_STATUS searchMols(const uint16_t *square, int size, int count, int threads, uint16_t *mates,
+                       MOLS_STATS *stats)
+{
+    stats->transversals = 0;
+    stats->nodes = 0;
+    TRANSVERSALS first;
+    if (!findTransversals(square, size, &first))
+    {
+        stats->transversals = first.count;
+        freeTransversals(&first);
+        return MOLS_TOO_MANY;
+    }
+    stats->transversals = first.count;
+
+    SEARCH search;
+    search.size = size;
+    search.count = count;
+    search.square = square;
+    search.first = &first;
+    search.bestKey = NO_KEY;
+    search.mates = mates;
+    search.nodes = 0;
+    pthread_mutex_init(&search.lock, NULL);
+
+    // Every mate has a transversal through the cell with the fewest of them: one branch each
+    COVER root;
+    initCover(&root, &search, 0, NULL, 1, &first);
+    int branches;
+    int cell = chooseCell(&root, 0, &branches);
+    int *firsts = (int *)allocOrExit(((size_t)branches + 1) * sizeof(int));
+    const uint64_t *through = first.through + (size_t)cell * first.words;
+    for (int k = 0, key = 0; k < first.count && key < branches; k++)
+    {
+        if (hasValue(through, k + 1))
+        {
+            firsts[key++] = k;
+        }
+    }
+    freeCover(&root);
+
+    if (threads == 1)
+    {
+        for (int key = 0; key < branches && search.bestKey == NO_KEY; key++)
+        {
+            searchBranch(&search, key, firsts[key]);
+        }
+    }
+    else
+    {
+        // Pushed in decreasing key order, so every worker pops its smallest key first
+        POOL *pool = createPool(threads);
+        for (int key = branches - 1; key >= 0; key--)
+        {
+            JOB *job = (JOB *)allocOrExit(sizeof(JOB));
+            job->search = &search;
+            job->key = key;
+            job->first = firsts[key];
+            submitTask(pool, -1, runJob, job);
+        }
+        waitPool(pool);
+        freePool(pool);
+    }
+
+    stats->nodes = search.nodes;
+    free(firsts);
+    freeTransversals(&first);
+    pthread_mutex_destroy(&search.lock);
+    return search.bestKey != NO_KEY ? MOLS_FOUND : MOLS_NOT_FOUND;
+}
+
+const char *molsStatusName(MOLS_STATUS status)
+{
+    switch (status)
+    {
+    case MOLS_FOUND:
+        return "found";
+    case MOLS_NOT_FOUND:
+        return "not-found";
+    case MOLS_TOO_MANY:
+        return "too-many-transversals";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Builds the addition table of a product of elementary abelian groups of a given order.
+ *
+ * The order n = p1 * p2 * ... (primes with repetition) is the product of the groups Z_p: a value
+ * is written with one digit per prime factor, and two values add digit by digit modulo the
+ * primes. For a prime order this is the cyclic square. Unlike the cyclic square of an even order,
+ * the table has orthogonal mates whenever n is not 2 modulo 4 (Hall and Paige), and it belongs
+ * to a set of at least q - 1 MOLS, q the smallest prime power dividing n (MacNeish).
+ *
+ * @param size The order of the square.
+ * @param values Receives the size * size values, row by row.
+ */
+static void groupSquare(int size, uint16_t *values)
+{
+    int primes[32]; // At most log2(MAX_SIZE) prime factors
+    int factors = 0;
+    for (int rest = size, p = 2; rest > 1; p++)
+    {
+        while (rest % p == 0)
+        {
+            primes[factors++] = p;
+            rest /= p;
+        }
+    }
+    for (int a = 0; a < size; a++)
+    {
+        for (int b = 0; b < size; b++)
+        {
+            int sum = 0;
+            for (int f = factors - 1, x = a, y = b, weight = 1; f >= 0; f--)
+            {
+                int p = primes[f];
+                sum += (x % p + y % p) % p * weight;
+                weight *= p;
+                x /= p;
+                y /= p;
+            }
+            values[a * size + b] = (uint16_t)(sum + 1);
+        }
+    }
+}
+
+/**
+ * @brief Reads the square a search starts from.
+ *
+ * @param source A game file holding a completed square, or an order for the square of groupSquare().
+ * @param values Receives the values, room for MAX_SIZE * MAX_SIZE of them.
+ * @param size Receives the order of the square.
+ * @return true on success, false (with a message printed) otherwise.
+ */
+static bool readSquare(const char *source, uint16_t *values, int *size)
+{
+    const char *p = source;
+    while (isdigit((unsigned char)*p))
+    {
+        p++;
+    }
+    if (p != source && *p == '\0')
+    {
+        *size = atoi(source);
+        if (*size < 1 || *size > MAX_SIZE)
+        {
+            printf("Invalid order. Max allowed order is %d\n", MAX_SIZE);
+            return false;
+        }
+        if (*size % 4 == 2)
+        {
+            // No group table of such an order has a transversal; orders 2 and 6 have no MOLS at all
+            printf(*size <= 6 ? "No pair of orthogonal Latin squares of order %d exists\n"
+                              : "No group square of order %d has a mate, give a game file instead\n",
+                   *size);
+            return false;
+        }
+        groupSquare(*size, values);
+        return true;
+    }
+
+    GAME game;
+    readLatinSquare(&game, source);
+    bool complete = isComplete(&game);
+    if (complete)
+    {
+        *size = game.size;
+        for (int i = 0; i < game.size; i++)
+        {
+            for (int j = 0; j < game.size; j++)
+            {
+                values[i * game.size + j] = (uint16_t)abs(getCell(&game, i, j));
+            }
+        }
+    }
+    else
+    {
+        printf("%s: the Latin square is not complete!\n", source);
+    }
+    freeGame(&game);
+    return complete;
+}
+
+int runMols(const char *source, int count, int threads)
+{
+    uint16_t *square = (uint16_t *)allocOrExit((size_t)MAX_SIZE * MAX_SIZE * sizeof(uint16_t));
+    int size;
+    if (!readSquare(source, square, &size))
+    {
+        free(square);
+        return 1;
+    }
+
+    size_t cells = (size_t)size * size;
+    uint16_t *mates = (uint16_t *)allocOrExit((size_t)(count - 1) * cells * sizeof(uint16_t));
+    MOLS_STATS stats;
+    double start = now();
+    MOLS_STATUS status = searchMols(square, size, count, threads, mates, &stats);
+    double seconds = now() - start;
+
+    if (status == MOLS_FOUND)
+    {
+        for (int m = 0; m < count - 1; m++)
+        {
+            printf(m == 0 ? "%d\n" : "\n%d\n", size);
+            for (int i = 0; i < size; i++)
+            {
+                for (int j = 0; j < size; j++)
+                {
+                    printf("%d ", mates[m * cells + i * size + j]);
+                }
+                printf("\n");
+            }
+        }
+    }
+    fprintf(stderr, "%s: %d MOLS %s, %d transversals, %llu nodes, %.3f s\n", source, count,
+            molsStatusName(status), stats.transversals, stats.nodes, seconds);
+
+    free(mates);
+    free(square);
+    return status == MOLS_FOUND ? 0 : 1;
+}
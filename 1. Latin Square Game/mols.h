@@ -0,0 +1,83 @@
+/**
+ * @file mols.h
+ * @brief Declarations of the search for mutually orthogonal Latin squares (MOLS).
+ *
+ * Two Latin squares of the same order are orthogonal when no two cells hold the same pair of
+ * values. A square has an orthogonal mate exactly when its cells split into size disjoint
+ * transversals (size cells, one per row, column and value): the mate gives one value to each
+ * transversal. The transversals are enumerated row by row with bitsets of the free columns and
+ * of the values used, then the cells are covered exactly by them: every cell has a bitset of
+ * the transversals through it, the transversals still disjoint from the chosen ones form a live
+ * bitset, and the search branches on the uncovered cell with the fewest live transversals.
+ * A set of k MOLS is grown one mate at a time, the next mate being built from the transversals
+ * common to every square of the set. The branches of the first cell are searched in parallel.
+ */
+
+#ifndef MOLS_H
+#define MOLS_H
+
+#include "latinsquare.h"
+
+#define MAX_TRANSVERSALS (1 << 20) // Squares with more transversals are not searched
+
+/**
+ * @brief Outcome of a search for mutually orthogonal Latin squares.
+ */
+typedef enum
+{
+    MOLS_FOUND,     /**< The set was completed */
+    MOLS_NOT_FOUND, /**< The search is exhausted: no such set contains the square */
+    MOLS_TOO_MANY   /**< The square has more than MAX_TRANSVERSALS transversals: nothing was searched */
+} MOLS_STATUS;
+
+/**
+ * @brief Represents the work done by a search.
+ */
+typedef struct molsstats
+{
+    int transversals;         /**< Transversals of the given square */
+    unsigned long long nodes; /**< Nodes of the exact covers, every mate included */
+} MOLS_STATS;
+
+/**
+ * @brief Searches for squares that form a set of mutually orthogonal Latin squares with a square.
+ *
+ * The result is the set the sequential search finds first, whatever the number of threads. The
+ * mates are normalized: the transversal through cell (0, j) gets value j + 1, so the first row of
+ * every mate is 1..size.
+ *
+ * @param square The size * size values of a Latin square, row by row.
+ * @param size The order of the square.
+ * @param count The number of squares of the set, the given one included, at least 2.
+ * @param threads Number of worker threads; 1 searches on the calling thread, below 1 uses all processors.
+ * @param mates Receives the count - 1 mates, one after the other, when the set is found.
+ * @param stats Receives the work done.
+ * @return MOLS_FOUND, MOLS_NOT_FOUND or MOLS_TOO_MANY.
+ */
+MOLS_STATUS searchMols(const uint16_t *square, int size, int count, int threads, uint16_t *mates,
+                       MOLS_STATS *stats);
+
+/**
+ * @brief Returns a short name for the outcome of a search.
+ *
+ * @param status The outcome returned by searchMols().
+ * @return A lowercase name without spaces, e.g. "not-found".
+ */
+const char *molsStatusName(MOLS_STATUS status);
+
+/**
+ * @brief Searches for a set of MOLS containing the square of a game file and prints it.
+ *
+ * The mates are printed on the standard output in the format of a game file, separated by an
+ * empty line, and a summary on the standard error.
+ *
+ * @param source A game file holding a completed square, or an order standing for the addition
+ *               table of a product of elementary abelian groups of that order, the cyclic square
+ *               for a prime order. Orders 2 modulo 4, where no such table has a mate, are refused.
+ * @param count The number of squares of the set, the given one included, at least 2.
+ * @param threads Number of worker threads, below 1 for one per processor.
+ * @return 0 if the set was found, 1 otherwise.
+ */
+int runMols(const char *source, int count, int threads);
+
+#endif // MOLS_H
@@ -0,0 +1,84 @@
+/**
+ * @file random.h
+ * @brief A small seeded pseudo-random generator (SplitMix64) with independent streams.
+ *
+ * The C library rand() is neither thread safe nor reproducible across platforms, so every
+ * thread that needs random numbers keeps its own 64-bit state, derived from the user seed and
+ * a stream number with streamSeed().
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+#define GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL // Increment of the SplitMix64 state
+
+/**
+ * @brief Scrambles a 64-bit value (the SplitMix64 output function).
+ *
+ * @param z The value.
+ * @return The scrambled value.
+ */
+static inline uint64_t mixRandom(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns the initial state of a random stream.
+ *
+ * @param seed The user seed.
+ * @param stream The stream number, e.g. the index of the item generated.
+ * @return The state.
+ */
+static inline uint64_t streamSeed(uint64_t seed, uint64_t stream)
+{
+    return mixRandom(seed ^ mixRandom(stream + GOLDEN_GAMMA));
+}
+
+/**
+ * @brief Advances a random state and returns the next 64-bit number.
+ *
+ * @param state The state of the stream.
+ * @return The random number.
+ */
+static inline uint64_t nextRandom(uint64_t *state)
+{
+    *state += GOLDEN_GAMMA;
+    return mixRandom(*state);
+}
+
+/**
+ * @brief Returns a random number in [0..bound).
+ *
+ * @param state The state of the stream.
+ * @param bound The exclusive upper bound, at least 1.
+ * @return The random number.
+ */
+static inline int randomBelow(uint64_t *state, int bound)
+{
+    return (int)(nextRandom(state) % (uint64_t)bound); // The modulo bias is negligible for small bounds
+}
+
+/**
+ * @brief Shuffles an array of integers uniformly (Fisher-Yates).
+ *
+ * @param items The array.
+ * @param count The number of items.
+ * @param state The state of the stream.
+ */
+static inline void shuffleInts(int *items, int count, uint64_t *state)
+{
+    for (int k = count - 1; k > 0; k--)
+    {
+        int other = randomBelow(state, k + 1);
+        int item = items[k];
+        items[k] = items[other];
+        items[other] = item;
+    }
+}
+
+#endif // RANDOM_H
@@ -0,0 +1,351 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime and mkdir
+
+#include "sampler.h"
+#include "console.h"
+#include "corpus.h"
+#include "random.h"
+#include "threadpool.h"
+#include "timing.h"
+#include <errno.h>
+#include <sys/stat.h>
+
+#define RANDOM_PART_BITS 21     // Bits of a random number drawn for a row, a column or a symbol
+#define SAMPLER_WARN_MOVES 1e9L // Moves of a run beyond which a warning is printed, about a minute
+
+/**
+ * @brief Represents a proper or improper incidence cube by the 1s of its lines.
+ *
+ * Every table has two slots per line, the second one -1 unless the line holds two 1s.
+ */
+typedef struct cube
+{
+    int size;       /**< The order of the square */
+    short *symbols; /**< The symbols of cell (r, c), at 2 * (r * size + c) */
+    short *columns; /**< The columns of symbol s in row r, at 2 * (r * size + s) */
+    short *rows;    /**< The rows of symbol s in column c, at 2 * (c * size + s) */
+    bool proper;    /**< Whether the cube has no -1 entry, i.e. is a Latin square */
+    int minusRow;   /**< The row of the -1 entry of an improper cube */
+    int minusCol;   /**< Its column */
+    int minusSym;   /**< Its symbol */
+} CUBE;
+
+/**
+ * @brief Represents the state of a sampler run shared by the workers.
+ */
+typedef struct sampler
+{
+    int size;              /**< The order of the squares */
+    long long count;       /**< The number of squares */
+    long long steps;       /**< The proper states between two squares of a chain */
+    uint64_t seed;         /**< The seed of the random streams */
+    const char *directory; /**< The directory receiving the game files, NULL for a corpus */
+    CORPUS_WRITER writer;  /**< The corpus receiving the squares */
+    long long written;     /**< Squares written */
+    long long failures;    /**< Squares that could not be written */
+    pthread_mutex_t lock;  /**< Protects the counters and the corpus */
+} SAMPLER;
+
+/**
+ * @brief Represents one chain handed to the pool.
+ */
+typedef struct chain
+{
+    SAMPLER *sampler; /**< The sampler run */
+    long long index;  /**< The index of the chain, which selects its random stream and its squares */
+} CHAIN;
+
+/**
+ * @brief Adds a value to the two slots of a line.
+ *
+ * @param slots The slots, with at most one value.
+ * @param value The value.
+ */
+static inline void addSlot(short *slots, int value)
+{
+    slots[slots[0] < 0 ? 0 : 1] = (short)value;
+}
+
+/**
+ * @brief Removes a value from the two slots of a line, keeping the other one first.
+ *
+ * @param slots The slots, holding the value.
+ * @param value The value.
+ */
+static inline void removeSlot(short *slots, int value)
+{
+    if (slots[0] == value)
+    {
+        slots[0] = slots[1];
+    }
+    slots[1] = -1;
+}
+
+/**
+ * @brief Adds 1 or -1 to an entry of a cube whose value stays in {-1, 0, 1}.
+ *
+ * @param cube The cube.
+ * @param r The row of the entry.
+ * @param c The column of the entry.
+ * @param s The symbol of the entry.
+ * @param delta 1 or -1.
+ */
+static void changeEntry(CUBE *cube, int r, int c, int s, int delta)
+{
+    int n = cube->size;
+    short *symbols = cube->symbols + 2 * (r * n + c);
+    short *columns = cube->columns + 2 * (r * n + s);
+    short *rows = cube->rows + 2 * (c * n + s);
+    if (delta > 0)
+    {
+        if (!cube->proper && r == cube->minusRow && c == cube->minusCol && s == cube->minusSym)
+        {
+            cube->proper = true; // -1 to 0
+            return;
+        }
+        addSlot(symbols, s);
+        addSlot(columns, c);
+        addSlot(rows, r);
+    }
+    else if (symbols[0] == s || symbols[1] == s)
+    {
+        removeSlot(symbols, s);
+        removeSlot(columns, c);
+        removeSlot(rows, r);
+    }
+    else
+    {
+        cube->proper = false; // 0 to -1
+        cube->minusRow = r;
+        cube->minusCol = c;
+        cube->minusSym = s;
+    }
+}
+
+/**
+ * @brief Maps bits of a random number to [0..bound), with the multiply-shift method.
+ *
+ * @param bits The random number; its RANDOM_PART_BITS lowest bits are used.
+ * @param bound The exclusive upper bound, at most MAX_SIZE.
+ * @return The random number in [0..bound).
+ */
+static inline int randomPart(uint64_t bits, int bound)
+{
+    return (int)(((bits & ((1u << RANDOM_PART_BITS) - 1)) * (uint64_t)bound) >> RANDOM_PART_BITS);
+}
+
+/**
+ * @brief Makes one move of the Jacobson-Matthews chain.
+ *
+ * @param cube The cube.
+ * @param state The random stream.
+ */
+static void moveCube(CUBE *cube, uint64_t *state)
+{
+    int n = cube->size;
+    int r, c, s, r1, c1, s1;
+    if (cube->proper)
+    {
+        // A random 0 entry, and the 1s of its lines
+        do
+        {
+            uint64_t bits = nextRandom(state);
+            r = randomPart(bits, n);
+            c = randomPart(bits >> RANDOM_PART_BITS, n);
+            s = randomPart(bits >> 2 * RANDOM_PART_BITS, n);
+        } while (cube->symbols[2 * (r * n + c)] == s);
+        s1 = cube->symbols[2 * (r * n + c)];
+        c1 = cube->columns[2 * (r * n + s)];
+        r1 = cube->rows[2 * (c * n + s)];
+    }
+    else
+    {
+        // The -1 entry, and one of the two 1s of each of its lines
+        r = cube->minusRow;
+        c = cube->minusCol;
+        s = cube->minusSym;
+        uint64_t bits = nextRandom(state);
+        s1 = cube->symbols[2 * (r * n + c) + (bits & 1)];
+        c1 = cube->columns[2 * (r * n + s) + (bits >> 1 & 1)];
+        r1 = cube->rows[2 * (c * n + s) + (bits >> 2 & 1)];
+    }
+
+    // The additions first, so no line holds more than two 1s; the last entry may become -1
+    changeEntry(cube, r, c, s, 1);
+    changeEntry(cube, r, c1, s1, 1);
+    changeEntry(cube, r1, c, s1, 1);
+    changeEntry(cube, r1, c1, s, 1);
+    changeEntry(cube, r, c, s1, -1);
+    changeEntry(cube, r, c1, s, -1);
+    changeEntry(cube, r1, c, s, -1);
+    changeEntry(cube, r1, c1, s1, -1);
+}
+
+/**
+ * @brief Initializes a cube with the cyclic square, (r + c) mod size.
+ *
+ * @param cube The cube to initialize.
+ * @param size The order of the square.
+ */
+static void initCube(CUBE *cube, int size)
+{
+    size_t slots = 2 * (size_t)size * size;
+    cube->size = size;
+    cube->symbols = (short *)allocOrExit(3 * slots * sizeof(short));
+    cube->columns = cube->symbols + slots;
+    cube->rows = cube->columns + slots;
+    for (size_t k = 0; k < 3 * slots; k++)
+    {
+        cube->symbols[k] = -1;
+    }
+    cube->proper = true;
+    for (int r = 0; r < size; r++)
+    {
+        for (int c = 0; c < size; c++)
+        {
+            changeEntry(cube, r, c, (r + c) % size, 1);
+        }
+    }
+}
+
+/**
+ * @brief Writes a square drawn by a chain.
+ *
+ * @param sampler The sampler run.
+ * @param game The square.
+ * @param index The index of the square, which names its game file.
+ */
+static void writeSquare(SAMPLER *sampler, GAME *game, long long index)
+{
+    bool saved;
+    char outputFile[MAX_PATH];
+    if (sampler->directory != NULL)
+    {
+        int digits = snprintf(NULL, 0, "%lld", sampler->count);
+        snprintf(outputFile, sizeof(outputFile), "%s/square-%0*lld.txt", sampler->directory, digits, index + 1);
+        saved = saveLatinSquare(game, outputFile);
+        pthread_mutex_lock(&sampler->lock);
+    }
+    else
+    {
+        pthread_mutex_lock(&sampler->lock);
+        saved = appendCorpus(&sampler->writer, game, NULL);
+        snprintf(outputFile, sizeof(outputFile), "Error writing the corpus");
+    }
+    if (saved)
+    {
+        sampler->written++;
+    }
+    else
+    {
+        perror(outputFile);
+        sampler->failures++;
+    }
+    pthread_mutex_unlock(&sampler->lock);
+}
+
+/**
+ * @brief Task function of the pool: runs one chain and writes its squares.
+ *
+ * @param pool The pool running the task.
+ * @param worker The worker running the task.
+ * @param arg The CHAIN to run. It is released here.
+ */
+static void runChain(POOL *pool, int worker, void *arg)
+{
+    CHAIN *chain = (CHAIN *)arg;
+    SAMPLER *sampler = chain->sampler;
+    int size = sampler->size;
+    uint64_t state = streamSeed(sampler->seed, (uint64_t)chain->index);
+    (void)pool;
+    (void)worker;
+
+    CUBE cube;
+    GAME game;
+    initCube(&cube, size);
+    initGameOrExit(&game, size);
+    long long first = chain->index * SAMPLER_CHAIN_SQUARES;
+    long long last = first + SAMPLER_CHAIN_SQUARES < sampler->count ? first + SAMPLER_CHAIN_SQUARES : sampler->count;
+    for (long long index = first; index < last; index++)
+    {
+        // Only the proper states are counted: the first proper state after a number of moves
+        // would favour the squares that end long improper runs
+        for (long long visited = 0; visited < sampler->steps && size > 1;) // Order 1 has a single square
+        {
+            moveCube(&cube, &state);
+            if (cube.proper)
+            {
+                visited++;
+            }
+        }
+        clearGame(&game);
+        for (int r = 0; r < size; r++)
+        {
+            for (int c = 0; c < size; c++)
+            {
+                placeValue(&game, r, c, cube.symbols[2 * (r * size + c)] + 1);
+            }
+        }
+        writeSquare(sampler, &game, index);
+    }
+    freeGame(&game);
+    free(cube.symbols);
+
+    free(chain);
+}
+
+long long runSampler(int size, long long count, long long steps, uint64_t seed, int threads, const char *output,
+                     bool corpus)
+{
+    if (steps < 1)
+    {
+        steps = (long long)size * size;
+    }
+
+    // Every proper state follows an improper run of about size moves
+    long double moves = (long double)steps * size * count;
+    if (moves > SAMPLER_WARN_MOVES)
+    {
+        fprintf(stderr, "Warning: about %.1Le moves of the chains, this may take long (fewer --steps are faster)\n",
+                moves);
+    }
+
+    SAMPLER sampler;
+    sampler.size = size;
+    sampler.count = count;
+    sampler.steps = steps;
+    sampler.seed = seed;
+    sampler.directory = corpus ? NULL : output;
+    sampler.written = 0;
+    sampler.failures = 0;
+    if (corpus ? !createCorpus(&sampler.writer, output, size, false) : mkdir(output, 0777) != 0 && errno != EEXIST)
+    {
+        perror(output);
+        return count;
+    }
+    pthread_mutex_init(&sampler.lock, NULL);
+
+    POOL *pool = createPool(threads);
+    double start = now();
+    long long chains = (count + SAMPLER_CHAIN_SQUARES - 1) / SAMPLER_CHAIN_SQUARES;
+    for (long long k = 0; k < chains; k++)
+    {
+        CHAIN *chain = (CHAIN *)allocOrExit(sizeof(CHAIN));
+        chain->sampler = &sampler;
+        chain->index = k;
+        submitTask(pool, -1, runChain, chain);
+    }
+    waitPool(pool);
+    freePool(pool);
+    if (corpus && !finishCorpus(&sampler.writer))
+    {
+        perror(output);
+        sampler.failures = count;
+    }
+
+    double elapsed = now() - start;
+    fprintf(stderr, "%lld squares of order %d, %lld steps each, %lld failed, seed %llu, %.3f s, %.0f squares/s\n",
+            sampler.written, size, steps, sampler.failures, (unsigned long long)seed, elapsed,
+            elapsed > 0 ? sampler.written / elapsed : 0.0);
+    pthread_mutex_destroy(&sampler.lock);
+    return sampler.failures;
+}
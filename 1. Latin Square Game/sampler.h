@@ -0,0 +1,50 @@
+/**
+ * @file sampler.h
+ * @brief Declarations of the uniform sampler of Latin squares (Jacobson-Matthews Markov chain).
+ *
+ * A Latin square of order n is seen as an n x n x n cube of 0/1 entries with one 1 on every line
+ * (row, column, symbol). Jacobson and Matthews extend it to "improper" cubes, with a single -1
+ * entry whose three lines hold two 1s each. A move adds +1 and -1 around an elementary 2 x 2 x 2
+ * sub-cube: from a proper square it starts at a random 0 entry, from an improper one at the -1
+ * entry with random 1s among the two of each of its lines. The chain is symmetric and its proper
+ * states are uniformly distributed in the limit, unlike squares grown by backtracking, which
+ * favour the first completions of the search.
+ *
+ * Each line of the cube holds at most two 1s, so the cube is stored as three tables of two slots
+ * (the symbols of a cell, the columns of a symbol in a row, the rows of a symbol in a column)
+ * and a move takes constant time at every order. A proper state is reached again after an
+ * improper run of about size moves, though, so visiting S proper states takes about S * size moves.
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "latinsquare.h"
+
+#define SAMPLER_CHAIN_SQUARES 256 // Squares drawn from one chain before starting another
+
+/**
+ * @brief Draws random Latin squares and writes them as game files or to a corpus.
+ *
+ * The squares are split into chains of SAMPLER_CHAIN_SQUARES, each with its own random stream
+ * derived from the seed, run on a work-stealing pool. A chain starts from the cyclic square and
+ * moves through steps proper states before its first square and between two squares; improper
+ * states are not counted, since the proper states the chain visits are the ones uniformly
+ * distributed. A seed always gives the same squares, whatever the number of threads; in a
+ * corpus the chains come in the order they finish.
+ *
+ * @param size The order of the squares.
+ * @param count The number of squares.
+ * @param steps The proper states visited between two squares of a chain, below 1 for size^2. Each
+ *              costs about size moves, so a square costs about steps * size moves (size^3 by
+ *              default); a warning is printed when the whole run needs more than SAMPLER_WARN_MOVES.
+ * @param seed The seed of the random streams.
+ * @param threads The number of worker threads, below 1 for one per processor.
+ * @param output A directory receiving square-<k>.txt files, created if needed, or the corpus file.
+ * @param corpus true to write a corpus file, false for game files.
+ * @return The number of squares that could not be written.
+ */
+long long runSampler(int size, long long count, long long steps, uint64_t seed, int threads, const char *output,
+                     bool corpus);
+
+#endif // SAMPLER_H
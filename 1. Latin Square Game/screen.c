@@ -0,0 +1,364 @@
+#define _POSIX_C_SOURCE 200809L // For isatty, fileno and sigaction
+
+#include "screen.h"
+#include "console.h"
+#include "stats.h"
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define CELL_BYTES 32    // Bytes of a cell in a differential frame: cursor position and value
+#define LINE_BYTES 16    // Bytes of the cursor position before a line of the board
+#define FRAME_EXTRA 128  // Bytes of the sequences and the heading around a frame
+#define HEADING_BYTES 64 // Bytes of the heading of a clipped viewport
+#define RESET_SEQUENCE "\033[r\033[999;1H\n" // Whole window scrolling again, cursor on its last line
+
+static volatile sig_atomic_t boardAnchored = 0; // Whether a board holds the top of the terminal
+static struct sigaction previousInt;            // The SIGINT action before the first screen was opened
+static struct sigaction previousTerm;           // The SIGTERM action before the first screen was opened
+
+/**
+ * @brief Gives the whole window back to the scrolling output when the program ends with a board
+ *        anchored, e.g. through exit().
+ */
+static void restoreAtExit(void)
+{
+    if (boardAnchored)
+    {
+        boardAnchored = 0;
+        fputs(RESET_SEQUENCE, stdout);
+        fflush(stdout);
+    }
+}
+
+/**
+ * @brief Handler of SIGINT and SIGTERM: gives the window back, then dies of the signal as before.
+ *
+ * @param signal The signal received.
+ */
+static void restoreOnSignal(int signal)
+{
+    if (boardAnchored)
+    {
+        boardAnchored = 0;
+        ssize_t written = write(STDOUT_FILENO, RESET_SEQUENCE, sizeof(RESET_SEQUENCE) - 1);
+        (void)written; // Nothing more can be done on failure
+    }
+    sigaction(signal, signal == SIGINT ? &previousInt : &previousTerm, NULL);
+    raise(signal);
+}
+
+/**
+ * @brief Makes the terminal be restored however the program ends, once per process.
+ */
+static void installRestore(void)
+{
+    static bool installed = false;
+    if (installed)
+    {
+        return;
+    }
+    installed = true;
+    atexit(restoreAtExit);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = restoreOnSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &previousInt);
+    sigaction(SIGTERM, &action, &previousTerm);
+}
+
+/**
+ * @brief Reads the size of the terminal window.
+ *
+ * @param lines Receives the number of lines.
+ * @param columns Receives the number of columns.
+ * @return true if the size is known.
+ */
+static bool windowSize(int *lines, int *columns)
+{
+    struct winsize window;
+    if (ioctl(fileno(stdout), TIOCGWINSZ, &window) != 0 || window.ws_row == 0 || window.ws_col == 0)
+    {
+        return false;
+    }
+    *lines = window.ws_row;
+    *columns = window.ws_col;
+    return true;
+}
+
+/**
+ * @brief Writes the part of the board inside the viewport at the top of the window, each line
+ *        at its own place, under a heading naming the rows and columns shown when it is clipped.
+ *
+ * @param screen The screen, with its viewport set.
+ * @param game The game whose board is drawn.
+ * @param out Where the bytes are written.
+ * @return The position after the bytes.
+ */
+static char *renderViewport(SCREEN *screen, const GAME *game, char *out)
+{
+    int size = screen->size;
+    int digits = valueDigits(size);
+    if (screen->heading)
+    {
+        char heading[HEADING_BYTES];
+        snprintf(heading, sizeof(heading), "Rows %d-%d, columns %d-%d of %d", screen->top + 1,
+                 screen->top + screen->rows, screen->left + 1, screen->left + screen->cols, size);
+        // Cut to the window so it never wraps, erasing what is left of a longer heading
+        out += sprintf(out, "\033[1;1H%.*s\033[K", screen->columns - 1, heading);
+    }
+    for (int r = 0; r <= screen->rows; r++)
+    {
+        // Border line, then the cells of the row, as renderLatinSquare() draws them
+        out += sprintf(out, "\033[%d;1H+", screen->heading + 2 * r + 1);
+        for (int c = 0; c < screen->cols; c++)
+        {
+            memset(out, '-', digits + 4);
+            out += digits + 4;
+            *out++ = '+';
+        }
+        if (r == screen->rows)
+        {
+            break;
+        }
+        int i = screen->top + r;
+        out += sprintf(out, "\033[%d;1H", screen->heading + 2 * r + 2);
+        for (int j = screen->left; j < screen->left + screen->cols; j++)
+        {
+            int number = getCell(game, i, j);
+            out += sprintf(out, "%s%*d%s", number < 0 ? "| (" : "|  ", digits, abs(number), number < 0 ? ") " : "  ");
+        }
+        *out++ = '|';
+    }
+    for (int k = 0; k < size * size; k++)
+    {
+        screen->shown[k] = (short)getCell(game, k / size, k % size);
+    }
+    return out;
+}
+
+/**
+ * @brief Moves the viewport so it holds a cell, about in its middle, when it does not already.
+ *
+ * @param screen The screen, with its viewport set.
+ * @param i The row index (0-based) of the cell.
+ * @param j The column index (0-based) of the cell.
+ * @return true if the viewport moved.
+ */
+static bool followCell(SCREEN *screen, int i, int j)
+{
+    int top = screen->top;
+    int left = screen->left;
+    if (i < top || i >= top + screen->rows)
+    {
+        top = i - screen->rows / 2;
+    }
+    if (j < left || j >= left + screen->cols)
+    {
+        left = j - screen->cols / 2;
+    }
+    top = top < 0 ? 0 : top > screen->size - screen->rows ? screen->size - screen->rows : top;
+    left = left < 0 ? 0 : left > screen->size - screen->cols ? screen->size - screen->cols : left;
+    bool moved = top != screen->top || left != screen->left;
+    screen->top = top;
+    screen->left = left;
+    return moved;
+}
+
+/**
+ * @brief Clears the screen, draws the board at its top and makes the lines below it scroll.
+ *
+ * A board larger than the window is drawn through a viewport of the rows and columns that fit,
+ * keeping its place from the last frame as far as the new window allows.
+ *
+ * @param screen The screen.
+ * @param game The game whose board is drawn.
+ * @param lines The lines of the window.
+ * @param columns The columns of the window.
+ * @return false, with nothing drawn, if the window cannot hold even one cell of the board.
+ */
+static bool anchorBoard(SCREEN *screen, const GAME *game, int lines, int columns)
+{
+    int size = screen->size;
+    int width = valueDigits(size) + 5;
+    int rows = size;
+    int cols = size;
+    int heading = 0;
+    if (lines < 2 * size + 1 + SCREEN_MIN_LINES || columns < size * width + 1)
+    {
+        heading = 1;
+        rows = (lines - SCREEN_MIN_LINES - heading - 1) / 2;
+        cols = (columns - 1) / width;
+        rows = rows < size ? rows : size;
+        cols = cols < size ? cols : size;
+        if (rows < 1 || cols < 1)
+        {
+            return false;
+        }
+    }
+    screen->rows = rows;
+    screen->cols = cols;
+    screen->heading = heading;
+    followCell(screen, screen->top, screen->left); // Keep the viewport inside the board
+    int boardLines = heading + 2 * rows + 1;
+    screen->lines = lines;
+    screen->columns = columns;
+
+    // Reset the scrolling region, clear, draw, then scroll below the board only
+    char *out = screen->buffer;
+    out += sprintf(out, "\033[r\033[H\033[2J");
+    out = renderViewport(screen, game, out);
+    out += sprintf(out, "\033[%d;%dr\033[%d;1H", boardLines + 1, lines, boardLines + 1);
+    fwrite(screen->buffer, 1, (size_t)(out - screen->buffer), stdout);
+    fflush(stdout);
+
+    screen->anchored = true;
+    boardAnchored = 1;
+    return true;
+}
+
+/**
+ * @brief Gives the whole window back to the scrolling output and leaves the cursor on its last line.
+ *
+ * @param screen The screen, anchored.
+ */
+static void releaseBoard(SCREEN *screen)
+{
+    printf("\033[r\033[%d;1H", screen->lines);
+    fflush(stdout);
+    screen->anchored = false;
+    boardAnchored = 0;
+}
+
+/**
+ * @brief Writes the cells of the viewport that changed since the last frame over their old
+ *        values, or the whole viewport again after moving it to a changed cell outside it.
+ *
+ * @param screen The screen, anchored.
+ * @param game The game whose board is drawn.
+ */
+static void drawChanges(SCREEN *screen, const GAME *game)
+{
+    STATS_START(TIMER_RENDER);
+    int size = screen->size;
+    int digits = valueDigits(size);
+    char *out = screen->buffer;
+    out += sprintf(out, "\0337"); // Save the cursor of the scrolling region
+
+    // The viewport follows the moves: it scrolls to the last changed cell it does not show
+    int outsideRow = -1, outsideColumn = -1;
+    for (int k = 0; k < size * size; k++)
+    {
+        int i = k / size, j = k % size;
+        if (getCell(game, i, j) != screen->shown[k] &&
+            (i < screen->top || i >= screen->top + screen->rows || j < screen->left || j >= screen->left + screen->cols))
+        {
+            outsideRow = i;
+            outsideColumn = j;
+        }
+    }
+
+    char *first = out;
+    if (outsideRow >= 0 && followCell(screen, outsideRow, outsideColumn))
+    {
+        out = renderViewport(screen, game, out);
+    }
+    else
+    {
+        for (int i = screen->top; i < screen->top + screen->rows; i++)
+        {
+            for (int j = screen->left; j < screen->left + screen->cols; j++)
+            {
+                int number = getCell(game, i, j);
+                if (number == screen->shown[i * size + j])
+                {
+                    continue;
+                }
+
+                // Same text as renderLatinSquare(), after the "|" of the cell
+                out += sprintf(out, "\033[%d;%dH%s%*d%s", screen->heading + 2 * (i - screen->top) + 2,
+                               (j - screen->left) * (digits + 5) + 2, number < 0 ? " (" : "  ", digits, abs(number),
+                               number < 0 ? ") " : "  ");
+            }
+        }
+        for (int k = 0; k < size * size; k++)
+        {
+            screen->shown[k] = (short)getCell(game, k / size, k % size);
+        }
+    }
+    if (out > first)
+    {
+        out += sprintf(out, "\0338"); // Restore the cursor
+        fwrite(screen->buffer, 1, (size_t)(out - screen->buffer), stdout);
+        fflush(stdout);
+    }
+    STATS_STOP(TIMER_RENDER);
+}
+
+void openScreen(SCREEN *screen, const GAME *game)
+{
+    int size = game->size;
+    const char *term = getenv("TERM");
+    screen->size = size;
+    screen->terminal = isatty(fileno(stdout)) && term != NULL && strcmp(term, "dumb") != 0;
+    screen->anchored = false;
+    screen->lines = 0;
+    screen->columns = 0;
+    screen->top = 0;
+    screen->left = 0;
+    screen->rows = size;
+    screen->cols = size;
+    screen->heading = 0;
+    screen->shown = (short *)allocOrExit((size_t)size * size * sizeof(short));
+
+    size_t full = boardTextSize(size) + (size_t)(2 * size + 1) * LINE_BYTES;
+    size_t changes = (size_t)size * size * CELL_BYTES;
+    screen->capacity = (full > changes ? full : changes) + FRAME_EXTRA;
+    screen->buffer = (char *)allocOrExit(screen->capacity);
+
+    int lines, columns;
+    if (screen->terminal)
+    {
+        installRestore();
+    }
+    if (screen->terminal && windowSize(&lines, &columns))
+    {
+        anchorBoard(screen, game, lines, columns);
+    }
+}
+
+void drawScreen(SCREEN *screen, const GAME *game)
+{
+    int lines, columns;
+    if (screen->terminal && windowSize(&lines, &columns))
+    {
+        if (screen->anchored && lines == screen->lines && columns == screen->columns)
+        {
+            drawChanges(screen, game);
+            return;
+        }
+        if (anchorBoard(screen, game, lines, columns))
+        {
+            return;
+        }
+    }
+
+    // No terminal, or a window too small for even one cell: scroll full boards like displayLatinSquare()
+    if (screen->anchored)
+    {
+        releaseBoard(screen);
+    }
+    displayLatinSquare(game);
+}
+
+void closeScreen(SCREEN *screen)
+{
+    if (screen->anchored)
+    {
+        releaseBoard(screen);
+    }
+    free(screen->shown);
+    free(screen->buffer);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file screen.h
+ * @brief Declarations of the differential drawing of the board of an interactive game.
+ *
+ * When the standard output is a terminal taking ANSI escape sequences, the board is drawn once at
+ * the top of the screen and the lines below it are made the scrolling region of the terminal, so
+ * the menu, the commands and the messages scroll there while the board stays in place. Every
+ * following frame only moves the cursor to the cells that changed since the last one and writes
+ * them again: a few bytes per move instead of the whole board, tens of kilobytes at order 64.
+ * A board larger than the window is shown through a viewport of the rows and columns that fit,
+ * under a heading naming them, and the viewport scrolls to any changed cell it does not show.
+ * The board is drawn again when the window is resized, and the whole board is printed at every
+ * frame, like displayLatinSquare() does, when the output is not a terminal, when TERM is "dumb"
+ * or when the window cannot hold one cell, its heading and SCREEN_MIN_LINES lines below it.
+ * The whole window is given back to the scrolling output however the program ends: by
+ * closeScreen(), by exit() or by SIGINT or SIGTERM, after which the signal takes its former effect.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include "latinsquare.h"
+
+#define SCREEN_MIN_LINES 4 // Lines the scrolling region below the board needs at least
+
+/**
+ * @brief Represents the board shown on the terminal.
+ */
+typedef struct screen
+{
+    int size;        /**< The order of the square */
+    bool terminal;   /**< Whether the output takes escape sequences; false prints full boards */
+    bool anchored;   /**< Whether the board is drawn at the top with the scrolling region below */
+    int lines;       /**< Lines of the window when the board was anchored */
+    int columns;     /**< Columns of the window when the board was anchored */
+    int top;         /**< The first row (0-based) of the viewport */
+    int left;        /**< The first column (0-based) of the viewport */
+    int rows;        /**< The rows of the viewport */
+    int cols;        /**< The columns of the viewport */
+    int heading;     /**< Lines above the board: 1 for the heading of a clipped viewport, else 0 */
+    short *shown;    /**< The cells as last drawn or, outside the viewport, last seen */
+    char *buffer;    /**< The bytes of a frame, written with one call */
+    size_t capacity; /**< Bytes allocated for buffer */
+} SCREEN;
+
+/**
+ * @brief Prepares the drawing of a game and, on a terminal, draws its board at the top of the screen.
+ *
+ * @param screen The screen to initialize.
+ * @param game The game whose board is drawn.
+ */
+void openScreen(SCREEN *screen, const GAME *game);
+
+/**
+ * @brief Draws the board of a game: only its changed cells when it is anchored, in full otherwise.
+ *
+ * A change outside the viewport scrolls the viewport to it, which draws the viewport again.
+ *
+ * The cursor is left where it was, in the scrolling region, after a differential frame, and
+ * below the board after a full one.
+ *
+ * @param screen The screen opened for the game.
+ * @param game The game whose board is drawn.
+ */
+void drawScreen(SCREEN *screen, const GAME *game);
+
+/**
+ * @brief Gives the whole window back to the scrolling output and releases the screen.
+ *
+ * @param screen The screen to close.
+ */
+void closeScreen(SCREEN *screen);
+
+#endif // SCREEN_H
@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L // For getline and write
+
+#include "script.h"
+#include "command.h"
+#include "console.h"
+#include <errno.h>
+#include <unistd.h>
+
+#define OUTPUT_BUFFER_BYTES 65536 // Room for error reports besides one board
+#define MAX_REPORT_LINE 128       // Longest line of an error report or of the summary
+#define MAX_ECHO 64               // Characters of a rejected command repeated in its report
+
+/**
+ * @brief Represents the output of a script, gathered in memory between two writes.
+ */
+typedef struct output
+{
+    char *data;      /**< The buffer, allocated once */
+    size_t length;   /**< Characters waiting in the buffer */
+    size_t capacity; /**< Size of the buffer */
+    bool failed;     /**< Whether a write to the standard output failed */
+} OUTPUT;
+
+/**
+ * @brief Writes the buffered output to the standard output with as few calls as possible.
+ *
+ * @param output The output, emptied.
+ */
+static void flushOutput(OUTPUT *output)
+{
+    size_t done = 0;
+    while (done < output->length && !output->failed)
+    {
+        ssize_t written = write(STDOUT_FILENO, output->data + done, output->length - done);
+        if (written < 0 && errno != EINTR)
+        {
+            perror("Error writing output");
+            output->failed = true;
+        }
+        else if (written > 0)
+        {
+            done += (size_t)written;
+        }
+    }
+    output->length = 0;
+}
+
+/**
+ * @brief Makes room in the buffer, flushing it if needed.
+ *
+ * @param output The output.
+ * @param bytes The number of characters about to be added, at most the capacity.
+ */
+static void reserveOutput(OUTPUT *output, size_t bytes)
+{
+    if (output->length + bytes > output->capacity)
+    {
+        flushOutput(output);
+    }
+}
+
+/**
+ * @brief Adds the drawing of the board to the output.
+ *
+ * @param output The output.
+ * @param game The game holding the Latin square.
+ */
+static void renderBoard(OUTPUT *output, const GAME *game)
+{
+    reserveOutput(output, boardTextSize(game->size));
+    output->length += renderLatinSquare(game, output->data + output->length);
+}
+
+/**
+ * @brief Adds the report of a rejected command to the output.
+ *
+ * @param output The output.
+ * @param lineNumber The line of the command in the stream.
+ * @param reason Why the command was rejected.
+ * @param line The command, up to its end of line.
+ */
+static void reportError(OUTPUT *output, unsigned long lineNumber, const char *reason, const char *line)
+{
+    int echo = (int)strcspn(line, "\r\n");
+    echo = echo > MAX_ECHO ? MAX_ECHO : echo;
+
+    reserveOutput(output, MAX_REPORT_LINE);
+    output->length += snprintf(output->data + output->length, MAX_REPORT_LINE, "line %lu: %s %.*s\n",
+                               lineNumber, reason, echo, line);
+}
+
+/**
+ * @brief Answers a question about the candidates of the game, or reports it when it is rejected.
+ *
+ * @param output The output.
+ * @param lineNumber The line of the command in the stream.
+ * @param game The game holding the Latin square.
+ * @param candidates The candidate sets of the game.
+ * @param command The c, h or d command.
+ * @return true if the command was answered, false if it was rejected and reported.
+ */
+static bool reportQuery(OUTPUT *output, unsigned long lineNumber, const GAME *game, const CANDIDATES *candidates,
+                        const COMMAND *command)
+{
+    reserveOutput(output, QUERY_ANSWER_BYTES);
+    size_t length;
+    MOVE_STATUS status = answerQuery(game, candidates, command, output->data + output->length, &length);
+    if (status != MOVE_OK)
+    {
+        reportError(output, lineNumber, moveStatusName(status), command->text);
+        return false;
+    }
+    output->length += length;
+    return true;
+}
+
+int runScript(GAME *game, const char *filename, const char *commandFile, bool render, bool strict)
+{
+    bool useStdin = strcmp(commandFile, "-") == 0;
+    FILE *input = useStdin ? stdin : fopen(commandFile, "r");
+    if (input == NULL)
+    {
+        perror(commandFile);
+        return -1;
+    }
+
+    OUTPUT output;
+    output.capacity = boardTextSize(game->size) + OUTPUT_BUFFER_BYTES;
+    output.data = (char *)allocOrExit(output.capacity);
+    output.length = 0;
+    output.failed = false;
+    fflush(stdout); // Nothing printed before must come after the buffer
+
+    JOURNAL history; // Kept in memory only, for the undo and redo commands
+    initJournal(&history);
+    CANDIDATES candidates; // Kept up to date by every move, for the c, h and d commands
+    if (!attachCandidates(&candidates, game) || (strict && !attachMatchings(&candidates, game, true)))
+    {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    unsigned long lineNumber = 0;
+    unsigned long commands = 0;
+    int rejected = 0;
+    bool save = false;
+    while (!save && getline(&line, &lineCapacity, input) != -1)
+    {
+        lineNumber++;
+        COMMAND command = parseCommand(line);
+        const char *text = command.text;
+        if (command.kind == COMMAND_NONE)
+        {
+            continue; // Blank line or comment
+        }
+        commands++;
+
+        if (command.kind == COMMAND_UNDO || command.kind == COMMAND_REDO || command.kind == COMMAND_SAVE)
+        {
+            bool done = command.kind == COMMAND_UNDO   ? undoMove(&history, game)
+                        : command.kind == COMMAND_REDO ? redoMove(&history, game)
+                                                       : true;
+            if (!done)
+            {
+                reportError(&output, lineNumber, command.kind == COMMAND_UNDO ? "no-undo" : "no-redo", text);
+                rejected++;
+            }
+            else if (render && command.kind != COMMAND_SAVE)
+            {
+                renderBoard(&output, game);
+                flushOutput(&output); // One write per board
+            }
+            save = isComplete(game);
+            continue;
+        }
+        if (command.kind == COMMAND_CANDIDATES || command.kind == COMMAND_HINT || command.kind == COMMAND_DEAD)
+        {
+            rejected += !reportQuery(&output, lineNumber, game, &candidates, &command);
+            continue;
+        }
+        if (command.kind == COMMAND_INVALID)
+        {
+            reportError(&output, lineNumber, "format", text);
+            rejected++;
+            continue;
+        }
+        if (command.i == 0 && command.j == 0 && command.val == 0)
+        {
+            save = true; // Save and end, as in play()
+            continue;
+        }
+
+        MOVE_STATUS status = applyMove(game, &history, &command);
+        if (status != MOVE_OK)
+        {
+            reportError(&output, lineNumber, moveStatusName(status), text);
+            rejected++;
+            continue;
+        }
+
+        if (render)
+        {
+            renderBoard(&output, game);
+            flushOutput(&output); // One write per board
+        }
+        save = isComplete(game);
+    }
+
+    bool failed = ferror(input) != 0;
+    if (failed)
+    {
+        perror(commandFile);
+    }
+    free(line);
+    detachCandidates(&candidates, game);
+    closeJournal(&history, false);
+    if (!useStdin)
+    {
+        fclose(input);
+    }
+
+    // The final state: the board, then a summary line
+    char outputFile[MAX_PATH];
+    outputFileName(filename, outputFile, sizeof(outputFile));
+    bool saved = save && saveLatinSquare(game, outputFile);
+    if (save && !saved)
+    {
+        perror(outputFile);
+        failed = true;
+    }
+
+    renderBoard(&output, game);
+    reserveOutput(&output, MAX_REPORT_LINE + MAX_PATH);
+    output.length += snprintf(output.data + output.length, MAX_REPORT_LINE + MAX_PATH,
+                              "%lu commands, %d rejected, %s, %s%s\n", commands, rejected,
+                              isComplete(game) ? "complete" : "partial", saved ? "saved to " : "not saved",
+                              saved ? outputFile : "");
+    flushOutput(&output);
+    failed = failed || output.failed;
+    free(output.data);
+
+    return failed ? -1 : rejected;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file script.h
+ * @brief Declarations of the scripted mode that replays a stream of moves without interaction.
+ */
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "latinsquare.h"
+
+/**
+ * @brief Applies a stream of commands to a game without prompting or redrawing the board.
+ *
+ * The commands are the ones of play(), one per line: "i,j=val" fills or clears a cell, "u" and
+ * "r" undo and redo a move, "s" is accepted and does nothing since no journal file is kept, and
+ * "0,0=0" saves the game and ends the script. Blank lines and lines starting with '#' are
+ * ignored. Besides the answers to the questions about candidates (see candidates.h)
+ *
+ *     c i,j   candidates <i>,<j>: <values accepted by the cell>
+ *     h       hint <i>,<j>=<val> single|row|column, hint dead <i>,<j> or hint none
+ *     d       dead <count> <i>,<j> ... (the empty cells accepting no value)
+ *
+ * only the rejected commands are reported, as
+ *
+ *     line <n>: <reason> <command>
+ *
+ * where the reason is "format", "no-undo", "no-redo" or the moveStatusName() of the move, which
+ * is "dead-end" in strict mode for a value after which the board fails Hall's condition. At the
+ * end the final board and a summary line are printed. As in play(), the game is saved like
+ * writeLatinSquare() does when it is completed or on "0,0=0", and not saved when the stream
+ * ends first.
+ *
+ * The output is gathered in one buffer allocated up front and written with a single system call
+ * per board, so replaying a long session does not depend on the speed of the terminal.
+ *
+ * @param game The game holding the Latin square.
+ * @param filename The name of the game file, used to name the saved file.
+ * @param commandFile The name of the command file, or "-" for the standard input.
+ * @param render true to also print the board after every applied command.
+ * @param strict true to reject the moves after which the board can no longer be completed.
+ * @return The number of rejected commands, or -1 if the commands or the game cannot be read or saved.
+ */
+int runScript(GAME *game, const char *filename, const char *commandFile, bool render, bool strict);
+
+#endif // SCRIPT_H
@@ -0,0 +1,643 @@
+#define _POSIX_C_SOURCE 200809L // For sigaction and the socket functions
+
+#include "server.h"
+#include "command.h"
+#include "console.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SESSIONS_PER_BLOCK 256 // Sessions allocated together
+#define LINE_BYTES 64          // Longest command line, longer ones are rejected
+#define READ_BYTES 4096        // Bytes read from a client at a time
+#define MAX_BACKLOG 65536      // Unsent answers of a session before its commands are no longer read
+#define MAX_EVENTS 256         // Events handled per call to epoll_wait
+#define MAX_ANSWER_LINE 128    // Longest answer other than those of the c, h and d commands
+
+static volatile sig_atomic_t stopRequested = 0; // Set by SIGINT and SIGTERM
+
+/**
+ * @brief Represents a client connection and the game it plays.
+ */
+typedef struct session
+{
+    int fd;                   /**< The connection */
+    uint32_t events;          /**< The events the epoll set waits for */
+    bool closing;             /**< End the session once its answers are sent */
+    bool overlong;            /**< The current line is too long and skipped up to its end */
+    void *board;              /**< Its slot for the board and bitsets, in the block of the session */
+    GAME game;                /**< Its copy of the game, stored in the slot */
+    JOURNAL *history;         /**< Moves to undo and redo, allocated on the first move */
+    CANDIDATES *candidates;   /**< Candidate sets, attached on the first c, h or d command */
+    char line[LINE_BYTES];    /**< The start of the command line not complete yet */
+    size_t lineLength;        /**< Characters in line */
+    char *backlog;            /**< Answers the client has not accepted yet, NULL when there are none */
+    size_t backlogLength;     /**< Characters in the backlog */
+    size_t backlogSent;       /**< Characters of the backlog already sent */
+    size_t backlogCapacity;   /**< Size of the backlog */
+    struct session *nextFree; /**< The next free session, for the free ones */
+} SESSION;
+
+/**
+ * @brief Represents sessions allocated together, with the boards of their games.
+ */
+typedef struct sessionblock
+{
+    SESSION sessions[SESSIONS_PER_BLOCK]; /**< The sessions */
+    void *boards;                         /**< SESSIONS_PER_BLOCK slots of gameBlockBytes() bytes */
+    struct sessionblock *next;            /**< The block allocated before */
+} SESSION_BLOCK;
+
+/**
+ * @brief Represents the state of the server.
+ */
+typedef struct server
+{
+    int listener;                /**< The listening socket */
+    int epoll;                   /**< The epoll set of the listener and the sessions */
+    GAME model;                  /**< The game every session starts from */
+    size_t boardBytes;           /**< Size of a board slot */
+    SESSION_BLOCK *blocks;       /**< Every block allocated, the newest first */
+    SESSION *freeSessions;       /**< Sessions ready for a new connection */
+    int sessions;                /**< Sessions open */
+    int maxSessions;             /**< Sessions open at most */
+    unsigned long served;        /**< Sessions opened so far */
+    unsigned long long commands; /**< Commands answered so far */
+    char *answers;               /**< Answers to the commands of the last read */
+    size_t answersLength;        /**< Characters in answers */
+    size_t answersCapacity;      /**< Size of answers */
+} SERVER;
+
+/**
+ * @brief Asks the event loop to stop.
+ *
+ * @param signal The signal received.
+ */
+static void requestStop(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
+
+/**
+ * @brief Makes room for an answer in the answers to the last read.
+ *
+ * @param server The server.
+ * @param bytes The number of characters about to be added.
+ * @return Where to write the answer.
+ */
+static char *reserveAnswer(SERVER *server, size_t bytes)
+{
+    if (server->answersLength + bytes > server->answersCapacity)
+    {
+        size_t capacity = server->answersCapacity * 2;
+        while (capacity < server->answersLength + bytes)
+        {
+            capacity *= 2;
+        }
+        char *answers = (char *)realloc(server->answers, capacity);
+        if (answers == NULL)
+        {
+            perror("Error allocating memory");
+            exit(EXIT_FAILURE);
+        }
+        server->answers = answers;
+        server->answersCapacity = capacity;
+    }
+    return server->answers + server->answersLength;
+}
+
+/**
+ * @brief Adds a one-line answer to the answers to the last read.
+ *
+ * @param server The server.
+ * @param text The answer, without its end of line.
+ * @param detail Added after a space when not NULL.
+ */
+static void addAnswer(SERVER *server, const char *text, const char *detail)
+{
+    char *out = reserveAnswer(server, MAX_ANSWER_LINE);
+    server->answersLength += snprintf(out, MAX_ANSWER_LINE, detail != NULL ? "%s %s\n" : "%s\n", text, detail);
+}
+
+/**
+ * @brief Waits for the events a session needs, given its state.
+ *
+ * A session with a full backlog, or ending, is no longer read from.
+ *
+ * @param server The server.
+ * @param session The session.
+ */
+static void updateEvents(SERVER *server, SESSION *session)
+{
+    size_t pending = session->backlogLength - session->backlogSent;
+    uint32_t events = (session->closing || pending > MAX_BACKLOG ? 0 : EPOLLIN) | (pending > 0 ? EPOLLOUT : 0);
+    if (events != session->events)
+    {
+        struct epoll_event event;
+        event.events = events;
+        event.data.ptr = session;
+        epoll_ctl(server->epoll, EPOLL_CTL_MOD, session->fd, &event);
+        session->events = events;
+    }
+}
+
+/**
+ * @brief Opens a session for a new connection, allocating a block of sessions if none is free.
+ *
+ * @param server The server.
+ * @param fd The connection, already non-blocking.
+ * @return The session, or NULL if it cannot be added to the epoll set.
+ */
+static SESSION *openSession(SERVER *server, int fd)
+{
+    if (server->freeSessions == NULL)
+    {
+        SESSION_BLOCK *block = (SESSION_BLOCK *)allocOrExit(sizeof(SESSION_BLOCK));
+        block->boards = allocOrExit(SESSIONS_PER_BLOCK * server->boardBytes);
+        block->next = server->blocks;
+        server->blocks = block;
+        for (int k = SESSIONS_PER_BLOCK - 1; k >= 0; k--)
+        {
+            block->sessions[k].fd = -1;
+            block->sessions[k].board = (char *)block->boards + k * server->boardBytes;
+            block->sessions[k].nextFree = server->freeSessions;
+            server->freeSessions = &block->sessions[k];
+        }
+    }
+
+    SESSION *session = server->freeSessions;
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = session;
+    if (epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        perror("Error adding a connection");
+        return NULL;
+    }
+    server->freeSessions = session->nextFree;
+    session->fd = fd;
+    session->events = EPOLLIN;
+    session->closing = false;
+    session->overlong = false;
+    copyGameInto(&session->game, &server->model, session->board);
+    session->history = NULL;
+    session->candidates = NULL;
+    session->lineLength = 0;
+    session->backlog = NULL;
+    session->backlogLength = 0;
+    session->backlogSent = 0;
+    session->backlogCapacity = 0;
+    server->sessions++;
+    server->served++;
+    return session;
+}
+
+/**
+ * @brief Ends a session: closes its connection and returns its memory to the server.
+ *
+ * @param server The server.
+ * @param session The session.
+ */
+static void closeSession(SERVER *server, SESSION *session)
+{
+    close(session->fd); // Also removes it from the epoll set
+    if (session->candidates != NULL)
+    {
+        detachCandidates(session->candidates, &session->game);
+        free(session->candidates);
+    }
+    if (session->history != NULL)
+    {
+        closeJournal(session->history, false);
+        free(session->history);
+    }
+    free(session->backlog);
+    session->fd = -1;
+    session->nextFree = server->freeSessions;
+    server->freeSessions = session;
+    server->sessions--;
+}
+
+/**
+ * @brief Sends as much of the backlog of a session as the connection accepts.
+ *
+ * @param session The session.
+ * @return false if the connection failed.
+ */
+static bool sendBacklog(SESSION *session)
+{
+    while (session->backlogSent < session->backlogLength)
+    {
+        ssize_t written = write(session->fd, session->backlog + session->backlogSent,
+                                session->backlogLength - session->backlogSent);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        session->backlogSent += (size_t)written;
+    }
+    free(session->backlog); // Idle sessions keep no buffer
+    session->backlog = NULL;
+    session->backlogLength = 0;
+    session->backlogSent = 0;
+    session->backlogCapacity = 0;
+    return true;
+}
+
+/**
+ * @brief Sends the answers to the last read of a session, keeping what the connection does not accept.
+ *
+ * The answers go after the backlog, so they are sent in order.
+ *
+ * @param server The server, whose answers are emptied.
+ * @param session The session.
+ * @return false if the connection failed.
+ */
+static bool sendAnswers(SERVER *server, SESSION *session)
+{
+    const char *text = server->answers;
+    size_t length = server->answersLength;
+    server->answersLength = 0;
+    while (session->backlog == NULL && length > 0)
+    {
+        ssize_t written = write(session->fd, text, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return false;
+            }
+            break;
+        }
+        text += written;
+        length -= (size_t)written;
+    }
+    if (length == 0)
+    {
+        return true;
+    }
+
+    if (session->backlogLength + length > session->backlogCapacity)
+    {
+        size_t capacity = session->backlogCapacity > 0 ? session->backlogCapacity : MAX_ANSWER_LINE;
+        while (capacity < session->backlogLength + length)
+        {
+            capacity *= 2;
+        }
+        char *backlog = (char *)realloc(session->backlog, capacity);
+        if (backlog == NULL)
+        {
+            perror("Error allocating memory");
+            exit(EXIT_FAILURE);
+        }
+        session->backlog = backlog;
+        session->backlogCapacity = capacity;
+    }
+    memcpy(session->backlog + session->backlogLength, text, length);
+    session->backlogLength += length;
+    return true;
+}
+
+/**
+ * @brief Runs one command line of a session and adds its answer to the answers of the server.
+ *
+ * @param server The server.
+ * @param session The session.
+ * @param line The command line, without its end of line.
+ */
+static void runCommand(SERVER *server, SESSION *session, const char *line)
+{
+    COMMAND command = parseCommand(line);
+    if (command.kind == COMMAND_NONE || session->closing)
+    {
+        return; // Blank line, comment, or a command after the end of the game
+    }
+    server->commands++;
+
+    GAME *game = &session->game;
+    switch (command.kind)
+    {
+    case COMMAND_UNDO:
+    case COMMAND_REDO:
+    {
+        bool undo = command.kind == COMMAND_UNDO;
+        bool done = session->history != NULL && (undo ? undoMove(session->history, game)
+                                                       : redoMove(session->history, game));
+        addAnswer(server, done ? "ok" : "error", done ? NULL : undo ? "no-undo" : "no-redo");
+        break;
+    }
+    case COMMAND_SAVE:
+        addAnswer(server, "ok", NULL);
+        break;
+    case COMMAND_CANDIDATES:
+    case COMMAND_HINT:
+    case COMMAND_DEAD:
+    {
+        if (session->candidates == NULL)
+        {
+            CANDIDATES *candidates = (CANDIDATES *)malloc(sizeof(CANDIDATES));
+            if (candidates == NULL || !attachCandidates(candidates, game))
+            {
+                free(candidates);
+                addAnswer(server, "error", "no-memory"); // The session goes on without queries
+                break;
+            }
+            session->candidates = candidates;
+        }
+        size_t length;
+        MOVE_STATUS status =
+            answerQuery(game, session->candidates, &command, reserveAnswer(server, QUERY_ANSWER_BYTES), &length);
+        if (status != MOVE_OK)
+        {
+            addAnswer(server, "error", moveStatusName(status));
+        }
+        server->answersLength += length;
+        break;
+    }
+    case COMMAND_MOVE:
+    {
+        if (command.i == 0 && command.j == 0 && command.val == 0)
+        {
+            addAnswer(server, "bye", NULL);
+            session->closing = true;
+            break;
+        }
+        if (session->history == NULL)
+        {
+            session->history = (JOURNAL *)allocOrExit(sizeof(JOURNAL));
+            initJournal(session->history);
+        }
+        MOVE_STATUS status = applyMove(game, session->history, &command);
+        if (status != MOVE_OK)
+        {
+            addAnswer(server, "error", moveStatusName(status));
+        }
+        else if (isComplete(game))
+        {
+            addAnswer(server, "complete", NULL);
+            session->closing = true;
+        }
+        else
+        {
+            addAnswer(server, "ok", NULL);
+        }
+        break;
+    }
+    default:
+        addAnswer(server, "error", "format");
+        break;
+    }
+}
+
+/**
+ * @brief Reads what a client sent once and runs the complete command lines.
+ *
+ * @param server The server.
+ * @param session The session.
+ * @return false if the session has to be closed at once.
+ */
+static bool readSession(SERVER *server, SESSION *session)
+{
+    char buffer[READ_BYTES];
+    ssize_t got = read(session->fd, buffer, sizeof(buffer));
+    if (got < 0)
+    {
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (got == 0)
+    {
+        session->closing = true; // The client sends nothing more, but still reads the answers
+        return true;
+    }
+
+    for (ssize_t k = 0; k < got; k++)
+    {
+        if (buffer[k] == '\n')
+        {
+            if (!session->overlong)
+            {
+                session->line[session->lineLength] = '\0';
+                runCommand(server, session, session->line);
+            }
+            session->lineLength = 0;
+            session->overlong = false;
+        }
+        else if (session->overlong)
+        {
+            continue;
+        }
+        else if (session->lineLength == LINE_BYTES - 1)
+        {
+            addAnswer(server, "error", "format");
+            server->commands++;
+            session->overlong = true;
+        }
+        else
+        {
+            session->line[session->lineLength++] = buffer[k];
+        }
+    }
+    return sendAnswers(server, session);
+}
+
+/**
+ * @brief Accepts the pending connections, turning away the ones beyond the maximum number of sessions.
+ *
+ * @param server The server.
+ */
+static void acceptSessions(SERVER *server)
+{
+    for (;;)
+    {
+        int fd = accept(server->listener, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                perror("Error accepting a connection");
+            }
+            return;
+        }
+        if (server->sessions >= server->maxSessions)
+        {
+            static const char busy[] = "error busy\n";
+            ssize_t ignored = write(fd, busy, sizeof(busy) - 1); // Best effort, the socket buffer is empty
+            (void)ignored;
+            close(fd);
+        }
+        else if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0 || openSession(server, fd) == NULL)
+        {
+            close(fd);
+        }
+    }
+}
+
+/**
+ * @brief Creates the listening socket of the server and its epoll set.
+ *
+ * @param server The server.
+ * @param socketPath The path of the socket.
+ * @return false if the socket cannot be set up.
+ */
+static bool listenOn(SERVER *server, const char *socketPath)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "%s: socket path too long\n", socketPath);
+        return false;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    struct stat status;
+    if (stat(socketPath, &status) == 0 && S_ISSOCK(status.st_mode))
+    {
+        unlink(socketPath); // Left by a server that did not stop cleanly
+    }
+
+    server->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listener < 0 || bind(server->listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(server->listener, SOMAXCONN) != 0 ||
+        fcntl(server->listener, F_SETFL, fcntl(server->listener, F_GETFL) | O_NONBLOCK) != 0)
+    {
+        perror(socketPath);
+        return false;
+    }
+
+    server->epoll = epoll_create1(0);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL; // The listener, the sessions have their own pointer
+    if (server->epoll < 0 || epoll_ctl(server->epoll, EPOLL_CTL_ADD, server->listener, &event) != 0)
+    {
+        perror("Error creating the epoll set");
+        return false;
+    }
+    return true;
+}
+
+int runServer(const char *socketPath, const char *filename, int maxSessions)
+{
+    SERVER server;
+    server.listener = -1;
+    server.epoll = -1;
+    readLatinSquare(&server.model, filename);
+    server.boardBytes = gameBlockBytes(server.model.size);
+    server.blocks = NULL;
+    server.freeSessions = NULL;
+    server.sessions = 0;
+    server.maxSessions = maxSessions < 1 ? DEFAULT_MAX_SESSIONS : maxSessions;
+    server.served = 0;
+    server.commands = 0;
+    server.answersCapacity = READ_BYTES * 2;
+    server.answers = (char *)allocOrExit(server.answersCapacity);
+    server.answersLength = 0;
+
+    bool listening = listenOn(&server, socketPath);
+    if (listening)
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        sigemptyset(&action.sa_mask);
+        action.sa_handler = SIG_IGN; // A client leaving early must not stop the server
+        sigaction(SIGPIPE, &action, NULL);
+        action.sa_handler = requestStop; // No SA_RESTART, so epoll_wait returns on the signal
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        fprintf(stderr, "%s: serving %s, at most %d sessions\n", socketPath, filename, server.maxSessions);
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (listening && !stopRequested)
+    {
+        int ready = epoll_wait(server.epoll, events, MAX_EVENTS, -1);
+        if (ready < 0 && errno != EINTR)
+        {
+            perror("Error waiting for events");
+            break;
+        }
+        bool accepting = false;
+        for (int k = 0; k < ready; k++)
+        {
+            SESSION *session = (SESSION *)events[k].data.ptr;
+            if (session == NULL)
+            {
+                accepting = true;
+                continue;
+            }
+            bool alive = !(events[k].events & (EPOLLERR | EPOLLHUP)); // Gone, answers could not be read
+            if (alive && (events[k].events & EPOLLOUT))
+            {
+                alive = sendBacklog(session);
+            }
+            if (alive && (events[k].events & EPOLLIN))
+            {
+                alive = readSession(&server, session);
+            }
+            if (!alive || (session->closing && session->backlog == NULL))
+            {
+                closeSession(&server, session);
+            }
+            else
+            {
+                updateEvents(&server, session);
+            }
+        }
+        if (accepting)
+        {
+            acceptSessions(&server); // After the batch, so no event left in it refers to a reused session
+        }
+    }
+
+    // Stopped: end every session and remove the socket
+    while (server.blocks != NULL)
+    {
+        SESSION_BLOCK *block = server.blocks;
+        for (int k = 0; k < SESSIONS_PER_BLOCK; k++)
+        {
+            if (block->sessions[k].fd >= 0)
+            {
+                closeSession(&server, &block->sessions[k]);
+            }
+        }
+        server.blocks = block->next;
+        free(block->boards);
+        free(block);
+    }
+    if (server.epoll >= 0)
+    {
+        close(server.epoll);
+    }
+    if (server.listener >= 0)
+    {
+        close(server.listener);
+        unlink(socketPath);
+    }
+    free(server.answers);
+    freeGame(&server.model);
+    if (listening)
+    {
+        fprintf(stderr, "%s: %lu sessions served, %llu commands\n", socketPath, server.served, server.commands);
+    }
+    return listening ? 0 : 1;
+}
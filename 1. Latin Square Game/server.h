@@ -0,0 +1,41 @@
+/**
+ * @file server.h
+ * @brief Declarations of the server mode that hosts many games behind a Unix domain socket.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "latinsquare.h"
+
+#define DEFAULT_MAX_SESSIONS 10000 // Sessions served at the same time when no limit is given
+
+/**
+ * @brief Serves games of a game file to the clients of a Unix domain socket until interrupted.
+ *
+ * Every connection is a session playing its own copy of the game. The commands are the ones of
+ * play() (see command.h), one per line, and each gets a one-line answer:
+ *
+ *     ok              the move, undo, redo or save was applied ("s" saves nothing)
+ *     complete        the move completed the square, then the session ends
+ *     bye             answer to "0,0=0", then the session ends
+ *     error <reason>  the command was rejected: "format", "no-undo", "no-redo" or the
+ *                     moveStatusName() of the move
+ *
+ * while "c i,j", "h" and "d" get the answers of the scripted mode. A connection beyond the
+ * maximum number of sessions gets "error busy" and is closed. Nothing is written to disk.
+ *
+ * A single thread serves every session from an epoll loop over non-blocking sockets. A session
+ * keeps only its board and bitsets, in a slot of a block of sessions allocated together and
+ * recycled when it ends, its undo history, a short line buffer, the answers the client has not
+ * read yet and, once it asks about them, its candidate sets. A client that stops reading its
+ * answers is not read from until it catches up.
+ *
+ * @param socketPath The path of the socket, replaced if a stale socket is there and removed at the end.
+ * @param filename The name of the game file.
+ * @param maxSessions The maximum number of sessions at the same time, below 1 for DEFAULT_MAX_SESSIONS.
+ * @return 0 after SIGINT or SIGTERM, 1 if the socket cannot be set up.
+ */
+int runServer(const char *socketPath, const char *filename, int maxSessions);
+
+#endif // SERVER_H
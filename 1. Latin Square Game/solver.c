@@ -0,0 +1,1492 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime
+
+#include "solver.h"
+#include "console.h"
+#include "kernels.h"
+#include "random.h"
+#include "stats.h"
+#include "threadpool.h"
+#include "timing.h"
+#include <limits.h>
+
+#define MAX_WORDS BITSET_WORDS(MAX_SIZE) // Words of the largest candidate bitset
+#define EVENTS_PER_CELL 9                // Queue entries per cell: 3 counters, each queued at most 3 times
+
+#define MAX_SPLIT_DEPTH 4   // Branching levels that may be split into parallel jobs
+#define TASKS_PER_THREAD 32 // Jobs to aim for per worker when splitting
+#define KEY_BITS 16         // Bits of a job key used by each split level
+#define NO_KEY (~0ULL)      // Key of the best completion before any is found
+
+#define CACHE_BYTES (64 << 20)     // Memory of the counting caches, shared by the workers
+#define CACHE_MIN_NODES 32         // Smallest subtree whose count is worth caching
+#define PROGRESS_NODES (1 << 14)   // Nodes searched between two looks at the clock
+#define PROGRESS_SECONDS 1.0       // Time between two progress reports
+
+/**
+ * @brief Represents the state shared by the jobs of a parallel search.
+ *
+ * Every job has a key that orders it like the sequential depth-first search would visit it.
+ * When a single completion is wanted, the completion with the smallest key wins and jobs with
+ * larger keys are cancelled, so the answer is the same as the one of the sequential search.
+ */
+typedef struct shared
+{
+    int size;                   /**< The order of the Latin square */
+    long long limit;            /**< Stop after this many completions */
+    long long found;            /**< Completions found by all jobs (atomic) */
+    unsigned long long bestKey; /**< Key of the job of the best completion (atomic) */
+    short *solution;            /**< The best completion, protected by lock */
+    pthread_mutex_t lock;       /**< Protects solution and bestKey updates */
+} SHARED;
+
+/**
+ * @brief Represents a branching point of the depth-first search.
+ */
+typedef struct frame
+{
+    int mark;                  /**< Trail position before the propagation of this node */
+    int branch;                /**< Trail position before the value tried at this node */
+    int cell;                  /**< The cell branched on */
+    uint64_t *cand;            /**< The candidates of the cell not tried yet */
+    int fresh;                 /**< Counting: the value standing for every unused symbol, 0 if none */
+    int freshCount;            /**< Counting: the number of unused symbols it stands for */
+    unsigned long long weight; /**< Counting: completions per completion of the value tried */
+    unsigned long long total;  /**< Counting: completions found below this node so far */
+    unsigned long long nodes;  /**< Counting: nodes searched before this node */
+} FRAME;
+
+/**
+ * @brief Represents the search state of the solver.
+ *
+ * The cells are stored flat and unsigned (the protected flag does not matter while solving).
+ * Every assignment is pushed on a trail so a branch can be undone without copying the board,
+ * and the search keeps its branching points on an explicit stack, so its depth is only bounded
+ * by the number of cells.
+ *
+ * The number of candidates of every empty cell, and the number of empty cells of every row and
+ * column where each value fits, are kept up to date by assign() and undo(), so propagation only
+ * looks at the counters that fell to one or zero. Those are queued as events: an event below
+ * size * size is a cell, the next size * size events are (row, value) pairs and the last ones
+ * (column, value) pairs, lineCount being indexed by the event minus size * size.
+ */
+typedef struct solver
+{
+    int size;                    /**< The order of the Latin square */
+    int words;                   /**< Words per bitset */
+    int cellWords;               /**< Words per bitset of cells */
+    int empty;                   /**< Number of empty cells */
+    uint64_t full[MAX_WORDS];    /**< Bitset of all values [1..size] */
+    short *cells;                /**< Current values, 0 for an empty cell */
+    uint64_t *rowMask;           /**< Values present in each row */
+    uint64_t *colMask;           /**< Values present in each column */
+    short *count;                /**< Candidates of each empty cell */
+    short *lineCount;            /**< Empty cells where each value fits, per row then per column */
+    uint64_t *buckets;           /**< Empty cells (cell + 1) by number of candidates, one bitset per count */
+    int *bucketSize;             /**< Number of cells in each bucket */
+    int *queue;                  /**< Events left to examine by propagate() */
+    int queueTop;                /**< Number of queued events */
+    int *trail;                  /**< Cells assigned so far, in order */
+    int trailTop;                /**< Number of entries in the trail */
+    FRAME *frames;               /**< Branching points of the search */
+    uint64_t *frameCand;         /**< Candidate bitsets of the branching points */
+    long long found;             /**< Number of completions found */
+    long long limit;             /**< Stop searching after this many completions */
+    unsigned long long nodes;    /**< Nodes opened by the search */
+    unsigned long long maxNodes; /**< Give up after this many nodes (sequential search only) */
+    short *solution;             /**< The first completion found */
+    SHARED *shared;              /**< State of the parallel search, NULL when sequential */
+    unsigned long long key;      /**< Key of the job this state belongs to */
+} SOLVER;
+
+/**
+ * @brief Represents a subtree of the search handed to the thread pool.
+ */
+typedef struct job
+{
+    SHARED *shared;            /**< State of the parallel search */
+    struct counter *counter;   /**< State of the parallel count, NULL when solving */
+    unsigned long long weight; /**< Counting: completions per completion of the subtree */
+    unsigned long long key;    /**< Position of the subtree in depth-first order */
+    int depth;                 /**< Number of split levels above the subtree */
+    int budget;                /**< Number of jobs the subtree may still be split into */
+    short cells[];             /**< The board at the root of the subtree */
+} JOB;
+
+/**
+ * @brief Represents a bounded table of subtree counts, owned by one worker.
+ *
+ * The completions of a node only depend on which cells are empty and on the values missing
+ * from every row and column, so the key of a node is its empty-cell bitmap followed by its row
+ * and column bitsets. Nodes reached through different branches (for example by swapping two
+ * values around a rectangle) share their count. A slot keeps the last key hashed to it.
+ */
+typedef struct cache
+{
+    int keyWords;                /**< Words of a key */
+    int slots;                   /**< Number of slots, a power of two, 0 to disable the cache */
+    uint64_t *hashes;            /**< Hash of the key in each slot, 0 for a free slot */
+    uint64_t *keys;              /**< Keys of the slots */
+    unsigned long long *counts;  /**< Counts of the slots */
+    uint64_t *scratch;           /**< Key of the node being looked up */
+} CACHE;
+
+/**
+ * @brief Represents the state shared by the jobs of a parallel count.
+ */
+typedef struct counter
+{
+    int size;                 /**< The order of the Latin square */
+    unsigned long long total; /**< Completions counted by the finished jobs */
+    bool overflow;            /**< Set when the count does not fit in 64 bits */
+    unsigned long long nodes; /**< Nodes searched so far (atomic) */
+    int jobs;                 /**< Jobs created so far (atomic) */
+    int finished;             /**< Jobs finished so far (atomic) */
+    bool progress;            /**< Report the progress on the standard error */
+    double start;             /**< Time the count started */
+    double lastReport;        /**< Time of the last progress report */
+    CACHE *caches;            /**< One cache per worker */
+    pthread_mutex_t lock;     /**< Protects total, overflow and the reports */
+} COUNTER;
+
+/**
+ * @brief Computes the candidate values of an empty cell.
+ *
+ * @param s The solver state.
+ * @param cell The flat index of the cell.
+ * @param cand Receives the values that appear neither in the row nor in the column of the cell.
+ * @return true if the cell has at least one candidate.
+ */
+static inline bool candidates(const SOLVER *s, int cell, uint64_t *cand)
+{
+    const uint64_t *row = s->rowMask + (cell / s->size) * s->words;
+    const uint64_t *col = s->colMask + (cell % s->size) * s->words;
+    uint64_t any = 0;
+    for (int w = 0; w < s->words; w++)
+    {
+        cand[w] = s->full[w] & ~(row[w] | col[w]);
+        any |= cand[w];
+    }
+    return any != 0;
+}
+
+/**
+ * @brief Moves an empty cell to the bucket of its new candidate count.
+ *
+ * @param s The solver state.
+ * @param cell The flat index of the cell.
+ * @param from The bucket of the cell, -1 if it is in none.
+ * @param to The bucket to move the cell to, -1 to take it out.
+ */
+static inline void moveBucket(SOLVER *s, int cell, int from, int to)
+{
+    if (from >= 0)
+    {
+        removeValue(s->buckets + (size_t)from * s->cellWords, cell + 1);
+        s->bucketSize[from]--;
+    }
+    if (to >= 0)
+    {
+        addValue(s->buckets + (size_t)to * s->cellWords, cell + 1);
+        s->bucketSize[to]++;
+    }
+}
+
+/**
+ * @brief Takes a candidate from an empty cell, queueing the cell if one or none is left.
+ *
+ * @param s The solver state.
+ * @param cell The flat index of the cell.
+ */
+static inline void dropCandidate(SOLVER *s, int cell)
+{
+    int count = --s->count[cell];
+    moveBucket(s, cell, count + 1, count);
+    if (count <= 1)
+    {
+        s->queue[s->queueTop++] = cell;
+    }
+}
+
+/**
+ * @brief Takes a cell from the cells of a line where a value fits, queueing it if one or none is left.
+ *
+ * @param s The solver state.
+ * @param line The (row or column, value) pair, as an event minus size * size.
+ */
+static inline void dropPlace(SOLVER *s, int line)
+{
+    if (--s->lineCount[line] <= 1)
+    {
+        s->queue[s->queueTop++] = line + s->size * s->size;
+    }
+}
+
+/**
+ * @brief Places a value in an empty cell and records it on the trail.
+ *
+ * The value must be a candidate of the cell. The candidates of the cell leave the counters of
+ * its row and column, and the value leaves the candidates of the empty cells of both lines.
+ *
+ * @param s The solver state.
+ * @param cell The flat index of the cell.
+ * @param val The value to place.
+ */
+static void assign(SOLVER *s, int cell, int val)
+{
+    int size = s->size;
+    int row = cell / size, col = cell % size;
+    int rows = 0, cols = size * size; // First (row, value) and (column, value) lines
+    uint64_t cand[MAX_WORDS];
+    candidates(s, cell, cand);
+
+    s->cells[cell] = val;
+    addValue(s->rowMask + row * s->words, val);
+    addValue(s->colMask + col * s->words, val);
+    moveBucket(s, cell, s->count[cell], -1);
+    for (int v = firstValue(cand, s->words); v != 0; v = firstValue(cand, s->words))
+    {
+        removeValue(cand, v);
+        dropPlace(s, rows + row * size + v - 1);
+        dropPlace(s, cols + col * size + v - 1);
+    }
+
+    for (int k = 0; k < size; k++)
+    {
+        int peer = row * size + k;
+        if (s->cells[peer] == 0 && !hasValue(s->colMask + k * s->words, val))
+        {
+            dropCandidate(s, peer);
+            dropPlace(s, rows + row * size + val - 1);
+            dropPlace(s, cols + k * size + val - 1);
+        }
+        peer = k * size + col;
+        if (s->cells[peer] == 0 && !hasValue(s->rowMask + k * s->words, val))
+        {
+            dropCandidate(s, peer);
+            dropPlace(s, rows + k * size + val - 1);
+            dropPlace(s, cols + col * size + val - 1);
+        }
+    }
+
+    s->trail[s->trailTop++] = cell;
+    s->empty--;
+}
+
+/**
+ * @brief Clears every cell assigned after the given trail position.
+ *
+ * The cells are cleared in the reverse order of assign(), so every counter gets back the value
+ * it had before the assignment. Nothing is queued.
+ *
+ * @param s The solver state.
+ * @param mark The trail position to return to.
+ */
+static void undo(SOLVER *s, int mark)
+{
+    int size = s->size;
+    int rows = 0, cols = size * size;
+    uint64_t cand[MAX_WORDS];
+    while (s->trailTop > mark)
+    {
+        int cell = s->trail[--s->trailTop];
+        int row = cell / size, col = cell % size;
+        int val = s->cells[cell];
+        removeValue(s->rowMask + row * s->words, val);
+        removeValue(s->colMask + col * s->words, val);
+
+        for (int k = 0; k < size; k++)
+        {
+            int peer = row * size + k;
+            if (s->cells[peer] == 0 && !hasValue(s->colMask + k * s->words, val))
+            {
+                moveBucket(s, peer, s->count[peer], s->count[peer] + 1);
+                s->count[peer]++;
+                s->lineCount[rows + row * size + val - 1]++;
+                s->lineCount[cols + k * size + val - 1]++;
+            }
+            peer = k * size + col;
+            if (s->cells[peer] == 0 && !hasValue(s->rowMask + k * s->words, val))
+            {
+                moveBucket(s, peer, s->count[peer], s->count[peer] + 1);
+                s->count[peer]++;
+                s->lineCount[rows + k * size + val - 1]++;
+                s->lineCount[cols + col * size + val - 1]++;
+            }
+        }
+
+        s->cells[cell] = 0;
+        candidates(s, cell, cand);
+        for (int v = firstValue(cand, s->words); v != 0; v = firstValue(cand, s->words))
+        {
+            removeValue(cand, v);
+            s->lineCount[rows + row * size + v - 1]++;
+            s->lineCount[cols + col * size + v - 1]++;
+        }
+        moveBucket(s, cell, -1, s->count[cell]);
+        s->empty++;
+    }
+}
+
+/**
+ * @brief Places the naked single of a queued cell.
+ *
+ * @param s The solver state.
+ * @param cell The flat index of the cell, with at most one candidate if still empty.
+ * @return false if the cell has no candidate left, true otherwise.
+ */
+static bool placeNakedSingle(SOLVER *s, int cell)
+{
+    if (s->cells[cell] != 0)
+    {
+        return true; // Filled since it was queued
+    }
+    if (s->count[cell] == 0)
+    {
+        return false;
+    }
+    uint64_t cand[MAX_WORDS];
+    candidates(s, cell, cand);
+    assign(s, cell, firstValue(cand, s->words));
+    STATS_COUNT(STAT_PROPAGATIONS);
+    return true;
+}
+
+/**
+ * @brief Places the hidden single of a queued (row or column, value) pair.
+ *
+ * @param s The solver state.
+ * @param line The pair, as an event minus size * size.
+ * @return false if the value is missing from the line and fits nowhere in it, true otherwise.
+ */
+static bool placeHiddenSingle(SOLVER *s, int line)
+{
+    int size = s->size;
+    bool column = line >= size * size;
+    int index = (column ? line - size * size : line) / size;
+    int val = line % size + 1;
+    const uint64_t *used = (column ? s->colMask : s->rowMask) + index * s->words;
+    if (hasValue(used, val))
+    {
+        return true; // The value is already in the line
+    }
+    if (s->lineCount[line] == 0)
+    {
+        return false; // The value has nowhere to go
+    }
+
+    int first = column ? index : index * size;
+    int step = column ? size : 1;
+    for (int k = 0, cell = first; k < size; k++, cell += step)
+    {
+        if (s->cells[cell] == 0 && !hasValue(s->rowMask + (cell / size) * s->words, val) &&
+            !hasValue(s->colMask + (cell % size) * s->words, val))
+        {
+            assign(s, cell, val);
+            STATS_COUNT(STAT_PROPAGATIONS);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Applies naked and hidden singles until nothing more can be deduced.
+ *
+ * Only the queued cells and (line, value) pairs are examined, the ones whose counter fell
+ * to one or zero since the last propagation. The queue is empty on return.
+ *
+ * @param s The solver state.
+ * @return false if a contradiction was found, true otherwise.
+ */
+static bool propagate(SOLVER *s)
+{
+    int cells = s->size * s->size;
+    while (s->queueTop > 0)
+    {
+        int event = s->queue[--s->queueTop];
+        bool consistent = event < cells ? placeNakedSingle(s, event) : placeHiddenSingle(s, event - cells);
+        if (!consistent)
+        {
+            s->queueTop = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Chooses the empty cell with the fewest candidates (minimum remaining values).
+ *
+ * The first cell of the smallest non-empty bucket is the first cell of the board with the
+ * fewest candidates, so the choice only depends on the board.
+ *
+ * @param s The solver state, after a successful propagation.
+ * @return The flat index of the cell to branch on.
+ */
+static int chooseBranchCell(const SOLVER *s)
+{
+    for (int count = 0; count <= s->size; count++)
+    {
+        if (s->bucketSize[count] > 0)
+        {
+            return firstValue(s->buckets + (size_t)count * s->cellWords, s->cellWords) - 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Records the completion held by the solver state.
+ *
+ * @param s The solver state, with no empty cell left.
+ */
+static void recordSolution(SOLVER *s)
+{
+    size_t bytes = (size_t)s->size * s->size * sizeof(short);
+    SHARED *shared = s->shared;
+    if (shared == NULL)
+    {
+        if (s->found++ == 0)
+        {
+            memcpy(s->solution, s->cells, bytes);
+        }
+        return;
+    }
+
+    __atomic_add_fetch(&shared->found, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&shared->lock);
+    if (s->key < shared->bestKey)
+    {
+        memcpy(shared->solution, s->cells, bytes);
+        __atomic_store_n(&shared->bestKey, s->key, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&shared->lock);
+}
+
+/**
+ * @brief Tells whether a job of a parallel search can stop.
+ *
+ * When a single completion is wanted, a job only stops once a completion with a key no larger
+ * than its own exists, because an earlier job must still be allowed to find the completion the
+ * sequential search would.
+ *
+ * @param shared The state of the parallel search.
+ * @param key The key of the job.
+ * @return true if the job should stop, false otherwise.
+ */
+static bool stopJob(SHARED *shared, unsigned long long key)
+{
+    if (__atomic_load_n(&shared->found, __ATOMIC_RELAXED) < shared->limit)
+    {
+        return false;
+    }
+    return shared->limit > 1 || __atomic_load_n(&shared->bestKey, __ATOMIC_RELAXED) <= key;
+}
+
+/**
+ * @brief Tells whether the search of this state can stop.
+ *
+ * Sequentially the search stops once the limit is reached, in a parallel search as stopJob() says.
+ *
+ * @param s The solver state.
+ * @return true if the search should stop, false otherwise.
+ */
+static bool stopSearch(const SOLVER *s)
+{
+    if (s->shared == NULL)
+    {
+        return s->found >= s->limit || s->nodes >= s->maxNodes;
+    }
+    return stopJob(s->shared, s->key);
+}
+
+/**
+ * @brief Propagates the current state and prepares a branching point for it.
+ *
+ * @param s The solver state.
+ * @param f The frame to fill.
+ * @return true if the node has to be branched on, false if it failed or was a completion
+ *         (in both cases the propagation has already been undone).
+ */
+static bool openFrame(SOLVER *s, FRAME *f)
+{
+    s->nodes++;
+    STATS_COUNT(STAT_NODES);
+    f->mark = s->trailTop;
+    STATS_START(TIMER_PROPAGATE);
+    bool consistent = propagate(s);
+    STATS_STOP(TIMER_PROPAGATE);
+    if (!consistent)
+    {
+        STATS_COUNT(STAT_BACKTRACKS);
+        undo(s, f->mark);
+        return false;
+    }
+    if (s->empty == 0)
+    {
+        STATS_COUNT(STAT_SOLUTIONS);
+        recordSolution(s);
+        undo(s, f->mark);
+        return false;
+    }
+    f->cell = chooseBranchCell(s);
+    candidates(s, f->cell, f->cand);
+    f->branch = s->trailTop;
+    return true;
+}
+
+/**
+ * @brief Searches for completions of the current state.
+ *
+ * After propagation the empty cell with the fewest candidates is chosen and every candidate
+ * is tried in increasing order. The state is restored before returning.
+ *
+ * @param s The solver state. The completions seen are recorded with recordSolution().
+ */
+static void search(SOLVER *s)
+{
+    int depth = openFrame(s, &s->frames[0]) ? 1 : 0;
+    while (depth > 0)
+    {
+        FRAME *f = &s->frames[depth - 1];
+        undo(s, f->branch); // Take back the value tried last at this node
+
+        int val = firstValue(f->cand, s->words);
+        if (val == 0 || stopSearch(s))
+        {
+            undo(s, f->mark);
+            depth--;
+            continue;
+        }
+
+        removeValue(f->cand, val);
+        assign(s, f->cell, val);
+        if (openFrame(s, &s->frames[depth]))
+        {
+            depth++;
+        }
+    }
+}
+
+/**
+ * @brief Allocates a solver state for squares of the given order.
+ *
+ * @param size The order of the Latin square.
+ * @return SOLVER* The new solver state.
+ */
+static SOLVER *allocSolver(int size)
+{
+    int cells = size * size;
+    int words = BITSET_WORDS(size);
+    SOLVER *s = (SOLVER *)allocOrExit(sizeof(SOLVER));
+    s->cells = (short *)allocOrExit(cells * sizeof(short));
+    s->solution = (short *)allocOrExit(cells * sizeof(short));
+    s->rowMask = (uint64_t *)allocOrExit(size * words * sizeof(uint64_t));
+    s->colMask = (uint64_t *)allocOrExit(size * words * sizeof(uint64_t));
+    s->count = (short *)allocOrExit(cells * sizeof(short));
+    s->lineCount = (short *)allocOrExit(2 * cells * sizeof(short));
+    s->buckets = (uint64_t *)allocOrExit((size_t)(size + 1) * BITSET_WORDS(cells) * sizeof(uint64_t));
+    s->bucketSize = (int *)allocOrExit((size + 1) * sizeof(int));
+    s->queue = (int *)allocOrExit((size_t)EVENTS_PER_CELL * cells * sizeof(int));
+    s->trail = (int *)allocOrExit(cells * sizeof(int));
+    s->frames = (FRAME *)allocOrExit((cells + 1) * sizeof(FRAME));
+    s->frameCand = (uint64_t *)allocOrExit((size_t)(cells + 1) * words * sizeof(uint64_t));
+    for (int k = 0; k <= cells; k++)
+    {
+        s->frames[k].cand = s->frameCand + (size_t)k * words;
+    }
+    return s;
+}
+
+/**
+ * @brief Releases a solver state.
+ *
+ * @param s The solver state.
+ */
+static void freeSolver(SOLVER *s)
+{
+    free(s->cells);
+    free(s->solution);
+    free(s->rowMask);
+    free(s->colMask);
+    free(s->count);
+    free(s->lineCount);
+    free(s->buckets);
+    free(s->bucketSize);
+    free(s->queue);
+    free(s->trail);
+    free(s->frames);
+    free(s->frameCand);
+    free(s);
+}
+
+/**
+ * @brief Loads the solver state from a flat board.
+ *
+ * The counters are computed from scratch and every one already at one or zero is queued,
+ * so the first propagate() sees the whole board.
+ *
+ * @param s The solver state to fill, allocated for this order.
+ * @param size The order of the Latin square.
+ * @param cells The size * size cells, row by row. The sign of the values is ignored.
+ */
+static void loadSolver(SOLVER *s, int size, const short *cells)
+{
+    s->size = size;
+    s->words = BITSET_WORDS(size);
+    s->cellWords = BITSET_WORDS(size * size);
+    s->empty = 0;
+    fillValues(s->full, size);
+    s->trailTop = 0;
+    s->found = 0;
+    s->limit = 1;
+    s->nodes = 0;
+    s->maxNodes = ULLONG_MAX;
+    s->shared = NULL;
+    s->key = 0;
+    memset(s->rowMask, 0, size * s->words * sizeof(uint64_t));
+    memset(s->colMask, 0, size * s->words * sizeof(uint64_t));
+    for (int cell = 0; cell < size * size; cell++)
+    {
+        s->cells[cell] = abs(cells[cell]);
+        if (s->cells[cell] == 0)
+        {
+            s->empty++;
+        }
+        else
+        {
+            addValue(s->rowMask + (cell / size) * s->words, s->cells[cell]);
+            addValue(s->colMask + (cell % size) * s->words, s->cells[cell]);
+        }
+    }
+
+    int area = size * size;
+    uint64_t cand[MAX_WORDS];
+    memset(s->lineCount, 0, 2 * area * sizeof(short));
+    memset(s->buckets, 0, (size_t)(size + 1) * s->cellWords * sizeof(uint64_t));
+    memset(s->bucketSize, 0, (size + 1) * sizeof(int));
+    s->queueTop = 0;
+    for (int cell = 0; cell < area; cell++)
+    {
+        if (s->cells[cell] != 0)
+        {
+            continue;
+        }
+        candidates(s, cell, cand);
+        s->count[cell] = countValues(cand, s->words);
+        moveBucket(s, cell, -1, s->count[cell]);
+        if (s->count[cell] <= 1)
+        {
+            s->queue[s->queueTop++] = cell;
+        }
+        for (int v = firstValue(cand, s->words); v != 0; v = firstValue(cand, s->words))
+        {
+            removeValue(cand, v);
+            s->lineCount[(cell / size) * size + v - 1]++;
+            s->lineCount[area + (cell % size) * size + v - 1]++;
+        }
+    }
+    for (int line = 0; line < 2 * area; line++)
+    {
+        int index = (line < area ? line : line - area) / size;
+        const uint64_t *used = (line < area ? s->rowMask : s->colMask) + index * s->words;
+        if (s->lineCount[line] <= 1 && !hasValue(used, line % size + 1))
+        {
+            s->queue[s->queueTop++] = area + line;
+        }
+    }
+}
+
+/**
+ * @brief Allocates a job for a board of the given order.
+ *
+ * @param size The order of the Latin square.
+ * @return JOB* The new job.
+ */
+static JOB *allocJob(int size)
+{
+    return (JOB *)allocOrExit(sizeof(JOB) + (size_t)size * size * sizeof(short));
+}
+
+static void runJob(POOL *pool, int worker, void *arg);
+
+/**
+ * @brief Splits a job into one child job per candidate of its branching cell.
+ *
+ * The children are pushed in decreasing value order, so the worker pops the smallest value
+ * first (the sequential order) while idle workers steal the larger ones.
+ *
+ * @param pool The pool running the job.
+ * @param worker The worker running the job.
+ * @param job The job to split.
+ * @param s The propagated state of the job, with at least one empty cell.
+ */
+static void splitJob(POOL *pool, int worker, const JOB *job, const SOLVER *s)
+{
+    int cell = chooseBranchCell(s);
+    uint64_t cand[MAX_WORDS];
+    candidates(s, cell, cand);
+    int count = countValues(cand, s->words);
+    int shift = KEY_BITS * (MAX_SPLIT_DEPTH - 1 - job->depth);
+
+    // The candidate values in increasing order
+    int values[MAX_SIZE];
+    for (int k = 0; k < count; k++)
+    {
+        values[k] = firstValue(cand, s->words);
+        removeValue(cand, values[k]);
+    }
+
+    for (int k = count - 1; k >= 0; k--)
+    {
+        JOB *child = allocJob(s->size);
+        child->shared = job->shared;
+        child->counter = NULL;
+        child->weight = 1;
+        child->key = job->key | ((unsigned long long)(k + 1) << shift);
+        child->depth = job->depth + 1;
+        child->budget = (job->budget + count - 1) / count;
+        memcpy(child->cells, s->cells, (size_t)s->size * s->size * sizeof(short));
+        child->cells[cell] = values[k];
+        submitTask(pool, worker, runJob, child);
+    }
+}
+
+/**
+ * @brief Task function of the thread pool: searches (or splits) one subtree.
+ *
+ * @param pool The pool running the job.
+ * @param worker The worker running the job.
+ * @param arg The JOB to run. It is released here.
+ */
+static void runJob(POOL *pool, int worker, void *arg)
+{
+    JOB *job = (JOB *)arg;
+    if (stopJob(job->shared, job->key))
+    {
+        free(job); // Cancelled: a better completion is already known
+        return;
+    }
+    SOLVER *s = allocSolver(job->shared->size);
+    loadSolver(s, job->shared->size, job->cells);
+    s->shared = job->shared;
+    s->key = job->key;
+
+    if (job->depth >= MAX_SPLIT_DEPTH || job->budget <= 1)
+    {
+        search(s);
+    }
+    else
+    {
+        // A split level is a node of the search, counted like the ones of openFrame()
+        STATS_COUNT(STAT_NODES);
+        STATS_START(TIMER_PROPAGATE);
+        bool consistent = propagate(s);
+        STATS_STOP(TIMER_PROPAGATE);
+        if (!consistent)
+        {
+            STATS_COUNT(STAT_BACKTRACKS);
+        }
+        else if (s->empty == 0)
+        {
+            STATS_COUNT(STAT_SOLUTIONS);
+            recordSolution(s);
+        }
+        else
+        {
+            splitJob(pool, worker, job, s);
+        }
+    }
+
+    freeSolver(s);
+    free(job);
+}
+
+/**
+ * @brief Finds completions of a game, sequentially or on a work-stealing pool.
+ *
+ * @param game The game holding the partial Latin square.
+ * @param limit Stop after this many completions.
+ * @param threads Number of worker threads; 1 searches on the calling thread, below 1 uses all processors.
+ * @param solution Receives the first completion in depth-first order, if any (size * size cells).
+ * @return The number of completions found, at most limit.
+ */
+static long long findCompletions(GAME *game, long long limit, int threads, short *solution)
+{
+    int size = game->size;
+    size_t bytes = (size_t)size * size * sizeof(short);
+    JOB *root = allocJob(size);
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            root->cells[i * size + j] = getCell(game, i, j);
+        }
+    }
+
+    long long found;
+    const KERNEL *kernel = findKernel(size);
+    if (threads == 1 && kernel != NULL)
+    {
+        unsigned long long nodes;
+        found = kernel->search(root->cells, limit, ULLONG_MAX, &nodes, solution);
+        free(root);
+        return found;
+    }
+    if (threads == 1)
+    {
+        SOLVER *s = allocSolver(size);
+        loadSolver(s, size, root->cells);
+        s->limit = limit;
+        search(s);
+        found = s->found;
+        memcpy(solution, s->solution, bytes);
+        freeSolver(s);
+        free(root);
+        return found;
+    }
+
+    SHARED *shared = (SHARED *)allocOrExit(sizeof(SHARED));
+    shared->size = size;
+    shared->limit = limit;
+    shared->found = 0;
+    shared->bestKey = NO_KEY;
+    shared->solution = solution;
+    pthread_mutex_init(&shared->lock, NULL);
+
+    POOL *pool = createPool(threads);
+    root->shared = shared;
+    root->counter = NULL;
+    root->weight = 1;
+    root->key = 0;
+    root->depth = 0;
+    root->budget = pool->threads * TASKS_PER_THREAD;
+    submitTask(pool, -1, runJob, root);
+    waitPool(pool);
+    freePool(pool);
+
+    found = shared->found < limit ? shared->found : limit;
+    pthread_mutex_destroy(&shared->lock);
+    free(shared);
+    return found;
+}
+
+/**
+ * @brief Adds two counts, saturating on overflow.
+ *
+ * @param a The first count.
+ * @param b The second count.
+ * @param overflow Set to true if the sum does not fit.
+ * @return The sum, or ULLONG_MAX on overflow.
+ */
+static unsigned long long addCount(unsigned long long a, unsigned long long b, bool *overflow)
+{
+    unsigned long long sum;
+    if (__builtin_add_overflow(a, b, &sum))
+    {
+        *overflow = true;
+        return ULLONG_MAX;
+    }
+    return sum;
+}
+
+/**
+ * @brief Multiplies two counts, saturating on overflow.
+ *
+ * @param a The first count.
+ * @param b The second count.
+ * @param overflow Set to true if the product does not fit.
+ * @return The product, or ULLONG_MAX on overflow.
+ */
+static unsigned long long mulCount(unsigned long long a, unsigned long long b, bool *overflow)
+{
+    unsigned long long product;
+    if (__builtin_mul_overflow(a, b, &product))
+    {
+        *overflow = true;
+        return ULLONG_MAX;
+    }
+    return product;
+}
+
+/**
+ * @brief Computes the values to branch on at a cell, merging the unused symbols.
+ *
+ * A symbol that appears nowhere on the board can be swapped with any other unused symbol
+ * without changing the board, so every unused symbol has as many completions as the first one.
+ * Only the first unused symbol is kept as a branch, standing for all of them.
+ *
+ * @param s The solver state.
+ * @param cell The empty cell branched on.
+ * @param cand Receives the values to try.
+ * @param freshCount Receives the number of unused symbols.
+ * @return The unused symbol kept as a branch, 0 if at most one symbol is unused.
+ */
+static int branchValues(const SOLVER *s, int cell, uint64_t *cand, int *freshCount)
+{
+    uint64_t fresh[MAX_WORDS];
+    memcpy(fresh, s->full, sizeof(fresh));
+    for (int row = 0; row < s->size; row++)
+    {
+        for (int w = 0; w < s->words; w++)
+        {
+            fresh[w] &= ~s->rowMask[row * s->words + w];
+        }
+    }
+
+    candidates(s, cell, cand);
+    *freshCount = countValues(fresh, s->words);
+    if (*freshCount < 2)
+    {
+        return 0;
+    }
+    int first = firstValue(fresh, s->words);
+    for (int w = 0; w < s->words; w++)
+    {
+        cand[w] &= ~fresh[w]; // Unused symbols are candidates of every empty cell
+    }
+    addValue(cand, first);
+    return first;
+}
+
+/**
+ * @brief Allocates the counting cache of one worker.
+ *
+ * @param cache The cache to fill.
+ * @param size The order of the Latin square.
+ * @param bytes The memory the cache may use.
+ */
+static void initCache(CACHE *cache, int size, size_t bytes)
+{
+    int words = BITSET_WORDS(size);
+    cache->keyWords = BITSET_WORDS(size * size) + 2 * size * words;
+    size_t entry = (cache->keyWords + 2) * sizeof(uint64_t);
+    cache->slots = 1;
+    while ((size_t)cache->slots * 2 * entry <= bytes)
+    {
+        cache->slots *= 2;
+    }
+    if ((size_t)cache->slots * entry > bytes || cache->slots < 16)
+    {
+        cache->slots = 0; // Keys too large for the memory available
+    }
+
+    // calloc so the pages of a cache that stays small are never touched
+    cache->hashes = (uint64_t *)calloc(cache->slots + 1, sizeof(uint64_t));
+    cache->keys = (uint64_t *)calloc((size_t)cache->slots * cache->keyWords + 1, sizeof(uint64_t));
+    cache->counts = (unsigned long long *)calloc(cache->slots + 1, sizeof(unsigned long long));
+    cache->scratch = (uint64_t *)calloc(cache->keyWords, sizeof(uint64_t));
+    if (cache->hashes == NULL || cache->keys == NULL || cache->counts == NULL || cache->scratch == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Releases the counting cache of one worker.
+ *
+ * @param cache The cache.
+ */
+static void freeCache(CACHE *cache)
+{
+    free(cache->hashes);
+    free(cache->keys);
+    free(cache->counts);
+    free(cache->scratch);
+}
+
+/**
+ * @brief Builds the cache key of the current node in cache->scratch.
+ *
+ * @param s The solver state, after propagation.
+ * @param cache The cache.
+ * @return The hash of the key, never 0.
+ */
+static uint64_t cacheKey(const SOLVER *s, CACHE *cache)
+{
+    int cells = s->size * s->size;
+    int maskWords = s->size * s->words;
+    uint64_t *key = cache->scratch;
+    memset(key, 0, BITSET_WORDS(cells) * sizeof(uint64_t));
+    for (int cell = 0; cell < cells; cell++)
+    {
+        if (s->cells[cell] == 0)
+        {
+            addValue(key, cell + 1);
+        }
+    }
+    memcpy(key + BITSET_WORDS(cells), s->rowMask, maskWords * sizeof(uint64_t));
+    memcpy(key + BITSET_WORDS(cells) + maskWords, s->colMask, maskWords * sizeof(uint64_t));
+
+    uint64_t hash = 0;
+    for (int w = 0; w < cache->keyWords; w++)
+    {
+        hash = mixRandom(hash ^ key[w]);
+    }
+    return hash | 1;
+}
+
+/**
+ * @brief Looks the current node up in the cache.
+ *
+ * @param s The solver state, after propagation.
+ * @param cache The cache.
+ * @param count Receives the count of the node on a hit.
+ * @return true on a hit.
+ */
+static bool lookupCount(const SOLVER *s, CACHE *cache, unsigned long long *count)
+{
+    if (cache->slots == 0)
+    {
+        return false;
+    }
+    uint64_t hash = cacheKey(s, cache);
+    int slot = (int)(hash & (cache->slots - 1));
+    if (cache->hashes[slot] != hash ||
+        memcmp(cache->keys + (size_t)slot * cache->keyWords, cache->scratch, cache->keyWords * sizeof(uint64_t)) != 0)
+    {
+        return false;
+    }
+    *count = cache->counts[slot];
+    return true;
+}
+
+/**
+ * @brief Stores the count of the current node in the cache, replacing the slot's last entry.
+ *
+ * @param s The solver state, after propagation.
+ * @param cache The cache.
+ * @param count The number of completions of the node.
+ */
+static void storeCount(const SOLVER *s, CACHE *cache, unsigned long long count)
+{
+    if (cache->slots == 0)
+    {
+        return;
+    }
+    uint64_t hash = cacheKey(s, cache);
+    int slot = (int)(hash & (cache->slots - 1));
+    cache->hashes[slot] = hash;
+    memcpy(cache->keys + (size_t)slot * cache->keyWords, cache->scratch, cache->keyWords * sizeof(uint64_t));
+    cache->counts[slot] = count;
+}
+
+/**
+ * @brief Adds searched nodes to the shared counter and prints a progress line when due.
+ *
+ * @param counter The shared count state.
+ * @param nodes The nodes searched since the last call.
+ */
+static void reportProgress(COUNTER *counter, unsigned long long nodes)
+{
+    unsigned long long total = __atomic_add_fetch(&counter->nodes, nodes, __ATOMIC_RELAXED);
+    if (!counter->progress || pthread_mutex_trylock(&counter->lock) != 0)
+    {
+        return; // Another worker is reporting
+    }
+    double time = now();
+    if (time - counter->lastReport >= PROGRESS_SECONDS)
+    {
+        counter->lastReport = time;
+        fprintf(stderr, "%d/%d subtrees, %llu completions so far, %llu nodes, %.1f s\n",
+                __atomic_load_n(&counter->finished, __ATOMIC_RELAXED),
+                __atomic_load_n(&counter->jobs, __ATOMIC_RELAXED), counter->total, total, time - counter->start);
+    }
+    pthread_mutex_unlock(&counter->lock);
+}
+
+/**
+ * @brief Propagates the current state and prepares a counting branching point for it.
+ *
+ * @param s The solver state.
+ * @param f The frame to fill.
+ * @param cache The cache of the worker.
+ * @param nodes The nodes searched so far, incremented.
+ * @param count Receives the number of completions when no branching is needed.
+ * @return true if the node has to be branched on, false if its count is known
+ *         (in both cases with the propagation undone in the latter).
+ */
+static bool openCountFrame(SOLVER *s, FRAME *f, CACHE *cache, unsigned long long *nodes, unsigned long long *count)
+{
+    (*nodes)++;
+    STATS_COUNT(STAT_NODES);
+    f->mark = s->trailTop;
+    STATS_START(TIMER_PROPAGATE);
+    bool consistent = propagate(s);
+    STATS_STOP(TIMER_PROPAGATE);
+    if (!consistent)
+    {
+        STATS_COUNT(STAT_BACKTRACKS);
+        undo(s, f->mark);
+        *count = 0;
+        return false;
+    }
+    if (s->empty == 0)
+    {
+        STATS_COUNT(STAT_SOLUTIONS);
+        undo(s, f->mark);
+        *count = 1;
+        return false;
+    }
+    if (lookupCount(s, cache, count))
+    {
+        undo(s, f->mark);
+        return false;
+    }
+    f->cell = chooseBranchCell(s);
+    f->fresh = branchValues(s, f->cell, f->cand, &f->freshCount);
+    f->total = 0;
+    f->nodes = *nodes;
+    f->branch = s->trailTop;
+    return true;
+}
+
+/**
+ * @brief Counts every completion of the current state.
+ *
+ * Same depth-first search as search(), except that the count of every branching point is
+ * accumulated in its frame, unused symbols are merged by branchValues() and large subtrees are
+ * cached. The state is restored before returning.
+ *
+ * @param s The solver state.
+ * @param cache The cache of the worker.
+ * @param counter The shared count state, for the progress reports.
+ * @param overflow Set to true if the count does not fit in 64 bits.
+ * @return The number of completions.
+ */
+static unsigned long long countSearch(SOLVER *s, CACHE *cache, COUNTER *counter, bool *overflow)
+{
+    unsigned long long nodes = 0;
+    unsigned long long reported = 0;
+    unsigned long long count;
+    if (!openCountFrame(s, &s->frames[0], cache, &nodes, &count))
+    {
+        reportProgress(counter, nodes);
+        return count;
+    }
+
+    int depth = 1;
+    while (depth > 0)
+    {
+        FRAME *f = &s->frames[depth - 1];
+        undo(s, f->branch); // Take back the value tried last at this node
+
+        if (nodes - reported >= PROGRESS_NODES)
+        {
+            reportProgress(counter, nodes - reported);
+            reported = nodes;
+        }
+
+        int val = firstValue(f->cand, s->words);
+        if (val == 0)
+        {
+            // Every value was tried, f->total is the count of the node
+            if (nodes - f->nodes >= CACHE_MIN_NODES && !*overflow)
+            {
+                storeCount(s, cache, f->total);
+            }
+            undo(s, f->mark);
+            depth--;
+            if (depth == 0)
+            {
+                count = f->total;
+            }
+            else
+            {
+                FRAME *parent = &s->frames[depth - 1];
+                parent->total = addCount(parent->total, mulCount(f->total, parent->weight, overflow), overflow);
+            }
+            continue;
+        }
+
+        removeValue(f->cand, val);
+        f->weight = val == f->fresh ? (unsigned long long)f->freshCount : 1;
+        assign(s, f->cell, val);
+        unsigned long long leaf;
+        if (openCountFrame(s, &s->frames[depth], cache, &nodes, &leaf))
+        {
+            depth++;
+        }
+        else
+        {
+            f->total = addCount(f->total, mulCount(leaf, f->weight, overflow), overflow);
+        }
+    }
+
+    reportProgress(counter, nodes - reported);
+    return count;
+}
+
+/**
+ * @brief Adds the completions of a finished job to the shared count.
+ *
+ * @param counter The shared count state.
+ * @param count The completions of the job, before its weight is applied.
+ * @param weight The weight of the job.
+ * @param overflow Whether the job overflowed.
+ */
+static void addJobCount(COUNTER *counter, unsigned long long count, unsigned long long weight, bool overflow)
+{
+    pthread_mutex_lock(&counter->lock);
+    counter->overflow |= overflow || (weight == ULLONG_MAX && count > 0); // The weight saturated
+
+    counter->total = addCount(counter->total, mulCount(count, weight, &counter->overflow), &counter->overflow);
+    pthread_mutex_unlock(&counter->lock);
+    __atomic_add_fetch(&counter->finished, 1, __ATOMIC_RELAXED);
+}
+
+static void runCountJob(POOL *pool, int worker, void *arg);
+
+/**
+ * @brief Splits a counting job into one child job per value to branch on.
+ *
+ * @param pool The pool running the job.
+ * @param worker The worker running the job.
+ * @param job The job to split.
+ * @param s The propagated state of the job, with at least one empty cell.
+ */
+static void splitCountJob(POOL *pool, int worker, const JOB *job, const SOLVER *s)
+{
+    int cell = chooseBranchCell(s);
+    uint64_t cand[MAX_WORDS];
+    int freshCount;
+    int fresh = branchValues(s, cell, cand, &freshCount);
+    int count = countValues(cand, s->words);
+    __atomic_add_fetch(&job->counter->jobs, count, __ATOMIC_RELAXED);
+
+    for (int val = firstValue(cand, s->words); val != 0; val = firstValue(cand, s->words))
+    {
+        removeValue(cand, val);
+        JOB *child = allocJob(s->size);
+        child->shared = NULL;
+        child->counter = job->counter;
+        bool saturated = false; // A saturated weight is caught by addJobCount()
+        child->weight = mulCount(job->weight, val == fresh ? (unsigned long long)freshCount : 1, &saturated);
+        child->key = 0;
+        child->depth = job->depth + (count > 1); // A single branch does not use a split level
+        child->budget = (job->budget + count - 1) / count;
+        memcpy(child->cells, s->cells, (size_t)s->size * s->size * sizeof(short));
+        child->cells[cell] = val;
+        submitTask(pool, worker, runCountJob, child);
+    }
+}
+
+/**
+ * @brief Task function of the thread pool: counts (or splits) one subtree.
+ *
+ * @param pool The pool running the job.
+ * @param worker The worker running the job.
+ * @param arg The JOB to run. It is released here.
+ */
+static void runCountJob(POOL *pool, int worker, void *arg)
+{
+    JOB *job = (JOB *)arg;
+    COUNTER *counter = job->counter;
+    SOLVER *s = allocSolver(counter->size);
+    loadSolver(s, counter->size, job->cells);
+
+    bool overflow = false;
+    unsigned long long count = 0;
+    if (job->depth >= MAX_SPLIT_DEPTH || job->budget <= 1)
+    {
+        count = countSearch(s, &counter->caches[worker], counter, &overflow);
+    }
+    else
+    {
+        STATS_COUNT(STAT_NODES);
+        STATS_START(TIMER_PROPAGATE);
+        bool consistent = propagate(s);
+        STATS_STOP(TIMER_PROPAGATE);
+        if (!consistent)
+        {
+            STATS_COUNT(STAT_BACKTRACKS);
+        }
+        else if (s->empty == 0)
+        {
+            STATS_COUNT(STAT_SOLUTIONS);
+            count = 1;
+        }
+        else
+        {
+            splitCountJob(pool, worker, job, s);
+        }
+    }
+    addJobCount(counter, count, job->weight, overflow);
+
+    freeSolver(s);
+    free(job);
+}
+
+/**
+ * @brief Copies a board, choosing the conjugate whose unused symbols are the most numerous.
+ *
+ * Exchanging the roles of rows, columns and symbols maps the completions of a partial square
+ * one to one onto the completions of its conjugate. Empty rows (or columns) become unused
+ * symbols of the conjugate, which branchValues() merges.
+ *
+ * @param game The game holding the partial Latin square.
+ * @param cells Receives the size * size cells of the conjugate, unsigned.
+ */
+static void conjugateBoard(const GAME *game, short *cells)
+{
+    int size = game->size;
+    int emptyRows = 0, emptyCols = 0, unusedSymbols = 0;
+    uint64_t used[MAX_WORDS] = {0};
+    for (int k = 0; k < size; k++)
+    {
+        emptyRows += countValues(rowSet(game, k), game->words) == 0;
+        emptyCols += countValues(colSet(game, k), game->words) == 0;
+        for (int w = 0; w < game->words; w++)
+        {
+            used[w] |= rowSet(game, k)[w];
+        }
+    }
+    unusedSymbols = size - countValues(used, game->words);
+
+    memset(cells, 0, (size_t)size * size * sizeof(short));
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            int val = abs(getCell(game, i, j));
+            if (val == 0)
+            {
+                continue;
+            }
+            if (emptyRows > unusedSymbols && emptyRows >= emptyCols)
+            {
+                cells[(val - 1) * size + j] = i + 1; // Rows and symbols exchanged
+            }
+            else if (emptyCols > unusedSymbols)
+            {
+                cells[i * size + val - 1] = j + 1; // Columns and symbols exchanged
+            }
+            else
+            {
+                cells[i * size + j] = val;
+            }
+        }
+    }
+}
+
+bool solveLatinSquare(GAME *game, int threads)
+{
+    int size = game->size;
+    short *solution = (short *)allocOrExit((size_t)size * size * sizeof(short));
+    STATS_START(TIMER_SEARCH);
+    bool solved = findCompletions(game, 1, threads, solution) > 0;
+    STATS_STOP(TIMER_SEARCH);
+
+    if (solved)
+    {
+        // Fill the empty cells, the givens keep their sign
+        for (int i = 0; i < size; i++)
+        {
+            for (int j = 0; j < size; j++)
+            {
+                if (getCell(game, i, j) == 0)
+                {
+                    placeValue(game, i, j, solution[i * size + j]);
+                }
+            }
+        }
+    }
+
+    free(solution);
+    return solved;
+}
+
+long long countCompletions(GAME *game, long long limit, int threads)
+{
+    short *solution = (short *)allocOrExit((size_t)game->size * game->size * sizeof(short));
+    STATS_START(TIMER_SEARCH);
+    long long found = findCompletions(game, limit, threads, solution);
+    STATS_STOP(TIMER_SEARCH);
+    free(solution);
+    return found;
+}
+
+long long searchCompletions(GAME *game, long long limit, unsigned long long maxNodes, unsigned long long *nodes)
+{
+    STATS_START(TIMER_SEARCH);
+    int size = game->size;
+    short *cells = (short *)allocOrExit((size_t)size * size * sizeof(short));
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            cells[i * size + j] = getCell(game, i, j);
+        }
+    }
+
+    long long found;
+    const KERNEL *kernel = findKernel(size);
+    if (kernel != NULL)
+    {
+        short *solution = (short *)allocOrExit((size_t)size * size * sizeof(short));
+        found = kernel->search(cells, limit, maxNodes, nodes, solution);
+        free(solution);
+    }
+    else
+    {
+        SOLVER *s = allocSolver(size);
+        loadSolver(s, size, cells);
+        s->limit = limit;
+        s->maxNodes = maxNodes;
+        search(s);
+        found = s->found;
+        *nodes = s->nodes;
+        freeSolver(s);
+    }
+    free(cells);
+    STATS_STOP(TIMER_SEARCH);
+    return found < limit && *nodes >= maxNodes ? -1 : found;
+}
+
+bool countLatinSquare(GAME *game, int threads, bool progress, unsigned long long *count)
+{
+    STATS_START(TIMER_SEARCH);
+    int size = game->size;
+    COUNTER counter;
+    counter.size = size;
+    counter.total = 0;
+    counter.overflow = false;
+    counter.nodes = 0;
+    counter.jobs = 1;
+    counter.finished = 0;
+    counter.progress = progress;
+    counter.start = now();
+    counter.lastReport = counter.start;
+    pthread_mutex_init(&counter.lock, NULL);
+
+    POOL *pool = createPool(threads);
+    counter.caches = (CACHE *)allocOrExit(pool->threads * sizeof(CACHE));
+    for (int k = 0; k < pool->threads; k++)
+    {
+        initCache(&counter.caches[k], size, CACHE_BYTES / pool->threads);
+    }
+
+    JOB *root = allocJob(size);
+    conjugateBoard(game, root->cells);
+    root->shared = NULL;
+    root->counter = &counter;
+    root->weight = 1;
+    root->key = 0;
+    root->depth = 0;
+    root->budget = pool->threads * TASKS_PER_THREAD;
+    submitTask(pool, -1, runCountJob, root);
+    waitPool(pool);
+
+    for (int k = 0; k < pool->threads; k++)
+    {
+        freeCache(&counter.caches[k]);
+    }
+    free(counter.caches);
+    freePool(pool);
+    pthread_mutex_destroy(&counter.lock);
+
+    *count = counter.total;
+    STATS_STOP(TIMER_SEARCH);
+    return !counter.overflow;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file solver.h
+ * @brief Declarations of the non-interactive Latin square solver.
+ */
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "latinsquare.h"
+
+/**
+ * @brief Completes a Latin square in place.
+ *
+ * The candidates of every empty cell are kept as a bitmask derived from the row and column
+ * occupancy bitsets of the game. The solver propagates naked singles (cells with a single
+ * candidate) and hidden singles (values that fit in a single cell of a row or column) and
+ * backtracks on the empty cell with the fewest candidates when propagation stalls. The
+ * candidate counts of the cells, rows and columns are updated with every assignment, so a
+ * node only re-examines the cells and lines its assignments touched.
+ * Protected givens keep their negative sign, the filled cells are stored as positive values.
+ *
+ * With more than one thread the search tree is split at its first branching levels into jobs
+ * run by a work-stealing thread pool. The completion returned is the one the sequential search
+ * finds first, whatever the number of threads.
+ *
+ * @param game The game holding the partial Latin square. On success it holds the completion.
+ * @param threads Number of worker threads; 1 solves on the calling thread, below 1 uses one per processor.
+ * @return true if a completion was found, false if the square cannot be completed.
+ */
+bool solveLatinSquare(GAME *game, int threads);
+
+/**
+ * @brief Counts the completions of a Latin square, stopping early at a limit.
+ *
+ * A limit of 2 is a uniqueness check: the search stops as soon as a second completion is found.
+ * The game is left unchanged.
+ *
+ * @param game The game holding the partial Latin square.
+ * @param limit Stop after this many completions.
+ * @param threads Number of worker threads; 1 searches on the calling thread, below 1 uses one per processor.
+ * @return The number of completions found, at most limit.
+ */
+long long countCompletions(GAME *game, long long limit, int threads);
+
+/**
+ * @brief Counts the completions of a Latin square on the calling thread, within a node budget.
+ *
+ * This is the search of countCompletions() with one thread, instrumented for measurements:
+ * it reports the number of nodes (propagated states) it opened and gives up after maxNodes.
+ * The game is left unchanged.
+ *
+ * @param game The game holding the partial Latin square.
+ * @param limit Stop after this many completions.
+ * @param maxNodes Give up after this many nodes.
+ * @param nodes Receives the number of nodes opened.
+ * @return The number of completions found, at most limit, or -1 if the search gave up first.
+ */
+long long searchCompletions(GAME *game, long long limit, unsigned long long maxNodes, unsigned long long *nodes);
+
+/**
+ * @brief Counts every completion of a Latin square.
+ *
+ * The search of solveLatinSquare() is extended to sum the completions of every branch, with
+ * three reductions:
+ *  - symbols that appear nowhere on the board are interchangeable (permuting them keeps the
+ *    board), so a single one is searched and its count multiplied by their number;
+ *  - the board is first replaced by the conjugate (rows, columns and symbols exchanged) with
+ *    the most such unused symbols, so empty rows and columns are merged as well;
+ *  - the count of a large subtree is cached under the empty cells and the values missing from
+ *    each row and column, which alone decide it, in a bounded table per worker.
+ *
+ * The top of the search tree is split into jobs run by a work-stealing thread pool.
+ *
+ * @param game The game holding the partial Latin square, left unchanged.
+ * @param threads Number of worker threads, below 1 for one per processor.
+ * @param progress true to print a progress line on the standard error every second.
+ * @param count Receives the number of completions.
+ * @return true on success, false if the number does not fit in 64 bits.
+ */
+bool countLatinSquare(GAME *game, int threads, bool progress, unsigned long long *count);
+
+#endif // SOLVER_H
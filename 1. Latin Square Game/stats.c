@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime
+
+#include "stats.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const char *const counterNames[STAT_COUNTERS] = {
+    "moves", "undos", "redos", "accepted", "out-of-range", "protected", "occupied", "duplicate",
+    "dead-end", "nodes", "backtracks", "propagations", "solutions"};
+
+static const char *const timerNames[STAT_TIMERS] = {"load", "validate", "render", "propagate", "search"};
+
+const char *statCounterName(STAT_COUNTER counter)
+{
+    return counterNames[counter];
+}
+
+const char *statTimerName(STAT_TIMER timer)
+{
+    return timerNames[timer];
+}
+
+#ifdef STATS
+
+__thread STATS_BLOCK *threadStats = NULL;
+
+static STATS_BLOCK *allStats = NULL;                          // Every block allocated
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER; // Protects allStats
+static uint64_t startTicks;                                   // STATS_TICKS() at the first event
+static uint64_t startClock;                                   // statsClock() at the first event
+static __thread STATS_BLOCK spareStats;                       // Counts of a thread whose block cannot be allocated
+
+uint64_t statsClock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Sums the blocks of every thread and writes them as JSON, at exit.
+ *
+ * The blocks are read without stopping the threads still running, so their last events may be
+ * missed.
+ */
+static void dumpStats(void)
+{
+    uint64_t elapsedTicks = STATS_TICKS() - startTicks;
+    uint64_t elapsedClock = statsClock() - startClock;
+    double nsPerTick = elapsedTicks > 0 ? (double)elapsedClock / elapsedTicks : 1;
+
+    STATS_BLOCK total = {{0}, {0}, {0}, NULL};
+    int threads = 0;
+    pthread_mutex_lock(&statsLock);
+    for (STATS_BLOCK *block = allStats; block != NULL; block = block->next)
+    {
+        for (int k = 0; k < STAT_COUNTERS; k++)
+        {
+            total.counts[k] += block->counts[k];
+        }
+        for (int k = 0; k < STAT_TIMERS; k++)
+        {
+            total.calls[k] += block->calls[k];
+            total.ticks[k] += block->ticks[k];
+        }
+        threads++;
+    }
+    pthread_mutex_unlock(&statsLock);
+
+    const char *path = getenv("LATINSQUARE_STATS");
+    FILE *out = path != NULL && path[0] != '\0' ? fopen(path, "w") : stderr;
+    if (out == NULL)
+    {
+        perror(path);
+        return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    fprintf(out, "{\"clock\": \"tsc\", ");
+#else
+    fprintf(out, "{\"clock\": \"ns\", ");
+#endif
+    fprintf(out, "\"ns-per-tick\": %.6f, \"threads\": %d,\n \"counters\": {", nsPerTick, threads);
+    for (int k = 0; k < STAT_COUNTERS; k++)
+    {
+        fprintf(out, "%s\"%s\": %llu", k > 0 ? ", " : "", counterNames[k], (unsigned long long)total.counts[k]);
+    }
+    fprintf(out, "},\n \"timers\": {");
+    for (int k = 0; k < STAT_TIMERS; k++)
+    {
+        fprintf(out, "%s\"%s\": {\"calls\": %llu, \"ticks\": %llu, \"ns\": %.1f}", k > 0 ? ", " : "", timerNames[k],
+                (unsigned long long)total.calls[k], (unsigned long long)total.ticks[k], total.ticks[k] * nsPerTick);
+    }
+    fprintf(out, "}}\n");
+    if (out != stderr)
+    {
+        fclose(out);
+    }
+}
+
+STATS_BLOCK *attachStats(void)
+{
+    STATS_BLOCK *block = (STATS_BLOCK *)calloc(1, sizeof(STATS_BLOCK));
+    if (block == NULL)
+    {
+        // The events of the thread are still counted, in a block left out of the dump
+        threadStats = &spareStats;
+        return threadStats;
+    }
+    pthread_mutex_lock(&statsLock);
+    if (allStats == NULL)
+    {
+        startTicks = STATS_TICKS();
+        startClock = statsClock();
+        atexit(dumpStats);
+    }
+    block->next = allStats;
+    allStats = block;
+    pthread_mutex_unlock(&statsLock);
+    threadStats = block;
+    return block;
+}
+
+#endif // STATS
@@ -0,0 +1,143 @@
+/**
+ * @file stats.h
+ * @brief Declarations of the statistics counters and timers of the game and the solver.
+ *
+ * The counters and timers only exist in a build with -DSTATS (make STATS=1, after make clean);
+ * otherwise every macro below expands to nothing and costs nothing. When they exist, every
+ * thread counts in its own block, allocated on its first event and never shared, so the hot
+ * paths add a plain increment and no atomic operation. The timers read the time stamp counter
+ * of the processor (a monotonic clock in nanoseconds elsewhere) before and after the code they
+ * surround. At exit the blocks of every thread are summed and written as one JSON object:
+ *
+ *     {"clock": "tsc", "ns-per-tick": 0.357, "threads": 2,
+ *      "counters": {"moves": 52, "accepted": 47, "out-of-range": 2, ...},
+ *      "timers": {"validate": {"calls": 54, "ticks": 2310, "ns": 824.7}, ...}}
+ *
+ * to the file named by the LATINSQUARE_STATS environment variable, or to the standard error.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Events counted.
+ */
+typedef enum
+{
+    STAT_MOVES,        /**< Moves applied by a player: play(), scripts and the server */
+    STAT_UNDOS,        /**< Moves undone */
+    STAT_REDOS,        /**< Moves redone */
+    STAT_ACCEPTED,     /**< Moves validated; the next five follow the order of MOVE_STATUS */
+    STAT_OUT_OF_RANGE, /**< Moves rejected as MOVE_OUT_OF_RANGE */
+    STAT_PROTECTED,    /**< Moves rejected as MOVE_PROTECTED */
+    STAT_OCCUPIED,     /**< Moves rejected as MOVE_OCCUPIED */
+    STAT_DUPLICATE,    /**< Moves rejected as MOVE_DUPLICATE */
+    STAT_DEAD_END,     /**< Moves rejected as MOVE_DEAD_END */
+    STAT_NODES,        /**< Nodes of the solver searches */
+    STAT_BACKTRACKS,   /**< Nodes whose propagation reached a contradiction */
+    STAT_PROPAGATIONS, /**< Values placed by the propagation (naked and hidden singles) */
+    STAT_SOLUTIONS,    /**< Completions reached by the searches */
+    STAT_COUNTERS      /**< Number of counters */
+} STAT_COUNTER;
+
+/**
+ * @brief Code timed.
+ */
+typedef enum
+{
+    TIMER_LOAD,      /**< Loading a game file */
+    TIMER_VALIDATE,  /**< validateMove() */
+    TIMER_RENDER,    /**< Drawing the board */
+    TIMER_PROPAGATE, /**< The propagation of a solver node */
+    TIMER_SEARCH,    /**< A whole search for completions or count */
+    STAT_TIMERS      /**< Number of timers */
+} STAT_TIMER;
+
+/**
+ * @brief Represents the counters and timers of one thread.
+ */
+typedef struct statsblock
+{
+    uint64_t counts[STAT_COUNTERS]; /**< Events counted */
+    uint64_t calls[STAT_TIMERS];    /**< Runs of the timed code */
+    uint64_t ticks[STAT_TIMERS];    /**< Clock ticks spent in the timed code */
+    struct statsblock *next;        /**< The block of another thread */
+} STATS_BLOCK;
+
+/**
+ * @brief Returns the name of a counter in the JSON dump.
+ *
+ * @param counter The counter.
+ * @return A lowercase name without spaces, e.g. "backtracks".
+ */
+const char *statCounterName(STAT_COUNTER counter);
+
+/**
+ * @brief Returns the name of a timer in the JSON dump.
+ *
+ * @param timer The timer.
+ * @return A lowercase name without spaces, e.g. "propagate".
+ */
+const char *statTimerName(STAT_TIMER timer);
+
+#ifdef STATS
+
+extern __thread STATS_BLOCK *threadStats; // The block of the calling thread, NULL before its first event
+
+/**
+ * @brief Allocates the block of the calling thread, and registers the dump at exit on the first call.
+ *
+ * When the block cannot be allocated the thread counts in a block of its own that is not dumped,
+ * so the counters never end the program.
+ *
+ * @return The block.
+ */
+STATS_BLOCK *attachStats(void);
+
+/**
+ * @brief Returns the block of the calling thread.
+ *
+ * @return The block.
+ */
+static inline STATS_BLOCK *localStats(void)
+{
+    return threadStats != NULL ? threadStats : attachStats();
+}
+
+/**
+ * @brief Reads the clock of the timers.
+ *
+ * @return The time stamp counter, or nanoseconds where there is none.
+ */
+uint64_t statsClock(void);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STATS_TICKS() __builtin_ia32_rdtsc()
+#else
+#define STATS_TICKS() statsClock()
+#endif
+
+#define STATS_COUNT(counter) (localStats()->counts[counter]++)           // Counts one event
+#define STATS_ADD(counter, n) (localStats()->counts[counter] += (n))     // Counts several events
+#define STATS_START(timer) uint64_t timer##_START = STATS_TICKS()        // Starts a timer in a block
+#define STATS_STOP(timer)                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        STATS_BLOCK *block_ = localStats();                                                                            \
+        block_->calls[timer]++;                                                                                        \
+        block_->ticks[timer] += STATS_TICKS() - timer##_START;                                                         \
+    } while (0) // Stops a timer started in the same block
+
+#else
+
+#define STATS_COUNT(counter) ((void)0)
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_START(timer) ((void)0)
+#define STATS_STOP(timer) ((void)0)
+
+#endif // STATS
+
+#endif // STATS_H
@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L // For sysconf and sched_yield
+
+#include "threadpool.h"
+#include <sched.h>
+#include <unistd.h>
+
+#define INITIAL_DEQUE_CAPACITY 64 // Tasks a deque holds before growing
+
+/**
+ * @brief Represents the argument of a worker thread.
+ */
+typedef struct worker
+{
+    POOL *pool; /**< The pool the worker belongs to */
+    int index;  /**< Its index in the pool */
+} WORKER;
+
+/**
+ * @brief Pushes a task at the bottom of a deque, growing it if needed.
+ *
+ * @param deque The deque.
+ * @param task The task to push.
+ */
+static void pushBottom(DEQUE *deque, TASK task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity)
+    {
+        TASK *tasks = (TASK *)malloc(2 * deque->capacity * sizeof(TASK));
+        if (tasks == NULL)
+        {
+            perror("Failed to allocate task memory!");
+            exit(EXIT_FAILURE);
+        }
+        for (int k = 0; k < deque->count; k++)
+        {
+            tasks[k] = deque->tasks[(deque->head + k) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->capacity *= 2;
+    }
+    deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/**
+ * @brief Pops the newest task from the bottom of a deque (owner side).
+ *
+ * @param deque The deque.
+ * @param task Receives the task.
+ * @return true if a task was taken, false if the deque was empty.
+ */
+static bool popBottom(DEQUE *deque, TASK *task)
+{
+    bool taken = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0)
+    {
+        deque->count--;
+        *task = deque->tasks[(deque->head + deque->count) % deque->capacity];
+        taken = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+/**
+ * @brief Steals the oldest task from the top of a deque (thief side).
+ *
+ * @param deque The deque.
+ * @param task Receives the task.
+ * @return true if a task was taken, false if the deque was empty.
+ */
+static bool stealTop(DEQUE *deque, TASK *task)
+{
+    bool taken = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0)
+    {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+        taken = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+/**
+ * @brief Takes a task from the worker's own deque, or steals one from another worker.
+ *
+ * @param pool The pool.
+ * @param index The index of the worker looking for work.
+ * @param task Receives the task.
+ * @return true if a task was found, false otherwise.
+ */
+static bool findTask(POOL *pool, int index, TASK *task)
+{
+    if (popBottom(&pool->deques[index], task))
+    {
+        return true;
+    }
+    for (int k = 1; k < pool->threads; k++)
+    {
+        if (stealTop(&pool->deques[(index + k) % pool->threads], task))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Runs one queued task, keeping the pool counters up to date.
+ *
+ * @param pool The pool.
+ * @param index The index of the worker running the task.
+ * @return true if a task was run, false if no task was found.
+ */
+static bool runOneTask(POOL *pool, int index)
+{
+    TASK task;
+    if (!findTask(pool, index, &task))
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued--;
+    pthread_mutex_unlock(&pool->lock);
+
+    task.run(pool, index, task.arg);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->outstanding == 0)
+    {
+        pthread_cond_broadcast(&pool->doneCond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+/**
+ * @brief Main loop of a worker thread: run tasks until the pool shuts down.
+ *
+ * @param arg The WORKER describing this thread.
+ * @return Always NULL.
+ */
+static void *workerLoop(void *arg)
+{
+    WORKER *self = (WORKER *)arg;
+    POOL *pool = self->pool;
+
+    while (true)
+    {
+        if (runOneTask(pool, self->index))
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (pool->shutdown)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        if (pool->queued == 0)
+        {
+            pthread_cond_wait(&pool->workCond, &pool->lock);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        else
+        {
+            // A task is being taken by another worker, try again shortly
+            pthread_mutex_unlock(&pool->lock);
+            sched_yield();
+        }
+    }
+}
+
+int processorCount(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count < 1 ? 1 : (int)count;
+}
+
+POOL *createPool(int threads)
+{
+    if (threads < 1)
+    {
+        threads = processorCount();
+    }
+
+    POOL *pool = (POOL *)malloc(sizeof(POOL));
+    if (pool == NULL)
+    {
+        perror("Failed to allocate pool memory!");
+        exit(EXIT_FAILURE);
+    }
+    pool->threads = threads;
+    pool->ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    pool->workers = (WORKER *)malloc(threads * sizeof(WORKER));
+    pool->deques = (DEQUE *)malloc(threads * sizeof(DEQUE));
+    if (pool->ids == NULL || pool->workers == NULL || pool->deques == NULL)
+    {
+        perror("Failed to allocate pool memory!");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->workCond, NULL);
+    pthread_cond_init(&pool->doneCond, NULL);
+    pool->queued = 0;
+    pool->outstanding = 0;
+    pool->nextDeque = 0;
+    pool->shutdown = false;
+
+    for (int k = 0; k < threads; k++)
+    {
+        DEQUE *deque = &pool->deques[k];
+        deque->tasks = (TASK *)malloc(INITIAL_DEQUE_CAPACITY * sizeof(TASK));
+        if (deque->tasks == NULL)
+        {
+            perror("Failed to allocate task memory!");
+            exit(EXIT_FAILURE);
+        }
+        deque->capacity = INITIAL_DEQUE_CAPACITY;
+        deque->head = 0;
+        deque->count = 0;
+        pthread_mutex_init(&deque->lock, NULL);
+    }
+
+    for (int k = 0; k < threads; k++)
+    {
+        pool->workers[k].pool = pool;
+        pool->workers[k].index = k;
+        if (pthread_create(&pool->ids[k], NULL, workerLoop, &pool->workers[k]) != 0)
+        {
+            perror("Failed to start worker thread!");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+void submitTask(POOL *pool, int worker, TASK_FUNCTION run, void *arg)
+{
+    TASK task = {run, arg};
+
+    pthread_mutex_lock(&pool->lock);
+    pool->outstanding++;
+    if (worker < 0)
+    {
+        worker = pool->nextDeque; // Spread external submissions over the deques
+        pool->nextDeque = (pool->nextDeque + 1) % pool->threads;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    pushBottom(&pool->deques[worker], task);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pthread_cond_signal(&pool->workCond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void helpUntilDone(POOL *pool, int worker, int *pending)
+{
+    while (__atomic_load_n(pending, __ATOMIC_ACQUIRE) > 0)
+    {
+        if (!runOneTask(pool, worker))
+        {
+            sched_yield(); // The remaining tasks are running on other workers
+        }
+    }
+}
+
+void waitPool(POOL *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->outstanding > 0)
+    {
+        pthread_cond_wait(&pool->doneCond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void freePool(POOL *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->workCond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int k = 0; k < pool->threads; k++)
+    {
+        pthread_join(pool->ids[k], NULL);
+    }
+
+    for (int k = 0; k < pool->threads; k++)
+    {
+        free(pool->deques[k].tasks);
+        pthread_mutex_destroy(&pool->deques[k].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->workCond);
+    pthread_cond_destroy(&pool->doneCond);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool->ids);
+    free(pool);
+}
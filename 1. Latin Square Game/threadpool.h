@@ -0,0 +1,120 @@
+/**
+ * @file threadpool.h
+ * @brief Declarations of a work-stealing thread pool with one task deque per worker.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct pool;
+
+/**
+ * @brief Signature of a task function.
+ *
+ * @param pool The pool running the task, so the task can submit more work.
+ * @param worker The index of the worker running the task.
+ * @param arg The argument given when the task was submitted.
+ */
+typedef void (*TASK_FUNCTION)(struct pool *pool, int worker, void *arg);
+
+/**
+ * @brief Represents a unit of work waiting in a deque.
+ */
+typedef struct task
+{
+    TASK_FUNCTION run; /**< The function to execute */
+    void *arg;         /**< Its argument */
+} TASK;
+
+/**
+ * @brief Represents the double-ended task queue of one worker.
+ *
+ * The owner pushes and pops at the bottom (newest task first, depth-first order),
+ * idle workers steal from the top (oldest and usually largest task first).
+ */
+typedef struct deque
+{
+    TASK *tasks;          /**< Ring buffer of tasks */
+    int capacity;         /**< Size of the ring buffer */
+    int head;             /**< Index of the top task */
+    int count;            /**< Number of tasks in the deque */
+    pthread_mutex_t lock; /**< Protects the deque */
+} DEQUE;
+
+/**
+ * @brief Represents the thread pool.
+ */
+typedef struct pool
+{
+    int threads;              /**< Number of worker threads */
+    pthread_t *ids;           /**< Thread ids of the workers */
+    struct worker *workers;   /**< Per-worker arguments */
+    DEQUE *deques;            /**< One deque per worker */
+    pthread_mutex_t lock;     /**< Protects the counters below */
+    pthread_cond_t workCond;  /**< Signalled when a task is queued or on shutdown */
+    pthread_cond_t doneCond;  /**< Signalled when no task is outstanding */
+    int queued;               /**< Tasks waiting in the deques */
+    int outstanding;          /**< Tasks submitted but not finished */
+    int nextDeque;            /**< Round robin position for external submissions */
+    bool shutdown;            /**< Tells the workers to exit */
+} POOL;
+
+/**
+ * @brief Returns the number of online processors, at least 1.
+ *
+ * @return int The number of processors.
+ */
+int processorCount(void);
+
+/**
+ * @brief Creates a pool and starts its worker threads.
+ *
+ * @param threads The number of workers. Values below 1 use one worker per processor.
+ * @return POOL* The new pool. The program exits if it cannot be created.
+ */
+POOL *createPool(int threads);
+
+/**
+ * @brief Submits a task to the pool.
+ *
+ * @param pool The pool.
+ * @param worker The index of the submitting worker, so the task lands on its own deque,
+ *               or -1 when submitting from outside the pool.
+ * @param run The task function.
+ * @param arg Its argument. The task is responsible for releasing it.
+ */
+void submitTask(POOL *pool, int worker, TASK_FUNCTION run, void *arg);
+
+/**
+ * @brief Waits inside a task until a counter of sub-tasks drops to zero.
+ *
+ * Instead of blocking, the waiting worker keeps running queued tasks (its own first, then
+ * stolen ones), so a task can fork sub-tasks and join them without idling a worker.
+ * The sub-tasks must decrement the counter atomically when they finish.
+ *
+ * @param pool The pool.
+ * @param worker The index of the waiting worker.
+ * @param pending The number of unfinished sub-tasks.
+ */
+void helpUntilDone(POOL *pool, int worker, int *pending);
+
+/**
+ * @brief Blocks until every submitted task (and every task they submitted) has finished.
+ *
+ * @param pool The pool.
+ */
+void waitPool(POOL *pool);
+
+/**
+ * @brief Stops the workers and releases the pool. Pending tasks are not run.
+ *
+ * @param pool The pool.
+ */
+void freePool(POOL *pool);
+
+#endif // THREADPOOL_H
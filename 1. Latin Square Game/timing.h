@@ -0,0 +1,25 @@
+/**
+ * @file timing.h
+ * @brief The monotonic clock used to time the batch, search and generation modes.
+ *
+ * clock_gettime() is POSIX: a file including this header defines _POSIX_C_SOURCE first.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <time.h>
+
+/**
+ * @brief Returns a monotonic time stamp.
+ *
+ * @return The time in seconds.
+ */
+static inline double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#endif // TIMING_H
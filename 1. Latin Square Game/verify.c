@@ -0,0 +1,229 @@
+#include "verify.h"
+#include "kernels.h"
+
+#define TRANSPOSE_TILE 16 // Side of the blocks of the transposition: 16 rows of 32 bytes
+#define LANE_COUNT 8      // Values per vector
+
+/**
+ * @brief A vector of LANE_COUNT values, compiled to one SIMD register where the target has them.
+ */
+typedef uint16_t LANES __attribute__((vector_size(2 * LANE_COUNT)));
+
+/**
+ * @brief Loads LANE_COUNT consecutive values, whatever their alignment.
+ *
+ * @param values The first value.
+ * @return The vector of the values.
+ */
+static inline LANES loadLanes(const uint16_t *values)
+{
+    LANES lanes;
+    memcpy(&lanes, values, sizeof(lanes));
+    return lanes;
+}
+
+/**
+ * @brief Tells whether any lane of a vector is not zero.
+ *
+ * @param lanes The vector.
+ * @return true if a lane is not zero.
+ */
+static inline bool anyLane(LANES lanes)
+{
+    uint64_t words[sizeof(LANES) / sizeof(uint64_t)];
+    memcpy(words, &lanes, sizeof(words));
+    return (words[0] | words[1]) != 0;
+}
+
+/**
+ * @brief Finds the first row of a square in range that is not a permutation.
+ *
+ * Up to order 64 a row is folded into one bitmap word, with two accumulators so the ORs do not
+ * wait on each other. Larger rows stamp their values into an array with independent stores,
+ * and the array is then compared with the stamp in one vectorizable pass.
+ *
+ * @param values The size * size values, row by row, each in [1..size].
+ * @param size The order of the square.
+ * @param stamps The stamp of each value, holding no stamp above base.
+ * @param base The stamp of the first row minus 1; row i stamps base + i + 1.
+ * @return The index of the row, or -1 if every row is a permutation.
+ */
+static int firstBadRow(const uint16_t *values, int size, uint16_t *stamps, int base)
+{
+    uint64_t full[BITSET_WORDS(MAX_SIZE)];
+    fillValues(full, size);
+
+    for (int i = 0; i < size; i++)
+    {
+        const uint16_t *row = values + (size_t)i * size;
+        uint64_t missing = 0;
+        if (size <= WORD_BITS)
+        {
+            uint64_t even = 0, odd = 0;
+            int j = 0;
+            for (; j + 1 < size; j += 2)
+            {
+                even |= (uint64_t)1 << (row[j] - 1);
+                odd |= (uint64_t)1 << (row[j + 1] - 1);
+            }
+            if (j < size)
+            {
+                even |= (uint64_t)1 << (row[j] - 1);
+            }
+            missing = (even | odd) ^ full[0];
+        }
+        else
+        {
+            uint16_t stamp = (uint16_t)(base + i + 1);
+            for (int j = 0; j < size; j++)
+            {
+                stamps[row[j]] = stamp;
+            }
+            LANES differ = {0};
+            int v = 1;
+            for (; v + LANE_COUNT <= size + 1; v += LANE_COUNT)
+            {
+                differ |= loadLanes(stamps + v) ^ stamp;
+            }
+            for (; v <= size; v++)
+            {
+                missing |= stamps[v] ^ stamp;
+            }
+            missing |= anyLane(differ);
+        }
+        if (missing != 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Transposes a square by blocks, so both the reads and the writes stay within a few lines.
+ *
+ * @param values The size * size values, row by row.
+ * @param transposed Receives the values column by column.
+ * @param size The order of the square.
+ */
+static void transposeSquare(const uint16_t *values, uint16_t *transposed, int size)
+{
+    for (int ii = 0; ii < size; ii += TRANSPOSE_TILE)
+    {
+        int iEnd = ii + TRANSPOSE_TILE < size ? ii + TRANSPOSE_TILE : size;
+        for (int jj = 0; jj < size; jj += TRANSPOSE_TILE)
+        {
+            int jEnd = jj + TRANSPOSE_TILE < size ? jj + TRANSPOSE_TILE : size;
+            for (int i = ii; i < iEnd; i++)
+            {
+                for (int j = jj; j < jEnd; j++)
+                {
+                    transposed[(size_t)j * size + i] = values[(size_t)i * size + j];
+                }
+            }
+        }
+    }
+}
+
+VERIFY_STATUS verifySquare(const uint16_t *values, int size, uint16_t *scratch, int *line)
+{
+    const KERNEL *kernel = findKernel(size);
+    if (kernel != NULL)
+    {
+        return kernel->verify(values, line);
+    }
+
+    size_t cells = (size_t)size * size;
+
+    // One branch-free pass: empty cells wrap around to 0xFFFF, so both errors are caught
+    LANES outside = {0};
+    size_t k = 0;
+    for (; k + LANE_COUNT <= cells; k += LANE_COUNT)
+    {
+        outside |= (LANES)(loadLanes(values + k) - 1 >= (uint16_t)size);
+    }
+    bool bad = anyLane(outside);
+    for (; k < cells; k++)
+    {
+        bad |= (uint16_t)(values[k] - 1) >= (unsigned)size;
+    }
+    if (bad)
+    {
+        k = 0;
+        while ((uint16_t)(values[k] - 1) < (unsigned)size)
+        {
+            k++;
+        }
+        *line = (int)(k / size);
+        return values[k] == 0 ? VERIFY_INCOMPLETE : VERIFY_OUT_OF_RANGE;
+    }
+
+    // The rows stamp 1..size and the columns size+1..2*size, so the stamps are cleared once
+    uint16_t stamps[MAX_SIZE + 1] = {0};
+    *line = firstBadRow(values, size, stamps, 0);
+    if (*line >= 0)
+    {
+        return VERIFY_ROW;
+    }
+    transposeSquare(values, scratch, size);
+    *line = firstBadRow(scratch, size, stamps, size);
+    return *line >= 0 ? VERIFY_COLUMN : VERIFY_OK;
+}
+
+const char *verifyStatusName(VERIFY_STATUS status)
+{
+    switch (status)
+    {
+    case VERIFY_OK:
+        return "valid";
+    case VERIFY_INCOMPLETE:
+        return "incomplete";
+    case VERIFY_OUT_OF_RANGE:
+        return "out-of-range";
+    case VERIFY_ROW:
+        return "row-duplicate";
+    case VERIFY_COLUMN:
+        return "column-duplicate";
+    }
+    return "unknown";
+}
+
+LOAD_STATUS readSquareValues(const char *filename, uint16_t *values, int *size)
+{
+    char *data;
+    size_t length;
+    LOAD_STATUS status = readGameFile(filename, &data, &length);
+    if (status != LOAD_OK)
+    {
+        return status;
+    }
+
+    const char *text = data;
+    const char *end = data + length;
+    int order;
+    if (!scanGameNumber(&text, end, &order) || order < 1 || order > MAX_SIZE)
+    {
+        free(data);
+        return LOAD_INVALID_SIZE;
+    }
+    *size = order;
+
+    size_t cells = (size_t)order * order;
+    for (size_t k = 0; k < cells; k++)
+    {
+        int value;
+        if (!scanGameNumber(&text, end, &value))
+        {
+            status = LOAD_INVALID_VALUE;
+            break;
+        }
+        values[k] = (uint16_t)abs(value);
+    }
+    int extra;
+    if (status == LOAD_OK && scanGameNumber(&text, end, &extra))
+    {
+        status = LOAD_EXTRA_DATA;
+    }
+    free(data);
+    return status;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file verify.h
+ * @brief Declarations of the verification of completed Latin squares given as flat arrays of values.
+ *
+ * A square is verified straight from its values, without building a game: one pass checks that
+ * every value is in [1..size], then every row is folded into a bitmap of the values it holds
+ * (or, beyond order 64, into an array of stamps) and compared with the full set, which is only
+ * equal when the row is a permutation. The columns are copied to rows by a blocked
+ * transposition, so they are checked by the same sequential loop instead of striding through
+ * the board.
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "latinsquare.h"
+
+#define VERIFY_CELLS ((size_t)MAX_SIZE * MAX_SIZE) // Values a verification buffer holds
+
+/**
+ * @brief Outcome of verifying a square.
+ */
+typedef enum
+{
+    VERIFY_OK,           /**< Every row and column is a permutation of [1..size] */
+    VERIFY_INCOMPLETE,   /**< A cell is empty */
+    VERIFY_OUT_OF_RANGE, /**< A value is outside [1..size] */
+    VERIFY_ROW,          /**< A value repeats in a row */
+    VERIFY_COLUMN        /**< A value repeats in a column */
+} VERIFY_STATUS;
+
+/**
+ * @brief Verifies that a square is a completed Latin square.
+ *
+ * @param values The size * size values, row by row, without sign.
+ * @param size The order of the square.
+ * @param scratch A buffer of size * size values receiving the transposed square.
+ * @param line Receives the first row (column for VERIFY_COLUMN) breaking the rule, 0-based.
+ * @return VERIFY_OK for a Latin square, otherwise the first rule broken.
+ */
+VERIFY_STATUS verifySquare(const uint16_t *values, int size, uint16_t *scratch, int *line);
+
+/**
+ * @brief Returns a short name for the outcome of verifying a square.
+ *
+ * @param status The outcome returned by verifySquare().
+ * @return A lowercase name without spaces, e.g. "row-duplicate".
+ */
+const char *verifyStatusName(VERIFY_STATUS status);
+
+/**
+ * @brief Reads the values of a game file without building a game.
+ *
+ * The file is read by readGameFile() and its numbers by scanGameNumber(), as loadLatinSquare()
+ * does; the signs of the values are dropped and values beyond MAX_SIZE are stored as
+ * MAX_SIZE + 1, so they are still reported as out of range.
+ *
+ * @param filename The name of the game file.
+ * @param values Receives the values, at least VERIFY_CELLS of them.
+ * @param size Receives the order of the square.
+ * @return LOAD_OK on success, otherwise LOAD_OPEN_FAILED, LOAD_NO_MEMORY, LOAD_INVALID_SIZE,
+ *         LOAD_INVALID_VALUE or LOAD_EXTRA_DATA.
+ */
+LOAD_STATUS readSquareValues(const char *filename, uint16_t *values, int *size);
+
+#endif // VERIFY_H